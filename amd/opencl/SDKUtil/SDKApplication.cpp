@@ -20,10 +20,10 @@ int
 SDKSample::initialize()
 {
     sampleCommon = new streamsdk::SDKCommon();
-    int defaultOptions = 10;
+    int defaultOptions = 15;
 
     if(multiDevice)
-        defaultOptions = 9;
+        defaultOptions = 14;
 
     
     streamsdk::Option *optionList = new streamsdk::Option[defaultOptions];
@@ -88,13 +88,43 @@ SDKSample::initialize()
     optionList[8]._type = streamsdk::CA_NO_ARGUMENT;
     optionList[8]._value = &version;
 
+    optionList[9]._sVersion = "";
+    optionList[9]._lVersion = "benchmark";
+    optionList[9]._description = "Benchmark mode. Write stats and phase timings as [json|csv].";
+    optionList[9]._type = streamsdk::CA_ARG_STRING;
+    optionList[9]._value = &benchFormat;
+
+    optionList[10]._sVersion = "";
+    optionList[10]._lVersion = "benchWarmup";
+    optionList[10]._description = "Number of untimed warm-up runs in benchmark mode.";
+    optionList[10]._type = streamsdk::CA_ARG_INT;
+    optionList[10]._value = &benchWarmup;
+
+    optionList[11]._sVersion = "";
+    optionList[11]._lVersion = "benchRuns";
+    optionList[11]._description = "Number of measured runs in benchmark mode.";
+    optionList[11]._type = streamsdk::CA_ARG_INT;
+    optionList[11]._value = &benchRuns;
+
+    optionList[12]._sVersion = "";
+    optionList[12]._lVersion = "benchFile";
+    optionList[12]._description = "Append benchmark records to a file instead of stdout.";
+    optionList[12]._type = streamsdk::CA_ARG_STRING;
+    optionList[12]._value = &benchFile;
+
+    optionList[13]._sVersion = "";
+    optionList[13]._lVersion = "trace";
+    optionList[13]._description = "Write host phases and profiled OpenCL commands to a Chrome trace file.";
+    optionList[13]._type = streamsdk::CA_ARG_STRING;
+    optionList[13]._value = &traceFile;
+
     if(multiDevice == false)
     {
-        optionList[9]._sVersion = "d";
-        optionList[9]._lVersion = "deviceId";
-        optionList[9]._description = "Select deviceId to be used[0 to N-1 where N is number devices available].";
-        optionList[9]._type = streamsdk::CA_ARG_INT;
-        optionList[9]._value = &deviceId;
+        optionList[14]._sVersion = "d";
+        optionList[14]._lVersion = "deviceId";
+        optionList[14]._description = "Select deviceId to be used[0 to N-1 where N is number devices available].";
+        optionList[14]._type = streamsdk::CA_ARG_INT;
+        optionList[14]._value = &deviceId;
     }
 
     sampleArgs = new streamsdk::SDKCommandArgs(defaultOptions, optionList);
@@ -105,6 +135,9 @@ SDKSample::initialize()
 
 void SDKSample::printStats(std::string *statsStr, std::string * stats, int n)
 {
+    if(isBenchmarkEnabled())
+        writeBenchmarkRecord(statsStr, stats, n);
+
     if(timing)
     {
         streamsdk::Table sampleStats;
@@ -130,6 +163,211 @@ void SDKSample::printStats(std::string *statsStr, std::string * stats, int n)
     }
 }
 
+/* Escapes a string for a JSON value */
+static std::string
+jsonEscape(const std::string &str)
+{
+    std::string escaped;
+    for(size_t i = 0; i < str.size(); ++i)
+    {
+        if(str[i] == '"' || str[i] == '\\')
+            escaped.append(1, '\\');
+        if((unsigned char)str[i] < 0x20)
+            escaped.append(1, ' ');
+        else
+            escaped.append(1, str[i]);
+    }
+    return escaped;
+}
+
+/* Quotes a string for a CSV field */
+static std::string
+csvQuote(const std::string &str)
+{
+    std::string quoted("\"");
+    for(size_t i = 0; i < str.size(); ++i)
+    {
+        if(str[i] == '"')
+            quoted.append(1, '"');
+        quoted.append(1, str[i]);
+    }
+    quoted.append("\"");
+    return quoted;
+}
+
+void SDKSample::beginPhase(const std::string &phase)
+{
+    size_t i = 0;
+    while(i < phaseNames.size() && phaseNames[i] != phase)
+        ++i;
+
+    if(i == phaseNames.size())
+    {
+        phaseNames.push_back(phase);
+        phaseTimers.push_back(sampleCommon->createTimer());
+        phaseTraceBegin.push_back(0);
+    }
+
+    sampleCommon->startTimer(phaseTimers[i]);
+
+    streamsdk::SDKTrace &trace = streamsdk::SDKTrace::getInstance();
+    if(trace.isEnabled())
+        phaseTraceBegin[i] = trace.now();
+}
+
+void SDKSample::endPhase(const std::string &phase)
+{
+    for(size_t i = 0; i < phaseNames.size(); ++i)
+    {
+        if(phaseNames[i] == phase)
+        {
+            sampleCommon->stopTimer(phaseTimers[i]);
+
+            streamsdk::SDKTrace &trace = streamsdk::SDKTrace::getInstance();
+            if(trace.isEnabled() && phaseTraceBegin[i] != 0)
+                trace.addHostScope(phase, phaseTraceBegin[i], trace.now());
+            return;
+        }
+    }
+}
+
+void SDKSample::writeBenchmarkRecord(std::string *statsStr, std::string *stats, int n)
+{
+    std::ofstream benchStream;
+    bool newFile = true;
+    if(benchFile.size() != 0)
+    {
+        std::ifstream existing(benchFile.c_str());
+        newFile = !existing.good() || existing.peek() == std::ifstream::traits_type::eof();
+        existing.close();
+
+        benchStream.open(benchFile.c_str(), std::ios::out | std::ios::app);
+        if(!benchStream.is_open())
+        {
+            std::cout << "Error. Cannot open benchmark file : " << benchFile << std::endl;
+            return;
+        }
+    }
+    std::ostream &out = benchFile.size() != 0 ? benchStream : std::cout;
+    out << std::setprecision(9);
+
+    const char *fields[] = {"runs", "total", "min", "max", "mean", "median", "p99", "stddev"};
+    const int numFields = sizeof(fields) / sizeof(fields[0]);
+
+    if(benchFormat.compare("json") == 0)
+    {
+        // One JSON object per line, so records can be appended
+        out << "{\"sample\":\"" << jsonEscape(name) << "\""
+            << ",\"device\":\"" << jsonEscape(deviceType) << "\""
+            << ",\"warmup\":" << benchWarmup
+            << ",\"runs\":" << benchRuns
+            << ",\"stats\":{";
+        for(int i = 0; i < n && statsStr != NULL && stats != NULL; ++i)
+        {
+            out << (i ? "," : "") << "\"" << jsonEscape(statsStr[i]) << "\":\""
+                << jsonEscape(stats[i]) << "\"";
+        }
+        out << "},\"phases\":{";
+        for(size_t i = 0; i < phaseNames.size(); ++i)
+        {
+            streamsdk::TimerStats phaseStats;
+            sampleCommon->getTimerStats(phaseTimers[i], phaseStats);
+            double values[] = {(double)phaseStats.count, phaseStats.total, phaseStats.min,
+                               phaseStats.max, phaseStats.mean, phaseStats.median,
+                               phaseStats.p99, phaseStats.stddev};
+
+            out << (i ? "," : "") << "\"" << jsonEscape(phaseNames[i]) << "\":{";
+            for(int j = 0; j < numFields; ++j)
+                out << (j ? "," : "") << "\"" << fields[j] << "\":" << values[j];
+            out << "}";
+        }
+        out << "}}" << std::endl;
+    }
+    else
+    {
+        // Long format : one value per row
+        if(newFile)
+            out << "sample,device,section,name,field,value" << std::endl;
+
+        std::string prefix = csvQuote(name) + "," + csvQuote(deviceType) + ",";
+        for(int i = 0; i < n && statsStr != NULL && stats != NULL; ++i)
+        {
+            out << prefix << "stat," << csvQuote(statsStr[i]) << ",value,"
+                << csvQuote(stats[i]) << std::endl;
+        }
+        for(size_t i = 0; i < phaseNames.size(); ++i)
+        {
+            streamsdk::TimerStats phaseStats;
+            sampleCommon->getTimerStats(phaseTimers[i], phaseStats);
+            double values[] = {(double)phaseStats.count, phaseStats.total, phaseStats.min,
+                               phaseStats.max, phaseStats.mean, phaseStats.median,
+                               phaseStats.p99, phaseStats.stddev};
+
+            for(int j = 0; j < numFields; ++j)
+            {
+                out << prefix << "phase," << csvQuote(phaseNames[i]) << ","
+                    << fields[j] << "," << values[j] << std::endl;
+            }
+        }
+    }
+
+    benchRecorded = true;
+}
+
+int SDKSample::execute()
+{
+    int status = SDK_SUCCESS;
+
+    beginPhase("setup");
+    status = setup();
+    endPhase("setup");
+    if(status != SDK_SUCCESS)
+        return status;
+
+    int warmup = isBenchmarkEnabled() ? benchWarmup : 0;
+    int runs = isBenchmarkEnabled() ? benchRuns : 1;
+
+    // Only setup may report SDK_EXPECTED_FAILURE (unsupported device),
+    // any failure after it is a real one
+    for(int i = 0; i < warmup; ++i)
+    {
+        status = run();
+        if(status != SDK_SUCCESS)
+            return SDK_FAILURE;
+    }
+
+    // Drop phases timed by the sample during the warm-up runs
+    for(size_t i = 0; i < phaseNames.size() && warmup != 0; ++i)
+    {
+        if(phaseNames[i] != "setup")
+            sampleCommon->resetTimer(phaseTimers[i]);
+    }
+
+    for(int i = 0; i < runs; ++i)
+    {
+        beginPhase("compute");
+        status = run();
+        endPhase("compute");
+        if(status != SDK_SUCCESS)
+            return SDK_FAILURE;
+    }
+
+    beginPhase("verify");
+    status = verifyResults();
+    endPhase("verify");
+    if(status != SDK_SUCCESS)
+        return SDK_FAILURE;
+
+    benchRecorded = false;
+    printStats();
+
+    // Samples that do not report stats through SDKSample::printStats
+    if(isBenchmarkEnabled() && !benchRecorded)
+        writeBenchmarkRecord(NULL, NULL, 0);
+
+    return SDK_SUCCESS;
+}
+
 int SDKSample::parseCommandLine(int argc, char**argv)
 {
     if(sampleArgs==NULL)
@@ -197,6 +435,24 @@ int SDKSample::parseCommandLine(int argc, char**argv)
         return SDK_FAILURE;
     }
 
+    if(isBenchmarkEnabled() && benchFormat.compare("json") != 0 && benchFormat.compare("csv") != 0)
+    {
+        std::cout << "Error. Invalid benchmark format. "
+                  << "only \"json\" or \"csv\" supported\n";
+        usage();
+        return SDK_FAILURE;
+    }
+
+    if(benchWarmup < 0 || benchRuns < 1)
+    {
+        std::cout << "Error. --benchWarmup should be >= 0 and --benchRuns >= 1\n";
+        usage();
+        return SDK_FAILURE;
+    }
+
+    if(traceFile.size() != 0)
+        streamsdk::SDKTrace::getInstance().enable(traceFile);
+
     if(loadBinary.size() != 0 && flags.size() != 0)
     {
         std::cout << "Error. --flags and --load options are mutually exclusive\n";
@@ -436,6 +692,9 @@ SDKSample::SDKSample(std::string sampleName, bool enableMultiDevice)
     enableDeviceId = false;
     gpu = true;
     amdPlatform = false;
+    benchWarmup = 1;
+    benchRuns = 5;
+    benchRecorded = false;
 }
 
 SDKSample::SDKSample(const char* sampleName, bool enableMultiDevice)
@@ -454,6 +713,9 @@ SDKSample::SDKSample(const char* sampleName, bool enableMultiDevice)
     enableDeviceId = false;
     gpu = true;
     amdPlatform = false;
+    benchWarmup = 1;
+    benchRuns = 5;
+    benchRecorded = false;
 }
 
 SDKSample::~SDKSample()
@@ -0,0 +1,321 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#include "SDKBinaryCache.hpp"
+#include "SDKCommon.hpp"
+#include "SDKFile.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define GETPID _getpid
+#else
+#include <unistd.h>
+#define GETPID getpid
+#endif
+
+namespace streamsdk
+{
+
+/**
+ * Magic string at the start of every cache entry.
+ * Bump the version when the entry layout changes.
+ */
+static const char cacheMagic[8] = {'S', 'D', 'K', 'B', 'I', 'N', '0', '1'};
+
+/**
+ * Layout of an entry:
+ * header | key (keySize bytes) | binary (binarySize bytes)
+ */
+typedef struct
+{
+    char magic[8];          /**< magic cacheMagic */
+    cl_ulong keySize;       /**< keySize size of the stored key */
+    cl_ulong binarySize;    /**< binarySize size of the stored binary */
+    cl_ulong binaryHash;    /**< binaryHash hash of the binary, detects truncation */
+} cacheHeader;
+
+/* 64-bit FNV-1a hash */
+static cl_ulong
+hashBytes(const char *data, size_t size, cl_ulong hash = 14695981039346656037ULL)
+{
+    for(size_t i = 0; i < size; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string
+toHex(cl_ulong value)
+{
+    char str[17];
+    static const char digits[] = "0123456789abcdef";
+    for(int i = 15; i >= 0; --i)
+    {
+        str[i] = digits[value & 0xF];
+        value >>= 4;
+    }
+    str[16] = '\0';
+    return std::string(str);
+}
+
+/* Appends a string valued device/platform parameter to the key */
+static int
+appendDeviceInfo(cl_device_id device, cl_device_info param, std::string &key)
+{
+    size_t size = 0;
+    cl_int status = clGetDeviceInfo(device, param, 0, NULL, &size);
+    if(status != CL_SUCCESS)
+        return SDK_FAILURE;
+
+    std::string value(size, '\0');
+    status = clGetDeviceInfo(device, param, size, &value[0], NULL);
+    if(status != CL_SUCCESS)
+        return SDK_FAILURE;
+
+    key.append(value.c_str());
+    key.append("|");
+    return SDK_SUCCESS;
+}
+
+SDKBinaryCache::SDKBinaryCache(const std::string &defaultDir)
+    : enabled_(true), cacheDir_(defaultDir)
+{
+    const char *env = getenv("SDK_BINARY_CACHE");
+    if(env != NULL && strcmp(env, "0") == 0)
+        enabled_ = false;
+
+    env = getenv("SDK_BINARY_CACHE_DIR");
+    if(env != NULL && env[0] != '\0')
+        cacheDir_ = env;
+
+    if(cacheDir_.size() != 0)
+    {
+        char last = cacheDir_[cacheDir_.size() - 1];
+        if(last != '/' && last != '\\')
+            cacheDir_.append("/");
+    }
+}
+
+int
+SDKBinaryCache::computeKey(cl_device_id device,
+                           const char *source,
+                           size_t sourceSize,
+                           const std::string &flags,
+                           std::string &key)
+{
+    key = "";
+    if(appendDeviceInfo(device, CL_DEVICE_NAME, key) != SDK_SUCCESS ||
+       appendDeviceInfo(device, CL_DEVICE_VENDOR, key) != SDK_SUCCESS ||
+       appendDeviceInfo(device, CL_DRIVER_VERSION, key) != SDK_SUCCESS ||
+       appendDeviceInfo(device, CL_DEVICE_VERSION, key) != SDK_SUCCESS)
+    {
+        return SDK_FAILURE;
+    }
+
+    cl_platform_id platform = NULL;
+    cl_int status = clGetDeviceInfo(device,
+                                    CL_DEVICE_PLATFORM,
+                                    sizeof(cl_platform_id),
+                                    &platform,
+                                    NULL);
+    if(status != CL_SUCCESS)
+        return SDK_FAILURE;
+
+    char platformVersion[256];
+    status = clGetPlatformInfo(platform,
+                               CL_PLATFORM_VERSION,
+                               sizeof(platformVersion),
+                               platformVersion,
+                               NULL);
+    if(status != CL_SUCCESS)
+        return SDK_FAILURE;
+
+    key.append(platformVersion);
+    key.append("|");
+    key.append(flags);
+    key.append("|");
+    key.append(toHex(hashBytes(source, sourceSize)));
+
+    return SDK_SUCCESS;
+}
+
+std::string
+SDKBinaryCache::entryPath(const std::string &key) const
+{
+    return cacheDir_ + toHex(hashBytes(key.data(), key.size())) + ".bin";
+}
+
+int
+SDKBinaryCache::load(const std::string &key,
+                     SDKFile &entryFile,
+                     const char *&binary,
+                     size_t &binarySize)
+{
+    if(!enabled_)
+        return SDK_FAILURE;
+
+    std::string path = entryPath(key);
+    if(!entryFile.map(path.c_str()))
+        return SDK_FAILURE;
+
+    const char *entry = entryFile.data();
+    size_t entrySize = entryFile.size();
+    cacheHeader header;
+    if(entrySize < sizeof(cacheHeader))
+        return SDK_FAILURE;
+    memcpy(&header, entry, sizeof(cacheHeader));
+
+    if(memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+       header.keySize != key.size() ||
+       entrySize != sizeof(cacheHeader) + header.keySize + header.binarySize)
+    {
+        entryFile.unmap();
+        remove(key);
+        return SDK_FAILURE;
+    }
+
+    // Different key hashing to the same file name
+    if(key.compare(0, key.size(), entry + sizeof(cacheHeader), (size_t)header.keySize) != 0)
+        return SDK_FAILURE;
+
+    const char *data = entry + sizeof(cacheHeader) + header.keySize;
+    if(hashBytes(data, (size_t)header.binarySize) != header.binaryHash)
+    {
+        entryFile.unmap();
+        remove(key);
+        return SDK_FAILURE;
+    }
+
+    binary = data;
+    binarySize = (size_t)header.binarySize;
+    return SDK_SUCCESS;
+}
+
+int
+SDKBinaryCache::store(const std::string &key, cl_program program, cl_device_id device)
+{
+    if(!enabled_)
+        return SDK_FAILURE;
+
+    cl_uint numDevices = 0;
+    cl_int status = clGetProgramInfo(program,
+                                     CL_PROGRAM_NUM_DEVICES,
+                                     sizeof(cl_uint),
+                                     &numDevices,
+                                     NULL);
+    if(status != CL_SUCCESS || numDevices == 0)
+        return SDK_FAILURE;
+
+    std::vector<cl_device_id> devices(numDevices);
+    status = clGetProgramInfo(program,
+                              CL_PROGRAM_DEVICES,
+                              sizeof(cl_device_id) * numDevices,
+                              &devices[0],
+                              NULL);
+    if(status != CL_SUCCESS)
+        return SDK_FAILURE;
+
+    cl_uint index = 0;
+    while(index < numDevices && devices[index] != device)
+        ++index;
+    if(index == numDevices)
+        return SDK_FAILURE;
+
+    std::vector<size_t> binarySizes(numDevices);
+    status = clGetProgramInfo(program,
+                              CL_PROGRAM_BINARY_SIZES,
+                              sizeof(size_t) * numDevices,
+                              &binarySizes[0],
+                              NULL);
+    if(status != CL_SUCCESS || binarySizes[index] == 0)
+        return SDK_FAILURE;
+
+    // Binaries are returned for every device of the program
+    std::vector<std::string> binaries(numDevices);
+    std::vector<unsigned char*> binaryPtrs(numDevices);
+    for(cl_uint i = 0; i < numDevices; ++i)
+    {
+        binaries[i].resize(binarySizes[i] + 1);
+        binaryPtrs[i] = (unsigned char*)&binaries[i][0];
+    }
+    status = clGetProgramInfo(program,
+                              CL_PROGRAM_BINARIES,
+                              sizeof(unsigned char*) * numDevices,
+                              &binaryPtrs[0],
+                              NULL);
+    if(status != CL_SUCCESS)
+        return SDK_FAILURE;
+
+    const char *binary = (const char*)binaryPtrs[index];
+    size_t binarySize = binarySizes[index];
+
+    cacheHeader header;
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.keySize = key.size();
+    header.binarySize = binarySize;
+    header.binaryHash = hashBytes(binary, binarySize);
+
+    std::string entry;
+    entry.reserve(sizeof(cacheHeader) + key.size() + binarySize);
+    entry.append((const char*)&header, sizeof(cacheHeader));
+    entry.append(key);
+    entry.append(binary, binarySize);
+
+#ifdef _WIN32
+    _mkdir(cacheDir_.c_str());
+#else
+    mkdir(cacheDir_.c_str(), 0755);
+#endif
+
+    // Write to a file private to this process and rename it into place
+    static unsigned int tempCounter = 0;
+    std::string path = entryPath(key);
+    char suffix[64];
+    sprintf(suffix, ".%d.%u.tmp", (int)GETPID(), tempCounter++);
+    std::string tempPath = path + suffix;
+
+    SDKFile entryFile;
+    if(entryFile.writeBinaryToFile(tempPath.c_str(), entry.data(), entry.size()) != SDK_SUCCESS)
+        return SDK_FAILURE;
+
+#ifdef _WIN32
+    if(!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+#else
+    if(rename(tempPath.c_str(), path.c_str()) != 0)
+#endif
+    {
+        ::remove(tempPath.c_str());
+        return SDK_FAILURE;
+    }
+
+    return SDK_SUCCESS;
+}
+
+void
+SDKBinaryCache::remove(const std::string &key)
+{
+    ::remove(entryPath(key).c_str());
+}
+
+} // namespace streamsdk
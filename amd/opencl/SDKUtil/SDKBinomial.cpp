@@ -0,0 +1,274 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#include "SDKBinomial.hpp"
+#include "SDKThreadPool.hpp"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define SDK_BINOMIAL_SSE
+#define SDK_BINOMIAL_AVX __attribute__((target("avx,fma")))
+#define SDK_BINOMIAL_AVX512 __attribute__((target("avx512f")))
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SDK_BINOMIAL_SSE
+#include <emmintrin.h>
+#endif
+
+/**
+ * Options priced together, one per SIMD lane
+ */
+#define BINOMIAL_BATCH 16
+
+namespace streamsdk
+{
+
+/**
+ * Walks a batch from the leaves back to the root. v holds numSteps + 1
+ * nodes of BINOMIAL_BATCH lanes (64 byte aligned), the prices end up in
+ * the first node. Same recurrence as the BinomialOption kernels:
+ * v[k] = pu * v[k] + pd * v[k + 1]
+ */
+typedef void (*BinomialSweep)(int numSteps, float *v, const float *pu, const float *pd);
+
+#ifdef SDK_BINOMIAL_SSE
+/*
+ * Four vectors per node, the upper node is carried to the next k
+ */
+static void
+sweepSSE(int numSteps, float *v, const float *pu, const float *pd)
+{
+    __m128 vpu[4], vpd[4];
+    for(int q = 0; q < 4; ++q)
+    {
+        vpu[q] = _mm_loadu_ps(pu + 4 * q);
+        vpd[q] = _mm_loadu_ps(pd + 4 * q);
+    }
+
+    for(int j = numSteps; j > 0; --j)
+    {
+        float *node = v;
+        __m128 v0 = _mm_load_ps(node), v1 = _mm_load_ps(node + 4);
+        __m128 v2 = _mm_load_ps(node + 8), v3 = _mm_load_ps(node + 12);
+        for(int k = 0; k < j; ++k, node += BINOMIAL_BATCH)
+        {
+            __m128 u0 = _mm_load_ps(node + BINOMIAL_BATCH);
+            __m128 u1 = _mm_load_ps(node + BINOMIAL_BATCH + 4);
+            __m128 u2 = _mm_load_ps(node + BINOMIAL_BATCH + 8);
+            __m128 u3 = _mm_load_ps(node + BINOMIAL_BATCH + 12);
+            _mm_store_ps(node, _mm_add_ps(_mm_mul_ps(vpd[0], u0), _mm_mul_ps(vpu[0], v0)));
+            _mm_store_ps(node + 4, _mm_add_ps(_mm_mul_ps(vpd[1], u1), _mm_mul_ps(vpu[1], v1)));
+            _mm_store_ps(node + 8, _mm_add_ps(_mm_mul_ps(vpd[2], u2), _mm_mul_ps(vpu[2], v2)));
+            _mm_store_ps(node + 12, _mm_add_ps(_mm_mul_ps(vpd[3], u3), _mm_mul_ps(vpu[3], v3)));
+            v0 = u0;
+            v1 = u1;
+            v2 = u2;
+            v3 = u3;
+        }
+    }
+}
+#else
+static void
+sweepScalar(int numSteps, float *v, const float *pu, const float *pd)
+{
+    for(int j = numSteps; j > 0; --j)
+    {
+        float *node = v;
+        for(int k = 0; k < j; ++k, node += BINOMIAL_BATCH)
+        {
+            for(int i = 0; i < BINOMIAL_BATCH; ++i)
+                node[i] = pd[i] * node[i + BINOMIAL_BATCH] + pu[i] * node[i];
+        }
+    }
+}
+#endif
+
+#ifdef SDK_BINOMIAL_AVX
+static bool
+hasAVX()
+{
+    return __builtin_cpu_supports("avx") && __builtin_cpu_supports("fma");
+}
+
+static bool
+hasAVX512()
+{
+    return __builtin_cpu_supports("avx512f");
+}
+
+/*
+ * Two vectors per node, the upper node is carried to the next k
+ */
+SDK_BINOMIAL_AVX static void
+sweepAVX(int numSteps, float *v, const float *pu, const float *pd)
+{
+    __m256 pu0 = _mm256_loadu_ps(pu), pu1 = _mm256_loadu_ps(pu + 8);
+    __m256 pd0 = _mm256_loadu_ps(pd), pd1 = _mm256_loadu_ps(pd + 8);
+
+    for(int j = numSteps; j > 0; --j)
+    {
+        float *node = v;
+        __m256 v0 = _mm256_load_ps(node), v1 = _mm256_load_ps(node + 8);
+        for(int k = 0; k < j; ++k, node += BINOMIAL_BATCH)
+        {
+            __m256 u0 = _mm256_load_ps(node + BINOMIAL_BATCH);
+            __m256 u1 = _mm256_load_ps(node + BINOMIAL_BATCH + 8);
+            _mm256_store_ps(node, _mm256_fmadd_ps(pd0, u0, _mm256_mul_ps(pu0, v0)));
+            _mm256_store_ps(node + 8, _mm256_fmadd_ps(pd1, u1, _mm256_mul_ps(pu1, v1)));
+            v0 = u0;
+            v1 = u1;
+        }
+    }
+}
+
+/*
+ * One vector per node
+ */
+SDK_BINOMIAL_AVX512 static void
+sweepAVX512(int numSteps, float *v, const float *pu, const float *pd)
+{
+    __m512 vpu = _mm512_loadu_ps(pu);
+    __m512 vpd = _mm512_loadu_ps(pd);
+
+    for(int j = numSteps; j > 0; --j)
+    {
+        float *node = v;
+        __m512 lower = _mm512_load_ps(node);
+        for(int k = 0; k < j; ++k, node += BINOMIAL_BATCH)
+        {
+            __m512 upper = _mm512_load_ps(node + BINOMIAL_BATCH);
+            _mm512_store_ps(node, _mm512_fmadd_ps(vpd, upper, _mm512_mul_ps(vpu, lower)));
+            lower = upper;
+        }
+    }
+}
+#endif
+
+static BinomialSweep
+selectSweep()
+{
+#ifdef SDK_BINOMIAL_AVX
+    if(hasAVX512())
+        return sweepAVX512;
+    if(hasAVX())
+        return sweepAVX;
+#endif
+#ifdef SDK_BINOMIAL_SSE
+    return sweepSSE;
+#else
+    return sweepScalar;
+#endif
+}
+
+/*
+ * Prices batches [begin, end) of BINOMIAL_BATCH options
+ */
+struct BinomialBatches
+{
+    BinomialSweep sweep;
+    size_t count;
+    const float *s;
+    const float *x;
+    const float *t;
+    float riskFree;
+    float volatility;
+    int numSteps;
+    float *price;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        std::vector<float> nodes((numSteps + 2) * BINOMIAL_BATCH);
+        float *v = (float*)(((size_t)&nodes[0] + 63) & ~(size_t)63);
+
+        float pu[BINOMIAL_BATCH];
+        float pd[BINOMIAL_BATCH];
+        float strike[BINOMIAL_BATCH];
+        double leaf[BINOMIAL_BATCH];
+        double growth[BINOMIAL_BATCH];
+
+#ifdef SDK_BINOMIAL_SSE
+        // far out of the money nodes decay into denormals, which would slow
+        // the walk down by two orders of magnitude: flush them to zero
+        unsigned int csr = _mm_getcsr();
+        _mm_setcsr(csr | 0x8040);
+#endif
+
+        for(size_t batch = begin; batch < end; ++batch)
+        {
+            size_t first = batch * BINOMIAL_BATCH;
+            for(int i = 0; i < BINOMIAL_BATCH; ++i)
+            {
+                // lanes past the end repeat the last option
+                size_t o = std::min(first + i, count - 1);
+                float dt = t[o] * (1.0f / (float)numSteps);
+                float vsdt = volatility * sqrtf(dt);
+                float r = expf(riskFree * dt);
+                float rInv = 1.0f / r;
+                float u = expf(vsdt);
+                float d = 1.0f / u;
+                float p = (r - d) / (u - d);
+                pu[i] = p * rInv;
+                pd[i] = (1.0f - p) * rInv;
+
+                // lowest leaf s * u^-numSteps, each next one u^2 higher
+                strike[i] = x[o];
+                leaf[i] = s[o] * exp(-(double)vsdt * numSteps);
+                growth[i] = exp(2.0 * vsdt);
+            }
+
+            // call payoff max(S - X, 0) at expiration
+            for(int j = 0; j <= numSteps; ++j)
+            {
+                float *node = v + j * BINOMIAL_BATCH;
+                for(int i = 0; i < BINOMIAL_BATCH; ++i)
+                {
+                    float profit = (float)leaf[i] - strike[i];
+                    node[i] = profit > 0.0f ? profit : 0.0f;
+                    leaf[i] *= growth[i];
+                }
+            }
+
+            sweep(numSteps, v, pu, pd);
+
+            for(size_t i = 0; i < BINOMIAL_BATCH && first + i < count; ++i)
+                price[first + i] = v[i];
+        }
+
+#ifdef SDK_BINOMIAL_SSE
+        _mm_setcsr(csr);
+#endif
+    }
+};
+
+void
+binomialEuropeanCall(size_t count,
+                     const float *s, const float *x, const float *t,
+                     float riskFree, float volatility, int numSteps,
+                     float *price)
+{
+    if(count == 0)
+        return;
+
+    static const BinomialSweep sweep = selectSweep();
+    BinomialBatches batches = {sweep, count, s, x, t, riskFree, volatility,
+                               numSteps, price};
+    SDKThreadPool::getInstance().parallelFor(0, (count + BINOMIAL_BATCH - 1) / BINOMIAL_BATCH,
+                                             batches);
+}
+
+}
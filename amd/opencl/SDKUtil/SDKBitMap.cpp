@@ -187,134 +187,32 @@ SDKBitMap::load(const char * filename)
     // Release any existing resources
     releaseResources();
 
-    // Open BMP file
-    FILE * fd = fopen(filename, "rb");
-    // FILE *fd; 
-    //fopen_s(&fd, filename, "rb");
-
-    // Opened OK
-    if (fd != NULL) {
-        // Read header
-        fread((BitMapHeader *)this, sizeof(BitMapHeader), 1, fd);
-
-        // Failed to read header
-        if (ferror(fd)) {
-            fclose(fd);
-            return;
-        }
-
-        // Confirm that we have a bitmap file
-        if (id != bitMapID) {
-            fclose(fd);
-            return;
-        }
-
-        // Read map info header
-        fread((BitMapInfoHeader *)this, sizeof(BitMapInfoHeader), 1, fd);
-
-        // Failed to read map info header
-        if (ferror(fd)) {
-            fclose(fd);
-            return;
-        }
-
-        // No support for compressed images
-        if (compression) {
-            fclose(fd);
-            return;
-        }
-
-        // Support only 8 or 24 bits images
-        if (bitsPerPixel < 8) {
-            fclose(fd);
-            return;
-        }
-
-        // Store number of colors
-        numColors_ = 1 << bitsPerPixel;
-
-        //load the palate for 8 bits per pixel
-        if(bitsPerPixel == 8) {
-            colors_ = new ColorPalette[numColors_];
-            if (colors_ == NULL) {
-                fclose(fd);
-                return;
-            }
-            fread(
-                (char *)colors_,
-                numColors_ * sizeof(ColorPalette),
-                1,
-                fd);
-
-            // Failed to read colors
-            if (ferror(fd)) {
-                fclose(fd);
-                return;
-            }
-        }
-
-        // Allocate buffer to hold all pixels
-        unsigned int sizeBuffer = size - offset;
-        unsigned char * tmpPixels = new unsigned char[sizeBuffer];
-
-        if (tmpPixels == NULL) {
-            delete colors_;
-            colors_ = NULL;
-            fclose(fd);
-            return;
-        }
-
-        // Read pixels from file, including any padding
-        fread(tmpPixels, sizeBuffer * sizeof(unsigned char), 1, fd);
-
-        // Failed to read pixel data
-        if (ferror(fd)) {
-            delete colors_;
-            colors_ = NULL;
-            delete tmpPixels;
-            fclose(fd);
-            return;
-        }
-
-        // Allocate image
-        pixels_ = new uchar4[width * height];
-        if (pixels_ == NULL) {
-            delete colors_;
-            colors_ = NULL;
-            delete tmpPixels;
-            fclose(fd);
-            return;
-        }
-        // Set image, including w component (white)
-        memset(pixels_, 0xff, width * height * sizeof(uchar4));
-
-        unsigned int index = 0;
-        for(int y = 0; y < height; y++) {
-            for(int x = 0; x < width; x++) {
-                // Read RGB values
-                if (bitsPerPixel == 8) {
-                    pixels_[(y * width + x)] = colors_[tmpPixels[index++]];
-                }
-                else { // 24 bit
-                    pixels_[(y * width + x)].z = tmpPixels[index++];
-                    pixels_[(y * width + x)].y = tmpPixels[index++];
-                    pixels_[(y * width + x)].x = tmpPixels[index++];
-                }
-            }
+    // Decode straight from the mapped file, no staging copy of the pixels
+    SDKBitMapReader reader;
+    if (!reader.open(filename)) {
+        return;
+    }
 
-            // Handle padding
-            for(int x = 0; x < (4 - (3 * width) % 4) % 4; x++) {
-                index++;
-            }
-        }
+    *(BitMapHeader *)this = reader.getHeader();
+    *(BitMapInfoHeader *)this = reader.getInfoHeader();
+    height = reader.getHeight();
 
-        // Loaded file so we can close the file.
-        fclose(fd);
-        delete[] tmpPixels;
+    //load the palate for 8 bits per pixel
+    numColors_ = (int)reader.getPalette().size();
+    if (numColors_ != 0) {
+        colors_ = new ColorPalette[numColors_];
+        memcpy(colors_, &reader.getPalette()[0], numColors_ * sizeof(ColorPalette));
+    }
 
-        // Loaded file so record this fact
-        isLoaded_  = true;
+    // Allocate image
+    pixels_ = new uchar4[width * height];
+    if (!reader.readRows(0, height, pixels_)) {
+        releaseResources();
+        return;
     }
+
+    // Loaded file so record this fact
+    isLoaded_  = true;
 }
 
 int
@@ -407,9 +305,249 @@ SDKBitMap::write(const char * filename)
             }
         }
 
-        return true;
+        return fclose(fd) == 0;
     }
 
     return false;
 }
+
+
+SDKBitMapReader::SDKBitMapReader()
+    : pixelData_(NULL),
+      stride_(0),
+      height_(0),
+      topDown_(false),
+      isOpen_(false)
+{
+    memset(&header_, 0, sizeof(header_));
+    memset(&info_, 0, sizeof(info_));
+}
+
+bool
+SDKBitMapReader::open(const char * filename)
+{
+    close();
+
+    if (!file_.map(filename)) {
+        return false;
+    }
+
+    const unsigned char * data = (const unsigned char *)file_.data();
+    size_t fileSize = file_.size();
+    if (fileSize < sizeof(BitMapHeader) + sizeof(BitMapInfoHeader)) {
+        close();
+        return false;
+    }
+    memcpy(&header_, data, sizeof(BitMapHeader));
+    memcpy(&info_, data + sizeof(BitMapHeader), sizeof(BitMapInfoHeader));
+
+    // Uncompressed 8, 24 and 32 bit images only
+    if (header_.id != bitMapID ||
+        info_.compression != 0 ||
+        info_.width <= 0 ||
+        info_.height == 0 ||
+        (info_.bitsPerPixel != 8 &&
+         info_.bitsPerPixel != 24 &&
+         info_.bitsPerPixel != 32)) {
+        close();
+        return false;
+    }
+
+    topDown_ = info_.height < 0;
+    height_  = topDown_ ? -info_.height : info_.height;
+    stride_  = ((size_t)info_.width * (info_.bitsPerPixel / 8) + 3) & ~(size_t)3;
+
+    if (info_.bitsPerPixel == 8) {
+        // The palette follows the info header, unused entries are black
+        size_t paletteOffset = sizeof(BitMapHeader) + (size_t)info_.sizeInfo;
+        size_t numColors = (info_.clrUsed > 0 && info_.clrUsed <= 256) ? info_.clrUsed : 256;
+        if (paletteOffset + numColors * sizeof(ColorPalette) > fileSize) {
+            close();
+            return false;
+        }
+
+        uchar4 black = {0, 0, 0, 0};
+        palette_.assign(256, black);
+        memcpy(&palette_[0], data + paletteOffset, numColors * sizeof(ColorPalette));
+    }
+
+    if (header_.offset < 0 ||
+        (size_t)header_.offset + stride_ * height_ > fileSize) {
+        close();
+        return false;
+    }
+
+    pixelData_ = data + header_.offset;
+    isOpen_    = true;
+    return true;
+}
+
+void
+SDKBitMapReader::close()
+{
+    file_.unmap();
+    palette_.clear();
+    pixelData_ = NULL;
+    stride_    = 0;
+    height_    = 0;
+    isOpen_    = false;
+}
+
+bool
+SDKBitMapReader::readRows(int firstRow, int numRows, uchar4 * dst) const
+{
+    return readTile(0, firstRow, info_.width, numRows, dst, info_.width);
+}
+
+bool
+SDKBitMapReader::readTile(
+    int x,
+    int y,
+    int tileWidth,
+    int tileHeight,
+    uchar4 * dst,
+    int dstPitch) const
+{
+    if (!isOpen_ || dst == NULL ||
+        x < 0 || y < 0 || tileWidth < 0 || tileHeight < 0 ||
+        x + tileWidth > info_.width || y + tileHeight > height_) {
+        return false;
+    }
+
+    int bytesPerPixel = info_.bitsPerPixel / 8;
+    for (int row = 0; row < tileHeight; row++) {
+        // Bottom-up files store row 0 first
+        int storedRow = topDown_ ? height_ - 1 - (y + row) : y + row;
+        const unsigned char * src = pixelData_ + stride_ * storedRow + (size_t)x * bytesPerPixel;
+        uchar4 * out = dst + (size_t)row * dstPitch;
+
+        if (bytesPerPixel == 1) {
+            for (int i = 0; i < tileWidth; i++) {
+                out[i] = palette_[src[i]];
+            }
+        }
+        else {
+            // Pixels are stored as BGR(A), w is white unless stored
+            for (int i = 0; i < tileWidth; i++, src += bytesPerPixel) {
+                out[i].x = src[2];
+                out[i].y = src[1];
+                out[i].z = src[0];
+                out[i].w = bytesPerPixel == 4 ? src[3] : 0xff;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+SDKBitMapWriter::SDKBitMapWriter()
+    : fd_(NULL),
+      width_(0),
+      height_(0),
+      bitsPerPixel_(0),
+      rowsWritten_(0),
+      failed_(false)
+{
+}
+
+bool
+SDKBitMapWriter::open(const char * filename, int width, int height, int bitsPerPixel)
+{
+    close();
+
+    if (width <= 0 || height <= 0 || (bitsPerPixel != 24 && bitsPerPixel != 32)) {
+        return false;
+    }
+
+    fd_ = fopen(filename, "wb");
+    if (fd_ == NULL) {
+        return false;
+    }
+
+    width_        = width;
+    height_       = height;
+    bitsPerPixel_ = bitsPerPixel;
+    rowsWritten_  = 0;
+    failed_       = false;
+
+    size_t stride = ((size_t)width * (bitsPerPixel / 8) + 3) & ~(size_t)3;
+    rowBuffer_.assign(stride, 0);
+
+    BitMapHeader header;
+    header.id        = bitMapID;
+    header.reserved1 = 0x0000;
+    header.reserved2 = 0x0000;
+    header.offset    = sizeof(BitMapHeader) + sizeof(BitMapInfoHeader);
+    header.size      = (int)(header.offset + stride * height);
+
+    BitMapInfoHeader info;
+    info.sizeInfo      = sizeof(BitMapInfoHeader);
+    info.width         = width;
+    info.height        = height;
+    info.planes        = 1;
+    info.bitsPerPixel  = (short)bitsPerPixel;
+    info.compression   = 0;
+    info.imageSize     = (unsigned)(stride * height);
+    info.xPelsPerMeter = 0;
+    info.yPelsPerMeter = 0;
+    info.clrUsed       = 0;
+    info.clrImportant  = 0;
+
+    if (fwrite(&header, sizeof(BitMapHeader), 1, fd_) != 1 ||
+        fwrite(&info, sizeof(BitMapInfoHeader), 1, fd_) != 1) {
+        failed_ = true;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool
+SDKBitMapWriter::writeRows(const uchar4 * src, int numRows)
+{
+    if (fd_ == NULL || failed_ || src == NULL ||
+        numRows < 0 || rowsWritten_ + numRows > height_) {
+        return false;
+    }
+
+    int bytesPerPixel = bitsPerPixel_ / 8;
+    for (int row = 0; row < numRows; row++, src += width_) {
+        unsigned char * out = &rowBuffer_[0];
+        for (int i = 0; i < width_; i++, out += bytesPerPixel) {
+            out[0] = src[i].z;
+            out[1] = src[i].y;
+            out[2] = src[i].x;
+            if (bytesPerPixel == 4) {
+                out[3] = src[i].w;
+            }
+        }
+
+        if (fwrite(&rowBuffer_[0], 1, rowBuffer_.size(), fd_) != rowBuffer_.size()) {
+            failed_ = true;
+            return false;
+        }
+        rowsWritten_++;
+    }
+
+    return true;
+}
+
+bool
+SDKBitMapWriter::close()
+{
+    if (fd_ == NULL) {
+        return false;
+    }
+
+    bool ok = !failed_ && rowsWritten_ == height_;
+    if (fclose(fd_) != 0) {
+        ok = false;
+    }
+    fd_ = NULL;
+    rowBuffer_.clear();
+
+    return ok;
+}
 } //streamsdk
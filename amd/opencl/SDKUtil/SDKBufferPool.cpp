@@ -0,0 +1,377 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#include "SDKBufferPool.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__MINGW32__) && !defined(__MINGW64_VERSION_MAJOR)
+#define _aligned_malloc __mingw_aligned_malloc 
+#define _aligned_free  __mingw_aligned_free 
+#endif // __MINGW32__  and __MINGW64_VERSION_MAJOR
+
+namespace streamsdk
+{
+
+static SDKBufferPool *sharedBufferPool = NULL;
+static ThreadLock sharedBufferPoolLock;
+
+static size_t
+getPageSize()
+{
+    static size_t pageSize = 0;
+    if(pageSize == 0)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO sysInfo;
+        GetSystemInfo(&sysInfo);
+        pageSize = (size_t)sysInfo.dwPageSize;
+#else
+        long size = sysconf(_SC_PAGESIZE);
+        pageSize = size > 0 ? (size_t)size : 4096;
+#endif
+    }
+    return pageSize;
+}
+
+static inline size_t
+roundUp(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+static inline char*
+alignUp(char *ptr, size_t alignment)
+{
+    return (char*)roundUp((size_t)ptr, alignment);
+}
+
+/*
+ * Size classes for heap buffers: four per power of two, so a released
+ * buffer serves any later request of the same class.
+ */
+static size_t
+sizeClass(size_t size)
+{
+    if(size <= SDK_CACHE_LINE_SIZE)
+        return SDK_CACHE_LINE_SIZE;
+
+    size_t power = 1;
+    while(power <= size / 2)
+        power <<= 1;
+    return roundUp(size, power / 4);
+}
+
+
+SDKBufferPool::SDKBufferPool()
+    : hugePageMode_(HUGE_PAGES_TRANSPARENT),
+      largeThreshold_(256 * 1024),
+      maxCachedBytes_((size_t)1024 * 1024 * 1024),
+      cachedBytes_(0),
+      hits_(0),
+      misses_(0)
+{
+}
+
+SDKBufferPool::~SDKBufferPool()
+{
+    trim();
+    for(UsedList::iterator it = used_.begin(); it != used_.end(); ++it)
+        freeBlock(it->second);
+    used_.clear();
+}
+
+SDKBufferPool&
+SDKBufferPool::getInstance()
+{
+    sharedBufferPoolLock.lock();
+    if(!sharedBufferPool)
+    {
+        sharedBufferPool = new SDKBufferPool();
+
+        const char *env = getenv("SDK_HUGE_PAGES");
+        if(env)
+        {
+            if(strcmp(env, "none") == 0 || strcmp(env, "0") == 0)
+                sharedBufferPool->setHugePageMode(HUGE_PAGES_NONE);
+            else if(strcmp(env, "explicit") == 0)
+                sharedBufferPool->setHugePageMode(HUGE_PAGES_EXPLICIT);
+        }
+
+        env = getenv("SDK_POOL_CACHE_MB");
+        if(env && atoi(env) >= 0)
+            sharedBufferPool->setMaxCachedBytes((size_t)atoi(env) * 1024 * 1024);
+    }
+    sharedBufferPoolLock.unlock();
+
+    // never destroyed: buffers may be released by static destructors
+    return *sharedBufferPool;
+}
+
+void*
+SDKBufferPool::allocate(size_t size, size_t alignment)
+{
+    if(alignment < SDK_CACHE_LINE_SIZE)
+        alignment = SDK_CACHE_LINE_SIZE;
+    if((alignment & (alignment - 1)) != 0)
+        return NULL;
+    if(size == 0)
+        size = 1;
+
+    size_t rounded;
+    if(size < largeThreshold_)
+        rounded = sizeClass(size);
+    else if(hugePageMode_ != HUGE_PAGES_NONE && size >= SDK_HUGE_PAGE_SIZE)
+        rounded = roundUp(size, SDK_HUGE_PAGE_SIZE);
+    else
+        rounded = roundUp(size, getPageSize());
+
+    Block block;
+    lock_.lock();
+
+    // Best fit among the cached buffers, wasting at most half of one
+    FreeList::iterator it = free_.lower_bound(rounded);
+    for(; it != free_.end() && it->first / 2 <= rounded; ++it)
+    {
+        if((size_t)it->second.ptr % alignment == 0)
+            break;
+    }
+
+    if(it != free_.end() && it->first / 2 <= rounded)
+    {
+        block = it->second;
+        free_.erase(it);
+        cachedBytes_ -= block.capacity;
+        used_[block.ptr] = block;
+        ++hits_;
+        lock_.unlock();
+        return block.ptr;
+    }
+
+    ++misses_;
+    lock_.unlock();
+
+    if(!allocateBlock(rounded, alignment, block))
+        return NULL;
+
+    lock_.lock();
+    used_[block.ptr] = block;
+    lock_.unlock();
+    return block.ptr;
+}
+
+void
+SDKBufferPool::release(void *ptr)
+{
+    if(ptr == NULL)
+        return;
+
+    std::vector<Block> victims;
+    lock_.lock();
+    UsedList::iterator it = used_.find(ptr);
+    if(it == used_.end())
+    {
+        // Not allocated from this pool
+        lock_.unlock();
+        return;
+    }
+
+    Block block = it->second;
+    used_.erase(it);
+    if(block.capacity > maxCachedBytes_)
+    {
+        victims.push_back(block);
+    }
+    else
+    {
+        evict(block.capacity, victims);
+        free_.insert(std::make_pair(block.capacity, block));
+        cachedBytes_ += block.capacity;
+    }
+    lock_.unlock();
+
+    for(size_t i = 0; i < victims.size(); ++i)
+        freeBlock(victims[i]);
+}
+
+void
+SDKBufferPool::trim()
+{
+    std::vector<Block> victims;
+    lock_.lock();
+    for(FreeList::iterator it = free_.begin(); it != free_.end(); ++it)
+        victims.push_back(it->second);
+    free_.clear();
+    cachedBytes_ = 0;
+    lock_.unlock();
+
+    for(size_t i = 0; i < victims.size(); ++i)
+        freeBlock(victims[i]);
+}
+
+void
+SDKBufferPool::setMaxCachedBytes(size_t bytes)
+{
+    std::vector<Block> victims;
+    lock_.lock();
+    maxCachedBytes_ = bytes;
+    evict(0, victims);
+    lock_.unlock();
+
+    for(size_t i = 0; i < victims.size(); ++i)
+        freeBlock(victims[i]);
+}
+
+/*
+ * Drops the largest cached buffers until bytes more fit under the limit.
+ * Called with lock_ held, the victims are freed by the caller.
+ */
+void
+SDKBufferPool::evict(size_t bytes, std::vector<Block> &victims)
+{
+    while(!free_.empty() && cachedBytes_ + bytes > maxCachedBytes_)
+    {
+        FreeList::iterator last = free_.end();
+        --last;
+        cachedBytes_ -= last->second.capacity;
+        victims.push_back(last->second);
+        free_.erase(last);
+    }
+}
+
+bool
+SDKBufferPool::allocateBlock(size_t size, size_t alignment, Block &block)
+{
+    block.capacity = size;
+    block.mappedSize = 0;
+    block.base = NULL;
+    block.ptr = NULL;
+
+    if(size < largeThreshold_)
+    {
+#ifdef _WIN32
+        block.base = _aligned_malloc(size, alignment);
+#else
+        if(posix_memalign(&block.base, alignment, size) != 0)
+            block.base = NULL;
+#endif
+        block.ptr = block.base;
+        return block.ptr != NULL;
+    }
+
+    bool huge = hugePageMode_ != HUGE_PAGES_NONE && size >= SDK_HUGE_PAGE_SIZE;
+    if(alignment < getPageSize())
+        alignment = getPageSize();
+    if(huge && alignment < SDK_HUGE_PAGE_SIZE)
+        alignment = SDK_HUGE_PAGE_SIZE;
+
+#ifdef _WIN32
+    if(huge && hugePageMode_ == HUGE_PAGES_EXPLICIT && GetLargePageMinimum() != 0)
+    {
+        // Needs SeLockMemoryPrivilege, regular pages are used without it
+        size_t mapped = roundUp(size, GetLargePageMinimum());
+        block.base = VirtualAlloc(NULL,
+                                  mapped,
+                                  MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                  PAGE_READWRITE);
+        if(block.base != NULL && (size_t)block.base % alignment == 0)
+        {
+            block.mappedSize = mapped;
+            block.ptr = block.base;
+            return true;
+        }
+        if(block.base != NULL)
+            VirtualFree(block.base, 0, MEM_RELEASE);
+    }
+
+    // Pages of the over-allocation that are never touched are never committed
+    size_t mapped = size + alignment;
+    block.base = VirtualAlloc(NULL, mapped, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if(block.base == NULL)
+        return false;
+#else
+#ifdef MAP_HUGETLB
+    if(huge && hugePageMode_ == HUGE_PAGES_EXPLICIT)
+    {
+        void *base = mmap(NULL,
+                          size,
+                          PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                          -1,
+                          0);
+        if(base != MAP_FAILED && (size_t)base % alignment == 0)
+        {
+            block.base = block.ptr = base;
+            block.mappedSize = size;
+            return true;
+        }
+        if(base != MAP_FAILED)
+            munmap(base, size);
+    }
+#endif
+
+    // Over-map so an aligned range of size bytes fits, untouched pages cost no memory
+    size_t mapped = size + alignment - getPageSize();
+    void *base = mmap(NULL,
+                      mapped,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+    if(base == MAP_FAILED)
+        return false;
+    block.base = base;
+#endif
+
+    block.mappedSize = mapped;
+    block.ptr = alignUp((char*)block.base, alignment);
+
+#if !defined(_WIN32) && defined(MADV_HUGEPAGE)
+    if(huge)
+        madvise(block.ptr, size, MADV_HUGEPAGE);
+#endif
+
+    return true;
+}
+
+void
+SDKBufferPool::freeBlock(const Block &block)
+{
+    if(block.mappedSize == 0)
+    {
+#ifdef _WIN32
+        _aligned_free(block.base);
+#else
+        free(block.base);
+#endif
+        return;
+    }
+
+#ifdef _WIN32
+    VirtualFree(block.base, 0, MEM_RELEASE);
+#else
+    munmap(block.base, block.mappedSize);
+#endif
+}
+
+} // namespace streamsdk
@@ -14,9 +14,22 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************************************/
 #include <SDKCommon.hpp>
+#include <SDKBinaryCache.hpp>
+#include <SDKThreadPool.hpp>
+#include <SDKTrace.hpp>
+#include <algorithm>
+#include <climits>
 
 #ifndef _WIN32
 #include <unistd.h>
+#if defined(SDK_TIMER_USE_TSC)
+#include <x86intrin.h>
+#endif
+#endif
+
+/* Maximum number of intervals kept in the history of a timer */
+#ifndef SDK_TIMER_MAX_SAMPLES
+#define SDK_TIMER_MAX_SAMPLES (1 << 20)
 #endif
 
 namespace streamsdk
@@ -104,12 +117,158 @@ int SDKCommon::waitForEventAndRelease(cl_event *event)
 		CHECK_OPENCL_ERROR(status, "clGetEventEventInfo Failed with Error Code:");
 	}
 
+    SDKTrace &trace = SDKTrace::getInstance();
+    if(trace.isEnabled())
+        trace.recordEvent(*event);
+
     status = clReleaseEvent(*event);
     CHECK_OPENCL_ERROR(status, "clReleaseEvent Failed with Error Code:");
 
     return SDK_SUCCESS;
 }
 
+/*
+ * Philox4x32-10 counter based generator (Salmon et al., SC11).
+ * Each 64-bit counter value yields four 32-bit random numbers.
+ */
+static inline void
+philox4x32(cl_ulong counter, cl_uint seed, cl_uint out[4])
+{
+    cl_uint c0 = (cl_uint)counter;
+    cl_uint c1 = (cl_uint)(counter >> 32);
+    cl_uint c2 = 0;
+    cl_uint c3 = 0;
+    cl_uint k0 = seed;
+    cl_uint k1 = 0xCAFEF00D;
+
+    for(int round = 0; round < 10; ++round)
+    {
+        cl_ulong p0 = (cl_ulong)0xD2511F53 * c0;
+        cl_ulong p1 = (cl_ulong)0xCD9E8D57 * c2;
+        c0 = (cl_uint)(p1 >> 32) ^ c1 ^ k0;
+        c2 = (cl_uint)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (cl_uint)p1;
+        c3 = (cl_uint)p0;
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/* Work of one host thread of fillRandom */
+template<typename T>
+struct FillRandomChunk
+{
+    T *arrayPtr;
+    size_t begin;       /**< begin first element, multiple of 4 */
+    size_t end;
+    T rangeMin;
+    double range;
+    cl_uint seed;
+};
+
+/*
+ * Philox4x32-10 on SDK_PHILOX_BATCH consecutive counters at once.
+ * The lanes are independent, which lets the compiler vectorize the rounds.
+ */
+#define SDK_PHILOX_BATCH 8
+
+static inline void
+philox4x32Batch(cl_ulong counter, cl_uint seed, cl_uint out[4][SDK_PHILOX_BATCH])
+{
+    cl_uint c0[SDK_PHILOX_BATCH], c1[SDK_PHILOX_BATCH];
+    cl_uint c2[SDK_PHILOX_BATCH], c3[SDK_PHILOX_BATCH];
+    for(int lane = 0; lane < SDK_PHILOX_BATCH; ++lane)
+    {
+        c0[lane] = (cl_uint)(counter + lane);
+        c1[lane] = (cl_uint)((counter + lane) >> 32);
+        c2[lane] = 0;
+        c3[lane] = 0;
+    }
+
+    cl_uint k0 = seed;
+    cl_uint k1 = 0xCAFEF00D;
+    for(int round = 0; round < 10; ++round)
+    {
+        for(int lane = 0; lane < SDK_PHILOX_BATCH; ++lane)
+        {
+            cl_ulong p0 = (cl_ulong)0xD2511F53 * c0[lane];
+            cl_ulong p1 = (cl_ulong)0xCD9E8D57 * c2[lane];
+            c0[lane] = (cl_uint)(p1 >> 32) ^ c1[lane] ^ k0;
+            c2[lane] = (cl_uint)(p0 >> 32) ^ c3[lane] ^ k1;
+            c1[lane] = (cl_uint)p1;
+            c3[lane] = (cl_uint)p0;
+        }
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+
+    for(int lane = 0; lane < SDK_PHILOX_BATCH; ++lane)
+    {
+        out[0][lane] = c0[lane];
+        out[1][lane] = c1[lane];
+        out[2][lane] = c2[lane];
+        out[3][lane] = c3[lane];
+    }
+}
+
+template<typename T>
+static void*
+fillRandomChunkFunc(void *arg)
+{
+    FillRandomChunk<T> *chunk = (FillRandomChunk<T>*)arg;
+    T *arrayPtr = chunk->arrayPtr;
+    const double scale = chunk->range / 4294967296.0;
+
+    // Element i takes word i%4 of counter i/4
+    const size_t batchElements = 4 * SDK_PHILOX_BATCH;
+    size_t i = chunk->begin;
+    for(; i + batchElements <= chunk->end; i += batchElements)
+    {
+        cl_uint random[4][SDK_PHILOX_BATCH];
+        philox4x32Batch((cl_ulong)(i / 4), chunk->seed, random);
+        for(int lane = 0; lane < SDK_PHILOX_BATCH; ++lane)
+        {
+            for(int word = 0; word < 4; ++word)
+            {
+                arrayPtr[i + 4 * lane + word] =
+                    chunk->rangeMin + T(scale * (double)random[word][lane]);
+            }
+        }
+    }
+    for(; i < chunk->end; i += 4)
+    {
+        cl_uint random[4];
+        philox4x32((cl_ulong)(i / 4), chunk->seed, random);
+        for(size_t word = 0; word < 4 && i + word < chunk->end; ++word)
+            arrayPtr[i + word] = chunk->rangeMin + T(scale * (double)random[word]);
+    }
+
+    return NULL;
+}
+
+/*
+ * Runs func on every chunk on the shared thread pool.
+ * The calling thread processes the first chunk.
+ */
+template<typename Chunk>
+static void
+runOnHostThreads(threadFunc func, std::vector<Chunk> &chunks)
+{
+    TaskGroup group;
+    for(size_t t = 1; t < chunks.size(); ++t)
+        group.run(func, &chunks[t]);
+
+    if(chunks.size() != 0)
+        func(&chunks[0]);
+
+    group.wait();
+}
+
 template<typename T> 
 int SDKCommon::fillRandom(
          T * arrayPtr, 
@@ -128,16 +287,26 @@ int SDKCommon::fillRandom(
     if(!seed)
         seed = (unsigned int)time(NULL);
 
-    srand(seed);
     double range = double(rangeMax - rangeMin) + 1.0; 
+    size_t length = (size_t)width * (size_t)height;
 
-    /* random initialisation of input */
-    for(int i = 0; i < height; i++)
-        for(int j = 0; j < width; j++)
-        {
-            int index = i*width + j;
-            arrayPtr[index] = rangeMin + T(range*rand()/(RAND_MAX + 1.0)); 
-        }
+    /* random initialisation of input, chunks are split on counter boundaries */
+    const size_t minChunk = 1 << 16;
+    size_t numThreads = SDKThreadPool::getInstance().getNumThreads();
+    numThreads = std::max((size_t)1, std::min(numThreads, length / minChunk));
+    size_t chunkSize = ((length + numThreads - 1) / numThreads + 3) & ~(size_t)3;
+
+    std::vector<FillRandomChunk<T> > chunks(numThreads);
+    for(size_t t = 0; t < numThreads; ++t)
+    {
+        chunks[t].arrayPtr = arrayPtr;
+        chunks[t].begin = std::min(length, t * chunkSize);
+        chunks[t].end = std::min(length, (t + 1) * chunkSize);
+        chunks[t].rangeMin = rangeMin;
+        chunks[t].range = range;
+        chunks[t].seed = seed;
+    }
+    runOnHostThreads(fillRandomChunkFunc<T>, chunks);
 
     return SDK_SUCCESS;
 }
@@ -1246,13 +1415,13 @@ SDKCommon::generateBinaryImage(const bifData &binaryData)
     SDKFile kernelFile;
     std::string kernelPath = getPath();
     kernelPath.append(binaryData.kernelName.c_str());
-    if(!kernelFile.open(kernelPath.c_str()))
+    if(!kernelFile.map(kernelPath.c_str()))
     {
         std::cout << "Failed to load kernel file : " << kernelPath << std::endl;
         return SDK_FAILURE;
     }
-    const char * source = kernelFile.source().c_str();
-    size_t sourceSize[] = {strlen(source)};
+    const char * source = kernelFile.data();
+    size_t sourceSize[] = {kernelFile.size()};
     cl_program program = clCreateProgramWithSource(
                             context,
                             1,
@@ -1526,20 +1695,46 @@ SDKCommon::buildOpenCLProgram(cl_program &program, const cl_context& context, co
     cl_int status = CL_SUCCESS;
     SDKFile kernelFile;
     std::string kernelPath = getPath();
+    cl_device_id device = buildData.devices[buildData.deviceId];
+
+    std::string flagsStr = std::string(buildData.flagsStr.c_str());
+
+    // Get additional options
+    if(buildData.flagsFileName.size() != 0)
+    {
+        streamsdk::SDKFile flagsFile;
+        std::string flagsPath = getPath();
+        flagsPath.append(buildData.flagsFileName.c_str());
+        if(!flagsFile.open(flagsPath.c_str()))
+        {
+            std::cout << "Failed to load flags file: " << flagsPath << std::endl;
+            return SDK_FAILURE;
+        }
+        flagsFile.replaceNewlineWithSpaces();
+        const char * flags = flagsFile.source().c_str();
+        flagsStr.append(flags);
+    }
+
+    // Binaries built from source are cached unless --load is used
+    SDKBinaryCache binaryCache(getPath() + "BinaryCache");
+    std::string cacheKey;
+    bool useCache = false;
+    bool fromCache = false;
+
     if(buildData.binaryName.size() != 0)
     {
         kernelPath.append(buildData.binaryName.c_str());
-        if(kernelFile.readBinaryFromFile(kernelPath.c_str()))
+        if(!kernelFile.map(kernelPath.c_str()))
         {
             std::cout << "Failed to load kernel file : " << kernelPath << std::endl;
             return SDK_FAILURE;
         }
 
-        const char * binary = kernelFile.source().c_str();
-        size_t binarySize = kernelFile.source().size();
+        const char * binary = kernelFile.data();
+        size_t binarySize = kernelFile.size();
         program = clCreateProgramWithBinary(context,
                                             1,
-                                            &buildData.devices[buildData.deviceId], 
+                                            &device, 
                                             (const size_t *)&binarySize,
                                             (const unsigned char**)&binary,
                                             NULL,
@@ -1549,44 +1744,89 @@ SDKCommon::buildOpenCLProgram(cl_program &program, const cl_context& context, co
     else
     {
         kernelPath.append(buildData.kernelName.c_str());
-        if(!kernelFile.open(kernelPath.c_str()))//bool
+        if(!kernelFile.map(kernelPath.c_str()))//bool
         {
             std::cout << "Failed to load kernel file: " << kernelPath << std::endl;
             return SDK_FAILURE;
         }
-        const char * source = kernelFile.source().c_str();
-        size_t sourceSize[] = {strlen(source)};
-        program = clCreateProgramWithSource(context,
-                                            1,
-                                            &source,
-                                            sourceSize,
-                                            &status);
-        CHECK_OPENCL_ERROR(status, "clCreateProgramWithSource failed.");
-    }
+        const char * source = kernelFile.data();
+        size_t sourceSize[] = {kernelFile.size()};
 
-    std::string flagsStr = std::string(buildData.flagsStr.c_str());
+        if(binaryCache.isEnabled())
+        {
+            useCache = (binaryCache.computeKey(device,
+                                               source,
+                                               sourceSize[0],
+                                               flagsStr,
+                                               cacheKey) == SDK_SUCCESS);
+        }
 
-    // Get additional options
-    if(buildData.flagsFileName.size() != 0)
-    {
-        streamsdk::SDKFile flagsFile;
-        std::string flagsPath = getPath();
-        flagsPath.append(buildData.flagsFileName.c_str());
-        if(!flagsFile.open(flagsPath.c_str()))
+        SDKFile cacheFile;
+        const char * binary = NULL;
+        size_t binarySize = 0;
+        if(useCache &&
+           binaryCache.load(cacheKey, cacheFile, binary, binarySize) == SDK_SUCCESS)
         {
-            std::cout << "Failed to load flags file: " << flagsPath << std::endl;
-            return SDK_FAILURE;
+            cl_int binaryStatus = CL_SUCCESS;
+            program = clCreateProgramWithBinary(context,
+                                                1,
+                                                &device, 
+                                                (const size_t *)&binarySize,
+                                                (const unsigned char**)&binary,
+                                                &binaryStatus,
+                                                &status);
+            if(status == CL_SUCCESS && binaryStatus == CL_SUCCESS)
+            {
+                fromCache = true;
+            }
+            else
+            {
+                if(status == CL_SUCCESS)
+                    clReleaseProgram(program);
+                // a mapped file cannot be deleted on Windows
+                cacheFile.unmap();
+                binaryCache.remove(cacheKey);
+            }
+        }
+
+        if(!fromCache)
+        {
+            program = clCreateProgramWithSource(context,
+                                                1,
+                                                &source,
+                                                sourceSize,
+                                                &status);
+            CHECK_OPENCL_ERROR(status, "clCreateProgramWithSource failed.");
         }
-        flagsFile.replaceNewlineWithSpaces();
-        const char * flags = flagsFile.source().c_str();
-        flagsStr.append(flags);
     }
 
     if(flagsStr.size() != 0)
         std::cout << "Build Options are : " << flagsStr.c_str() << std::endl;
 
     /* create a cl program executable for all the devices specified */
-    status = clBuildProgram(program, 1, &buildData.devices[buildData.deviceId], flagsStr.c_str(), NULL, NULL);
+    status = clBuildProgram(program, 1, &device, flagsStr.c_str(), NULL, NULL);
+
+    if(status != CL_SUCCESS && fromCache)
+    {
+        // Stale or rejected cache entry : drop it and build from source
+        binaryCache.remove(cacheKey);
+        fromCache = false;
+
+        status = clReleaseProgram(program);
+        CHECK_OPENCL_ERROR(status, "clReleaseProgram failed.");
+
+        const char * source = kernelFile.data();
+        size_t sourceSize[] = {kernelFile.size()};
+        program = clCreateProgramWithSource(context,
+                                            1,
+                                            &source,
+                                            sourceSize,
+                                            &status);
+        CHECK_OPENCL_ERROR(status, "clCreateProgramWithSource failed.");
+
+        status = clBuildProgram(program, 1, &device, flagsStr.c_str(), NULL, NULL);
+    }
+
     if(status != CL_SUCCESS)
     {
         if(status == CL_BUILD_PROGRAM_FAILURE)
@@ -1596,7 +1836,7 @@ SDKCommon::buildOpenCLProgram(cl_program &program, const cl_context& context, co
             size_t buildLogSize = 0;
             logStatus = clGetProgramBuildInfo (
                             program, 
-                            buildData.devices[buildData.deviceId], 
+                            device, 
                             CL_PROGRAM_BUILD_LOG, 
                             buildLogSize, 
                             buildLog, 
@@ -1610,7 +1850,7 @@ SDKCommon::buildOpenCLProgram(cl_program &program, const cl_context& context, co
 
             logStatus = clGetProgramBuildInfo (
                             program, 
-                            buildData.devices[buildData.deviceId], 
+                            device, 
                             CL_PROGRAM_BUILD_LOG, 
                             buildLogSize, 
                             buildLog, 
@@ -1630,55 +1870,333 @@ SDKCommon::buildOpenCLProgram(cl_program &program, const cl_context& context, co
 
         CHECK_OPENCL_ERROR(status, "clBuildProgram failed.");
     }
+
+    if(useCache && !fromCache)
+        binaryCache.store(cacheKey, program, device);
+
     return SDK_SUCCESS;
 }
 
+/*
+ * Element wise comparison helpers.
+ * Floating point values are mapped to integers whose order matches the
+ * order of the values, so the ULP distance is the difference of the keys.
+ */
+static inline cl_long
+orderedKey(float value)
+{
+    cl_int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? (cl_long)INT_MIN - (cl_long)bits : (cl_long)bits;
+}
+
+static inline cl_ulong
+ulpDistance(float a, float b)
+{
+    if(a != a || b != b)
+        return (a != a && b != b) ? 0 : ~(cl_ulong)0;
+    cl_long ka = orderedKey(a);
+    cl_long kb = orderedKey(b);
+    return ka > kb ? (cl_ulong)(ka - kb) : (cl_ulong)(kb - ka);
+}
+
+static inline cl_long
+orderedKey(double value)
+{
+    cl_long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? (cl_long)(-9223372036854775807LL - 1) - bits : bits;
+}
+
+static inline cl_ulong
+ulpDistance(double a, double b)
+{
+    if(a != a || b != b)
+        return (a != a && b != b) ? 0 : ~(cl_ulong)0;
+    cl_long ka = orderedKey(a);
+    cl_long kb = orderedKey(b);
+    return ka > kb ? (cl_ulong)ka - (cl_ulong)kb : (cl_ulong)kb - (cl_ulong)ka;
+}
+
+template<typename T>
+static inline cl_ulong
+ulpDistance(T a, T b)
+{
+    return a > b ? (cl_ulong)a - (cl_ulong)b : (cl_ulong)b - (cl_ulong)a;
+}
+
+static inline int
+ulpBin(cl_ulong ulp)
+{
+    int bin = 0;
+    while(ulp != 0)
+    {
+        ++bin;
+        ulp >>= 1;
+    }
+    return bin;
+}
+
+/* Accumulates the squared error and reference of one element */
+template<typename T>
+static inline size_t
+accumulateError(T ref, T value, double &absError, double &errorSq, double &refSq)
+{
+    double diff = ref == value ? 0.0 : (double)ref - (double)value;
+    absError = diff < 0.0 ? -diff : diff;
+    errorSq += diff * diff;
+    refSq += (double)ref * (double)ref;
+    return ref == value ? 0 : 1;
+}
+
+/* Work of one host thread of compareDetailed */
+template<typename T>
+struct CompareChunk
+{
+    const T *refData;
+    const T *data;
+    size_t begin;
+    size_t end;
+    const CompareOptions *options;
+    CompareStats stats;
+    double errorSq;
+    double refSq;
+};
+
+static void
+clearCompareStats(CompareStats &stats)
+{
+    stats.length = 0;
+    stats.mismatchCount = 0;
+    stats.maxAbsError = 0.0;
+    stats.maxAbsErrorIndex = 0;
+    stats.maxRelError = 0.0;
+    stats.maxRelErrorIndex = 0;
+    stats.l2RelError = 0.0;
+    stats.l2RefNorm = 0.0;
+    stats.maxUlp = 0;
+    memset(stats.ulpHistogram, 0, sizeof(stats.ulpHistogram));
+    stats.mismatches.clear();
+}
+
+template<typename T>
+static void*
+compareChunkFunc(void *arg)
+{
+    CompareChunk<T> *chunk = (CompareChunk<T>*)arg;
+    const T *refData = chunk->refData;
+    const T *data = chunk->data;
+    const CompareOptions &options = *chunk->options;
+    CompareStats &stats = chunk->stats;
+
+    const size_t blockSize = 1024;
+    double absErrors[blockSize];
+
+    double errorSq = 0.0;
+    double refSq = 0.0;
+    for(size_t blockBegin = chunk->begin; blockBegin < chunk->end; blockBegin += blockSize)
+    {
+        size_t n = std::min(blockSize, chunk->end - blockBegin);
+        const T *r = refData + blockBegin;
+        const T *d = data + blockBegin;
+
+        // Branch free pass over the block (vectorizable)
+        // Four independent accumulators per sum to keep the pipelines busy
+        double blockErrorSq[4] = {0.0, 0.0, 0.0, 0.0};
+        double blockRefSq[4] = {0.0, 0.0, 0.0, 0.0};
+        size_t blockDiffers = 0;
+        size_t i = 0;
+        for(; i + 4 <= n; i += 4)
+        {
+            for(size_t lane = 0; lane < 4; ++lane)
+            {
+                blockDiffers += accumulateError(r[i + lane], d[i + lane], absErrors[i + lane],
+                                                blockErrorSq[lane], blockRefSq[lane]);
+            }
+        }
+        for(; i < n; ++i)
+        {
+            blockDiffers += accumulateError(r[i], d[i], absErrors[i],
+                                            blockErrorSq[0], blockRefSq[0]);
+        }
+        errorSq += (blockErrorSq[0] + blockErrorSq[1]) + (blockErrorSq[2] + blockErrorSq[3]);
+        refSq += (blockRefSq[0] + blockRefSq[1]) + (blockRefSq[2] + blockRefSq[3]);
+
+        // Whole block matches
+        if(blockDiffers == 0)
+        {
+            stats.ulpHistogram[0] += n;
+            continue;
+        }
+
+        // Detailed pass only has to classify each element
+        for(size_t i = 0; i < n; ++i)
+        {
+            cl_ulong ulp = ulpDistance(r[i], d[i]);
+            stats.ulpHistogram[ulpBin(ulp)]++;
+            if(ulp > stats.maxUlp)
+                stats.maxUlp = ulp;
+
+            if(ulp == 0)
+                continue;
+
+            double absError = absErrors[i];
+            if(absError != absError)
+                absError = HUGE_VAL;
+
+            double absRef = (double)r[i] < 0.0 ? -(double)r[i] : (double)r[i];
+            double relError = absRef > 0.0 ? absError / absRef : HUGE_VAL;
+
+            if(absError > stats.maxAbsError)
+            {
+                stats.maxAbsError = absError;
+                stats.maxAbsErrorIndex = blockBegin + i;
+            }
+            if(relError > stats.maxRelError)
+            {
+                stats.maxRelError = relError;
+                stats.maxRelErrorIndex = blockBegin + i;
+            }
+            if(absError > options.absTolerance && relError > options.relTolerance)
+            {
+                stats.mismatchCount++;
+                if(stats.mismatches.size() < options.maxMismatches)
+                    stats.mismatches.push_back(blockBegin + i);
+            }
+        }
+    }
+
+    chunk->errorSq = errorSq;
+    chunk->refSq = refSq;
+    return NULL;
+}
+
+template<typename T>
 bool
-SDKCommon::compare(const float *refData, const float *data, 
-                        const int length, const float epsilon)
+SDKCommon::compareDetailed(const T *refData, const T *data, size_t length,
+                           CompareStats &stats, const CompareOptions &options)
+{
+    clearCompareStats(stats);
+    stats.length = length;
+    if(refData == NULL || data == NULL || length == 0)
+        return length == 0;
+
+    // Small inputs are not worth the threads
+    const size_t minChunk = 1 << 16;
+    size_t numThreads = options.numThreads ? options.numThreads
+                                            : SDKThreadPool::getInstance().getNumThreads();
+    numThreads = std::max((size_t)1, std::min(numThreads, length / minChunk));
+
+    std::vector<CompareChunk<T> > chunks(numThreads);
+    size_t chunkSize = (length + numThreads - 1) / numThreads;
+    for(size_t t = 0; t < numThreads; ++t)
+    {
+        chunks[t].refData = refData;
+        chunks[t].data = data;
+        chunks[t].begin = std::min(length, t * chunkSize);
+        chunks[t].end = std::min(length, (t + 1) * chunkSize);
+        chunks[t].options = &options;
+        clearCompareStats(chunks[t].stats);
+    }
+
+    runOnHostThreads(compareChunkFunc<T>, chunks);
+
+    // Merge in chunk order so the recorded mismatches are the first ones
+    double errorSq = 0.0;
+    double refSq = 0.0;
+    for(size_t t = 0; t < numThreads; ++t)
+    {
+        const CompareStats &chunkStats = chunks[t].stats;
+        errorSq += chunks[t].errorSq;
+        refSq += chunks[t].refSq;
+        stats.mismatchCount += chunkStats.mismatchCount;
+        for(size_t i = 0; i < chunkStats.mismatches.size() &&
+                          stats.mismatches.size() < options.maxMismatches; ++i)
+        {
+            stats.mismatches.push_back(chunkStats.mismatches[i]);
+        }
+        if(chunkStats.maxAbsError > stats.maxAbsError)
+        {
+            stats.maxAbsError = chunkStats.maxAbsError;
+            stats.maxAbsErrorIndex = chunkStats.maxAbsErrorIndex;
+        }
+        if(chunkStats.maxRelError > stats.maxRelError)
+        {
+            stats.maxRelError = chunkStats.maxRelError;
+            stats.maxRelErrorIndex = chunkStats.maxRelErrorIndex;
+        }
+        if(chunkStats.maxUlp > stats.maxUlp)
+            stats.maxUlp = chunkStats.maxUlp;
+        for(int b = 0; b < SDK_ULP_HISTOGRAM_BINS; ++b)
+            stats.ulpHistogram[b] += chunkStats.ulpHistogram[b];
+    }
+
+    stats.l2RefNorm = ::sqrt(refSq);
+    stats.l2RelError = stats.l2RefNorm > 0.0 ? ::sqrt(errorSq) / stats.l2RefNorm
+                                             : (errorSq > 0.0 ? HUGE_VAL : 0.0);
+
+    return stats.mismatchCount == 0;
+}
+
+void
+SDKCommon::printCompareStats(const CompareStats &stats)
 {
-    float error = 0.0f;
-    float ref = 0.0f;
+    std::cout << "Compared " << stats.length << " values, "
+              << stats.mismatchCount << " out of tolerance" << std::endl;
+    std::cout << "Max absolute error : " << stats.maxAbsError
+              << " at " << stats.maxAbsErrorIndex << std::endl;
+    std::cout << "Max relative error : " << stats.maxRelError
+              << " at " << stats.maxRelErrorIndex << std::endl;
+    std::cout << "Relative L2 error  : " << stats.l2RelError << std::endl;
+    std::cout << "Max ULP distance   : " << stats.maxUlp << std::endl;
+
+    std::cout << "ULP histogram      :" << std::endl;
+    for(int b = 0; b < SDK_ULP_HISTOGRAM_BINS; ++b)
+    {
+        if(stats.ulpHistogram[b] == 0)
+            continue;
+        if(b == 0)
+            std::cout << "    0 : ";
+        else
+            std::cout << "    [2^" << b - 1 << ", 2^" << b << ") : ";
+        std::cout << stats.ulpHistogram[b] << std::endl;
+    }
 
-    for(int i = 1; i < length; ++i) 
+    if(stats.mismatches.size() != 0)
     {
-        float diff = refData[i] - data[i];
-        error += diff * diff;
-        ref += refData[i] * refData[i];
+        std::cout << "First mismatches at :";
+        for(size_t i = 0; i < stats.mismatches.size(); ++i)
+            std::cout << " " << stats.mismatches[i];
+        std::cout << std::endl;
     }
+}
 
-    float normRef =::sqrtf((float) ref);
-    if (::fabs((float) ref) < 1e-7f) {
+bool
+SDKCommon::compare(const float *refData, const float *data, 
+                        const int length, const float epsilon)
+{
+    CompareStats stats;
+    compareDetailed(refData, data, length > 0 ? (size_t)length : 0, stats);
+
+    if (::fabs(stats.l2RefNorm * stats.l2RefNorm) < 1e-7) {
         return false;
     }
-    float normError = ::sqrtf((float) error);
-    error = normError / normRef;
 
-    return error < epsilon;
+    return stats.l2RelError < epsilon;
 }
 
 bool
 SDKCommon::compare(const double *refData, const double *data, 
                         const int length, const double epsilon)
 {
-    double error = 0.0;
-    double ref = 0.0;
+    CompareStats stats;
+    compareDetailed(refData, data, length > 0 ? (size_t)length : 0, stats);
 
-    for(int i = 1; i < length; ++i) 
-    {
-        double diff = refData[i] - data[i];
-        error += diff * diff;
-        ref += refData[i] * refData[i];
-    }
-
-    double normRef =::sqrt((double) ref);
-    if (::fabs((double) ref) < 1e-7) {
+    if (::fabs(stats.l2RefNorm * stats.l2RefNorm) < 1e-7) {
         return false;
     }
-    double normError = ::sqrt((double) error);
-    error = normError / normRef;
 
-    return error < epsilon;
+    return stats.l2RelError < epsilon;
 }
 
 size_t
@@ -1706,109 +2224,144 @@ SDKCommon::getLocalThreads(const size_t globalThreads,
     return SDK_SUCCESS;
 }
 
-int SDKCommon::createTimer()
+/*
+ * Timing backend.
+ * Windows uses QueryPerformanceCounter. Everywhere else the monotonic clock
+ * is read with nanosecond resolution; define SDK_TIMER_USE_TSC on x86 to read
+ * the time stamp counter instead (calibrated once against the monotonic clock).
+ */
+#ifndef _WIN32
+static long long
+queryMonotonicNs()
 {
-    Timer* newTimer = new Timer;
-    newTimer->_start = 0;
-    newTimer->_clocks = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + (long long)ts.tv_nsec;
+}
+#endif
+
+static long long
+queryTimerFrequency()
+{
+    static long long freq = 0;
+    if(freq != 0)
+        return freq;
 
 #ifdef _WIN32
-    QueryPerformanceFrequency((LARGE_INTEGER*)&newTimer->_freq);
+    QueryPerformanceFrequency((LARGE_INTEGER*)&freq);
+#elif defined(SDK_TIMER_USE_TSC)
+    long long ns0 = queryMonotonicNs();
+    long long tsc0 = (long long)__rdtsc();
+    usleep(20000);
+    long long ns1 = queryMonotonicNs();
+    long long tsc1 = (long long)__rdtsc();
+    freq = (long long)((double)(tsc1 - tsc0) * 1.0E9 / (double)(ns1 - ns0));
 #else
-    newTimer->_freq = (long long)1.0E3;
+    freq = 1000000000LL;
 #endif
-    
-    /* Push back the address of new Timer instance created */
-    _timers.push_back(newTimer);
 
-    /*if(_numTimers == 1)
-    {
-        _timers = newTimer; 
-    }
-    else
-    {
-        Timer *save = _timers;
+    return freq;
+}
+
+static long long
+queryTimerTicks()
+{
+    long long n = 0;
+#ifdef _WIN32
+    QueryPerformanceCounter((LARGE_INTEGER*)&n);
+#elif defined(SDK_TIMER_USE_TSC)
+    n = (long long)__rdtsc();
+#else
+    n = queryMonotonicNs();
+#endif
+    return n;
+}
 
-        _timers = new Timer[_numTimers];
-        memcpy(_timers,save,sizeof(Timer)*(_numTimers-1));
-        _timers[_numTimers-1] = *newTimer;
-        delete newTimer;
-        newTimer = 0;
+/* Clears the accumulated time and the interval history of a timer */
+static void
+clearTimer(Timer *timer)
+{
+    timer->_start = 0;
+    timer->_clocks = 0;
+    timer->_count = 0;
+    timer->_min = 0;
+    timer->_max = 0;
+    timer->_mean = 0.0;
+    timer->_m2 = 0.0;
+    timer->_samples.clear();
+}
 
-        if(_numTimers <= 2 )
-        {
-            delete save; 
-        }
-        else
-        {
-            delete[] save;
-        }
-        save = 0;
-    }*/
+int SDKCommon::createTimer()
+{
+    Timer* newTimer = new Timer;
+    clearTimer(newTimer);
+    newTimer->_freq = queryTimerFrequency();
+    
+    /* Push back the address of new Timer instance created */
+    _timers.push_back(newTimer);
 
     return (int)(_timers.size() - 1);
 }
 
 int SDKCommon::resetTimer(int handle)
 {
-    if(handle >= (int)_timers.size())
+    if(handle < 0 || handle >= (int)_timers.size())
     {
         error("Cannot reset timer. Invalid handle.");
         return -1;
     }
 
-    (_timers[handle]->_start) = 0;
-    (_timers[handle]->_clocks) = 0;
+    clearTimer(_timers[handle]);
     return SDK_SUCCESS;
 }
 
 int SDKCommon::startTimer(int handle)
 {
-    if(handle >= (int)_timers.size())
+    if(handle < 0 || handle >= (int)_timers.size())
     {
-        error("Cannot reset timer. Invalid handle.");
+        error("Cannot start timer. Invalid handle.");
         return SDK_FAILURE;
     }
 
-#ifdef _WIN32
-    QueryPerformanceCounter((LARGE_INTEGER*)&(_timers[handle]->_start));	
-#else
-    struct timeval s;
-    gettimeofday(&s, 0);
-    _timers[handle]->_start = (long long)s.tv_sec * (long long)1.0E3 + (long long)s.tv_usec / (long long)1.0E3;
-#endif
+    _timers[handle]->_start = queryTimerTicks();
 
     return SDK_SUCCESS;
 }
 
 int SDKCommon::stopTimer(int handle)
 {
-    long long n=0;
+    long long n = queryTimerTicks();
 
-    if(handle >= (int)_timers.size())
+    if(handle < 0 || handle >= (int)_timers.size())
     {
-        error("Cannot reset timer. Invalid handle.");
+        error("Cannot stop timer. Invalid handle.");
         return SDK_FAILURE;
     }
 
-#ifdef _WIN32
-    QueryPerformanceCounter((LARGE_INTEGER*)&(n));	
-#else
-    struct timeval s;
-    gettimeofday(&s, 0);
-    n = (long long)s.tv_sec * (long long)1.0E3+ (long long)s.tv_usec / (long long)1.0E3;
-#endif
+    Timer *timer = _timers[handle];
+    n -= timer->_start;
+    timer->_start = 0;
+    timer->_clocks += n;
 
-    n -= _timers[handle]->_start;
-    _timers[handle]->_start = 0;
-    _timers[handle]->_clocks += n;
+    /* Update running statistics (Welford) and the interval history */
+    timer->_count++;
+    if(timer->_count == 1 || n < timer->_min)
+        timer->_min = n;
+    if(timer->_count == 1 || n > timer->_max)
+        timer->_max = n;
+    double delta = (double)n - timer->_mean;
+    timer->_mean += delta / (double)timer->_count;
+    timer->_m2 += delta * ((double)n - timer->_mean);
+
+    if(timer->_samples.size() < SDK_TIMER_MAX_SAMPLES)
+        timer->_samples.push_back(n);
 
     return SDK_SUCCESS;
 }
 
 double SDKCommon::readTimer(int handle)
 {
-    if(handle >= (int)_timers.size())
+    if(handle < 0 || handle >= (int)_timers.size())
     {
         error("Cannot read timer. Invalid handle.");
         return SDK_FAILURE;
@@ -1820,6 +2373,46 @@ double SDKCommon::readTimer(int handle)
     return reading;
 }
 
+int SDKCommon::getTimerStats(int handle, TimerStats &stats)
+{
+    if(handle < 0 || handle >= (int)_timers.size())
+    {
+        error("Cannot read timer statistics. Invalid handle.");
+        return SDK_FAILURE;
+    }
+
+    Timer *timer = _timers[handle];
+    double freq = (double)timer->_freq;
+
+    memset(&stats, 0, sizeof(TimerStats));
+    stats.count = timer->_count;
+    stats.total = (double)timer->_clocks / freq;
+    if(timer->_count == 0)
+        return SDK_SUCCESS;
+
+    stats.min = (double)timer->_min / freq;
+    stats.max = (double)timer->_max / freq;
+    stats.mean = timer->_mean / freq;
+    if(timer->_count > 1)
+        stats.stddev = ::sqrt(timer->_m2 / (double)(timer->_count - 1)) / freq;
+
+    /* Percentiles come from the recorded history */
+    std::vector<long long> sorted(timer->_samples);
+    std::sort(sorted.begin(), sorted.end());
+    size_t last = sorted.size() - 1;
+    stats.median = (double)sorted[last / 2] / freq;
+    if(sorted.size() % 2 == 0)
+        stats.median = 0.5 * ((double)sorted[last / 2] + (double)sorted[last / 2 + 1]) / freq;
+    stats.p99 = (double)sorted[(size_t)::ceil(0.99 * (double)last)] / freq;
+
+    return SDK_SUCCESS;
+}
+
+double SDKCommon::getTimerResolution()
+{
+    return 1.0 / (double)queryTimerFrequency();
+}
+
 void SDKCommon::printTable(Table *t)
 {
     if(t == NULL)
@@ -2022,6 +2615,31 @@ int SDKCommon::fillConstant(long * arrayPtr,
         const long val);
 
 
+template
+bool SDKCommon::compareDetailed<float>(const float*, const float*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<double>(const double*, const double*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<char>(const char*, const char*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<unsigned char>(const unsigned char*, const unsigned char*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<short>(const short*, const short*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<unsigned short>(const unsigned short*, const unsigned short*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<int>(const int*, const int*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<unsigned int>(const unsigned int*, const unsigned int*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<long>(const long*, const long*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<unsigned long>(const unsigned long*, const unsigned long*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<long long>(const long long*, const long long*, size_t, CompareStats&, const CompareOptions&);
+template
+bool SDKCommon::compareDetailed<unsigned long long>(const unsigned long long*, const unsigned long long*, size_t, CompareStats&, const CompareOptions&);
+
 template
 const char* getOpenCLErrorCodeStr<int>(int input);
 
@@ -25,6 +25,14 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define GETCWD ::getcwd
 #endif // !_WIN32
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 namespace streamsdk
 {
 
@@ -62,8 +70,8 @@ SDKFile::readBinaryFromFile(const char* fileName)
 {
     FILE * input = NULL;
     size_t size = 0;
-    char* binary = NULL;
 
+    unmap();
     input = fopen(fileName, "rb");
     if(input == NULL)
     {
@@ -73,20 +81,103 @@ SDKFile::readBinaryFromFile(const char* fileName)
     fseek(input, 0L, SEEK_END); 
     size = ftell(input);
     rewind(input);
-    binary = (char*)malloc(size);
-    if(binary == NULL)
+
+    // Read straight into the string, no intermediate buffer
+    source_.resize(size);
+    if(size != 0 && fread(&source_[0], sizeof(char), size, input) != size)
     {
+        fclose(input);
+        source_.clear();
         return SDK_FAILURE;
     }
-    fread(binary, sizeof(char), size, input);
     fclose(input);
-    source_.assign(binary, size);
-    free(binary);
 
     return SDK_SUCCESS;
 }
 
 
+bool
+SDKFile::map(const char* fileName)
+{
+    unmap();
+    source_.clear();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName,
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    if(fileSize.QuadPart != 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapping != NULL)
+        {
+            view_ = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            viewSize_ = view_ ? (size_t)fileSize.QuadPart : 0;
+            // The view keeps the mapping alive
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = ::open(fileName, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    if(S_ISREG(fileStat.st_mode) && fileStat.st_size != 0)
+    {
+        void* view = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(view != MAP_FAILED)
+        {
+            view_ = (const char*)view;
+            viewSize_ = (size_t)fileStat.st_size;
+        }
+    }
+    close(fd);
+#endif
+
+    // Empty files and files that cannot be mapped are read instead
+    if(view_ == NULL)
+        return readBinaryFromFile(fileName) == SDK_SUCCESS;
+
+    return true;
+}
+
+
+void
+SDKFile::unmap()
+{
+    if(view_ == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(view_);
+#else
+    munmap((void*)view_, viewSize_);
+#endif
+    view_ = NULL;
+    viewSize_ = 0;
+}
 
 
 bool
@@ -96,6 +187,8 @@ SDKFile::open(
     size_t      size;
     char*       str;
 
+    unmap();
+
     // Open file stream
     std::fstream f(fileName, (std::fstream::in | std::fstream::binary));
 
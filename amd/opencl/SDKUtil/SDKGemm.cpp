@@ -0,0 +1,471 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#include "SDKGemm.hpp"
+#include "SDKThreadPool.hpp"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define SDK_GEMM_SSE2
+#define SDK_GEMM_AVX __attribute__((target("avx,fma")))
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SDK_GEMM_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * Columns of a B panel handled by one task, a multiple of every kernel's nr
+ */
+#define GEMM_COLUMN_CHUNK 256
+
+/**
+ * Largest register tile of all kernels (mr * nr)
+ */
+#define GEMM_MAX_TILE 96
+
+namespace streamsdk
+{
+
+/**
+ * Micro-kernel and the blocking that goes with it.
+ * run() adds the product of an A strip (mr values per step) and a B strip
+ * (nr values per step) over kc steps to the mr x nr tile at c
+ */
+template<typename T>
+struct GemmKernel
+{
+    void (*run)(size_t kc, const T *a, const T *b, T *c, size_t ldc);
+    size_t mr, nr;      /**< register tile */
+    size_t mc;          /**< rows of a packed block of A (L2) */
+    size_t kc;          /**< depth of the packed blocks */
+    size_t nc;          /**< columns of a packed panel of B (L3) */
+};
+
+template<typename T, int MR, int NR>
+static void
+kernelScalar(size_t kc, const T *a, const T *b, T *c, size_t ldc)
+{
+    T acc[MR][NR];
+    for(int r = 0; r < MR; ++r)
+        for(int j = 0; j < NR; ++j)
+            acc[r][j] = 0;
+
+    for(size_t l = 0; l < kc; ++l, a += MR, b += NR)
+    {
+        for(int r = 0; r < MR; ++r)
+            for(int j = 0; j < NR; ++j)
+                acc[r][j] += a[r] * b[j];
+    }
+
+    for(int r = 0; r < MR; ++r)
+        for(int j = 0; j < NR; ++j)
+            c[r * ldc + j] += acc[r][j];
+}
+
+#ifdef SDK_GEMM_SSE2
+/*
+ * 4 x 8 floats, 8 accumulators
+ */
+#define GEMM_ROW_SSE_F(r) \
+    { \
+        __m128 ar = _mm_set1_ps(a[r]); \
+        c##r##0 = _mm_add_ps(c##r##0, _mm_mul_ps(ar, b0)); \
+        c##r##1 = _mm_add_ps(c##r##1, _mm_mul_ps(ar, b1)); \
+    }
+#define GEMM_STORE_SSE_F(r) \
+    { \
+        _mm_storeu_ps(c + r * ldc, _mm_add_ps(_mm_loadu_ps(c + r * ldc), c##r##0)); \
+        _mm_storeu_ps(c + r * ldc + 4, _mm_add_ps(_mm_loadu_ps(c + r * ldc + 4), c##r##1)); \
+    }
+
+static void
+kernelFloatSSE(size_t kc, const float *a, const float *b, float *c, size_t ldc)
+{
+    __m128 c00 = _mm_setzero_ps(), c01 = c00, c10 = c00, c11 = c00;
+    __m128 c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+
+    for(size_t l = 0; l < kc; ++l, a += 4, b += 8)
+    {
+        __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4);
+        GEMM_ROW_SSE_F(0) GEMM_ROW_SSE_F(1) GEMM_ROW_SSE_F(2) GEMM_ROW_SSE_F(3)
+    }
+
+    GEMM_STORE_SSE_F(0) GEMM_STORE_SSE_F(1) GEMM_STORE_SSE_F(2) GEMM_STORE_SSE_F(3)
+}
+
+/*
+ * 4 x 4 doubles, 8 accumulators
+ */
+#define GEMM_ROW_SSE_D(r) \
+    { \
+        __m128d ar = _mm_set1_pd(a[r]); \
+        c##r##0 = _mm_add_pd(c##r##0, _mm_mul_pd(ar, b0)); \
+        c##r##1 = _mm_add_pd(c##r##1, _mm_mul_pd(ar, b1)); \
+    }
+#define GEMM_STORE_SSE_D(r) \
+    { \
+        _mm_storeu_pd(c + r * ldc, _mm_add_pd(_mm_loadu_pd(c + r * ldc), c##r##0)); \
+        _mm_storeu_pd(c + r * ldc + 2, _mm_add_pd(_mm_loadu_pd(c + r * ldc + 2), c##r##1)); \
+    }
+
+static void
+kernelDoubleSSE(size_t kc, const double *a, const double *b, double *c, size_t ldc)
+{
+    __m128d c00 = _mm_setzero_pd(), c01 = c00, c10 = c00, c11 = c00;
+    __m128d c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+
+    for(size_t l = 0; l < kc; ++l, a += 4, b += 4)
+    {
+        __m128d b0 = _mm_loadu_pd(b), b1 = _mm_loadu_pd(b + 2);
+        GEMM_ROW_SSE_D(0) GEMM_ROW_SSE_D(1) GEMM_ROW_SSE_D(2) GEMM_ROW_SSE_D(3)
+    }
+
+    GEMM_STORE_SSE_D(0) GEMM_STORE_SSE_D(1) GEMM_STORE_SSE_D(2) GEMM_STORE_SSE_D(3)
+}
+#endif
+
+#ifdef SDK_GEMM_AVX
+static bool
+hasAVX()
+{
+    return __builtin_cpu_supports("avx") && __builtin_cpu_supports("fma");
+}
+
+/*
+ * 6 x 16 floats, 12 accumulators
+ */
+#define GEMM_ROW_AVX_F(r) \
+    { \
+        __m256 ar = _mm256_broadcast_ss(a + r); \
+        c##r##0 = _mm256_fmadd_ps(ar, b0, c##r##0); \
+        c##r##1 = _mm256_fmadd_ps(ar, b1, c##r##1); \
+    }
+#define GEMM_STORE_AVX_F(r) \
+    { \
+        _mm256_storeu_ps(c + r * ldc, _mm256_add_ps(_mm256_loadu_ps(c + r * ldc), c##r##0)); \
+        _mm256_storeu_ps(c + r * ldc + 8, _mm256_add_ps(_mm256_loadu_ps(c + r * ldc + 8), c##r##1)); \
+    }
+
+SDK_GEMM_AVX static void
+kernelFloatAVX(size_t kc, const float *a, const float *b, float *c, size_t ldc)
+{
+    __m256 c00 = _mm256_setzero_ps(), c01 = c00, c10 = c00, c11 = c00;
+    __m256 c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+    __m256 c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+
+    for(size_t l = 0; l < kc; ++l, a += 6, b += 16)
+    {
+        __m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8);
+        GEMM_ROW_AVX_F(0) GEMM_ROW_AVX_F(1) GEMM_ROW_AVX_F(2)
+        GEMM_ROW_AVX_F(3) GEMM_ROW_AVX_F(4) GEMM_ROW_AVX_F(5)
+    }
+
+    GEMM_STORE_AVX_F(0) GEMM_STORE_AVX_F(1) GEMM_STORE_AVX_F(2)
+    GEMM_STORE_AVX_F(3) GEMM_STORE_AVX_F(4) GEMM_STORE_AVX_F(5)
+}
+
+/*
+ * 6 x 8 doubles, 12 accumulators
+ */
+#define GEMM_ROW_AVX_D(r) \
+    { \
+        __m256d ar = _mm256_broadcast_sd(a + r); \
+        c##r##0 = _mm256_fmadd_pd(ar, b0, c##r##0); \
+        c##r##1 = _mm256_fmadd_pd(ar, b1, c##r##1); \
+    }
+#define GEMM_STORE_AVX_D(r) \
+    { \
+        _mm256_storeu_pd(c + r * ldc, _mm256_add_pd(_mm256_loadu_pd(c + r * ldc), c##r##0)); \
+        _mm256_storeu_pd(c + r * ldc + 4, _mm256_add_pd(_mm256_loadu_pd(c + r * ldc + 4), c##r##1)); \
+    }
+
+SDK_GEMM_AVX static void
+kernelDoubleAVX(size_t kc, const double *a, const double *b, double *c, size_t ldc)
+{
+    __m256d c00 = _mm256_setzero_pd(), c01 = c00, c10 = c00, c11 = c00;
+    __m256d c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+    __m256d c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+
+    for(size_t l = 0; l < kc; ++l, a += 6, b += 8)
+    {
+        __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+        GEMM_ROW_AVX_D(0) GEMM_ROW_AVX_D(1) GEMM_ROW_AVX_D(2)
+        GEMM_ROW_AVX_D(3) GEMM_ROW_AVX_D(4) GEMM_ROW_AVX_D(5)
+    }
+
+    GEMM_STORE_AVX_D(0) GEMM_STORE_AVX_D(1) GEMM_STORE_AVX_D(2)
+    GEMM_STORE_AVX_D(3) GEMM_STORE_AVX_D(4) GEMM_STORE_AVX_D(5)
+}
+#endif
+
+/*
+ * Kernel selection, the blocks keep a packed block of A in L2 and
+ * a strip of B (nr x kc) in L1
+ */
+static GemmKernel<float>
+selectKernel(const float *)
+{
+    GemmKernel<float> kernel;
+    kernel.mc = 96;
+    kernel.kc = 256;
+    kernel.nc = 3072;
+#if defined(SDK_GEMM_AVX)
+    if(hasAVX())
+    {
+        kernel.run = kernelFloatAVX;
+        kernel.mr = 6;
+        kernel.nr = 16;
+        return kernel;
+    }
+#endif
+#if defined(SDK_GEMM_SSE2)
+    kernel.run = kernelFloatSSE;
+    kernel.mr = 4;
+    kernel.nr = 8;
+#else
+    kernel.run = kernelScalar<float, 4, 4>;
+    kernel.mr = 4;
+    kernel.nr = 4;
+#endif
+    return kernel;
+}
+
+static GemmKernel<double>
+selectKernel(const double *)
+{
+    GemmKernel<double> kernel;
+    kernel.mc = 72;
+    kernel.kc = 256;
+    kernel.nc = 2048;
+#if defined(SDK_GEMM_AVX)
+    if(hasAVX())
+    {
+        kernel.run = kernelDoubleAVX;
+        kernel.mr = 6;
+        kernel.nr = 8;
+        return kernel;
+    }
+#endif
+#if defined(SDK_GEMM_SSE2)
+    kernel.run = kernelDoubleSSE;
+    kernel.mr = 4;
+    kernel.nr = 4;
+#else
+    kernel.run = kernelScalar<double, 4, 4>;
+    kernel.mr = 4;
+    kernel.nr = 4;
+#endif
+    return kernel;
+}
+
+/*
+ * Zeroes rows [begin, end) of C
+ */
+template<typename T>
+struct GemmClear
+{
+    T *c;
+    size_t ldc, n;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t i = begin; i < end; ++i)
+            memset(c + i * ldc, 0, n * sizeof(T));
+    }
+};
+
+/*
+ * Packs strips [begin, end) of nr columns of the depth x width panel of B
+ * at b, step by step, zero padding the last strip
+ */
+template<typename T>
+struct GemmPackB
+{
+    const T *b;
+    size_t ldb, depth, width, nr;
+    T *packed;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t s = begin; s < end; ++s)
+        {
+            size_t j = s * nr;
+            size_t w = std::min(nr, width - j);
+            T *dst = packed + s * nr * depth;
+            for(size_t l = 0; l < depth; ++l, dst += nr)
+            {
+                const T *src = b + l * ldb + j;
+                for(size_t x = 0; x < w; ++x)
+                    dst[x] = src[x];
+                for(size_t x = w; x < nr; ++x)
+                    dst[x] = 0;
+            }
+        }
+    }
+};
+
+/*
+ * Packs a rows x depth block of A at a into strips of mr rows,
+ * step by step, zero padding the last strip
+ */
+template<typename T>
+static void
+packA(const T *a, size_t lda, size_t rows, size_t depth, size_t mr, T *dst)
+{
+    for(size_t i = 0; i < rows; i += mr)
+    {
+        size_t h = std::min(mr, rows - i);
+        for(size_t l = 0; l < depth; ++l, dst += mr)
+        {
+            for(size_t r = 0; r < h; ++r)
+                dst[r] = a[(i + r) * lda + l];
+            for(size_t r = h; r < mr; ++r)
+                dst[r] = 0;
+        }
+    }
+}
+
+/*
+ * Multiplies macro-tiles with the packed panel of B. Task t covers the
+ * block of A t / numChunks and the column chunk t % numChunks, so a range
+ * of tasks packs each block of A once
+ */
+template<typename T>
+struct GemmMacroTiles
+{
+    const GemmKernel<T> *kernel;
+    const T *a;
+    size_t lda;
+    const T *packedB;
+    T *c;
+    size_t ldc;
+    size_t m, width, depth, numChunks;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        const size_t mr = kernel->mr, nr = kernel->nr;
+        std::vector<T> packedA(kernel->mc * depth);
+        T tile[GEMM_MAX_TILE];
+        size_t packedBlock = (size_t)-1;
+
+        for(size_t t = begin; t < end; ++t)
+        {
+            size_t block = t / numChunks;
+            size_t i0 = block * kernel->mc;
+            size_t rows = std::min(kernel->mc, m - i0);
+            if(block != packedBlock)
+            {
+                packA(a + i0 * lda, lda, rows, depth, mr, &packedA[0]);
+                packedBlock = block;
+            }
+
+            size_t j0 = (t % numChunks) * GEMM_COLUMN_CHUNK;
+            size_t j1 = std::min(j0 + GEMM_COLUMN_CHUNK, width);
+            for(size_t j = j0; j < j1; j += nr)
+            {
+                size_t w = std::min(nr, width - j);
+                const T *strideB = packedB + (j / nr) * nr * depth;
+                for(size_t i = 0; i < rows; i += mr)
+                {
+                    size_t h = std::min(mr, rows - i);
+                    const T *strideA = &packedA[0] + (i / mr) * mr * depth;
+                    T *out = c + (i0 + i) * ldc + j;
+                    if(h == mr && w == nr)
+                    {
+                        kernel->run(depth, strideA, strideB, out, ldc);
+                        continue;
+                    }
+
+                    // edge tile: full kernel into a scratch tile
+                    for(size_t x = 0; x < mr * nr; ++x)
+                        tile[x] = 0;
+                    kernel->run(depth, strideA, strideB, tile, nr);
+                    for(size_t r = 0; r < h; ++r)
+                        for(size_t x = 0; x < w; ++x)
+                            out[r * ldc + x] += tile[r * nr + x];
+                }
+            }
+        }
+    }
+};
+
+template<typename T>
+static void
+gemmBlocked(const GemmKernel<T> &kernel, size_t m, size_t n, size_t k,
+            const T *a, size_t lda, const T *b, size_t ldb,
+            T *c, size_t ldc, bool accumulate)
+{
+    if(m == 0 || n == 0)
+        return;
+
+    SDKThreadPool &pool = SDKThreadPool::getInstance();
+    if(!accumulate)
+    {
+        GemmClear<T> clear = {c, ldc, n};
+        pool.parallelFor(0, m, clear);
+    }
+    if(k == 0)
+        return;
+
+    size_t maxWidth = std::min(kernel.nc, n);
+    std::vector<T> packedB(((maxWidth + kernel.nr - 1) / kernel.nr) * kernel.nr * std::min(kernel.kc, k));
+    size_t numBlocks = (m + kernel.mc - 1) / kernel.mc;
+
+    for(size_t jc = 0; jc < n; jc += kernel.nc)
+    {
+        size_t width = std::min(kernel.nc, n - jc);
+        size_t numStrips = (width + kernel.nr - 1) / kernel.nr;
+        size_t numChunks = (width + GEMM_COLUMN_CHUNK - 1) / GEMM_COLUMN_CHUNK;
+
+        for(size_t pc = 0; pc < k; pc += kernel.kc)
+        {
+            size_t depth = std::min(kernel.kc, k - pc);
+            GemmPackB<T> pack = {b + pc * ldb + jc, ldb, depth, width, kernel.nr, &packedB[0]};
+            pool.parallelFor(0, numStrips, pack);
+
+            GemmMacroTiles<T> tiles = {&kernel, a + pc, lda, &packedB[0], c + jc, ldc,
+                                       m, width, depth, numChunks};
+            pool.parallelFor(0, numBlocks * numChunks, tiles);
+        }
+    }
+}
+
+void
+gemm(size_t m, size_t n, size_t k,
+     const float *a, size_t lda,
+     const float *b, size_t ldb,
+     float *c, size_t ldc,
+     bool accumulate)
+{
+    static const GemmKernel<float> kernel = selectKernel(a);
+    gemmBlocked(kernel, m, n, k, a, lda, b, ldb, c, ldc, accumulate);
+}
+
+void
+gemm(size_t m, size_t n, size_t k,
+     const double *a, size_t lda,
+     const double *b, size_t ldb,
+     double *c, size_t ldc,
+     bool accumulate)
+{
+    static const GemmKernel<double> kernel = selectKernel(a);
+    gemmBlocked(kernel, m, n, k, a, lda, b, ldb, c, ldc, accumulate);
+}
+
+}
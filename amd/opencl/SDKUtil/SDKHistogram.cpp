@@ -0,0 +1,325 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#include "SDKHistogram.hpp"
+#include "SDKThreadPool.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SDK_HISTOGRAM_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * Copies of a thread's sub-histogram, consecutive values go to different copies
+ */
+#define HISTOGRAM_COPIES 4
+
+/**
+ * Largest bin count that is still replicated, so that all copies of a
+ * 32 bit sub-histogram fit in a 32KB L1 cache
+ */
+#define HISTOGRAM_COPY_BINS 2048
+
+/**
+ * Below this many values per thread a chunk is counted by fewer threads
+ */
+#define HISTOGRAM_MIN_CHUNK 65536
+
+/**
+ * Values counted per round of add(). Keeps every 32 bit counter, and the
+ * sum of a counter over all threads, exact
+ */
+#define HISTOGRAM_MAX_PIECE (1 << 30)
+
+/**
+ * Groups of 4 bins summed by one merge task
+ */
+#define HISTOGRAM_MERGE_GRAIN 1024
+
+namespace streamsdk
+{
+
+/*
+ * Bin of value v. Out of range values go to the discard bin numBins, which
+ * is never reported; the compare is left out when T cannot exceed numBins - 1
+ */
+template<typename T, bool Checked>
+static inline size_t
+histogramBin(T v, size_t numBins)
+{
+    if(Checked)
+        return (size_t)v < numBins ? (size_t)v : numBins;
+    return (size_t)v;
+}
+
+/*
+ * Adds the counters of src[0, n) to dst[0, n), n a multiple of 4
+ */
+static inline void
+histogramAdd(unsigned int *dst, const unsigned int *src, size_t n)
+{
+    size_t i = 0;
+#ifdef SDK_HISTOGRAM_SSE2
+    for(; i < n; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi32(a, b));
+    }
+#endif
+    for(; i < n; ++i)
+        dst[i] += src[i];
+}
+
+/*
+ * Counts the ranges [begin, end) of one round, range r into the
+ * sub-histogram slots + r * copies * stride
+ */
+template<typename T, bool Checked>
+struct HistogramCount
+{
+    const T *data;
+    size_t count;
+    size_t numRanges;
+    size_t numBins;
+    size_t stride;
+    size_t copies;
+    unsigned int *slots;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t r = begin; r < end; ++r)
+        {
+            unsigned int *h = slots + r * copies * stride;
+            const T *v = data + count / numRanges * r + std::min(r, count % numRanges);
+            const T *last = data + count / numRanges * (r + 1) + std::min(r + 1, count % numRanges);
+
+            memset(h, 0, copies * stride * sizeof(unsigned int));
+            if(copies == HISTOGRAM_COPIES)
+            {
+                unsigned int *h1 = h + stride;
+                unsigned int *h2 = h1 + stride;
+                unsigned int *h3 = h2 + stride;
+                if(sizeof(T) == 1 && !Checked)
+                {
+                    // bytes are read 8 at a time and picked out with shifts
+                    for(; v + 8 <= last; v += 8)
+                    {
+                        unsigned long long w;
+                        memcpy(&w, v, sizeof(w));
+                        ++h[w & 0xff];
+                        ++h1[(w >> 8) & 0xff];
+                        ++h2[(w >> 16) & 0xff];
+                        ++h3[(w >> 24) & 0xff];
+                        ++h[(w >> 32) & 0xff];
+                        ++h1[(w >> 40) & 0xff];
+                        ++h2[(w >> 48) & 0xff];
+                        ++h3[w >> 56];
+                    }
+                }
+                for(; v + 8 <= last; v += 8)
+                {
+                    ++h[histogramBin<T, Checked>(v[0], numBins)];
+                    ++h1[histogramBin<T, Checked>(v[1], numBins)];
+                    ++h2[histogramBin<T, Checked>(v[2], numBins)];
+                    ++h3[histogramBin<T, Checked>(v[3], numBins)];
+                    ++h[histogramBin<T, Checked>(v[4], numBins)];
+                    ++h1[histogramBin<T, Checked>(v[5], numBins)];
+                    ++h2[histogramBin<T, Checked>(v[6], numBins)];
+                    ++h3[histogramBin<T, Checked>(v[7], numBins)];
+                }
+                for(; v < last; ++v)
+                    ++h[histogramBin<T, Checked>(*v, numBins)];
+
+                histogramAdd(h, h1, stride);
+                histogramAdd(h2, h3, stride);
+                histogramAdd(h, h2, stride);
+            }
+            else
+            {
+                for(; v < last; ++v)
+                    ++h[histogramBin<T, Checked>(*v, numBins)];
+            }
+        }
+    }
+};
+
+/*
+ * Sums the sub-histograms of numRanges threads over the bin groups
+ * [begin, end) (4 bins each) into the 64 bit totals
+ */
+struct HistogramMerge
+{
+    const unsigned int *slots;
+    size_t numRanges;
+    size_t slotSize;
+    unsigned long long *counts;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t g = begin; g < end; ++g)
+        {
+            const unsigned int *h = slots + g * 4;
+#ifdef SDK_HISTOGRAM_SSE2
+            __m128i sum = _mm_loadu_si128((const __m128i*)h);
+            for(size_t r = 1; r < numRanges; ++r)
+                sum = _mm_add_epi32(sum, _mm_loadu_si128((const __m128i*)(h + r * slotSize)));
+
+            __m128i zero = _mm_setzero_si128();
+            __m128i *c = (__m128i*)(counts + g * 4);
+            _mm_storeu_si128(c, _mm_add_epi64(_mm_loadu_si128(c), _mm_unpacklo_epi32(sum, zero)));
+            _mm_storeu_si128(c + 1, _mm_add_epi64(_mm_loadu_si128(c + 1), _mm_unpackhi_epi32(sum, zero)));
+#else
+            for(int i = 0; i < 4; ++i)
+            {
+                unsigned int sum = h[i];
+                for(size_t r = 1; r < numRanges; ++r)
+                    sum += h[r * slotSize + i];
+                counts[g * 4 + i] += sum;
+            }
+#endif
+        }
+    }
+};
+
+HostHistogram::HostHistogram(size_t numBins)
+    : _numBins(numBins),
+      _stride((numBins + 4) & ~(size_t)3),
+      _copies(numBins <= HISTOGRAM_COPY_BINS ? HISTOGRAM_COPIES : 1),
+      _numSlots(SDKThreadPool::getInstance().getNumThreads()),
+      _slots(NULL),
+      _counts(NULL)
+{
+    // one spare counter past the bins takes the out of range values
+    _slots = (unsigned int*)malloc(_numSlots * _copies * _stride * sizeof(unsigned int));
+    _counts = (unsigned long long*)malloc(_stride * sizeof(unsigned long long));
+    if(_slots == NULL || _counts == NULL)
+    {
+        free(_slots);
+        free(_counts);
+        _slots = NULL;
+        _counts = NULL;
+        return;
+    }
+    reset();
+}
+
+HostHistogram::~HostHistogram()
+{
+    free(_slots);
+    free(_counts);
+}
+
+void
+HostHistogram::reset()
+{
+    if(_counts != NULL)
+        memset(_counts, 0, _stride * sizeof(unsigned long long));
+}
+
+void
+HostHistogram::getCounts(unsigned int *bins) const
+{
+    for(size_t i = 0; i < _numBins; ++i)
+        bins[i] = _counts != NULL ? (unsigned int)_counts[i] : 0;
+}
+
+template<typename T>
+void
+HostHistogram::addValues(const T *data, size_t count)
+{
+    if(!isValid())
+        return;
+
+    SDKThreadPool &pool = SDKThreadPool::getInstance();
+    bool checked = _numBins <= (size_t)(T)~(T)0;
+    while(count > 0)
+    {
+        size_t n = std::min(count, (size_t)HISTOGRAM_MAX_PIECE);
+        size_t numRanges = std::max((size_t)1, std::min(_numSlots, n / HISTOGRAM_MIN_CHUNK));
+
+        if(checked)
+        {
+            HistogramCount<T, true> body = {data, n, numRanges, _numBins, _stride, _copies, _slots};
+            pool.parallelFor(0, numRanges, body, 1);
+        }
+        else
+        {
+            HistogramCount<T, false> body = {data, n, numRanges, _numBins, _stride, _copies, _slots};
+            pool.parallelFor(0, numRanges, body, 1);
+        }
+
+        HistogramMerge merge = {_slots, numRanges, _copies * _stride, _counts};
+        pool.parallelFor(0, _stride / 4, merge, HISTOGRAM_MERGE_GRAIN);
+
+        data += n;
+        count -= n;
+    }
+}
+
+void
+HostHistogram::add(const unsigned char *data, size_t count)
+{
+    addValues(data, count);
+}
+
+void
+HostHistogram::add(const unsigned short *data, size_t count)
+{
+    addValues(data, count);
+}
+
+void
+HostHistogram::add(const unsigned int *data, size_t count)
+{
+    addValues(data, count);
+}
+
+template<typename T>
+static bool
+histogramOnce(const T *data, size_t count, size_t numBins, unsigned int *bins)
+{
+    HostHistogram h(numBins);
+    if(!h.isValid())
+        return false;
+
+    h.add(data, count);
+    h.getCounts(bins);
+    return true;
+}
+
+bool
+histogram(const unsigned char *data, size_t count, size_t numBins, unsigned int *bins)
+{
+    return histogramOnce(data, count, numBins, bins);
+}
+
+bool
+histogram(const unsigned short *data, size_t count, size_t numBins, unsigned int *bins)
+{
+    return histogramOnce(data, count, numBins, bins);
+}
+
+bool
+histogram(const unsigned int *data, size_t count, size_t numBins, unsigned int *bins)
+{
+    return histogramOnce(data, count, numBins, bins);
+}
+
+}
@@ -0,0 +1,669 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#include "SDKMonteCarlo.hpp"
+#include "SDKThreadPool.hpp"
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SDK_MC_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * Paths simulated together: 4 Philox counters of 4 paths each
+ */
+#define MC_BLOCK_PATHS 16
+
+/**
+ * Blocks folded by one reduction task. Fixed, so the order of the partial
+ * sums does not depend on the number of threads
+ */
+#define MC_TASK_BLOCKS 64
+
+/*
+ * Philox4x32-10 constants (Salmon et al., "Parallel random numbers: as easy
+ * as 1, 2, 3", SC 2011)
+ */
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+namespace streamsdk
+{
+
+/**
+ * Everything a path needs, in the precision T of the simulation
+ */
+template<typename T>
+struct AsianParams
+{
+    size_t numPaths;
+    int numSum;
+    T initPrice;
+    T strikePrice;
+    T c1;               /**< drift of the log price per observation */
+    T c2;               /**< volatility of the log price per observation */
+    T c3dt;             /**< (interest + sigma^2 / 2) * time step */
+    T invSigma;
+    T invNumSum;
+    unsigned int key[2];
+};
+
+/**
+ * Undiscounted payoff and vega sums of a range of paths
+ */
+struct AsianSums
+{
+    double price;
+    double vega;
+};
+
+struct AsianSumsCombine
+{
+    AsianSums operator()(const AsianSums &a, const AsianSums &b) const
+    {
+        AsianSums sum = {a.price + b.price, a.vega + b.vega};
+        return sum;
+    }
+};
+
+/*
+ * Adds the payoffs of block paths [16 * block, 16 * block + 16) to sums in
+ * path order, skipping the padding past numPaths. pay[p][l] and
+ * deriv[p][l] belong to path 16 * block + 4 * l + p
+ */
+template<typename T>
+static void
+addBlock(const AsianParams<T> &params, size_t block,
+         const T pay[4][4], const T deriv[4][4], AsianSums &sums)
+{
+    size_t path = block * MC_BLOCK_PATHS;
+    for(int l = 0; l < 4; ++l)
+    {
+        for(int p = 0; p < 4; ++p, ++path)
+        {
+            if(path < params.numPaths)
+            {
+                sums.price += pay[p][l];
+                sums.vega += deriv[p][l];
+            }
+        }
+    }
+}
+
+#ifdef SDK_MC_SSE2
+/*
+ * Low and high 32 bits of the products of the lanes of a with m
+ */
+static inline __m128i
+mulHiLo(__m128i a, __m128i m, __m128i *hi)
+{
+    __m128i even = _mm_mul_epu32(a, m);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+    *hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 3, 1)),
+                             _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+/*
+ * Philox4x32-10 of the counters (group, i, 0) of four consecutive groups,
+ * w[j] holds word j of each group's output
+ */
+static inline void
+philoxSSE(const unsigned int key[2], size_t group, unsigned int i, __m128i w[4])
+{
+    const __m128i m0 = _mm_set1_epi32((int)PHILOX_M0);
+    const __m128i m1 = _mm_set1_epi32((int)PHILOX_M1);
+    __m128i c0 = _mm_set_epi32((int)(group + 3), (int)(group + 2), (int)(group + 1), (int)group);
+    __m128i c1 = _mm_set_epi32((int)((unsigned long long)(group + 3) >> 32),
+                               (int)((unsigned long long)(group + 2) >> 32),
+                               (int)((unsigned long long)(group + 1) >> 32),
+                               (int)((unsigned long long)group >> 32));
+    __m128i c2 = _mm_set1_epi32((int)i);
+    __m128i c3 = _mm_setzero_si128();
+    unsigned int k0 = key[0], k1 = key[1];
+
+    for(int round = 0; round < PHILOX_ROUNDS; ++round)
+    {
+        __m128i hi0, hi1;
+        __m128i lo0 = mulHiLo(c0, m0, &hi0);
+        __m128i lo1 = mulHiLo(c2, m1, &hi1);
+        c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32((int)k0));
+        c1 = lo1;
+        c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32((int)k1));
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    w[0] = c0;
+    w[1] = c1;
+    w[2] = c2;
+    w[3] = c3;
+}
+
+/*
+ * Single precision, 4 lanes. Cephes style range reduction and polynomials
+ */
+static inline __m128
+expPS(__m128 x)
+{
+    x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+    x = _mm_max_ps(x, _mm_set1_ps(-87.3365447504f));
+
+    // x = n * ln2 + r, |r| <= ln2 / 2
+    __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)));
+    __m128 fn = _mm_cvtepi32_ps(n);
+    x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(-2.12194440e-4f)));
+
+    __m128 y = _mm_set1_ps(1.9875691500E-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507E-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073E-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894E-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), _mm_add_ps(x, _mm_set1_ps(1.0f)));
+
+    // * 2^n
+    __m128i scale = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(y, _mm_castsi128_ps(scale));
+}
+
+/*
+ * Natural logarithm of normal positive x
+ */
+static inline __m128
+logPS(__m128 x)
+{
+    // x = m * 2^e, sqrt(1/2) <= m < sqrt(2)
+    __m128i bits = _mm_castps_si128(x);
+    __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                             _mm_set1_epi32(0x3f000000)));
+    __m128 small = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+    e = _mm_sub_ps(e, _mm_and_ps(small, _mm_set1_ps(1.0f)));
+    m = _mm_add_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_and_ps(small, m));
+
+    __m128 z = _mm_mul_ps(m, m);
+    __m128 y = _mm_set1_ps(7.0376836292E-2f);
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.1514610310E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.1676998740E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.2420140846E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.4249322787E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.6668057665E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(2.0000714765E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-2.4999993993E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(3.3333331174E-1f));
+    y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+
+    y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+}
+
+/*
+ * sin and cos of 2 * pi * u. The quadrant is taken from u itself, so the
+ * range reduction is exact
+ */
+static inline void
+sinCosTurnPS(__m128 u, __m128 *s, __m128 *c)
+{
+    __m128 q = _mm_mul_ps(u, _mm_set1_ps(4.0f));
+    __m128i n = _mm_cvtps_epi32(q);
+    __m128 a = _mm_mul_ps(_mm_sub_ps(q, _mm_cvtepi32_ps(n)), _mm_set1_ps(1.57079632679489662f));
+    __m128 z = _mm_mul_ps(a, a);
+
+    __m128 ps = _mm_set1_ps(-1.9515295891E-4f);
+    ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(8.3321608736E-3f));
+    ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(-1.6666654611E-1f));
+    ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), a), a);
+
+    __m128 pc = _mm_set1_ps(2.443315711809948E-5f);
+    pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(-1.388731625493765E-3f));
+    pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827E-2f));
+    pc = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(pc, z), z), _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(z, _mm_set1_ps(0.5f))));
+
+    // rotate by n quarter turns
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(n, one), one));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(n, two), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(n, one), two), 30));
+    *s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps)), sinSign);
+    *c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc)), cosSign);
+}
+
+static void
+simulateBlock(const AsianParams<float> &params, size_t block, AsianSums &sums)
+{
+    const __m128 initPrice = _mm_set1_ps(params.initPrice);
+    const __m128 c1 = _mm_set1_ps(params.c1);
+    const __m128 c2 = _mm_set1_ps(params.c2);
+
+    __m128 logPrice[4], sumPrice[4], sumDeriv[4];
+    for(int p = 0; p < 4; ++p)
+    {
+        logPrice[p] = _mm_setzero_ps();
+        sumPrice[p] = initPrice;
+        sumDeriv[p] = _mm_setzero_ps();
+    }
+
+    for(int i = 1; i < params.numSum; ++i)
+    {
+        __m128i w[4];
+        philoxSSE(params.key, block * 4, (unsigned int)i, w);
+
+        // uniforms in (0, 1) from the top 24 bits, Box-Muller on two pairs
+        __m128 u[4];
+        for(int j = 0; j < 4; ++j)
+            u[j] = _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(_mm_srli_epi32(w[j], 8)), _mm_set1_ps(0.5f)),
+                              _mm_set1_ps(1.0f / 16777216.0f));
+
+        __m128 z[4], s, c;
+        __m128 r = _mm_sqrt_ps(_mm_mul_ps(_mm_set1_ps(-2.0f), logPS(u[0])));
+        sinCosTurnPS(u[1], &s, &c);
+        z[0] = _mm_mul_ps(r, c);
+        z[1] = _mm_mul_ps(r, s);
+        r = _mm_sqrt_ps(_mm_mul_ps(_mm_set1_ps(-2.0f), logPS(u[2])));
+        sinCosTurnPS(u[3], &s, &c);
+        z[2] = _mm_mul_ps(r, c);
+        z[3] = _mm_mul_ps(r, s);
+
+        // log(price / initPrice) is the running sum of the increments
+        __m128 drift = _mm_set1_ps(params.c3dt * i);
+        for(int p = 0; p < 4; ++p)
+        {
+            logPrice[p] = _mm_add_ps(logPrice[p], _mm_add_ps(c1, _mm_mul_ps(c2, z[p])));
+            __m128 price = _mm_mul_ps(initPrice, expPS(logPrice[p]));
+            sumPrice[p] = _mm_add_ps(sumPrice[p], price);
+            sumDeriv[p] = _mm_add_ps(sumDeriv[p], _mm_mul_ps(price, _mm_sub_ps(logPrice[p], drift)));
+        }
+    }
+
+    float pay[4][4], deriv[4][4];
+    for(int p = 0; p < 4; ++p)
+    {
+        __m128 diff = _mm_sub_ps(_mm_mul_ps(sumPrice[p], _mm_set1_ps(params.invNumSum)),
+                                 _mm_set1_ps(params.strikePrice));
+        __m128 inMoney = _mm_cmpgt_ps(diff, _mm_setzero_ps());
+        __m128 meanDeriv = _mm_mul_ps(sumDeriv[p], _mm_set1_ps(params.invSigma * params.invNumSum));
+        _mm_storeu_ps(pay[p], _mm_and_ps(inMoney, diff));
+        _mm_storeu_ps(deriv[p], _mm_and_ps(inMoney, meanDeriv));
+    }
+    addBlock(params, block, pay, deriv, sums);
+}
+
+/*
+ * Double precision, 2 lanes. fdlibm style polynomials
+ */
+static inline __m128d
+expPD(__m128d x)
+{
+    x = _mm_min_pd(x, _mm_set1_pd(709.0));
+    x = _mm_max_pd(x, _mm_set1_pd(-708.0));
+
+    // x = n * ln2 + r, |r| <= ln2 / 2
+    __m128i n = _mm_cvtpd_epi32(_mm_mul_pd(x, _mm_set1_pd(1.4426950408889634073599)));
+    __m128d fn = _mm_cvtepi32_pd(n);
+    x = _mm_sub_pd(x, _mm_mul_pd(fn, _mm_set1_pd(6.93145751953125E-1)));
+    x = _mm_sub_pd(x, _mm_mul_pd(fn, _mm_set1_pd(1.42860682030941723212E-6)));
+
+    // Pade approximation, exp(r) = 1 + 2 r P(r^2) / (Q(r^2) - r P(r^2))
+    __m128d xx = _mm_mul_pd(x, x);
+    __m128d p = _mm_set1_pd(1.26177193074810590878E-4);
+    p = _mm_add_pd(_mm_mul_pd(p, xx), _mm_set1_pd(3.02994407707441961300E-2));
+    p = _mm_mul_pd(_mm_add_pd(_mm_mul_pd(p, xx), _mm_set1_pd(9.99999999999999999910E-1)), x);
+    __m128d q = _mm_set1_pd(3.00198505138664455042E-6);
+    q = _mm_add_pd(_mm_mul_pd(q, xx), _mm_set1_pd(2.52448340349684104192E-3));
+    q = _mm_add_pd(_mm_mul_pd(q, xx), _mm_set1_pd(2.27265548208155028766E-1));
+    q = _mm_add_pd(_mm_mul_pd(q, xx), _mm_set1_pd(2.00000000000000000009E0));
+    __m128d y = _mm_div_pd(p, _mm_sub_pd(q, p));
+    y = _mm_add_pd(_mm_add_pd(y, y), _mm_set1_pd(1.0));
+
+    // * 2^n, only the low 11 bits of the biased exponent reach the result
+    __m128i biased = _mm_add_epi64(_mm_unpacklo_epi32(n, _mm_setzero_si128()), _mm_set_epi32(0, 1023, 0, 1023));
+    return _mm_mul_pd(y, _mm_castsi128_pd(_mm_slli_epi64(biased, 52)));
+}
+
+/*
+ * Natural logarithm of normal positive x
+ */
+static inline __m128d
+logPD(__m128d x)
+{
+    // x = m * 2^k, sqrt(1/2) < m <= sqrt(2)
+    __m128i bits = _mm_castpd_si128(x);
+    __m128i exponent = _mm_shuffle_epi32(_mm_srli_epi64(bits, 52), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128d k = _mm_cvtepi32_pd(_mm_sub_epi32(exponent, _mm_set1_epi32(1023)));
+    __m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set_epi32(0x000fffff, -1, 0x000fffff, -1)),
+                                              _mm_set_epi32(0x3ff00000, 0, 0x3ff00000, 0)));
+    __m128d large = _mm_cmpgt_pd(m, _mm_set1_pd(1.41421356237309504880));
+    m = _mm_or_pd(_mm_and_pd(large, _mm_mul_pd(m, _mm_set1_pd(0.5))), _mm_andnot_pd(large, m));
+    k = _mm_add_pd(k, _mm_and_pd(large, _mm_set1_pd(1.0)));
+
+    // log(1 + f) = f - f^2 / 2 + s (f^2 / 2 + R(s^2)), s = f / (2 + f)
+    __m128d f = _mm_sub_pd(m, _mm_set1_pd(1.0));
+    __m128d s = _mm_div_pd(f, _mm_add_pd(f, _mm_set1_pd(2.0)));
+    __m128d z = _mm_mul_pd(s, s);
+    __m128d w = _mm_mul_pd(z, z);
+    __m128d t1 = _mm_set1_pd(1.531383769920937332e-01);
+    t1 = _mm_add_pd(_mm_mul_pd(t1, w), _mm_set1_pd(2.222219843214978396e-01));
+    t1 = _mm_mul_pd(_mm_add_pd(_mm_mul_pd(t1, w), _mm_set1_pd(3.999999999940941908e-01)), w);
+    __m128d t2 = _mm_set1_pd(1.479819860511658591e-01);
+    t2 = _mm_add_pd(_mm_mul_pd(t2, w), _mm_set1_pd(1.818357216161805012e-01));
+    t2 = _mm_add_pd(_mm_mul_pd(t2, w), _mm_set1_pd(2.857142874366239149e-01));
+    t2 = _mm_mul_pd(_mm_add_pd(_mm_mul_pd(t2, w), _mm_set1_pd(6.666666666666735130e-01)), z);
+    __m128d hfsq = _mm_mul_pd(_mm_set1_pd(0.5), _mm_mul_pd(f, f));
+    __m128d y = _mm_add_pd(_mm_mul_pd(s, _mm_add_pd(hfsq, _mm_add_pd(t1, t2))),
+                           _mm_mul_pd(k, _mm_set1_pd(1.90821492927058770002e-10)));
+    y = _mm_sub_pd(f, _mm_sub_pd(hfsq, y));
+    return _mm_add_pd(y, _mm_mul_pd(k, _mm_set1_pd(6.93147180369123816490e-01)));
+}
+
+/*
+ * sin and cos of 2 * pi * u, quadrant taken from u
+ */
+static inline void
+sinCosTurnPD(__m128d u, __m128d *s, __m128d *c)
+{
+    __m128d q = _mm_mul_pd(u, _mm_set1_pd(4.0));
+    __m128i n = _mm_cvtpd_epi32(q);
+    __m128d a = _mm_mul_pd(_mm_sub_pd(q, _mm_cvtepi32_pd(n)), _mm_set1_pd(1.57079632679489661923));
+    __m128d z = _mm_mul_pd(a, a);
+
+    __m128d ps = _mm_set1_pd(1.58969099521155010221e-10);
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-2.50507602534068634195e-08));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(2.75573137070700676789e-06));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.98412698298579493134e-04));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(8.33333333332248946124e-03));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(-1.66666666666666324348e-01));
+    ps = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(ps, z), a), a);
+
+    __m128d pc = _mm_set1_pd(-1.13596475577881948265e-11);
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(2.08757232129817482790e-09));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-2.75573143513906633035e-07));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(2.48015872894767294178e-05));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(-1.38888888888741095749e-03));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(4.16666666666666019037e-02));
+    pc = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(pc, z), z), _mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(z, _mm_set1_pd(0.5))));
+
+    // rotate by n quarter turns, masks widened to 64 bit lanes
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i n2 = _mm_unpacklo_epi32(n, n);
+    __m128d swap = _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(n2, one), one));
+    __m128d sinSign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(n2, _mm_set_epi32(0, 2, 0, 2)), 62));
+    __m128d cosSign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(_mm_add_epi32(n2, one),
+                                                                    _mm_set_epi32(0, 2, 0, 2)), 62));
+    *s = _mm_xor_pd(_mm_or_pd(_mm_and_pd(swap, pc), _mm_andnot_pd(swap, ps)), sinSign);
+    *c = _mm_xor_pd(_mm_or_pd(_mm_and_pd(swap, ps), _mm_andnot_pd(swap, pc)), cosSign);
+}
+
+/*
+ * Uniforms in (0, 1) from the 32 bit words of lanes 0 and 1 of w
+ */
+static inline __m128d
+uniformPD(__m128i w)
+{
+    __m128d v = _mm_cvtepi32_pd(_mm_xor_si128(w, _mm_set1_epi32((int)0x80000000u)));
+    v = _mm_add_pd(v, _mm_set1_pd(2147483648.5));
+    return _mm_mul_pd(v, _mm_set1_pd(1.0 / 4294967296.0));
+}
+
+static void
+simulateBlock(const AsianParams<double> &params, size_t block, AsianSums &sums)
+{
+    const __m128d initPrice = _mm_set1_pd(params.initPrice);
+    const __m128d c1 = _mm_set1_pd(params.c1);
+    const __m128d c2 = _mm_set1_pd(params.c2);
+
+    // [p][h]: paths 4 * l + p of groups l = 2h, 2h + 1
+    __m128d logPrice[4][2], sumPrice[4][2], sumDeriv[4][2];
+    for(int p = 0; p < 4; ++p)
+    {
+        for(int h = 0; h < 2; ++h)
+        {
+            logPrice[p][h] = _mm_setzero_pd();
+            sumPrice[p][h] = initPrice;
+            sumDeriv[p][h] = _mm_setzero_pd();
+        }
+    }
+
+    for(int i = 1; i < params.numSum; ++i)
+    {
+        __m128i w[4];
+        philoxSSE(params.key, block * 4, (unsigned int)i, w);
+
+        __m128d drift = _mm_set1_pd(params.c3dt * i);
+        for(int h = 0; h < 2; ++h)
+        {
+            __m128d u[4];
+            for(int j = 0; j < 4; ++j)
+                u[j] = uniformPD(h == 0 ? w[j] : _mm_shuffle_epi32(w[j], _MM_SHUFFLE(1, 0, 3, 2)));
+
+            __m128d z[4], s, c;
+            __m128d r = _mm_sqrt_pd(_mm_mul_pd(_mm_set1_pd(-2.0), logPD(u[0])));
+            sinCosTurnPD(u[1], &s, &c);
+            z[0] = _mm_mul_pd(r, c);
+            z[1] = _mm_mul_pd(r, s);
+            r = _mm_sqrt_pd(_mm_mul_pd(_mm_set1_pd(-2.0), logPD(u[2])));
+            sinCosTurnPD(u[3], &s, &c);
+            z[2] = _mm_mul_pd(r, c);
+            z[3] = _mm_mul_pd(r, s);
+
+            for(int p = 0; p < 4; ++p)
+            {
+                logPrice[p][h] = _mm_add_pd(logPrice[p][h], _mm_add_pd(c1, _mm_mul_pd(c2, z[p])));
+                __m128d price = _mm_mul_pd(initPrice, expPD(logPrice[p][h]));
+                sumPrice[p][h] = _mm_add_pd(sumPrice[p][h], price);
+                sumDeriv[p][h] = _mm_add_pd(sumDeriv[p][h], _mm_mul_pd(price, _mm_sub_pd(logPrice[p][h], drift)));
+            }
+        }
+    }
+
+    double pay[4][4], deriv[4][4];
+    for(int p = 0; p < 4; ++p)
+    {
+        for(int h = 0; h < 2; ++h)
+        {
+            __m128d diff = _mm_sub_pd(_mm_mul_pd(sumPrice[p][h], _mm_set1_pd(params.invNumSum)),
+                                      _mm_set1_pd(params.strikePrice));
+            __m128d inMoney = _mm_cmpgt_pd(diff, _mm_setzero_pd());
+            __m128d meanDeriv = _mm_mul_pd(sumDeriv[p][h], _mm_set1_pd(params.invSigma * params.invNumSum));
+            _mm_storeu_pd(pay[p] + 2 * h, _mm_and_pd(inMoney, diff));
+            _mm_storeu_pd(deriv[p] + 2 * h, _mm_and_pd(inMoney, meanDeriv));
+        }
+    }
+    addBlock(params, block, pay, deriv, sums);
+}
+#else
+static void
+philox(const unsigned int key[2], size_t group, unsigned int i, unsigned int w[4])
+{
+    unsigned int c0 = (unsigned int)group;
+    unsigned int c1 = (unsigned int)((unsigned long long)group >> 32);
+    unsigned int c2 = i, c3 = 0;
+    unsigned int k0 = key[0], k1 = key[1];
+
+    for(int round = 0; round < PHILOX_ROUNDS; ++round)
+    {
+        unsigned long long p0 = (unsigned long long)PHILOX_M0 * c0;
+        unsigned long long p1 = (unsigned long long)PHILOX_M1 * c2;
+        c0 = (unsigned int)(p1 >> 32) ^ c1 ^ k0;
+        c1 = (unsigned int)p1;
+        c2 = (unsigned int)(p0 >> 32) ^ c3 ^ k1;
+        c3 = (unsigned int)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    w[0] = c0;
+    w[1] = c1;
+    w[2] = c2;
+    w[3] = c3;
+}
+
+static inline float
+uniform(unsigned int w, float)
+{
+    return ((float)(w >> 8) + 0.5f) * (1.0f / 16777216.0f);
+}
+
+static inline double
+uniform(unsigned int w, double)
+{
+    return ((double)w + 0.5) * (1.0 / 4294967296.0);
+}
+
+/*
+ * Same streams and path layout as the SSE2 kernels, with the C library's
+ * exp, log, sin and cos
+ */
+template<typename T>
+static void
+simulateBlock(const AsianParams<T> &params, size_t block, AsianSums &sums)
+{
+    const T twoPi = (T)6.28318530717958647692;
+    T logPrice[4][4], sumPrice[4][4], sumDeriv[4][4];
+    for(int p = 0; p < 4; ++p)
+    {
+        for(int l = 0; l < 4; ++l)
+        {
+            logPrice[p][l] = 0;
+            sumPrice[p][l] = params.initPrice;
+            sumDeriv[p][l] = 0;
+        }
+    }
+
+    for(int i = 1; i < params.numSum; ++i)
+    {
+        T drift = params.c3dt * i;
+        for(int l = 0; l < 4; ++l)
+        {
+            unsigned int w[4];
+            philox(params.key, block * 4 + l, (unsigned int)i, w);
+
+            T z[4];
+            T r = sqrt(-2 * log(uniform(w[0], T())));
+            T phi = twoPi * uniform(w[1], T());
+            z[0] = r * cos(phi);
+            z[1] = r * sin(phi);
+            r = sqrt(-2 * log(uniform(w[2], T())));
+            phi = twoPi * uniform(w[3], T());
+            z[2] = r * cos(phi);
+            z[3] = r * sin(phi);
+
+            for(int p = 0; p < 4; ++p)
+            {
+                logPrice[p][l] += params.c1 + params.c2 * z[p];
+                T price = params.initPrice * exp(logPrice[p][l]);
+                sumPrice[p][l] += price;
+                sumDeriv[p][l] += price * (logPrice[p][l] - drift);
+            }
+        }
+    }
+
+    T pay[4][4], deriv[4][4];
+    for(int p = 0; p < 4; ++p)
+    {
+        for(int l = 0; l < 4; ++l)
+        {
+            T diff = sumPrice[p][l] * params.invNumSum - params.strikePrice;
+            bool inMoney = diff > 0;
+            pay[p][l] = inMoney ? diff : 0;
+            deriv[p][l] = inMoney ? sumDeriv[p][l] * params.invSigma * params.invNumSum : 0;
+        }
+    }
+    addBlock(params, block, pay, deriv, sums);
+}
+#endif
+
+/*
+ * Sums of blocks [begin, end)
+ */
+template<typename T>
+struct AsianBlocks
+{
+    const AsianParams<T> *params;
+
+    AsianSums operator()(size_t begin, size_t end) const
+    {
+        AsianSums sums = {0.0, 0.0};
+        for(size_t block = begin; block < end; ++block)
+            simulateBlock(*params, block, sums);
+        return sums;
+    }
+};
+
+template<typename T>
+static void
+asianCall(size_t numPaths, int numSum, T initPrice, T strikePrice, T interest,
+          T maturity, T sigma, unsigned int seed, unsigned int stream,
+          T *price, T *vega)
+{
+    T timeStep = maturity / (numSum - 1);
+
+    AsianParams<T> params;
+    params.numPaths = numPaths;
+    params.numSum = numSum;
+    params.initPrice = initPrice;
+    params.strikePrice = strikePrice;
+    params.c1 = (interest - (T)0.5 * sigma * sigma) * timeStep;
+    params.c2 = sigma * sqrt(timeStep);
+    params.c3dt = (interest + (T)0.5 * sigma * sigma) * timeStep;
+    params.invSigma = 1 / sigma;
+    params.invNumSum = (T)1 / numSum;
+    params.key[0] = seed;
+    params.key[1] = stream;
+
+    AsianBlocks<T> blocks = {&params};
+    AsianSums zero = {0.0, 0.0};
+    size_t numBlocks = (numPaths + MC_BLOCK_PATHS - 1) / MC_BLOCK_PATHS;
+    AsianSums sums = SDKThreadPool::getInstance().parallelReduce(0, numBlocks, zero, blocks,
+                                                                 AsianSumsCombine(), MC_TASK_BLOCKS);
+
+    double discount = exp(-(double)interest * maturity) / (numPaths ? numPaths : 1);
+    *price = (T)(sums.price * discount);
+    *vega = (T)(sums.vega * discount);
+}
+
+void
+asianCallMonteCarlo(size_t numPaths, int numSum,
+                    float initPrice, float strikePrice, float interest,
+                    float maturity, float sigma,
+                    unsigned int seed, unsigned int stream,
+                    float *price, float *vega)
+{
+    asianCall(numPaths, numSum, initPrice, strikePrice, interest, maturity, sigma,
+              seed, stream, price, vega);
+}
+
+void
+asianCallMonteCarlo(size_t numPaths, int numSum,
+                    double initPrice, double strikePrice, double interest,
+                    double maturity, double sigma,
+                    unsigned int seed, unsigned int stream,
+                    double *price, double *vega)
+{
+    asianCall(numPaths, numSum, initPrice, strikePrice, interest, maturity, sigma,
+              seed, stream, price, vega);
+}
+
+}
@@ -0,0 +1,365 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#include "SDKRadixSort.hpp"
+#include "SDKThreadPool.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+/**
+ * Bits per digit
+ */
+#define RADIX_SORT_BITS 8
+#define RADIX_SORT_BUCKETS (1 << RADIX_SORT_BITS)
+#define RADIX_SORT_MASK (RADIX_SORT_BUCKETS - 1)
+
+/**
+ * Below this many keys per chunk the keys are sorted in a single chunk
+ */
+#define RADIX_SORT_MIN_CHUNK 65536
+
+/**
+ * Bytes buffered per bucket before the scatter writes them out
+ */
+#define RADIX_SORT_LINE 64
+
+namespace streamsdk
+{
+
+template<typename K>
+static inline unsigned int
+radixDigit(K key, unsigned int shift)
+{
+    return (unsigned int)(key >> shift) & RADIX_SORT_MASK;
+}
+
+/**
+ * Keys (and values) of the current pass, split into numChunks contiguous
+ * chunks
+ */
+template<typename K>
+struct RadixPass
+{
+    const K *srcKeys;
+    const unsigned int *srcValues;
+    K *dstKeys;
+    unsigned int *dstValues;
+    size_t count;
+    size_t numChunks;
+
+    size_t chunkBegin(size_t chunk) const
+    {
+        return count / numChunks * chunk + std::min(chunk, count % numChunks);
+    }
+};
+
+/*
+ * Histograms of every digit of the chunks [begin, end) of the unsorted keys,
+ * counts[(chunk * numDigits + digit) * RADIX_SORT_BUCKETS + bucket]
+ */
+template<typename K>
+struct RadixCountAll
+{
+    const RadixPass<K> *pass;
+    size_t *counts;
+
+    enum
+    {
+        NUM_DIGITS = sizeof(K) * 8 / RADIX_SORT_BITS
+    };
+
+    void operator()(size_t begin, size_t end) const
+    {
+        size_t c[NUM_DIGITS][RADIX_SORT_BUCKETS];
+        for(size_t chunk = begin; chunk < end; ++chunk)
+        {
+            memset(c, 0, sizeof(c));
+            const K *key = pass->srcKeys + pass->chunkBegin(chunk);
+            const K *last = pass->srcKeys + pass->chunkBegin(chunk + 1);
+            for(; key < last; ++key)
+            {
+                K v = *key;
+                for(int d = 0; d < NUM_DIGITS; ++d, v >>= RADIX_SORT_BITS)
+                    ++c[d][v & RADIX_SORT_MASK];
+            }
+            memcpy(counts + chunk * NUM_DIGITS * RADIX_SORT_BUCKETS, c, sizeof(c));
+        }
+    }
+};
+
+/*
+ * Histogram of one digit of the chunks [begin, end),
+ * counts[chunk * RADIX_SORT_BUCKETS + bucket]
+ */
+template<typename K>
+struct RadixCount
+{
+    const RadixPass<K> *pass;
+    unsigned int shift;
+    size_t *counts;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        size_t c[RADIX_SORT_BUCKETS];
+        for(size_t chunk = begin; chunk < end; ++chunk)
+        {
+            memset(c, 0, sizeof(c));
+            const K *key = pass->srcKeys + pass->chunkBegin(chunk);
+            const K *last = pass->srcKeys + pass->chunkBegin(chunk + 1);
+            for(; key < last; ++key)
+                ++c[radixDigit(*key, shift)];
+            memcpy(counts + chunk * RADIX_SORT_BUCKETS, c, sizeof(c));
+        }
+    }
+};
+
+/*
+ * Moves the keys of the chunks [begin, end) to their place in the output,
+ * starting each bucket of a chunk at offsets[chunk * RADIX_SORT_BUCKETS + bucket].
+ * Keys are staged per bucket and written out whenever the output position
+ * crosses a line boundary, so every write but the first and last of a
+ * bucket is one full, aligned line.
+ */
+template<typename K, bool WithValues>
+struct RadixScatter
+{
+    const RadixPass<K> *pass;
+    unsigned int shift;
+    const size_t *offsets;
+
+    enum
+    {
+        KEYS_PER_LINE = RADIX_SORT_LINE / sizeof(K)
+    };
+
+    void operator()(size_t begin, size_t end) const
+    {
+        std::vector<K> keyStorage(RADIX_SORT_BUCKETS * KEYS_PER_LINE);
+        std::vector<unsigned int> valueStorage(RADIX_SORT_BUCKETS * KEYS_PER_LINE);
+        K *keyLines = &keyStorage[0];
+        unsigned int *valueLines = &valueStorage[0];
+        const K *srcKeys = pass->srcKeys;
+        const unsigned int *srcValues = pass->srcValues;
+        K *dstKeys = pass->dstKeys;
+        unsigned int *dstValues = pass->dstValues;
+        size_t pos[RADIX_SORT_BUCKETS];
+        size_t start[RADIX_SORT_BUCKETS];
+
+        for(size_t chunk = begin; chunk < end; ++chunk)
+        {
+            for(int b = 0; b < RADIX_SORT_BUCKETS; ++b)
+                pos[b] = start[b] = offsets[chunk * RADIX_SORT_BUCKETS + b];
+
+            size_t first = pass->chunkBegin(chunk);
+            size_t last = pass->chunkBegin(chunk + 1);
+            for(size_t i = first; i < last; ++i)
+            {
+                K key = srcKeys[i];
+                unsigned int b = radixDigit(key, shift);
+                size_t slot = b * KEYS_PER_LINE + (pos[b] & (KEYS_PER_LINE - 1));
+                keyLines[slot] = key;
+                if(WithValues)
+                    valueLines[slot] = srcValues[i];
+
+                if((++pos[b] & (KEYS_PER_LINE - 1)) == 0)
+                {
+                    size_t from = start[b];
+                    if(pos[b] - from == KEYS_PER_LINE)
+                    {
+                        // a whole line, fixed size copy
+                        memcpy(dstKeys + from, keyLines + b * KEYS_PER_LINE, KEYS_PER_LINE * sizeof(K));
+                        if(WithValues)
+                            memcpy(dstValues + from, valueLines + b * KEYS_PER_LINE,
+                                   KEYS_PER_LINE * sizeof(unsigned int));
+                    }
+                    else
+                    {
+                        flush(b, from, pos[b], keyLines, valueLines);
+                    }
+                    start[b] = pos[b];
+                }
+            }
+
+            for(int b = 0; b < RADIX_SORT_BUCKETS; ++b)
+                flush(b, start[b], pos[b], keyLines, valueLines);
+        }
+    }
+
+    void flush(unsigned int b, size_t from, size_t to,
+               const K *keyLines, const unsigned int *valueLines) const
+    {
+        size_t slot = b * KEYS_PER_LINE + (from & (KEYS_PER_LINE - 1));
+        memcpy(pass->dstKeys + from, keyLines + slot, (to - from) * sizeof(K));
+        if(WithValues)
+            memcpy(pass->dstValues + from, valueLines + slot, (to - from) * sizeof(unsigned int));
+    }
+};
+
+/*
+ * Copies chunks [begin, end) of the scratch buffers back to the caller's
+ */
+template<typename K>
+struct RadixCopy
+{
+    const RadixPass<K> *pass;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        size_t first = pass->chunkBegin(begin);
+        size_t last = pass->chunkBegin(end);
+        memcpy(pass->dstKeys + first, pass->srcKeys + first, (last - first) * sizeof(K));
+        if(pass->srcValues)
+            memcpy(pass->dstValues + first, pass->srcValues + first, (last - first) * sizeof(unsigned int));
+    }
+};
+
+/*
+ * Turns the per chunk counts of one digit into output offsets: bucket by
+ * bucket, chunk by chunk within a bucket, which keeps the sort stable
+ */
+static void
+radixOffsets(const size_t *counts, size_t stride, size_t numChunks, size_t *offsets)
+{
+    size_t sum = 0;
+    for(int b = 0; b < RADIX_SORT_BUCKETS; ++b)
+    {
+        for(size_t chunk = 0; chunk < numChunks; ++chunk)
+        {
+            offsets[chunk * RADIX_SORT_BUCKETS + b] = sum;
+            sum += counts[chunk * stride + b];
+        }
+    }
+}
+
+template<typename K, bool WithValues>
+static bool
+radixSortImpl(K *keys, unsigned int *values, size_t count)
+{
+    const unsigned int numDigits = sizeof(K) * 8 / RADIX_SORT_BITS;
+    if(count < 2)
+        return true;
+
+    SDKThreadPool &pool = SDKThreadPool::getInstance();
+    RadixPass<K> pass;
+    pass.count = count;
+    pass.numChunks = std::max((size_t)1, std::min((size_t)pool.getNumThreads(), count / RADIX_SORT_MIN_CHUNK));
+    pass.srcKeys = keys;
+    pass.srcValues = values;
+
+    // every digit of every chunk in one read
+    std::vector<size_t> allCounts(pass.numChunks * numDigits * RADIX_SORT_BUCKETS);
+    RadixCountAll<K> countAll = {&pass, &allCounts[0]};
+    pool.parallelFor(0, pass.numChunks, countAll, 1);
+
+    // passes where not all keys fall into one bucket
+    std::vector<unsigned int> digits;
+    for(unsigned int d = 0; d < numDigits; ++d)
+    {
+        bool uniform = false;
+        for(int b = 0; b < RADIX_SORT_BUCKETS && !uniform; ++b)
+        {
+            size_t total = 0;
+            for(size_t chunk = 0; chunk < pass.numChunks; ++chunk)
+                total += allCounts[(chunk * numDigits + d) * RADIX_SORT_BUCKETS + b];
+            uniform = (total == count);
+        }
+        if(!uniform)
+            digits.push_back(d);
+    }
+    if(digits.empty())
+        return true;
+
+    K *tempKeys = (K*)malloc(count * sizeof(K));
+    unsigned int *tempValues = WithValues ? (unsigned int*)malloc(count * sizeof(unsigned int)) : NULL;
+    if(tempKeys == NULL || (WithValues && tempValues == NULL))
+    {
+        free(tempKeys);
+        free(tempValues);
+        return false;
+    }
+
+    std::vector<size_t> counts(pass.numChunks * RADIX_SORT_BUCKETS);
+    std::vector<size_t> offsets(pass.numChunks * RADIX_SORT_BUCKETS);
+    K *bufferKeys[2] = {keys, tempKeys};
+    unsigned int *bufferValues[2] = {values, tempValues};
+
+    for(size_t p = 0; p < digits.size(); ++p)
+    {
+        unsigned int shift = digits[p] * RADIX_SORT_BITS;
+        pass.srcKeys = bufferKeys[p & 1];
+        pass.srcValues = bufferValues[p & 1];
+        pass.dstKeys = bufferKeys[(p + 1) & 1];
+        pass.dstValues = bufferValues[(p + 1) & 1];
+
+        if(p == 0 || pass.numChunks == 1)
+        {
+            // the chunks still hold the same keys as in the first read
+            radixOffsets(&allCounts[digits[p] * RADIX_SORT_BUCKETS], numDigits * RADIX_SORT_BUCKETS,
+                         pass.numChunks, &offsets[0]);
+        }
+        else
+        {
+            RadixCount<K> countDigit = {&pass, shift, &counts[0]};
+            pool.parallelFor(0, pass.numChunks, countDigit, 1);
+            radixOffsets(&counts[0], RADIX_SORT_BUCKETS, pass.numChunks, &offsets[0]);
+        }
+
+        RadixScatter<K, WithValues> scatter = {&pass, shift, &offsets[0]};
+        pool.parallelFor(0, pass.numChunks, scatter, 1);
+    }
+
+    if(digits.size() & 1)
+    {
+        pass.srcKeys = tempKeys;
+        pass.srcValues = tempValues;
+        pass.dstKeys = keys;
+        pass.dstValues = values;
+        RadixCopy<K> copy = {&pass};
+        pool.parallelFor(0, pass.numChunks, copy, 1);
+    }
+
+    free(tempKeys);
+    free(tempValues);
+    return true;
+}
+
+bool
+radixSort(unsigned int *keys, size_t count)
+{
+    return radixSortImpl<unsigned int, false>(keys, NULL, count);
+}
+
+bool
+radixSort(unsigned long long *keys, size_t count)
+{
+    return radixSortImpl<unsigned long long, false>(keys, NULL, count);
+}
+
+bool
+radixSort(unsigned int *keys, unsigned int *values, size_t count)
+{
+    return radixSortImpl<unsigned int, true>(keys, values, count);
+}
+
+bool
+radixSort(unsigned long long *keys, unsigned int *values, size_t count)
+{
+    return radixSortImpl<unsigned long long, true>(keys, values, count);
+}
+
+}
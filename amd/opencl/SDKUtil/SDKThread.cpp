@@ -15,6 +15,10 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 ********************************************************************/
 #include "SDKThread.hpp"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 namespace streamsdk
 {
     //! pack the function pointer and data inside this struct
@@ -40,6 +44,27 @@ namespace streamsdk
     #endif
 
     
+    unsigned int
+    getNumCPUCores()
+    {
+        static unsigned int numCores = 0;
+        if(numCores != 0)
+            return numCores;
+
+    #ifdef _WIN32
+        SYSTEM_INFO sysInfo;
+        GetSystemInfo(&sysInfo);
+        numCores = (unsigned int)sysInfo.dwNumberOfProcessors;
+    #else
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        numCores = count > 0 ? (unsigned int)count : 1;
+    #endif
+
+        if(numCores == 0)
+            numCores = 1;
+        return numCores;
+    }
+
     ThreadLock::ThreadLock()
     {
     #ifdef _WIN32
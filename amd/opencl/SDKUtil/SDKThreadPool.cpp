@@ -0,0 +1,438 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#include "SDKThreadPool.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define SDK_THREAD_LOCAL __declspec(thread)
+#else
+#include <sched.h>
+#include <unistd.h>
+#define SDK_THREAD_LOCAL __thread
+#endif
+
+/**
+ * Failed steal attempts before an idle worker goes to sleep
+ */
+#define SDK_POOL_SPIN_COUNT 64
+
+namespace streamsdk
+{
+    /**
+     * A worker thread and its task deque
+     */
+    struct PoolWorker
+    {
+        SDKThreadPool *pool;
+        unsigned int index;
+        std::vector<unsigned int> cpus;  /**< allowed cores, empty = any */
+        SDKThread thread;
+        ThreadLock lock;
+        std::deque<PoolTask> tasks;
+
+        static void* entry(void *arg);
+    };
+
+    //! worker the calling thread belongs to, NULL outside of any pool
+    static SDK_THREAD_LOCAL PoolWorker *currentWorker = NULL;
+
+    static SDKThreadPool *sharedPool = NULL;
+    static ThreadLock sharedPoolLock;
+
+    //! atomically adds delta to value and returns the new value
+    static inline long
+    atomicAdd(volatile long *value, long delta)
+    {
+    #ifdef _WIN32
+        return InterlockedExchangeAdd(value, delta) + delta;
+    #else
+        return __sync_add_and_fetch(value, delta);
+    #endif
+    }
+
+    static inline long
+    atomicLoad(volatile long *value)
+    {
+        return atomicAdd(value, 0);
+    }
+
+    static inline void
+    yieldThread()
+    {
+    #ifdef _WIN32
+        SwitchToThread();
+    #else
+        sched_yield();
+    #endif
+    }
+
+    //! cores of a NUMA node, false if the node is unknown
+    static bool
+    getNodeCpus(int node, std::vector<unsigned int> &cpus)
+    {
+        cpus.clear();
+    #ifdef _WIN32
+        ULONGLONG mask = 0;
+        if(node > 0xFF || !GetNumaNodeProcessorMask((UCHAR)node, &mask))
+            return false;
+        for(unsigned int cpu = 0; cpu < 64; ++cpu)
+        {
+            if(mask & ((ULONGLONG)1 << cpu))
+                cpus.push_back(cpu);
+        }
+    #else
+        char path[128];
+        sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *fp = fopen(path, "r");
+        if(!fp)
+            return false;
+
+        // cpulist reads like "0-3,8-11"
+        unsigned int first, last;
+        while(fscanf(fp, "%u", &first) == 1)
+        {
+            last = first;
+            int c = fgetc(fp);
+            if(c == '-')
+            {
+                if(fscanf(fp, "%u", &last) != 1)
+                    break;
+                c = fgetc(fp);
+            }
+            for(unsigned int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+            if(c != ',')
+                break;
+        }
+        fclose(fp);
+    #endif
+        return !cpus.empty();
+    }
+
+    //! restricts the calling thread to the given cores
+    static void
+    setCurrentThreadAffinity(const std::vector<unsigned int> &cpus)
+    {
+        if(cpus.empty())
+            return;
+    #ifdef _WIN32
+        DWORD_PTR mask = 0;
+        for(size_t i = 0; i < cpus.size(); ++i)
+        {
+            if(cpus[i] < sizeof(DWORD_PTR) * 8)
+                mask |= (DWORD_PTR)1 << cpus[i];
+        }
+        if(mask != 0)
+            SetThreadAffinityMask(GetCurrentThread(), mask);
+    #elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(size_t i = 0; i < cpus.size(); ++i)
+        {
+            if(cpus[i] < CPU_SETSIZE)
+                CPU_SET(cpus[i], &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    #endif
+    }
+
+    void*
+    PoolWorker::entry(void *arg)
+    {
+        PoolWorker *worker = (PoolWorker*)arg;
+        currentWorker = worker;
+        setCurrentThreadAffinity(worker->cpus);
+        worker->pool->workerLoop(worker);
+        currentWorker = NULL;
+        return NULL;
+    }
+
+
+    TaskGroup::TaskGroup(SDKThreadPool *pool)
+        : _pool(pool ? pool : &SDKThreadPool::getInstance()), _pending(0)
+    {
+    }
+
+    TaskGroup::~TaskGroup()
+    {
+        wait();
+    }
+
+    void
+    TaskGroup::run(threadFunc func, void *arg)
+    {
+        _pool->submit(this, func, arg);
+    }
+
+    void
+    TaskGroup::wait()
+    {
+        while(atomicLoad(&_pending) != 0)
+        {
+            if(!_pool->runPendingTask())
+                yieldThread();
+        }
+    }
+
+
+    SDKThreadPool::SDKThreadPool(const ThreadPoolOptions &options)
+        : _pinThreads(options.pinThreads), _queued(0), _sleepers(0),
+          _nextWorker(0), _stop(false)
+    {
+        bool onNode = options.numaNode >= 0 && getNodeCpus(options.numaNode, _cpus);
+        if(!onNode)
+        {
+            _cpus.clear();
+            for(unsigned int cpu = 0; cpu < getNumCPUCores(); ++cpu)
+                _cpus.push_back(cpu);
+        }
+
+        unsigned int numThreads = options.numThreads;
+        if(numThreads == 0)
+            numThreads = (unsigned int)_cpus.size();
+
+    #ifdef _WIN32
+        _wake = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+    #else
+        sem_init(&_wake, 0, 0);
+    #endif
+
+        // the thread waiting on a group is the first executor
+        for(unsigned int i = 1; i < numThreads; ++i)
+        {
+            PoolWorker *worker = new PoolWorker();
+            worker->pool = this;
+            worker->index = (unsigned int)_workers.size();
+            if(_pinThreads)
+                worker->cpus.push_back(_cpus[i % _cpus.size()]);
+            else if(onNode)
+                worker->cpus = _cpus;
+
+            if(!worker->thread.create(PoolWorker::entry, worker))
+            {
+                delete worker;
+                break;
+            }
+            _workers.push_back(worker);
+        }
+    }
+
+    SDKThreadPool::~SDKThreadPool()
+    {
+        _stop = true;
+        _sleepLock.lock();
+        long sleepers = _sleepers;
+        _sleepers = 0;
+    #ifdef _WIN32
+        if(sleepers > 0)
+            ReleaseSemaphore(_wake, sleepers, NULL);
+    #else
+        for(long i = 0; i < sleepers; ++i)
+            sem_post(&_wake);
+    #endif
+        _sleepLock.unlock();
+
+        for(size_t i = 0; i < _workers.size(); ++i)
+        {
+            _workers[i]->thread.join();
+            delete _workers[i];
+        }
+
+    #ifdef _WIN32
+        CloseHandle(_wake);
+    #else
+        sem_destroy(&_wake);
+    #endif
+    }
+
+    SDKThreadPool&
+    SDKThreadPool::getInstance()
+    {
+        sharedPoolLock.lock();
+        if(!sharedPool)
+        {
+            ThreadPoolOptions options;
+            const char *env = getenv("SDK_NUM_THREADS");
+            if(env && atoi(env) > 0)
+                options.numThreads = (unsigned int)atoi(env);
+            env = getenv("SDK_THREAD_AFFINITY");
+            options.pinThreads = env && strcmp(env, "0") != 0;
+            env = getenv("SDK_NUMA_NODE");
+            if(env)
+                options.numaNode = atoi(env);
+
+            // never destroyed: workers may still be in use by static destructors
+            sharedPool = new SDKThreadPool(options);
+        }
+        sharedPoolLock.unlock();
+        return *sharedPool;
+    }
+
+    void
+    SDKThreadPool::submit(TaskGroup *group, threadFunc func, void *arg)
+    {
+        PoolTask task;
+        task.func = func;
+        task.arg = arg;
+        task.group = group;
+        atomicAdd(&group->_pending, 1);
+
+        if(_workers.empty())
+        {
+            execute(task);
+            return;
+        }
+
+        // keep nested work local to the submitting worker
+        PoolWorker *target = currentWorker;
+        if(!target || target->pool != this)
+        {
+            unsigned long next = (unsigned long)atomicAdd(&_nextWorker, 1);
+            target = _workers[next % _workers.size()];
+        }
+
+        target->lock.lock();
+        target->tasks.push_back(task);
+        target->lock.unlock();
+
+        atomicAdd(&_queued, 1);
+        if(atomicLoad(&_sleepers) > 0)
+        {
+            _sleepLock.lock();
+            if(_sleepers > 0)
+            {
+                --_sleepers;
+            #ifdef _WIN32
+                ReleaseSemaphore(_wake, 1, NULL);
+            #else
+                sem_post(&_wake);
+            #endif
+            }
+            _sleepLock.unlock();
+        }
+    }
+
+    bool
+    SDKThreadPool::takeTask(PoolWorker *self, PoolTask &task)
+    {
+        bool found = false;
+
+        // own tasks are taken newest first
+        if(self)
+        {
+            self->lock.lock();
+            if(!self->tasks.empty())
+            {
+                task = self->tasks.back();
+                self->tasks.pop_back();
+                found = true;
+            }
+            self->lock.unlock();
+        }
+
+        // others are robbed oldest first
+        size_t count = _workers.size();
+        size_t start = self ? self->index + 1 : 0;
+        for(size_t i = 0; i < count && !found; ++i)
+        {
+            PoolWorker *victim = _workers[(start + i) % count];
+            if(victim == self)
+                continue;
+
+            victim->lock.lock();
+            if(!victim->tasks.empty())
+            {
+                task = victim->tasks.front();
+                victim->tasks.pop_front();
+                found = true;
+            }
+            victim->lock.unlock();
+        }
+
+        if(found)
+            atomicAdd(&_queued, -1);
+        return found;
+    }
+
+    void
+    SDKThreadPool::execute(const PoolTask &task)
+    {
+        task.func(task.arg);
+        atomicAdd(&task.group->_pending, -1);
+    }
+
+    bool
+    SDKThreadPool::runPendingTask()
+    {
+        PoolWorker *self = currentWorker;
+        if(self && self->pool != this)
+            self = NULL;
+
+        PoolTask task;
+        if(!takeTask(self, task))
+            return false;
+        execute(task);
+        return true;
+    }
+
+    void
+    SDKThreadPool::sleep()
+    {
+        _sleepLock.lock();
+        atomicAdd(&_sleepers, 1);
+        if(atomicLoad(&_queued) > 0 || _stop)
+        {
+            atomicAdd(&_sleepers, -1);
+            _sleepLock.unlock();
+            return;
+        }
+        _sleepLock.unlock();
+
+    #ifdef _WIN32
+        WaitForSingleObject(_wake, INFINITE);
+    #else
+        while(sem_wait(&_wake) != 0)
+            ;
+    #endif
+    }
+
+    void
+    SDKThreadPool::workerLoop(PoolWorker *worker)
+    {
+        unsigned int idle = 0;
+        while(!_stop)
+        {
+            PoolTask task;
+            if(takeTask(worker, task))
+            {
+                execute(task);
+                idle = 0;
+            }
+            else if(++idle < SDK_POOL_SPIN_COUNT)
+            {
+                yieldThread();
+            }
+            else
+            {
+                sleep();
+                idle = 0;
+            }
+        }
+    }
+}
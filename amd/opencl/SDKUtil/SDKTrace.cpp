@@ -0,0 +1,386 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#include "SDKTrace.hpp"
+#include "SDKCommon.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define SDK_THREAD_LOCAL __declspec(thread)
+#else
+#include <time.h>
+#define SDK_THREAD_LOCAL __thread
+#endif
+
+namespace streamsdk
+{
+
+static SDKTrace *sharedTrace = NULL;
+static ThreadLock sharedTraceLock;
+
+//! index of the calling thread's host track, -1 until first used
+static SDK_THREAD_LOCAL int traceThread = -1;
+
+static void
+writeTraceAtExit()
+{
+    if(sharedTrace)
+        sharedTrace->write();
+}
+
+static const char*
+commandTypeName(cl_command_type type)
+{
+    switch(type)
+    {
+    case CL_COMMAND_NDRANGE_KERNEL:         return "NDRangeKernel";
+    case CL_COMMAND_TASK:                   return "Task";
+    case CL_COMMAND_NATIVE_KERNEL:          return "NativeKernel";
+    case CL_COMMAND_READ_BUFFER:            return "ReadBuffer";
+    case CL_COMMAND_WRITE_BUFFER:           return "WriteBuffer";
+    case CL_COMMAND_COPY_BUFFER:            return "CopyBuffer";
+    case CL_COMMAND_READ_IMAGE:             return "ReadImage";
+    case CL_COMMAND_WRITE_IMAGE:            return "WriteImage";
+    case CL_COMMAND_COPY_IMAGE:             return "CopyImage";
+    case CL_COMMAND_COPY_IMAGE_TO_BUFFER:   return "CopyImageToBuffer";
+    case CL_COMMAND_COPY_BUFFER_TO_IMAGE:   return "CopyBufferToImage";
+    case CL_COMMAND_MAP_BUFFER:             return "MapBuffer";
+    case CL_COMMAND_MAP_IMAGE:              return "MapImage";
+    case CL_COMMAND_UNMAP_MEM_OBJECT:       return "UnmapMemObject";
+    case CL_COMMAND_MARKER:                 return "Marker";
+    case CL_COMMAND_ACQUIRE_GL_OBJECTS:     return "AcquireGLObjects";
+    case CL_COMMAND_RELEASE_GL_OBJECTS:     return "ReleaseGLObjects";
+    case CL_COMMAND_READ_BUFFER_RECT:       return "ReadBufferRect";
+    case CL_COMMAND_WRITE_BUFFER_RECT:      return "WriteBufferRect";
+    case CL_COMMAND_COPY_BUFFER_RECT:       return "CopyBufferRect";
+    case CL_COMMAND_USER:                   return "User";
+#ifdef CL_VERSION_1_2
+    case CL_COMMAND_BARRIER:                return "Barrier";
+    case CL_COMMAND_MIGRATE_MEM_OBJECTS:    return "MigrateMemObjects";
+    case CL_COMMAND_FILL_BUFFER:            return "FillBuffer";
+    case CL_COMMAND_FILL_IMAGE:             return "FillImage";
+#endif
+    default:                                return "Command";
+    }
+}
+
+//! writes str as a JSON string literal
+static void
+writeJsonString(FILE *fp, const std::string &str)
+{
+    fputc('"', fp);
+    for(size_t i = 0; i < str.size(); ++i)
+    {
+        unsigned char c = (unsigned char)str[i];
+        if(c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if(c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+
+SDKTrace::SDKTrace()
+    : enabled_(false),
+      origin_(0),
+      numThreads_(0),
+      registered_(false)
+{
+}
+
+SDKTrace&
+SDKTrace::getInstance()
+{
+    sharedTraceLock.lock();
+    if(!sharedTrace)
+    {
+        sharedTrace = new SDKTrace();
+        const char *env = getenv("SDK_TRACE");
+        if(env && env[0] != '\0')
+            sharedTrace->enable(env);
+    }
+    sharedTraceLock.unlock();
+    return *sharedTrace;
+}
+
+void
+SDKTrace::enable(const std::string &fileName)
+{
+    lock_.lock();
+    fileName_ = fileName;
+    if(origin_ == 0)
+        origin_ = now();
+    enabled_ = true;
+    if(!registered_)
+    {
+        registered_ = true;
+        atexit(writeTraceAtExit);
+    }
+    lock_.unlock();
+}
+
+cl_ulong
+SDKTrace::now() const
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (cl_ulong)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (cl_ulong)ts.tv_sec * 1000000000ULL + (cl_ulong)ts.tv_nsec;
+#endif
+}
+
+/*
+ * Called with lock_ held
+ */
+int
+SDKTrace::threadIndex()
+{
+    if(traceThread < 0)
+        traceThread = numThreads_++;
+    return traceThread;
+}
+
+void
+SDKTrace::addHostScope(const std::string &name, cl_ulong beginNs, cl_ulong endNs)
+{
+    if(!enabled_)
+        return;
+
+    Record record;
+    record.name = name;
+    record.pid = 0;
+    record.begin = beginNs;
+    record.end = endNs;
+    record.queued = 0;
+    record.submit = 0;
+
+    lock_.lock();
+    record.tid = threadIndex();
+    if(records_.size() < SDK_TRACE_MAX_RECORDS)
+        records_.push_back(record);
+    lock_.unlock();
+}
+
+/*
+ * Maps the queue of an event to its track, called with lock_ held
+ */
+bool
+SDKTrace::lookupQueue(cl_event event, int &pid, int &tid)
+{
+    cl_command_queue queue = NULL;
+    if(clGetEventInfo(event, CL_EVENT_COMMAND_QUEUE, sizeof(queue), &queue, NULL) != CL_SUCCESS ||
+       queue == NULL)
+        return false;
+
+    std::map<cl_command_queue, int>::iterator it = queueIndex_.find(queue);
+    if(it != queueIndex_.end())
+    {
+        pid = queueDevice_[queue] + 1;
+        tid = it->second;
+        return true;
+    }
+
+    cl_device_id device = NULL;
+    if(clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, sizeof(device), &device, NULL) != CL_SUCCESS)
+        return false;
+
+    std::map<cl_device_id, int>::iterator dev = deviceIndex_.find(device);
+    int index;
+    if(dev == deviceIndex_.end())
+    {
+        char deviceName[256] = "OpenCL device";
+        clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+
+        Device info;
+        info.name = deviceName;
+        info.offset = 0;
+        info.hasOffset = false;
+        info.numQueues = 0;
+        index = (int)devices_.size();
+        devices_.push_back(info);
+        deviceIndex_[device] = index;
+    }
+    else
+    {
+        index = dev->second;
+    }
+
+    queueDevice_[queue] = index;
+    queueIndex_[queue] = devices_[index].numQueues++;
+    pid = index + 1;
+    tid = queueIndex_[queue];
+    return true;
+}
+
+int
+SDKTrace::recordEvent(cl_event event, const char *name)
+{
+    if(!enabled_ || event == NULL)
+        return SDK_FAILURE;
+
+    // Upper bound of the host time the command ended at
+    cl_ulong observed = now();
+
+    Record record;
+    if(clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED,
+                               sizeof(cl_ulong), &record.queued, NULL) != CL_SUCCESS ||
+       clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT,
+                               sizeof(cl_ulong), &record.submit, NULL) != CL_SUCCESS ||
+       clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+                               sizeof(cl_ulong), &record.begin, NULL) != CL_SUCCESS ||
+       clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END,
+                               sizeof(cl_ulong), &record.end, NULL) != CL_SUCCESS)
+        return SDK_FAILURE;
+
+    if(record.end < record.begin)
+        record.end = record.begin;
+
+    if(name)
+    {
+        record.name = name;
+    }
+    else
+    {
+        cl_command_type type = 0;
+        clGetEventInfo(event, CL_EVENT_COMMAND_TYPE, sizeof(type), &type, NULL);
+        record.name = commandTypeName(type);
+    }
+
+    lock_.lock();
+    if(!lookupQueue(event, record.pid, record.tid))
+    {
+        lock_.unlock();
+        return SDK_FAILURE;
+    }
+
+    Device &device = devices_[record.pid - 1];
+    cl_long offset = (cl_long)(observed - record.end);
+    if(!device.hasOffset || offset < device.offset)
+    {
+        device.offset = offset;
+        device.hasOffset = true;
+    }
+
+    if(records_.size() < SDK_TRACE_MAX_RECORDS)
+        records_.push_back(record);
+    lock_.unlock();
+
+    return SDK_SUCCESS;
+}
+
+void
+SDKTrace::releaseQueue(cl_command_queue queue)
+{
+    // Tracks already given out stay in use, devices_ keeps counting them
+    lock_.lock();
+    queueIndex_.erase(queue);
+    queueDevice_.erase(queue);
+    lock_.unlock();
+}
+
+int
+SDKTrace::write()
+{
+    lock_.lock();
+    if(fileName_.size() == 0)
+    {
+        lock_.unlock();
+        return SDK_FAILURE;
+    }
+
+    FILE *fp = fopen(fileName_.c_str(), "w");
+    if(fp == NULL)
+    {
+        lock_.unlock();
+        std::cout << "Error. Cannot open trace file : " << fileName_ << std::endl;
+        return SDK_FAILURE;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"Host\"}}");
+    for(int t = 0; t < numThreads_; ++t)
+    {
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+                    "\"args\":{\"name\":\"Thread %d\"}}", t, t);
+    }
+    for(size_t d = 0; d < devices_.size(); ++d)
+    {
+        fprintf(fp, ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":",
+                (int)d + 1);
+        writeJsonString(fp, devices_[d].name);
+        fprintf(fp, "}}");
+        for(int q = 0; q < devices_[d].numQueues; ++q)
+        {
+            fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                        "\"args\":{\"name\":\"Queue %d\"}}", (int)d + 1, q, q);
+        }
+    }
+
+    for(size_t i = 0; i < records_.size(); ++i)
+    {
+        const Record &record = records_[i];
+        cl_long shift = record.pid == 0 ? 0 : devices_[record.pid - 1].offset;
+        double ts = (double)((cl_long)record.begin + shift - (cl_long)origin_) * 1e-3;
+        double dur = (double)(record.end - record.begin) * 1e-3;
+
+        fprintf(fp, ",\n{\"name\":");
+        writeJsonString(fp, record.name);
+        fprintf(fp, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                record.pid == 0 ? "host" : "device", record.pid, record.tid, ts, dur);
+        if(record.pid != 0)
+        {
+            // Time spent in the queue and between submission and start
+            fprintf(fp, ",\"args\":{\"queued_us\":%.3f,\"submitted_us\":%.3f}",
+                    (double)(record.submit - record.queued) * 1e-3,
+                    (double)(record.begin - record.submit) * 1e-3);
+        }
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "\n]}\n");
+
+    bool ok = !ferror(fp);
+    ok = (fclose(fp) == 0) && ok;
+    lock_.unlock();
+
+    return ok ? SDK_SUCCESS : SDK_FAILURE;
+}
+
+
+SDKTraceScope::SDKTraceScope(const char *name)
+    : name_(name), begin_(0)
+{
+    SDKTrace &trace = SDKTrace::getInstance();
+    if(trace.isEnabled())
+        begin_ = trace.now();
+}
+
+SDKTraceScope::~SDKTraceScope()
+{
+    SDKTrace &trace = SDKTrace::getInstance();
+    if(begin_ != 0 && trace.isEnabled())
+        trace.addHostScope(name_, begin_, trace.now());
+}
+
+} // namespace streamsdk
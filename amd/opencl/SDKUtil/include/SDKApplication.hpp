@@ -22,6 +22,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define SDKAPPLICATION_H_
 #include <SDKCommon.hpp>
 #include <SDKCommandArgs.hpp>
+#include <SDKTrace.hpp>
 
 /**
  * GLOBAL DEFINED Macros
@@ -91,7 +92,16 @@ protected:
     std::string dumpBinary;                 /**< Cmd Line Option- Dump Binary with name */
     std::string loadBinary;                 /**< Cmd Line Option- Load Binary with name */
     std::string flags;                      /**< Cmd Line Option- compiler flags */
-    
+    std::string benchFormat;                /**< Cmd Line Option- benchmark output format(json|csv) */
+    int benchWarmup;                        /**< Cmd Line Option- untimed warm-up runs in benchmark mode */
+    int benchRuns;                          /**< Cmd Line Option- measured runs in benchmark mode */
+    std::string benchFile;                  /**< Cmd Line Option- file the benchmark records are appended to */
+    std::vector<std::string> phaseNames;    /**< Names of the benchmark phases */
+    std::vector<int> phaseTimers;           /**< Timer handles of the benchmark phases */
+    std::vector<unsigned long long> phaseTraceBegin; /**< Trace timestamps the running phases began at */
+    std::string traceFile;                  /**< Cmd Line Option- Chrome trace output file */
+    bool benchRecorded;                     /**< If the benchmark record has been written */
+
 protected:
     /**
      * setup
@@ -135,6 +145,36 @@ protected:
      */
     virtual void printStats(std::string *stdStr, std::string * stats, int n);
 
+    /**
+     * printStats
+     * Print the results from the test, overridden by the samples
+     */
+    virtual void printStats() {}
+
+    /**
+     * beginPhase
+     * Starts timing a benchmark phase (setup, transfer, compute, verify...)
+     * Samples can time their own phases, e.g. "transfer", inside run()
+     * @param phase name of the phase
+     */
+    void beginPhase(const std::string &phase);
+
+    /**
+     * endPhase
+     * Stops timing a benchmark phase started with beginPhase
+     * @param phase name of the phase
+     */
+    void endPhase(const std::string &phase);
+
+    /**
+     * writeBenchmarkRecord
+     * Writes the stats and phase timings in the benchmark format
+     * @param statsStr names of the stats (may be NULL)
+     * @param stats values of the stats (may be NULL)
+     * @param n number of stats
+     */
+    void writeBenchmarkRecord(std::string *statsStr, std::string *stats, int n);
+
     /**
      * Destructor
      * Destroy the resources used by tests
@@ -246,6 +286,27 @@ public:
      */
     int parseCommandLine(int argc, char **argv);
     
+    /**
+     * execute
+     * Runs setup, the warm-up and measured runs, verifyResults and printStats.
+     * Every step is timed as a phase; in benchmark mode (--benchmark json|csv)
+     * the stats and phase timings are written as a machine readable record.
+     * cleanup is left to the caller.
+     * @return 0 on success, SDK_EXPECTED_FAILURE if setup skipped the sample
+     *         (e.g. unsupported device) and SDK_FAILURE on any other failure
+     */
+    int execute();
+
+    /**
+     * isBenchmarkEnabled
+     * Checks if the benchmark mode is used
+     * @return true if benchmark mode Enabled else false
+     */
+    bool isBenchmarkEnabled()
+    {
+        return benchFormat.size() != 0;
+    }
+
     /**
      * validatePlatformAndDeviceOptions
      * Validates if the intended platform and device is used
@@ -0,0 +1,124 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#ifndef SDKBINARYCACHE_HPP_
+#define SDKBINARYCACHE_HPP_
+
+/**
+ * Header Files
+ */
+#include <string>
+#include <CL/opencl.h>
+#include "SDKFile.hpp"
+
+/**
+ * namespace streamsdk
+ */
+namespace streamsdk
+{
+
+/**
+ * class SDKBinaryCache
+ * Persistent on-disk cache of program binaries used by
+ * SDKCommon::buildOpenCLProgram.
+ *
+ * An entry is keyed by the hash of the kernel source, the build options
+ * and the identity of the device (name, vendor, driver and platform
+ * version), so a driver update or a change of flags simply misses.
+ * Entries are written to a temporary file and renamed into place, so
+ * concurrent writers never expose a partially written binary.
+ * Headers pulled in through #include are not part of the key.
+ *
+ * Environment variables:
+ *   SDK_BINARY_CACHE=0        disables the cache
+ *   SDK_BINARY_CACHE_DIR=dir  overrides the cache directory
+ *                             (default: "BinaryCache" next to the executable)
+ */
+class SDKBinaryCache
+{
+public:
+    /**
+     * Constructor
+     * @param defaultDir directory used when SDK_BINARY_CACHE_DIR is not set
+     */
+    SDKBinaryCache(const std::string &defaultDir);
+
+    /**
+     * isEnabled
+     * @return true unless disabled through SDK_BINARY_CACHE=0
+     */
+    bool isEnabled() const { return enabled_; }
+
+    /**
+     * computeKey
+     * Builds the cache key for a source/options/device combination
+     * @param device device the program is built for
+     * @param source kernel source
+     * @param sourceSize size of the kernel source in bytes
+     * @param flags build options
+     * @param key output key
+     * @return SDK_SUCCESS if success else nonzero
+     */
+    int computeKey(cl_device_id device,
+                   const char *source,
+                   size_t sourceSize,
+                   const std::string &flags,
+                   std::string &key);
+
+    /**
+     * load
+     * Maps the binary stored for a key
+     * @param key key returned by computeKey
+     * @param entryFile holds the mapped entry, must outlive binary
+     * @param binary output pointer to the binary inside entryFile
+     * @param binarySize output size of the binary in bytes
+     * @return SDK_SUCCESS if a valid entry was found else nonzero
+     */
+    int load(const std::string &key,
+             SDKFile &entryFile,
+             const char *&binary,
+             size_t &binarySize);
+
+    /**
+     * store
+     * Stores the binary of a built program for one of its devices
+     * @param key key returned by computeKey
+     * @param program built program object
+     * @param device device whose binary is stored
+     * @return SDK_SUCCESS if success else nonzero
+     */
+    int store(const std::string &key, cl_program program, cl_device_id device);
+
+    /**
+     * remove
+     * Invalidates the entry for a key (e.g. the runtime rejected the binary)
+     * @param key key returned by computeKey
+     */
+    void remove(const std::string &key);
+
+private:
+    /**
+     * entryPath
+     * @return file name of the entry for a key
+     */
+    std::string entryPath(const std::string &key) const;
+
+    bool enabled_;           /**< enabled_ false if disabled by environment */
+    std::string cacheDir_;   /**< cacheDir_ directory holding the entries */
+};
+
+} // namespace streamsdk
+
+#endif  // SDKBINARYCACHE_HPP_
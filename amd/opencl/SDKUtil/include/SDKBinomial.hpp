@@ -0,0 +1,59 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#ifndef SDKBINOMIAL_HPP_
+#define SDKBINOMIAL_HPP_
+
+/**
+ * Header Files
+ */
+#include <stddef.h>
+#include "SDKThread.hpp"
+
+/**
+ * namespace streamsdk
+ */
+namespace streamsdk
+{
+
+/**
+ * binomialEuropeanCall
+ * Prices European call options on a Cox-Ross-Rubinstein lattice of
+ * numSteps steps, the host counterpart of the BinomialOption kernels.
+ *
+ * Options are priced in batches of 16, one per SIMD lane, so the backward
+ * walk over the lattice is a single pass of vector multiply-adds shared by
+ * the whole batch (AVX-512, AVX with FMA or SSE, picked at run time).
+ * Leaf payoffs are generated by repeated multiplication with u^2 in double
+ * precision instead of one exp per leaf, and denormals are flushed to zero
+ * during the walk. Batches are spread over SDKThreadPool::getInstance().
+ *
+ * @param count number of options
+ * @param s spot prices
+ * @param x strike prices
+ * @param t times to expiration in years
+ * @param riskFree risk free interest rate
+ * @param volatility volatility of the underlying
+ * @param numSteps depth of the lattice
+ * @param price returned option prices
+ */
+EXPORT void binomialEuropeanCall(size_t count,
+                                 const float *s, const float *x, const float *t,
+                                 float riskFree, float volatility, int numSteps,
+                                 float *price);
+
+}
+
+#endif
@@ -23,7 +23,9 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <iostream>
 #include <string.h>
 #include <stdio.h>
+#include <vector>
 #include <SDKCommon.hpp>
+#include <SDKFile.hpp>
 
 /**
  * Namespace streamsdk
@@ -240,4 +242,135 @@ public:
 };
 }
 #pragma pack(pop)
+
+namespace streamsdk
+{
+
+/**
+ * class SDKBitMapReader
+ * Random access to the rows of an uncompressed 8, 24 or 32 bit bitmap
+ * without decoding the whole image. The file is memory mapped, so only
+ * the rows that are read are paged in and images larger than the
+ * physical memory can be processed in stripes or tiles.
+ * Rows are numbered in the order SDKBitMap::getPixels() uses.
+ */
+class SDKBitMapReader
+{
+public:
+    SDKBitMapReader();
+
+    /**
+     * Maps the bitmap and parses its headers
+     * @param filename path of the bitmap
+     * @return true if the file is a bitmap this reader supports
+     */
+    bool open(const char * filename);
+
+    /**
+     * Releases the mapping
+     */
+    void close();
+
+    bool isOpen() const { return isOpen_; }
+
+    int getWidth() const { return info_.width; }
+
+    int getHeight() const { return height_; }
+
+    int getBitsPerPixel() const { return info_.bitsPerPixel; }
+
+    /**
+     * File and info headers as stored in the file
+     */
+    const BitMapHeader& getHeader() const { return header_; }
+    const BitMapInfoHeader& getInfoHeader() const { return info_; }
+
+    /**
+     * Palette of an 8 bit image, empty otherwise
+     */
+    const std::vector<ColorPalette>& getPalette() const { return palette_; }
+
+    /**
+     * Decodes rows [firstRow, firstRow + numRows) into dst
+     * @param dst receives numRows * getWidth() pixels
+     * @return false if the rows are out of range
+     */
+    bool readRows(int firstRow, int numRows, uchar4 * dst) const;
+
+    /**
+     * Decodes a tile into dst
+     * @param dstPitch distance in pixels between rows of dst
+     * @return false if the tile is out of range
+     */
+    bool readTile(int x, int y, int tileWidth, int tileHeight,
+                  uchar4 * dst, int dstPitch) const;
+
+private:
+    SDKBitMapReader(const SDKBitMapReader&);
+    SDKBitMapReader& operator=(const SDKBitMapReader&);
+
+    SDKFile file_;                      /**< Mapped bitmap file */
+    BitMapHeader header_;               /**< File header */
+    BitMapInfoHeader info_;             /**< Info header */
+    std::vector<ColorPalette> palette_; /**< Palette of 8 bit images */
+    const unsigned char * pixelData_;   /**< First stored row */
+    size_t stride_;                     /**< Bytes per stored row */
+    int height_;                        /**< Number of rows */
+    bool topDown_;                      /**< Rows stored top to bottom */
+    bool isOpen_;                       /**< If a bitmap is mapped */
+};
+
+/**
+ * class SDKBitMapWriter
+ * Writes an uncompressed 24 or 32 bit bitmap a stripe of rows at a time,
+ * so the image never has to be resident as a whole. Rows are written in
+ * the order SDKBitMap::getPixels() uses.
+ */
+class SDKBitMapWriter
+{
+public:
+    SDKBitMapWriter();
+
+    /**
+     * Closes the file if still open
+     */
+    ~SDKBitMapWriter() { close(); }
+
+    /**
+     * Creates the file and writes the headers
+     * @return false if the file cannot be created or bitsPerPixel is not 24 or 32
+     */
+    bool open(const char * filename, int width, int height, int bitsPerPixel = 24);
+
+    /**
+     * Appends numRows rows of getWidth() pixels
+     * @return false on a write error or if more rows than the height are written
+     */
+    bool writeRows(const uchar4 * src, int numRows);
+
+    /**
+     * Closes the file
+     * @return true if every row was written successfully
+     */
+    bool close();
+
+    int getWidth() const { return width_; }
+
+    int getHeight() const { return height_; }
+
+    int getRowsWritten() const { return rowsWritten_; }
+
+private:
+    SDKBitMapWriter(const SDKBitMapWriter&);
+    SDKBitMapWriter& operator=(const SDKBitMapWriter&);
+
+    FILE * fd_;                             /**< Output file */
+    int width_;                             /**< Image width */
+    int height_;                            /**< Image height */
+    int bitsPerPixel_;                      /**< 24 or 32 */
+    int rowsWritten_;                       /**< Rows written so far */
+    bool failed_;                           /**< A write failed */
+    std::vector<unsigned char> rowBuffer_;  /**< One encoded row */
+};
+}
 #endif //CL_BITMAP
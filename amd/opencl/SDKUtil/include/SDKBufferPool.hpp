@@ -0,0 +1,174 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#ifndef SDKBUFFERPOOL_HPP_
+#define SDKBUFFERPOOL_HPP_
+
+/**
+ * Header Files
+ */
+#include <map>
+#include <vector>
+#include <SDKThread.hpp>
+
+/**
+ * Alignment of pool buffers unless a larger one is requested
+ */
+#define SDK_CACHE_LINE_SIZE 64
+
+/**
+ * Size of a huge page, buffers backed by huge pages are rounded up to it
+ */
+#define SDK_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * Returns a buffer obtained from SDKBufferPool::getInstance() to the pool
+ */
+#define POOL_FREE(ptr) \
+    { \
+        if(ptr != NULL) \
+        { \
+            streamsdk::SDKBufferPool::getInstance().release(ptr); \
+            ptr = NULL; \
+        } \
+    }
+
+/**
+ * namespace streamsdk
+ */
+namespace streamsdk
+{
+
+/**
+ * How large buffers are backed
+ */
+enum HugePageMode
+{
+    HUGE_PAGES_NONE,         /**< regular pages */
+    HUGE_PAGES_TRANSPARENT,  /**< 2MB aligned and advised for transparent huge pages */
+    HUGE_PAGES_EXPLICIT      /**< reserved huge pages, transparent if none are free */
+};
+
+/**
+ * class SDKBufferPool
+ * Recycling allocator for host buffers.
+ *
+ * Buffers are at least cache-line aligned. Buffers of at least
+ * getLargeThreshold() bytes are mapped directly from the OS, page aligned
+ * and, depending on the huge page mode, backed by huge pages. Released
+ * buffers are kept and handed out again for requests of a similar size,
+ * so repeated runs neither fragment the heap nor fault the pages in again.
+ *
+ * Environment variables read by the shared instance:
+ *   SDK_HUGE_PAGES=none|transparent|explicit  (default: transparent)
+ *   SDK_POOL_CACHE_MB=n                       bytes kept for reuse (default: 1024)
+ */
+class SDKBufferPool
+{
+public:
+    /**
+     * Constructor
+     */
+    SDKBufferPool();
+
+    /**
+     * Destructor, returns every cached buffer to the OS
+     */
+    ~SDKBufferPool();
+
+    /**
+     * getInstance
+     * @return the pool shared by the samples
+     */
+    static SDKBufferPool& getInstance();
+
+    /**
+     * allocate
+     * @param size bytes requested
+     * @param alignment power of two, raised to SDK_CACHE_LINE_SIZE if smaller
+     * @return buffer of at least size bytes, NULL on failure
+     */
+    void* allocate(size_t size, size_t alignment = SDK_CACHE_LINE_SIZE);
+
+    /**
+     * release
+     * Returns a buffer to the pool. Buffers beyond the cache limit go
+     * back to the OS. NULL is ignored.
+     */
+    void release(void *ptr);
+
+    /**
+     * trim
+     * Returns every cached buffer to the OS
+     */
+    void trim();
+
+    void setHugePageMode(HugePageMode mode) { hugePageMode_ = mode; }
+    HugePageMode getHugePageMode() const { return hugePageMode_; }
+
+    /**
+     * Buffers of at least this size are page mapped, default 256KB
+     */
+    void setLargeThreshold(size_t bytes) { largeThreshold_ = bytes; }
+    size_t getLargeThreshold() const { return largeThreshold_; }
+
+    /**
+     * Bytes of released buffers kept for reuse
+     */
+    void setMaxCachedBytes(size_t bytes);
+    size_t getCachedBytes() const { return cachedBytes_; }
+
+    /**
+     * Allocations served from the cache and from the OS
+     */
+    size_t getHits() const { return hits_; }
+    size_t getMisses() const { return misses_; }
+
+private:
+    /**
+     * A buffer and the memory backing it
+     */
+    struct Block
+    {
+        void *base;         /**< start of the OS allocation */
+        size_t capacity;    /**< usable bytes from ptr */
+        size_t mappedSize;  /**< bytes mapped at base, 0 if heap allocated */
+        void *ptr;          /**< pointer handed out */
+    };
+
+    typedef std::multimap<size_t, Block> FreeList;
+    typedef std::map<void*, Block> UsedList;
+
+    SDKBufferPool(const SDKBufferPool&);
+    SDKBufferPool& operator=(const SDKBufferPool&);
+
+    bool allocateBlock(size_t size, size_t alignment, Block &block);
+    void freeBlock(const Block &block);
+    void evict(size_t bytes, std::vector<Block> &victims);
+
+    ThreadLock lock_;
+    FreeList free_;
+    UsedList used_;
+    HugePageMode hugePageMode_;
+    size_t largeThreshold_;
+    size_t maxCachedBytes_;
+    size_t cachedBytes_;
+    size_t hits_;
+    size_t misses_;
+};
+
+} // namespace streamsdk
+
+#endif // SDKBUFFERPOOL_HPP_
@@ -77,6 +77,8 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define SDK_VERSION_BUILD 1
 #define SDK_VERSION_REVISION 1
 
+#define SDK_ULP_HISTOGRAM_BINS 65
+
 #define CHECK_ALLOCATION(actual, msg) \
         if(actual == NULL) \
         { \
@@ -242,6 +244,73 @@ namespace streamsdk
 		long long _freq;	/**< _freq frequency*/
 		long long _clocks;	/**< _clocks number of ticks at end*/
 		long long _start;	/**< _start start point ticks*/
+		long long _count;	/**< _count number of start/stop intervals measured*/
+		long long _min;		/**< _min shortest interval in ticks*/
+		long long _max;		/**< _max longest interval in ticks*/
+		double _mean;		/**< _mean running mean of the intervals in ticks*/
+		double _m2;			/**< _m2 running sum of squared deviations (Welford)*/
+		std::vector<long long> _samples; /**< _samples history of interval lengths in ticks*/
+	};
+
+	/**
+	 * TimerStats
+	 * struct to hold the statistics of a timer, all values in seconds
+	 */
+	struct TimerStats
+	{
+		long long count;	/**< count number of start/stop intervals measured */
+		double total;		/**< total sum of all intervals */
+		double min;			/**< min shortest interval */
+		double max;			/**< max longest interval */
+		double mean;		/**< mean average interval */
+		double median;		/**< median median of the recorded history */
+		double p99;			/**< p99 99th percentile of the recorded history */
+		double stddev;		/**< stddev standard deviation of the intervals */
+	};
+
+	/**
+	 * CompareOptions
+	 * struct to control SDKCommon::compareDetailed
+	 * An element mismatches when both its absolute and its relative error
+	 * exceed the tolerances; the defaults ask for exact equality
+	 */
+	struct CompareOptions
+	{
+		double absTolerance;		/**< absTolerance allowed absolute error */
+		double relTolerance;		/**< relTolerance allowed error relative to the reference */
+		size_t maxMismatches;		/**< maxMismatches number of mismatching indices recorded */
+		unsigned int numThreads;	/**< numThreads host threads used, 0 for all pool threads */
+
+		/**
+		 * Constructor
+		 */
+		CompareOptions()
+		{
+			absTolerance = 0.0;
+			relTolerance = 0.0;
+			maxMismatches = 16;
+			numThreads = 0;
+		}
+	};
+
+	/**
+	 * CompareStats
+	 * struct to hold the error statistics computed by SDKCommon::compareDetailed
+	 * ulpHistogram[0] counts exact matches, ulpHistogram[b] distances in [2^(b-1), 2^b)
+	 */
+	struct CompareStats
+	{
+		size_t length;					/**< length number of values compared */
+		size_t mismatchCount;			/**< mismatchCount number of values out of tolerance */
+		double maxAbsError;				/**< maxAbsError largest absolute error */
+		size_t maxAbsErrorIndex;		/**< maxAbsErrorIndex index of the largest absolute error */
+		double maxRelError;				/**< maxRelError largest relative error */
+		size_t maxRelErrorIndex;		/**< maxRelErrorIndex index of the largest relative error */
+		double l2RelError;				/**< l2RelError norm of the error relative to the norm of the reference */
+		double l2RefNorm;				/**< l2RefNorm norm of the reference */
+		cl_ulong maxUlp;				/**< maxUlp largest distance in units in the last place */
+		cl_ulong ulpHistogram[SDK_ULP_HISTOGRAM_BINS];	/**< ulpHistogram histogram of the ULP distances */
+		std::vector<size_t> mismatches;	/**< mismatches first mismatching indices in ascending order */
 	};
 
 	/**
@@ -583,6 +652,29 @@ namespace streamsdk
 		bool compare(const double *refData, const double *data, 
 						const int length, const double epsilon = 1e-6); 
 
+		/**
+		 * compareDetailed
+		 * multi-threaded element wise comparison with error statistics
+		 * Instantiated for float, double and the integer types
+		 * @param refData reference values
+		 * @param data values to check
+		 * @param length number of values to compare
+		 * @param stats CompareStats object filled with the error statistics
+		 * @param options tolerances and threading options
+		 * @return true if no value is out of tolerance
+		 */
+		template<typename T>
+		bool compareDetailed(const T *refData, const T *data, size_t length,
+						CompareStats &stats,
+						const CompareOptions &options = CompareOptions());
+
+		/**
+		 * printCompareStats
+		 * displays the statistics computed by compareDetailed
+		 * @param stats CompareStats object
+		 */
+		void printCompareStats(const CompareStats &stats);
+
 		/**
 		 * display devices
 		 * displays the devices in a platform
@@ -652,7 +744,8 @@ namespace streamsdk
 
 		/**
 		 * waitForEventAndRelease
-		 * waits for a event to complete and release the event afterwards
+		 * waits for a event to complete and release the event afterwards,
+		 * recording its profiling information when SDKTrace is enabled
 		 * @param event cl_event object
 		 * @return 0 if success else nonzero
 		 */
@@ -673,6 +766,9 @@ namespace streamsdk
 		/**
 		 * fillRandom
 		 * fill array with random values
+		 * Values come from a Philox4x32-10 counter based generator keyed by
+		 * the seed, so the output only depends on the seed and the index and
+		 * the array is filled by all host threads
 		 */
 		template<typename T> 
 		int fillRandom(
@@ -758,6 +854,21 @@ namespace streamsdk
 		int stopTimer(int handle);
 		double readTimer(int handle);
 
+		/**
+		 * getTimerStats
+		 * statistics over every start/stop interval of a timer
+		 * @param handle timer handle returned by createTimer
+		 * @param stats TimerStats object filled in seconds
+		 * @return 0 if success else nonzero
+		 */
+		int getTimerStats(int handle, TimerStats &stats);
+
+		/**
+		 * getTimerResolution
+		 * @return resolution of the timing backend in seconds
+		 */
+		static double getTimerResolution();
+
 		/**
 		 * printTable
 		 * displays a table of input/output 
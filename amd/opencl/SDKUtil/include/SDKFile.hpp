@@ -47,12 +47,12 @@ public:
     /**
 	 *Default constructor
 	 */
-    SDKFile(): source_(""){}
+    SDKFile(): source_(""), view_(NULL), viewSize_(0){}
 
     /**
 	 * Destructor
 	 */
-    ~SDKFile(){};
+    ~SDKFile(){ unmap(); }
 
     /**
 	 * Opens the CL program file
@@ -76,6 +76,42 @@ public:
 	 */
     int readBinaryFromFile(const char* fileName);
 
+    /**
+	 * map
+	 * Maps the file read-only into memory. The contents are then
+	 * available through data() and size() without being copied and
+	 * are paged in on first access. Falls back to reading the file
+	 * into memory where it cannot be mapped.
+	 * The view is not NUL terminated and source() is left empty.
+	 * @param fileName name of file
+	 * @return true if success else false
+	 */
+    bool map(const char* fileName);
+
+    /**
+	 * unmap
+	 * Releases the view created by map()
+	 */
+    void unmap();
+
+    /**
+	 * isMapped
+	 * @return true if data() points into a file mapping
+	 */
+    bool isMapped() const { return view_ != NULL; }
+
+    /**
+	 * data
+	 * Returns the mapped view, or the loaded contents if not mapped
+	 */
+    const char* data() const { return view_ ? view_ : source_.data(); }
+
+    /**
+	 * size
+	 * Returns the size in bytes of data()
+	 */
+    size_t size() const { return view_ ? viewSize_ : source_.size(); }
+
     /**
 	 * Replaces Newline with spaces
 	 */
@@ -113,6 +149,8 @@ private:
     SDKFile& operator=(const SDKFile&);
 
     std::string     source_;    //!< source code of the CL program
+    const char*     view_;      //!< read-only file mapping, NULL if not mapped
+    size_t          viewSize_;  //!< size of view_ in bytes
 };
 
 } // namespace streamsdk
@@ -0,0 +1,71 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#ifndef SDKGEMM_HPP_
+#define SDKGEMM_HPP_
+
+/**
+ * Header Files
+ */
+#include <stddef.h>
+#include "SDKThread.hpp"
+
+/**
+ * namespace streamsdk
+ */
+namespace streamsdk
+{
+
+/**
+ * gemm
+ * Host matrix multiplication C = A * B, or C += A * B, of row-major matrices.
+ *
+ * B is packed into panels sized for the L3 cache and slices of A into
+ * blocks sized for L2; a register-tiled micro-kernel multiplies one panel
+ * strip of each, so every element loaded from memory is reused across a
+ * whole tile. The blocks of A are spread over SDKThreadPool::getInstance().
+ * Any sizes work, edges are zero padded in the packed copies. The kernel
+ * uses AVX and FMA where the CPU has them, SSE2 otherwise.
+ *
+ * @param m rows of A and C
+ * @param n columns of B and C
+ * @param k columns of A and rows of B
+ * @param a matrix A, element (i, l) at a[i * lda + l]
+ * @param lda row pitch of A in elements
+ * @param b matrix B, element (l, j) at b[l * ldb + j]
+ * @param ldb row pitch of B in elements
+ * @param c matrix C, element (i, j) at c[i * ldc + j]
+ * @param ldc row pitch of C in elements
+ * @param accumulate add the product to C instead of overwriting it
+ */
+EXPORT void gemm(size_t m, size_t n, size_t k,
+                 const float *a, size_t lda,
+                 const float *b, size_t ldb,
+                 float *c, size_t ldc,
+                 bool accumulate = false);
+
+/**
+ * gemm
+ * Double precision variant of the above
+ */
+EXPORT void gemm(size_t m, size_t n, size_t k,
+                 const double *a, size_t lda,
+                 const double *b, size_t ldb,
+                 double *c, size_t ldc,
+                 bool accumulate = false);
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#ifndef SDKHISTOGRAM_HPP_
+#define SDKHISTOGRAM_HPP_
+
+/**
+ * Header Files
+ */
+#include <stddef.h>
+#include "SDKThread.hpp"
+
+/**
+ * namespace streamsdk
+ */
+namespace streamsdk
+{
+
+/**
+ * class HostHistogram
+ * Host histogram of 8, 16 or 32 bit values into numBins bins, fed chunk by
+ * chunk through add() so inputs larger than memory can be streamed.
+ *
+ * Every add() splits its chunk into one contiguous range per host thread of
+ * SDKThreadPool::getInstance(). A thread counts its range into a private
+ * sub-histogram that is replicated four times (when four copies fit in L1),
+ * consecutive values going to different copies, so runs of equal values do
+ * not stall on the store of the previous increment. The copies and then the
+ * threads are summed with SIMD adds into 64 bit totals.
+ *
+ * Values >= numBins are not counted.
+ */
+class EXPORT HostHistogram
+{
+    public:
+        /**
+         * Constructor, allocates the sub-histograms
+         * @param numBins number of bins, values 0..numBins-1 are counted
+         */
+        HostHistogram(size_t numBins);
+
+        ~HostHistogram();
+
+        /**
+         * isValid
+         * @return false if the sub-histograms could not be allocated,
+         *         add() does nothing then
+         */
+        bool isValid() const
+        {
+            return _slots != NULL;
+        }
+
+        /**
+         * Counts the count values of data into the histogram
+         */
+        void add(const unsigned char *data, size_t count);
+        void add(const unsigned short *data, size_t count);
+        void add(const unsigned int *data, size_t count);
+
+        /**
+         * Sets every bin to 0
+         */
+        void reset();
+
+        /**
+         * getNumBins
+         * @return number of bins
+         */
+        size_t getNumBins() const
+        {
+            return _numBins;
+        }
+
+        /**
+         * getCounts
+         * @return the numBins totals so far
+         */
+        const unsigned long long* getCounts() const
+        {
+            return _counts;
+        }
+
+        /**
+         * getCounts
+         * Copies the totals to bins, truncated to 32 bits
+         */
+        void getCounts(unsigned int *bins) const;
+
+    private:
+        HostHistogram(const HostHistogram&);
+        HostHistogram& operator=(const HostHistogram&);
+
+        template<typename T>
+        void addValues(const T *data, size_t count);
+
+        size_t _numBins;
+        size_t _stride;             /**< counters per sub-histogram copy */
+        size_t _copies;             /**< copies per thread */
+        size_t _numSlots;           /**< sub-histograms, one per thread */
+        unsigned int *_slots;
+        unsigned long long *_counts;
+};
+
+/**
+ * histogram
+ * One-shot histogram of count values into numBins bins through HostHistogram
+ *
+ * @param data values to count
+ * @param count number of values
+ * @param numBins number of bins
+ * @param bins receives the numBins counts
+ * @return false if the sub-histograms could not be allocated
+ */
+EXPORT bool histogram(const unsigned char *data, size_t count, size_t numBins, unsigned int *bins);
+EXPORT bool histogram(const unsigned short *data, size_t count, size_t numBins, unsigned int *bins);
+EXPORT bool histogram(const unsigned int *data, size_t count, size_t numBins, unsigned int *bins);
+
+}
+
+#endif
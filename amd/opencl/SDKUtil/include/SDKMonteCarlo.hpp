@@ -0,0 +1,76 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#ifndef SDKMONTECARLO_HPP_
+#define SDKMONTECARLO_HPP_
+
+/**
+ * Header Files
+ */
+#include <stddef.h>
+#include "SDKThread.hpp"
+
+/**
+ * namespace streamsdk
+ */
+namespace streamsdk
+{
+
+/**
+ * asianCallMonteCarlo
+ * Monte Carlo price and vega of an arithmetic average Asian call, the host
+ * counterpart of the MonteCarloAsian kernels.
+ *
+ * Each path is a geometric Brownian motion observed at numSum equally
+ * spaced points from 0 to maturity (the initial price included in the
+ * average). The normals of path p at observation i come from a Philox4x32-10
+ * counter keyed by (seed, stream), with (p / 4, i) as the counter, so every
+ * path owns its random stream and the result does not depend on how the
+ * paths are spread over SDKThreadPool::getInstance(). Partial sums are
+ * folded in a fixed order, which makes price and vega bit-identical for any
+ * number of threads. Paths are simulated 16 at a time with SSE2 exp, log
+ * and sin/cos approximations where available.
+ *
+ * @param numPaths number of simulated paths
+ * @param numSum number of observations averaged, at least 2
+ * @param initPrice initial price of the underlying
+ * @param strikePrice strike price
+ * @param interest risk free interest rate
+ * @param maturity time to maturity in years
+ * @param sigma volatility of the underlying
+ * @param seed first word of the random key
+ * @param stream second word of the random key, e.g. the index of the sigma
+ * @param price returned discounted option price
+ * @param vega returned discounted derivative of the price by sigma
+ */
+EXPORT void asianCallMonteCarlo(size_t numPaths, int numSum,
+                                float initPrice, float strikePrice, float interest,
+                                float maturity, float sigma,
+                                unsigned int seed, unsigned int stream,
+                                float *price, float *vega);
+
+/**
+ * asianCallMonteCarlo
+ * Double precision variant of the above
+ */
+EXPORT void asianCallMonteCarlo(size_t numPaths, int numSum,
+                                double initPrice, double strikePrice, double interest,
+                                double maturity, double sigma,
+                                unsigned int seed, unsigned int stream,
+                                double *price, double *vega);
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#ifndef SDKRADIXSORT_HPP_
+#define SDKRADIXSORT_HPP_
+
+/**
+ * Header Files
+ */
+#include <stddef.h>
+#include "SDKThread.hpp"
+
+/**
+ * namespace streamsdk
+ */
+namespace streamsdk
+{
+
+/**
+ * radixSort
+ * Sorts count unsigned keys in place in ascending order, stable, with an
+ * LSD radix sort of 8 bit digits.
+ *
+ * One read of the keys counts every digit; passes whose digit is the same
+ * for all keys are skipped. Each pass splits the keys into one contiguous
+ * chunk per host thread of SDKThreadPool::getInstance(): the chunks are
+ * counted in parallel, the per chunk histograms are turned into output
+ * offsets, and the chunks are scattered in parallel through write-combining
+ * buffers that hold one cache line per bucket, so the scatter streams whole
+ * lines to memory instead of touching 256 lines per key.
+ *
+ * The scratch buffer (count keys, plus count values) comes from malloc.
+ *
+ * @param keys keys to sort
+ * @param count number of keys
+ * @return false if the scratch buffer could not be allocated, keys are
+ *         left unchanged then
+ */
+EXPORT bool radixSort(unsigned int *keys, size_t count);
+
+/**
+ * radixSort
+ * 64 bit keys
+ */
+EXPORT bool radixSort(unsigned long long *keys, size_t count);
+
+/**
+ * radixSort
+ * Sorts keys and permutes values along with them (values[i] stays attached
+ * to keys[i]), e.g. to get the sorting permutation from values 0..count-1
+ *
+ * @param keys keys to sort
+ * @param values payload of each key
+ * @param count number of keys
+ * @return false if the scratch buffers could not be allocated
+ */
+EXPORT bool radixSort(unsigned int *keys, unsigned int *values, size_t count);
+
+/**
+ * radixSort
+ * 64 bit keys with values
+ */
+EXPORT bool radixSort(unsigned long long *keys, unsigned int *values, size_t count);
+
+}
+
+#endif
@@ -14,7 +14,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ********************************************************************/
 #ifndef _SDK_THREAD_H_
-#define _SDK_THREAD_H
+#define _SDK_THREAD_H_
 
 #ifdef _WIN32
 #ifndef _WIN32_WINNT
@@ -66,6 +66,12 @@ namespace streamsdk
 	 */
     typedef void* (*threadFunc)(void*);
 
+    /**
+     * getNumCPUCores
+     * @return number of logical processors available to the process
+     */
+    unsigned int getNumCPUCores();
+
     /**
 	 * class ThreadLock
      *  \brief Provides a wrapper for locking primitives used to 
@@ -0,0 +1,293 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#ifndef _SDK_THREAD_POOL_H_
+#define _SDK_THREAD_POOL_H_
+
+/**
+ * Header Files
+ */
+#include <vector>
+#include <deque>
+#include "SDKThread.hpp"
+#ifndef _WIN32
+#include <semaphore.h>
+#endif
+
+/**
+ * namespace streamsdk
+ */
+namespace streamsdk
+{
+    class SDKThreadPool;
+    class TaskGroup;
+    struct PoolWorker;
+
+    /**
+     * Queued unit of work
+     */
+    struct PoolTask
+    {
+        threadFunc func;
+        void *arg;
+        TaskGroup *group;
+    };
+
+    /**
+     * struct ThreadPoolOptions
+     * Construction options of SDKThreadPool
+     */
+    struct ThreadPoolOptions
+    {
+        unsigned int numThreads;  /**< threads including the caller, 0 = all cores */
+        bool pinThreads;          /**< pin each worker to one core */
+        int numaNode;             /**< restrict the workers to this node, -1 = any */
+
+        ThreadPoolOptions()
+            : numThreads(0), pinThreads(false), numaNode(-1)
+        {
+        }
+    };
+
+    /**
+     * class TaskGroup
+     * A set of tasks submitted to a pool that can be waited on together.
+     * wait() runs queued tasks on the calling thread until the group is
+     * done, so groups may be nested inside tasks without deadlocking.
+     * The destructor waits for outstanding tasks.
+     */
+    class EXPORT TaskGroup
+    {
+        public:
+            /**
+             * Constructor
+             * @param pool pool to run on, NULL selects the shared pool
+             */
+            TaskGroup(SDKThreadPool *pool = NULL);
+
+            ~TaskGroup();
+
+            /**
+             * Queues func(arg). The return value of func is ignored
+             */
+            void run(threadFunc func, void *arg);
+
+            /**
+             * Returns once every task queued through run() has finished
+             */
+            void wait();
+
+        private:
+            friend class SDKThreadPool;
+
+            TaskGroup(const TaskGroup&);
+            TaskGroup& operator=(const TaskGroup&);
+
+            SDKThreadPool *_pool;
+            volatile long _pending;
+    };
+
+    /**
+     * Range handed to a parallelFor/parallelReduce task
+     */
+    template<typename Body, typename T>
+    struct ParallelRange
+    {
+        const Body *body;
+        size_t begin;
+        size_t end;
+        T *result;
+    };
+
+    template<typename Body>
+    void* parallelForTask(void *arg)
+    {
+        ParallelRange<Body, int> *range = (ParallelRange<Body, int>*)arg;
+        (*range->body)(range->begin, range->end);
+        return NULL;
+    }
+
+    template<typename Body, typename T>
+    void* parallelReduceTask(void *arg)
+    {
+        ParallelRange<Body, T> *range = (ParallelRange<Body, T>*)arg;
+        *range->result = (*range->body)(range->begin, range->end);
+        return NULL;
+    }
+
+    /**
+     * class SDKThreadPool
+     * Work-stealing pool of persistent host threads.
+     *
+     * Each worker owns a deque: it pops its own tasks LIFO while idle
+     * workers steal FIFO from the others. Tasks submitted from outside
+     * the pool are spread round-robin over the workers. The thread that
+     * waits on a TaskGroup helps executing tasks, so a pool created with
+     * numThreads = n starts n - 1 workers.
+     *
+     * The shared instance is sized from the environment:
+     *   SDK_NUM_THREADS=n      threads including the caller (default: all cores)
+     *   SDK_THREAD_AFFINITY=1  pins every worker to one core
+     *   SDK_NUMA_NODE=n        keeps the workers on the cores of node n
+     */
+    class EXPORT SDKThreadPool
+    {
+        public:
+            /**
+             * Constructor, starts the worker threads
+             */
+            SDKThreadPool(const ThreadPoolOptions &options = ThreadPoolOptions());
+
+            /**
+             * Destructor, finishes queued tasks and joins the workers
+             */
+            ~SDKThreadPool();
+
+            /**
+             * getInstance
+             * @return the pool shared by SDKUtil and the samples
+             */
+            static SDKThreadPool& getInstance();
+
+            /**
+             * getNumThreads
+             * @return number of threads executing tasks, including the caller
+             */
+            unsigned int getNumThreads() const
+            {
+                return (unsigned int)_workers.size() + 1;
+            }
+
+            /**
+             * Runs one queued task on the calling thread
+             * @return false if no task was available
+             */
+            bool runPendingTask();
+
+            /**
+             * parallelFor
+             * Calls body(begin, end) on disjoint sub-ranges covering [begin, end)
+             * @param grain minimum elements per sub-range, 0 picks one
+             *        that gives every thread a few sub-ranges
+             */
+            template<typename Body>
+            void parallelFor(size_t begin, size_t end, const Body &body, size_t grain = 0)
+            {
+                if(end <= begin)
+                    return;
+
+                std::vector<ParallelRange<Body, int> > ranges;
+                splitRange(begin, end, grain, &body, (int*)NULL, ranges);
+                if(ranges.size() == 1)
+                {
+                    body(begin, end);
+                    return;
+                }
+
+                TaskGroup group(this);
+                for(size_t i = 1; i < ranges.size(); ++i)
+                    group.run(parallelForTask<Body>, &ranges[i]);
+                parallelForTask<Body>(&ranges[0]);
+                group.wait();
+            }
+
+            /**
+             * parallelReduce
+             * Evaluates body(begin, end) -> T on sub-ranges and folds the
+             * partial results with combine(T, T) in range order, so the
+             * result is reproducible for a given grain. Pass a nonzero
+             * grain to make it independent of the number of threads.
+             */
+            template<typename T, typename Body, typename Combine>
+            T parallelReduce(size_t begin, size_t end, const T &identity,
+                             const Body &body, const Combine &combine,
+                             size_t grain = 0)
+            {
+                if(end <= begin)
+                    return identity;
+
+                std::vector<ParallelRange<Body, T> > ranges;
+                std::vector<T> partial;
+                splitRange(begin, end, grain, &body, (T*)NULL, ranges);
+                partial.resize(ranges.size(), identity);
+                for(size_t i = 0; i < ranges.size(); ++i)
+                    ranges[i].result = &partial[i];
+
+                TaskGroup group(this);
+                for(size_t i = 1; i < ranges.size(); ++i)
+                    group.run(parallelReduceTask<Body, T>, &ranges[i]);
+                parallelReduceTask<Body, T>(&ranges[0]);
+                group.wait();
+
+                T result = identity;
+                for(size_t i = 0; i < partial.size(); ++i)
+                    result = combine(result, partial[i]);
+                return result;
+            }
+
+        private:
+            friend class TaskGroup;
+            friend struct PoolWorker;
+
+            SDKThreadPool(const SDKThreadPool&);
+            SDKThreadPool& operator=(const SDKThreadPool&);
+
+            template<typename Body, typename T>
+            void splitRange(size_t begin, size_t end, size_t grain, const Body *body,
+                            T *result, std::vector<ParallelRange<Body, T> > &ranges)
+            {
+                size_t length = end - begin;
+                size_t count = getNumThreads() * 4;
+                if(grain != 0)
+                    count = (length + grain - 1) / grain;
+                if(count > length)
+                    count = length;
+                if(count == 0)
+                    count = 1;
+
+                ranges.resize(count);
+                for(size_t i = 0; i < count; ++i)
+                {
+                    ranges[i].body = body;
+                    ranges[i].begin = begin + (grain != 0 ? i * grain : length * i / count);
+                    ranges[i].end = (i + 1 == count) ? end
+                        : begin + (grain != 0 ? (i + 1) * grain : length * (i + 1) / count);
+                    ranges[i].result = result;
+                }
+            }
+
+            void submit(TaskGroup *group, threadFunc func, void *arg);
+            bool takeTask(PoolWorker *self, PoolTask &task);
+            void execute(const PoolTask &task);
+            void sleep();
+            void workerLoop(PoolWorker *worker);
+
+            std::vector<PoolWorker*> _workers;
+            std::vector<unsigned int> _cpus;
+            bool _pinThreads;
+            volatile long _queued;
+            volatile long _sleepers;
+            volatile long _nextWorker;
+            volatile bool _stop;
+            ThreadLock _sleepLock;
+        #ifdef _WIN32
+            HANDLE _wake;
+        #else
+            sem_t _wake;
+        #endif
+    };
+}
+
+#endif // _SDK_THREAD_POOL_H_
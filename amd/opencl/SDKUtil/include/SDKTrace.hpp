@@ -0,0 +1,194 @@
+/**********************************************************************
+Copyright ?012 Advanced Micro Devices, Inc. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+?Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+?Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+********************************************************************/
+#ifndef SDKTRACE_HPP_
+#define SDKTRACE_HPP_
+
+/**
+ * Header Files
+ */
+#include <string>
+#include <vector>
+#include <map>
+#include <CL/opencl.h>
+#include <SDKThread.hpp>
+
+/**
+ * Records kept before further ones are dropped
+ */
+#define SDK_TRACE_MAX_RECORDS (1 << 22)
+
+/**
+ * namespace streamsdk
+ */
+namespace streamsdk
+{
+
+/**
+ * class SDKTrace
+ * Timeline of host scopes and OpenCL commands written as Chrome
+ * trace-event JSON (load it in chrome://tracing or Perfetto).
+ *
+ * Host scopes appear under the process "Host", one track per thread.
+ * Commands appear under one process per device, one track per command
+ * queue, spanning CL_PROFILING_COMMAND_START to CL_PROFILING_COMMAND_END.
+ * Device clocks are aligned to the host clock using the earliest time a
+ * command was seen complete on the host, so device tracks may start up
+ * to one polling interval early. Commands on queues created without
+ * CL_QUEUE_PROFILING_ENABLE carry no timestamps and are skipped.
+ *
+ * Recording starts when SDK_TRACE=file.json is set or through enable().
+ * The file is (re)written by write() and when the process exits.
+ */
+class SDKTrace
+{
+public:
+    /**
+     * getInstance
+     * @return the process wide trace
+     */
+    static SDKTrace& getInstance();
+
+    /**
+     * isEnabled
+     * @return true while recording
+     */
+    bool isEnabled() const { return enabled_; }
+
+    /**
+     * enable
+     * Starts recording
+     * @param fileName file written by write() and at exit
+     */
+    void enable(const std::string &fileName);
+
+    /**
+     * disable
+     * Stops recording, the records are kept
+     */
+    void disable() { enabled_ = false; }
+
+    /**
+     * getQueueProperties
+     * @return properties with CL_QUEUE_PROFILING_ENABLE added while recording
+     */
+    cl_command_queue_properties getQueueProperties(cl_command_queue_properties properties = 0) const
+    {
+        return enabled_ ? (properties | CL_QUEUE_PROFILING_ENABLE) : properties;
+    }
+
+    /**
+     * now
+     * @return host timestamp in nanoseconds used for host scopes
+     */
+    cl_ulong now() const;
+
+    /**
+     * addHostScope
+     * Records a host scope on the calling thread's track
+     */
+    void addHostScope(const std::string &name, cl_ulong beginNs, cl_ulong endNs);
+
+    /**
+     * recordEvent
+     * Records a completed command. Must be called before the event is released.
+     * @param event completed event
+     * @param name label, defaults to the command type
+     * @return SDK_SUCCESS if the event carried profiling information
+     */
+    int recordEvent(cl_event event, const char *name = NULL);
+
+    /**
+     * releaseQueue
+     * Forgets a command queue. Call it before the queue is released so a
+     * later queue given the same handle gets a track of its own.
+     * @param queue command queue about to be released
+     */
+    void releaseQueue(cl_command_queue queue);
+
+    /**
+     * write
+     * Writes every record to the file given to enable()
+     * @return SDK_SUCCESS if success else nonzero
+     */
+    int write();
+
+private:
+    /**
+     * A host scope or a device command
+     */
+    struct Record
+    {
+        std::string name;
+        int pid;                /**< 0 for host, device index + 1 otherwise */
+        int tid;                /**< host thread or queue index */
+        cl_ulong begin;         /**< host clock for host scopes, device clock otherwise */
+        cl_ulong end;
+        cl_ulong queued;        /**< device clock, commands only */
+        cl_ulong submit;        /**< device clock, commands only */
+    };
+
+    /**
+     * A device and the offset from its clock to the host clock
+     */
+    struct Device
+    {
+        std::string name;
+        cl_long offset;         /**< host clock - device clock */
+        bool hasOffset;
+        int numQueues;
+    };
+
+    SDKTrace();
+    SDKTrace(const SDKTrace&);
+    SDKTrace& operator=(const SDKTrace&);
+
+    int threadIndex();
+    bool lookupQueue(cl_event event, int &pid, int &tid);
+
+    bool enabled_;
+    std::string fileName_;
+    cl_ulong origin_;                   /**< host time the trace starts at */
+    ThreadLock lock_;
+    std::vector<Record> records_;
+    std::vector<Device> devices_;
+    std::map<cl_device_id, int> deviceIndex_;
+    std::map<cl_command_queue, int> queueIndex_;
+    std::map<cl_command_queue, int> queueDevice_;
+    int numThreads_;
+    bool registered_;                   /**< if the exit handler is installed */
+};
+
+/**
+ * class SDKTraceScope
+ * Records the lifetime of the object as a host scope when tracing
+ */
+class SDKTraceScope
+{
+public:
+    SDKTraceScope(const char *name);
+    ~SDKTraceScope();
+
+private:
+    SDKTraceScope(const SDKTraceScope&);
+    SDKTraceScope& operator=(const SDKTraceScope&);
+
+    const char *name_;
+    cl_ulong begin_;
+};
+
+} // namespace streamsdk
+
+#endif // SDKTRACE_HPP_
@@ -25,11 +25,8 @@ BinomialOption::setupBinomialOption()
     // Make numSamples multiple of 4
     numSamples = (numSamples / 4)? (numSamples / 4) * 4: 4;
 
-#if defined (_WIN32)
-    randArray = (cl_float*)_aligned_malloc(numSamples * sizeof(cl_float4), 16);
-#else
-    randArray = (cl_float*)memalign(16, numSamples * sizeof(cl_float4));
-#endif
+    randArray = (cl_float*)streamsdk::SDKBufferPool::getInstance().allocate(
+                numSamples * sizeof(cl_float4));
     CHECK_ALLOCATION(randArray, "Failed to allocate host memory. (randArray)");
     
     for(int i = 0; i < numSamples * 4; i++)
@@ -37,11 +34,8 @@ BinomialOption::setupBinomialOption()
         randArray[i] = (float)rand() / (float)RAND_MAX;
     }
 
-#if defined (_WIN32)
-    output = (cl_float*)_aligned_malloc(numSamples * sizeof(cl_float4), 16);
-#else
-    output = (cl_float*)memalign(16, numSamples * sizeof(cl_float4));
-#endif
+    output = (cl_float*)streamsdk::SDKBufferPool::getInstance().allocate(
+                numSamples * sizeof(cl_float4));
 
     CHECK_ALLOCATION(output, "Failed to allocate host memory. (output)");
     memset(output, 0, numSamples * sizeof(cl_float4));
@@ -357,76 +351,26 @@ BinomialOption::binomialOptionCPUReference()
     refOutput = (float*)malloc(numSamples * sizeof(cl_float4));
     CHECK_ALLOCATION(refOutput, "Failed to allocate host memory. (refOutput)");
 
-    float* stepsArray = (float*)malloc((numSteps + 1) * sizeof(cl_float4));
-    CHECK_ALLOCATION(stepsArray, "Failed to allocate host memory. (stepsArray)");
+    // Option parameters, derived from the random inputs as in the kernel
+    float* params = (float*)malloc(3 * numSamples * sizeof(float));
+    CHECK_ALLOCATION(params, "Failed to allocate host memory. (params)");
 
-    // Iterate for all samples
-    for(int bid = 0; bid < numSamples; ++bid)
+    float* s = params;
+    float* x = params + numSamples;
+    float* optionYears = params + 2 * numSamples;
+    for(int i = 0; i < numSamples; ++i)
     {
-        float s[4];
-        float x[4];
-        float vsdt[4];
-        float puByr[4];
-        float pdByr[4];
-        float optionYears[4];
-
-        float inRand[4];
-
-        for(int i = 0; i < 4; ++i)
-        {
-            inRand[i] = randArray[bid + i];
-            s[i] = (1.0f - inRand[i]) * 5.0f + inRand[i] * 30.f;
-            x[i] = (1.0f - inRand[i]) * 1.0f + inRand[i] * 100.f;
-            optionYears[i] = (1.0f - inRand[i]) * 0.25f + inRand[i] * 10.f; 
-            float dt = optionYears[i] * (1.0f / (float)numSteps);
-            vsdt[i] = VOLATILITY * sqrtf(dt);
-            float rdt = RISKFREE * dt;
-            float r = expf(rdt);
-            float rInv = 1.0f / r;
-            float u = expf(vsdt[i]);
-            float d = 1.0f / u;
-            float pu = (r - d)/(u - d);
-            float pd = 1.0f - pu;
-            puByr[i] = pu * rInv;
-            pdByr[i] = pd * rInv;
-        }
-        /**
-         * Compute values at expiration date:
-         * Call option value at period end is v(t) = s(t) - x
-         * If s(t) is greater than x, or zero otherwise...
-         * The computation is similar for put options...
-         */
-        for(int j = 0; j <= numSteps; j++)
-        {
-            for(int i = 0; i < 4; ++i)
-            {
-                float profit = s[i] * expf(vsdt[i] * (2.0f * j - numSteps)) - x[i];
-                stepsArray[j * 4 + i] = profit > 0.0f ? profit : 0.0f;
-            }
-        }
+        float inRand = randArray[i];
+        s[i] = (1.0f - inRand) * 5.0f + inRand * 30.f;
+        x[i] = (1.0f - inRand) * 1.0f + inRand * 100.f;
+        optionYears[i] = (1.0f - inRand) * 0.25f + inRand * 10.f;
+    }
 
-        /**
-         * walk backwards up on the binomial tree of depth numSteps
-         * Reduce the price step by step
-         */
-        for(int j = numSteps; j > 0; --j)
-        {
-            for(int k = 0; k <= j - 1; ++k)
-            {
-                for(int i = 0; i < 4; ++i)
-                {
-					int index_k = k * 4 + i;
-					int index_k_1 = (k + 1) * 4 + i;
-                    stepsArray[index_k] = pdByr[i] * stepsArray[index_k_1] + puByr[i] * stepsArray[index_k];
-                }
-            }   
-        }
+    // Price the samples in SIMD batches on all host threads
+    streamsdk::binomialEuropeanCall(numSamples, s, x, optionYears,
+                                    RISKFREE, VOLATILITY, numSteps, refOutput);
 
-        //Copy the root to result
-        refOutput[bid] = stepsArray[0];
-    }
-    
-    free(stepsArray);
+    free(params);
 
     return SDK_SUCCESS;
 }
@@ -607,17 +551,9 @@ BinomialOption::cleanup()
 BinomialOption::~BinomialOption()
 {
 
-#ifdef _WIN32
-             ALIGNED_FREE(randArray);
-#else
-             FREE(randArray);
-#endif
+     POOL_FREE(randArray);
 
-#ifdef _WIN32
-             ALIGNED_FREE(output);
-#else
-             FREE(output);
-#endif
+     POOL_FREE(output);
 
      FREE(refOutput);
 
@@ -658,4 +594,4 @@ main(int argc, char * argv[])
         clBinomialOption.printStats();
     }
     return SDK_SUCCESS;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -28,6 +28,8 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <SDKCommon.hpp>
 #include <SDKApplication.hpp>
 #include <SDKFile.hpp>
+#include <SDKBufferPool.hpp>
+#include <SDKBinomial.hpp>
 
 #include <malloc.h>
 
@@ -31,6 +31,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <SDKApplication.hpp>
 #include <SDKFile.hpp>
 #include <SDKThread.hpp>
+#include <SDKBinomial.hpp>
 
 
 #define CHECK_OPENCL_ERROR_RETURN_NULL(actual, msg) \
@@ -16,6 +16,10 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 
 #include "FloydWarshall.hpp"
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 int FloydWarshall::setupFloydWarshall()
 {
@@ -403,6 +407,187 @@ FloydWarshall::minimum(cl_uint a, cl_uint b)
     return (b < a) ? b : a;
 }
 
+/*
+ * Min-plus update of one row segment for intermediate node k:
+ * dist[x] = min(dist[x], distToK + distFromK[x]), path[x] = k where it improved
+ */
+static inline void
+minPlusRow(cl_uint *dist, cl_uint *path, const cl_uint *distFromK,
+           cl_uint distToK, cl_uint k, cl_uint length)
+{
+    cl_uint x = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    // unsigned compare through the sign-flipped signed compare
+    const __m128i bias = _mm_set1_epi32((int)0x80000000);
+    const __m128i vToK = _mm_set1_epi32((int)distToK);
+    const __m128i vK = _mm_set1_epi32((int)k);
+    for(; x + 4 <= length; x += 4)
+    {
+        __m128i direct = _mm_loadu_si128((const __m128i*)(dist + x));
+        __m128i indirect = _mm_add_epi32(vToK, _mm_loadu_si128((const __m128i*)(distFromK + x)));
+        __m128i better = _mm_cmplt_epi32(_mm_xor_si128(indirect, bias), _mm_xor_si128(direct, bias));
+        if(_mm_movemask_epi8(better) == 0)
+            continue;
+
+        __m128i oldPath = _mm_loadu_si128((const __m128i*)(path + x));
+        _mm_storeu_si128((__m128i*)(dist + x),
+                         _mm_or_si128(_mm_and_si128(better, indirect), _mm_andnot_si128(better, direct)));
+        _mm_storeu_si128((__m128i*)(path + x),
+                         _mm_or_si128(_mm_and_si128(better, vK), _mm_andnot_si128(better, oldPath)));
+    }
+#endif
+    for(; x < length; ++x)
+    {
+        cl_uint indirectDistance = distToK + distFromK[x];
+        if(indirectDistance < dist[x])
+        {
+            dist[x] = indirectDistance;
+            path[x] = k;
+        }
+    }
+}
+
+/*
+ * Relaxes tile (tileY, tileX) through every intermediate node of tile tileK
+ */
+static void
+relaxTile(cl_uint *dist, cl_uint *path, cl_uint numNodes,
+          cl_uint tileY, cl_uint tileX, cl_uint tileK)
+{
+    cl_uint yBegin = tileY * CPU_TILE_SIZE;
+    cl_uint yEnd = std::min(yBegin + CPU_TILE_SIZE, numNodes);
+    cl_uint xBegin = tileX * CPU_TILE_SIZE;
+    cl_uint xLength = std::min(xBegin + CPU_TILE_SIZE, numNodes) - xBegin;
+    cl_uint kBegin = tileK * CPU_TILE_SIZE;
+    cl_uint kEnd = std::min(kBegin + CPU_TILE_SIZE, numNodes);
+
+    for(cl_uint k = kBegin; k < kEnd; ++k)
+    {
+        const cl_uint *distFromK = dist + (size_t)k * numNodes + xBegin;
+        for(cl_uint y = yBegin; y < yEnd; ++y)
+        {
+            size_t yXwidth = (size_t)y * numNodes;
+            minPlusRow(dist + yXwidth + xBegin, path + yXwidth + xBegin,
+                       distFromK, dist[yXwidth + k], k, xLength);
+        }
+    }
+}
+
+/*
+ * Relaxes tile (tileY, tileX) through tile tileK when neither tileY nor tileX
+ * is tileK. Then dist[y][k] and the rows dist[k][*] read here are not written
+ * by this update, so each row segment is kept in registers over the whole k loop.
+ */
+static void
+relaxIndependentTile(cl_uint *dist, cl_uint *path, cl_uint numNodes,
+                     cl_uint tileY, cl_uint tileX, cl_uint tileK)
+{
+    cl_uint yBegin = tileY * CPU_TILE_SIZE;
+    cl_uint yEnd = std::min(yBegin + CPU_TILE_SIZE, numNodes);
+    cl_uint xBegin = tileX * CPU_TILE_SIZE;
+    cl_uint xEnd = std::min(xBegin + CPU_TILE_SIZE, numNodes);
+    cl_uint kBegin = tileK * CPU_TILE_SIZE;
+    cl_uint kEnd = std::min(kBegin + CPU_TILE_SIZE, numNodes);
+
+    for(cl_uint y = yBegin; y < yEnd; ++y)
+    {
+        size_t yXwidth = (size_t)y * numNodes;
+        cl_uint *distY = dist + yXwidth;
+        cl_uint *pathY = path + yXwidth;
+        cl_uint x = xBegin;
+#if defined(__SSE2__) || defined(_M_X64)
+        // distances are held with the sign bit flipped so the signed compare orders them as unsigned
+        const __m128i bias = _mm_set1_epi32((int)0x80000000);
+        for(; x + 16 <= xEnd; x += 16)
+        {
+            __m128i d[4], p[4];
+            for(int j = 0; j < 4; ++j)
+            {
+                d[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(distY + x + 4 * j)), bias);
+                p[j] = _mm_loadu_si128((const __m128i*)(pathY + x + 4 * j));
+            }
+            for(cl_uint k = kBegin; k < kEnd; ++k)
+            {
+                const cl_uint *distFromK = dist + (size_t)k * numNodes + x;
+                __m128i vToK = _mm_set1_epi32((int)(distY[k] ^ 0x80000000u));
+                __m128i indirect[4], better[4];
+                for(int j = 0; j < 4; ++j)
+                {
+                    indirect[j] = _mm_add_epi32(vToK, _mm_loadu_si128((const __m128i*)(distFromK + 4 * j)));
+                    better[j] = _mm_cmplt_epi32(indirect[j], d[j]);
+                }
+
+                // improvements get rare as the distances converge
+                __m128i any = _mm_or_si128(_mm_or_si128(better[0], better[1]), _mm_or_si128(better[2], better[3]));
+                if(_mm_movemask_epi8(any) == 0)
+                    continue;
+
+                __m128i vK = _mm_set1_epi32((int)k);
+                for(int j = 0; j < 4; ++j)
+                {
+                    d[j] = _mm_or_si128(_mm_and_si128(better[j], indirect[j]), _mm_andnot_si128(better[j], d[j]));
+                    p[j] = _mm_or_si128(_mm_and_si128(better[j], vK), _mm_andnot_si128(better[j], p[j]));
+                }
+            }
+            for(int j = 0; j < 4; ++j)
+            {
+                _mm_storeu_si128((__m128i*)(distY + x + 4 * j), _mm_xor_si128(d[j], bias));
+                _mm_storeu_si128((__m128i*)(pathY + x + 4 * j), p[j]);
+            }
+        }
+#endif
+        for(cl_uint k = kBegin; k < kEnd && x < xEnd; ++k)
+        {
+            minPlusRow(distY + x, pathY + x, dist + (size_t)k * numNodes + x, distY[k], k, xEnd - x);
+        }
+    }
+}
+
+/*
+ * Phase 2: the tiles sharing a row or a column with the diagonal tile.
+ * Index t < numTiles is row tile (tileK, t), the rest are column tiles
+ */
+struct RelaxCrossTiles
+{
+    cl_uint *dist, *path, numNodes, numTiles, tileK;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t t = begin; t < end; ++t)
+        {
+            cl_uint tile = (cl_uint)(t % numTiles);
+            if(tile == tileK)
+                continue;
+            if(t < numTiles)
+                relaxTile(dist, path, numNodes, tileK, tile, tileK);
+            else
+                relaxTile(dist, path, numNodes, tile, tileK, tileK);
+        }
+    }
+};
+
+/*
+ * Phase 3: all other tiles, one row of tiles per index
+ */
+struct RelaxRemainingTiles
+{
+    cl_uint *dist, *path, numNodes, numTiles, tileK;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t tileY = begin; tileY < end; ++tileY)
+        {
+            if(tileY == tileK)
+                continue;
+            for(cl_uint tileX = 0; tileX < numTiles; ++tileX)
+            {
+                if(tileX != tileK)
+                    relaxIndependentTile(dist, path, numNodes, (cl_uint)tileY, tileX, tileK);
+            }
+        }
+    }
+};
+
 /*
  * Calculates the shortest path between each pair of nodes in a graph
  * pathDistanceMatrix gives the shortest distance between each node
@@ -416,41 +601,32 @@ FloydWarshall::floydWarshallCPUReference(cl_uint * pathDistanceMatrix,
                                          cl_uint * pathMatrix,
                                          const cl_uint numNodes) 
 {
-    cl_uint distanceYtoX, distanceYtoK, distanceKtoX, indirectDistance;
-
-    /*
-     * pathDistanceMatrix is the adjacency matrix(square) with
-     * the dimension equal to the number of nodes in the graph.
-     */
-    cl_uint width = numNodes;
-    cl_uint yXwidth;
-
     /*
      * for each intermediate node k in the graph find the shortest distance between
      * the nodes i and j and update as
      *
      * ShortestPath(i,j,k) = min(ShortestPath(i,j,k-1), ShortestPath(i,k,k-1) + ShortestPath(k,j,k-1))
+     *
+     * The k loop is blocked: the tiles of intermediate nodes are taken in order
+     * and every tile of the matrix is relaxed through them once. The diagonal
+     * tile only depends on itself, its row and column of tiles only on the
+     * diagonal tile, and the rest only on that cross, so each phase is parallel.
      */
-    for(cl_uint k = 0; k < numNodes; ++k)
+    cl_uint numTiles = (numNodes + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+    streamsdk::SDKThreadPool &pool = streamsdk::SDKThreadPool::getInstance();
+
+    for(cl_uint tileK = 0; tileK < numTiles; ++tileK)
     {
-        for(cl_uint y = 0; y < numNodes; ++y)
-        {
-            yXwidth =  y*numNodes;
-            for(cl_uint x = 0; x < numNodes; ++x)
-            {
-                distanceYtoX = pathDistanceMatrix[yXwidth + x];
-                distanceYtoK = pathDistanceMatrix[yXwidth + k];
-                distanceKtoX = pathDistanceMatrix[k * width + x];
+        // Phase 1: diagonal tile
+        relaxTile(pathDistanceMatrix, pathMatrix, numNodes, tileK, tileK, tileK);
 
-                indirectDistance = distanceYtoK + distanceKtoX;
+        // Phase 2: row and column of the diagonal tile
+        RelaxCrossTiles cross = {pathDistanceMatrix, pathMatrix, numNodes, numTiles, tileK};
+        pool.parallelFor(0, 2 * numTiles, cross, 1);
 
-                if(indirectDistance < distanceYtoX)
-                {
-                    pathDistanceMatrix[yXwidth + x] = indirectDistance;
-                    pathMatrix[yXwidth + x]         = k;
-                }
-            }
-        }
+        // Phase 3: remaining tiles
+        RelaxRemainingTiles remaining = {pathDistanceMatrix, pathMatrix, numNodes, numTiles, tileK};
+        pool.parallelFor(0, numTiles, remaining, 1);
     }
 }
 
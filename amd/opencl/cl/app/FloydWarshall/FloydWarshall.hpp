@@ -32,6 +32,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <SDKApplication.hpp>
 #include <SDKCommandArgs.hpp>
 #include <SDKFile.hpp>
+#include <SDKThreadPool.hpp>
 
 /**
  * FloydWarshall 
@@ -45,6 +46,12 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  */
 #define MAXDISTANCE    (200)
 
+/*
+ * Edge of the square tiles processed by the blocked CPU reference.
+ * Three tiles of distances and paths stay resident in L2.
+ */
+#define CPU_TILE_SIZE  (64)
+
 class FloydWarshall : public SDKSample
 {
     cl_uint                       seed;  /**< Seed value for random number generation */
@@ -142,7 +149,13 @@ public:
 
     /**
      * Reference CPU implementation of FloydWarshall PathFinding
-     * for performance comparison
+     * for performance comparison.
+     * Blocked three-phase scheme over CPU_TILE_SIZE tiles: for every
+     * diagonal tile, the tile itself, then its row and column of tiles,
+     * then all remaining tiles, the last two phases spread over the
+     * SDKThreadPool. Distances match the textbook triple loop exactly.
+     * The path matrix always names a node on a shortest path, but ties
+     * may be resolved differently from the textbook loop.
      * @param pathDistanceMatrix Distance between nodes of a graph
      * @param intermediate node between two nodes of a graph
      * @param number of nodes in the graph
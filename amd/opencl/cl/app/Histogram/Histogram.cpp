@@ -19,16 +19,14 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 #include <math.h>
 
-void 
+int 
 Histogram::calculateHostBin()
 {
-    for(int i = 0; i < height; ++i)
-    {
-        for(int j = 0; j < width; ++j)
-        {
-            hostBin[data[i * width + j]]++;
-        }
-    }
+    // Multi-threaded count into privatized sub-histograms
+    CHECK_ERROR(streamsdk::histogram(data, (size_t)width * height, (size_t)binSize, hostBin), true,
+                "Failed to allocate host memory. (histogram)");
+
+    return SDK_SUCCESS;
 }
 
 int
@@ -453,7 +451,8 @@ Histogram::verifyResults()
          * Rreference implementation on host device
          * calculates the histogram bin on host
          */
-        calculateHostBin();
+        int status = calculateHostBin();
+        CHECK_ERROR(status, SDK_SUCCESS, "Host Implementation Failed");
 
         // compare the results and see if they match 
         bool result = true;
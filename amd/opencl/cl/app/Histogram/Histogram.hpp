@@ -28,6 +28,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <SDKApplication.hpp>
 #include <SDKCommandArgs.hpp>
 #include <SDKFile.hpp>
+#include <SDKHistogram.hpp>
 
 
 #define WIDTH 1024
@@ -214,7 +215,8 @@ private:
 
     /**
     *  Calculate histogram bin on host 
+    * @return SDK_SUCCESS on success and SDK_FAILURE on failure
     */
-    void calculateHostBin();
+    int calculateHostBin();
 };
 #endif 
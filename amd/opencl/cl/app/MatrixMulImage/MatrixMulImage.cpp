@@ -404,16 +404,8 @@ MatrixMulImage::MatrixMulImageCPUReference(
     const cl_uint x,
     const cl_uint z)
 {
-    for(cl_uint i = 0; i < y; i++)
-    {
-        for(cl_uint j = 0; j < z; j++)
-        {
-            for(cl_uint k = 0; k < x; k++)
-            {
-                output[i*z + j] += (input0[i * x + k] * input1[k * z + j]);
-            }
-        }
-    }
+    // output (y x z) += input0 (y x x) * input1 (x x z)
+    streamsdk::gemm(y, z, x, input0, x, input1, z, output, z, true);
 }
 
 int 
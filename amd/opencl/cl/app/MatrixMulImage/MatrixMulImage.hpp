@@ -26,6 +26,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <SDKApplication.hpp>
 #include <SDKCommandArgs.hpp>
 #include <SDKFile.hpp>
+#include <SDKGemm.hpp>
 
 /**
  * MatrixMulImage 
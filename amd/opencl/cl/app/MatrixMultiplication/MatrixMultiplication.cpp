@@ -285,6 +285,7 @@ MatrixMultiplication::runCLKernels(void)
     cl_int eventStatus = CL_QUEUED;
 
     // Set input data to matrix A and matrix B
+    beginPhase("transfer");
     cl_event inMapEvt1, inMapEvt2, inUnmapEvt1, inUnmapEvt2, outMapEvt, outUnmapEvt;
     void* mapPtr1 = clEnqueueMapBuffer(
                         commandQueue, 
@@ -349,6 +350,7 @@ MatrixMultiplication::runCLKernels(void)
 
     status = sampleCommon->waitForEventAndRelease(&inUnmapEvt2);
     CHECK_ERROR(status,SDK_SUCCESS, "waitForEventAndRelease(inUnmapEvt2) failed");
+    endPhase("transfer");
 
     // Set appropriate arguments to the kernel
 
@@ -458,6 +460,7 @@ MatrixMultiplication::runCLKernels(void)
     status = clReleaseEvent(ndrEvt);
     CHECK_OPENCL_ERROR(status, "clReleaseEvent failed. (ndrEvt)");
 
+    beginPhase("transfer");
     void* outMapPtr = clEnqueueMapBuffer(
                         commandQueue, 
                         outputBuffer, 
@@ -492,6 +495,7 @@ MatrixMultiplication::runCLKernels(void)
 
     status = sampleCommon->waitForEventAndRelease(&outUnmapEvt);
     CHECK_ERROR(status,0, "waitForEventAndRelease(outUnmapEvt) failed");
+    endPhase("transfer");
 
     return SDK_SUCCESS;
 }
@@ -509,16 +513,8 @@ MatrixMultiplication::matrixMultiplicationCPUReference(
     const cl_uint x,
     const cl_uint z)
 {
-    for(cl_uint i = 0; i < y; i++)
-    {
-        for(cl_uint j = 0; j < z; j++)
-        {
-            for(cl_uint k = 0; k < x; k++)
-            {
-                output[i * z + j] += (input0[i * x + k] * input1[k * z + j]);
-            }
-        }
-    }
+    // output (y x z) += input0 (y x x) * input1 (x x z)
+    streamsdk::gemm(y, z, x, input0, x, input1, z, output, z, true);
 }
 
 int 
@@ -802,23 +798,14 @@ main(int argc, char * argv[])
     }
     else
     {
-        // Setup
-        if(clMatrixMultiplication.setup() != SDK_SUCCESS)
-            return SDK_FAILURE;
-        // Run
-        if(clMatrixMultiplication.run() != SDK_SUCCESS)
-            return SDK_FAILURE;
-
-        // VerifyResults
-        if(clMatrixMultiplication.verifyResults() != SDK_SUCCESS)
+        // Setup, Run, VerifyResults and printStats
+        if(clMatrixMultiplication.execute() != SDK_SUCCESS)
             return SDK_FAILURE;
 
         // Cleanup
         if(clMatrixMultiplication.cleanup() != SDK_SUCCESS)
             return SDK_FAILURE;
-        
-        clMatrixMultiplication.printStats();
     }
 
     return SDK_SUCCESS;
-}
\ No newline at end of file
+}
\ No newline at end of file
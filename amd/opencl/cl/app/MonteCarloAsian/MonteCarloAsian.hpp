@@ -27,6 +27,8 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <SDKCommon.hpp>
 #include <SDKApplication.hpp>
 #include <SDKFile.hpp>
+#include <SDKBufferPool.hpp>
+#include <SDKMonteCarlo.hpp>
 
 /**
  * MonteCarloAsian 
@@ -274,44 +276,6 @@ public:
 
     private:
 
-    /**
-     * @brief Left shift
-     * @param input input to be shifted
-     * @param shift shifting count
-     * @param output result after shifting input
-     */
-    void lshift128(unsigned int* input, unsigned int shift, unsigned int* output);
-
-    /**
-     * @brief Right shift
-     * @param input input to be shifted
-     * @param shift shifting count
-     * @param output result after shifting input
-     */
-    void rshift128(unsigned int* input, unsigned int shift, unsigned int* output);
-
-
-    /**
-     * @brief Generates gaussian random numbers by using 
-     *        Mersenenne Twister algo and box muller transformation
-     * @param seedArray  seed
-     * @param gaussianRand1 gaussian random number generatred
-     * @param gaussianRand2 gaussian random number generarted 
-     * @param nextRand  generated seed for next usage
-     */
-    void generateRand(unsigned int* seed,
-                      float *gaussianRand1,
-                      float *gaussianRand2,
-                      unsigned int* nextRand);
-
-    /**
-     * @brief   calculates the  price and vega for all trajectories
-     */
-    void calOutputs(float strikePrice, float* meanDeriv1, 
-                    float*  meanDeriv2, float* meanPrice1,
-                    float* meanPrice2, float* pathDeriv1, 
-                    float* pathDeriv2, float* priceVec1, float* priceVec2);
-
     /**
      * @brief   Reference implementation for Monte Carlo simuation for
      *          Asian Option pricing 
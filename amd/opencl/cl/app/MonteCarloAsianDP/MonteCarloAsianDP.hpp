@@ -27,6 +27,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <SDKCommon.hpp>
 #include <SDKApplication.hpp>
 #include <SDKFile.hpp>
+#include <SDKMonteCarlo.hpp>
 
 /**
  * MonteCarloAsian 
@@ -247,44 +248,6 @@ public:
 
     private:
 
-    /**
-     * @brief Left shift
-     * @param input input to be shifted
-     * @param shift shifting count
-     * @param output result after shifting input
-     */
-    void lshift128(unsigned int* input, unsigned int shift, unsigned int* output);
-
-    /**
-     * @brief Right shift
-     * @param input input to be shifted
-     * @param shift shifting count
-     * @param output result after shifting input
-     */
-    void rshift128(unsigned int* input, unsigned int shift, unsigned int* output);
-
-
-    /**
-     * @brief Generates gaussian random numbers by using 
-     *        Mersenenne Twister algo and box muller transformation
-     * @param seedArray  seed
-     * @param gaussianRand1 gaussian random number generatred
-     * @param gaussianRand2 gaussian random number generarted 
-     * @param nextRand  generated seed for next usage
-     */
-    void generateRand(unsigned int* seed,
-                      double *gaussianRand1,
-                      double *gaussianRand2,
-                      unsigned int* nextRand);
-
-    /**
-     * @brief   calculates the  price and vega for all trajectories
-     */
-    void calOutputs(double strikePrice, double* meanDeriv1, 
-                    double*  meanDeriv2, double* meanPrice1,
-                    double* meanPrice2, double* pathDeriv1, 
-                    double* pathDeriv2, double* priceVec1, double* priceVec2);
-
     /**
      * @brief   Reference implementation for Monte Carlo simuation for
      *          Asian Option pricing 
@@ -19,6 +19,8 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <GL/glut.h>
 #include <cmath>
 #include <malloc.h>
+#include <algorithm>
+#include <vector>
 
 int numBodies;      /**< No. of particles*/
 cl_float* pos;      /**< Output position */
@@ -50,18 +52,12 @@ NBody::setupNBody()
     initVel = (cl_float*)malloc(numBodies * sizeof(cl_float4));
     CHECK_ALLOCATION(initVel, "Failed to allocate host memory. (initVel)");
 
-#if defined (_WIN32)
-    pos = (cl_float*)_aligned_malloc(numBodies * sizeof(cl_float4), 16);
-#else
-    pos = (cl_float*)memalign(16, numBodies * sizeof(cl_float4));
-#endif
+    pos = (cl_float*)streamsdk::SDKBufferPool::getInstance().allocate(
+              numBodies * sizeof(cl_float4));
     CHECK_ALLOCATION(pos, "Failed to allocate host memory. (pos)");
 
-#if defined (_WIN32)
-    vel = (cl_float*)_aligned_malloc(numBodies * sizeof(cl_float4), 16);
-#else
-    vel = (cl_float*)memalign(16, numBodies * sizeof(cl_float4));
-#endif
+    vel = (cl_float*)streamsdk::SDKBufferPool::getInstance().allocate(
+              numBodies * sizeof(cl_float4));
     CHECK_ALLOCATION(vel, "Failed to allocate host memory. (vel)");
 
     // initialization of inputs
@@ -465,12 +461,519 @@ NBody::runCLKernels()
     return SDK_SUCCESS;
 }
 
+/*
+ * Barnes-Hut reference
+ *
+ * The bodies are sorted along a Morton (Z-order) curve of their bounding
+ * cube, so every octree cell is a contiguous range of the sorted bodies and
+ * its children are found by binary search on the next 3 bits of the codes.
+ * The tree is built one level at a time, the centres of mass are summed
+ * bottom-up the same way, and every level is split over the thread pool.
+ */
+struct BHBounds
+{
+    cl_float lo[3];
+    cl_float hi[3];
+};
+
+struct BHKey
+{
+    unsigned long long code;
+    cl_uint index;
+
+    bool operator<(const BHKey &other) const
+    {
+        return code < other.code || (code == other.code && index < other.index);
+    }
+};
+
+struct BHCell
+{
+    cl_float com[4];                    /**< centre of mass, w = total mass */
+    cl_float centre[3];                 /**< centre of the cube */
+    cl_float size;                      /**< edge length of the cube */
+    cl_float openSqr;                   /**< squared distance below which the cell is opened */
+    cl_uint begin;                      /**< first body (sorted order) */
+    cl_uint end;                        /**< one past the last body */
+    cl_uint firstChild;                 /**< children are stored contiguously */
+    cl_uint numChildren;                /**< 0 for a leaf */
+};
+
+/*
+ * Spreads the low 21 bits of v so that they occupy every third bit
+ */
+static unsigned long long
+spreadBits(cl_uint v)
+{
+    unsigned long long x = v & 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffULL;
+    x = (x | x << 16) & 0x1f0000ff0000ffULL;
+    x = (x | x << 8) & 0x100f00f00f00f00fULL;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2) & 0x1249249249249249ULL;
+    return x;
+}
+
+struct BHBoundsBody
+{
+    const cl_float *pos;
+
+    BHBounds operator()(size_t begin, size_t end) const
+    {
+        BHBounds b;
+        for(int k = 0; k < 3; ++k)
+        {
+            b.lo[k] = pos[4 * begin + k];
+            b.hi[k] = pos[4 * begin + k];
+        }
+        for(size_t i = begin + 1; i < end; ++i)
+        {
+            for(int k = 0; k < 3; ++k)
+            {
+                b.lo[k] = std::min(b.lo[k], pos[4 * i + k]);
+                b.hi[k] = std::max(b.hi[k], pos[4 * i + k]);
+            }
+        }
+        return b;
+    }
+};
+
+struct BHBoundsCombine
+{
+    BHBounds operator()(const BHBounds &a, const BHBounds &b) const
+    {
+        BHBounds r;
+        for(int k = 0; k < 3; ++k)
+        {
+            r.lo[k] = std::min(a.lo[k], b.lo[k]);
+            r.hi[k] = std::max(a.hi[k], b.hi[k]);
+        }
+        return r;
+    }
+};
+
+struct BHComputeKeys
+{
+    const cl_float *pos;
+    BHKey *keys;
+    cl_float origin[3];
+    cl_float scale;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        const cl_float maxCell = (cl_float)((1 << BH_MORTON_LEVELS) - 1);
+        for(size_t i = begin; i < end; ++i)
+        {
+            unsigned long long code = 0;
+            for(int k = 0; k < 3; ++k)
+            {
+                cl_float c = (pos[4 * i + k] - origin[k]) * scale;
+                c = std::max(0.0f, std::min(c, maxCell));
+                code |= spreadBits((cl_uint)c) << (2 - k);
+            }
+            keys[i].code = code;
+            keys[i].index = (cl_uint)i;
+        }
+    }
+};
+
+/*
+ * Sorts chunk c = [c * chunkSize, (c + 1) * chunkSize) of the keys
+ */
+struct BHSortChunks
+{
+    BHKey *keys;
+    size_t count, chunkSize;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t c = begin; c < end; ++c)
+        {
+            size_t first = std::min(c * chunkSize, count);
+            size_t last = std::min(first + chunkSize, count);
+            std::sort(keys + first, keys + last);
+        }
+    }
+};
+
+/*
+ * Merges the sorted runs 2p and 2p + 1 of length width from src into dst
+ */
+struct BHMergeRuns
+{
+    const BHKey *src;
+    BHKey *dst;
+    size_t count, width;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t p = begin; p < end; ++p)
+        {
+            size_t first = std::min(2 * p * width, count);
+            size_t middle = std::min(first + width, count);
+            size_t last = std::min(middle + width, count);
+            std::merge(src + first, src + middle, src + middle, src + last, dst + first);
+        }
+    }
+};
+
+struct BHGatherBodies
+{
+    const cl_float *pos;
+    const BHKey *keys;
+    cl_float *sorted;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            memcpy(sorted + 4 * i, pos + 4 * keys[i].index, 4 * sizeof(cl_float));
+        }
+    }
+};
+
+/*
+ * Finds the non-empty octants of a cell at the given depth.
+ * split[o]..split[o + 1] is the range of octant o
+ */
+static void
+splitCell(const BHKey *keys, const BHCell &cell, int depth, cl_uint split[9])
+{
+    int shift = 3 * (BH_MORTON_LEVELS - 1 - depth);
+    split[0] = cell.begin;
+    split[8] = cell.end;
+    for(cl_uint o = 1; o < 8; ++o)
+    {
+        cl_uint lo = split[o - 1], hi = cell.end;
+        while(lo < hi)
+        {
+            cl_uint mid = lo + (hi - lo) / 2;
+            if(((keys[mid].code >> shift) & 7) < o)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        split[o] = lo;
+    }
+}
+
+/*
+ * Counts the children of the cells [begin, end) of one level
+ */
+struct BHCountChildren
+{
+    const BHKey *keys;
+    BHCell *cells;
+    int depth;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t c = begin; c < end; ++c)
+        {
+            BHCell &cell = cells[c];
+            cell.numChildren = 0;
+            if(cell.end - cell.begin <= BH_LEAF_SIZE || depth == BH_MORTON_LEVELS)
+                continue;
+
+            cl_uint split[9];
+            splitCell(keys, cell, depth, split);
+            for(int o = 0; o < 8; ++o)
+            {
+                if(split[o + 1] > split[o])
+                    cell.numChildren++;
+            }
+        }
+    }
+};
+
+/*
+ * Creates the children of the cells [begin, end) of one level,
+ * firstChild has been assigned by a prefix sum over numChildren
+ */
+struct BHCreateChildren
+{
+    const BHKey *keys;
+    BHCell *cells;
+    int depth;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t c = begin; c < end; ++c)
+        {
+            const BHCell &cell = cells[c];
+            if(cell.numChildren == 0)
+                continue;
+
+            cl_uint split[9];
+            splitCell(keys, cell, depth, split);
+            cl_uint child = cell.firstChild;
+            for(int o = 0; o < 8; ++o)
+            {
+                if(split[o + 1] == split[o])
+                    continue;
+
+                BHCell &sub = cells[child++];
+                sub.size = 0.5f * cell.size;
+                for(int k = 0; k < 3; ++k)
+                {
+                    cl_float offset = ((o >> (2 - k)) & 1) ? 0.25f : -0.25f;
+                    sub.centre[k] = cell.centre[k] + offset * cell.size;
+                }
+                sub.begin = split[o];
+                sub.end = split[o + 1];
+            }
+        }
+    }
+};
+
+/*
+ * Sums mass and mass-weighted position of the cells [begin, end),
+ * the children of the cells are complete. A cell is opened closer than
+ * size / theta from its centre of mass, plus the offset of the centre
+ * of mass from the middle of the cube so that lopsided cells are safe
+ */
+struct BHSumMass
+{
+    const cl_float *sorted;
+    BHCell *cells;
+    cl_float invTheta;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t c = begin; c < end; ++c)
+        {
+            BHCell &cell = cells[c];
+            cl_float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            if(cell.numChildren == 0)
+            {
+                for(cl_uint i = cell.begin; i < cell.end; ++i)
+                {
+                    const cl_float *p = sorted + 4 * i;
+                    for(int k = 0; k < 3; ++k)
+                        sum[k] += p[3] * p[k];
+                    sum[3] += p[3];
+                }
+            }
+            else
+            {
+                for(cl_uint i = 0; i < cell.numChildren; ++i)
+                {
+                    const cl_float *p = cells[cell.firstChild + i].com;
+                    for(int k = 0; k < 3; ++k)
+                        sum[k] += p[3] * p[k];
+                    sum[3] += p[3];
+                }
+            }
+
+            cl_float invMass = (sum[3] != 0.0f) ? 1.0f / sum[3] : 0.0f;
+            cl_float offsetSqr = 0.0f;
+            for(int k = 0; k < 3; ++k)
+            {
+                cell.com[k] = (sum[3] != 0.0f) ? sum[k] * invMass : cell.centre[k];
+                offsetSqr += (cell.com[k] - cell.centre[k]) * (cell.com[k] - cell.centre[k]);
+            }
+            cell.com[3] = sum[3];
+
+            cl_float openDist = cell.size * invTheta + sqrt(offsetSqr);
+            cell.openSqr = openDist * openDist;
+        }
+    }
+};
+
+/*
+ * Walks the tree for the sorted bodies [begin, end). Neighbouring bodies
+ * open nearly the same cells, which keeps the walk in cache
+ */
+struct BHTraverse
+{
+    const cl_float *sorted;
+    const BHKey *keys;
+    const BHCell *cells;
+    cl_float *acc;
+    cl_float espSqr;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        cl_uint stack[8 * BH_MORTON_LEVELS + 8];
+        for(size_t i = begin; i < end; ++i)
+        {
+            const cl_float *p = sorted + 4 * i;
+            cl_float a[3] = {0.0f, 0.0f, 0.0f};
+            int top = 0;
+            stack[top++] = 0;
+
+            while(top > 0)
+            {
+                const BHCell &cell = cells[stack[--top]];
+                cl_float r[3];
+                cl_float distSqr = 0.0f;
+                for(int k = 0; k < 3; ++k)
+                {
+                    r[k] = cell.com[k] - p[k];
+                    distSqr += r[k] * r[k];
+                }
+
+                if(cell.numChildren == 0)
+                {
+                    for(cl_uint j = cell.begin; j < cell.end; ++j)
+                    {
+                        const cl_float *q = sorted + 4 * j;
+                        cl_float d[3];
+                        cl_float dSqr = 0.0f;
+                        for(int k = 0; k < 3; ++k)
+                        {
+                            d[k] = q[k] - p[k];
+                            dSqr += d[k] * d[k];
+                        }
+                        cl_float invDist = 1.0f / sqrt(dSqr + espSqr);
+                        cl_float s = q[3] * invDist * invDist * invDist;
+                        for(int k = 0; k < 3; ++k)
+                            a[k] += s * d[k];
+                    }
+                }
+                else if(distSqr > cell.openSqr)
+                {
+                    cl_float invDist = 1.0f / sqrt(distSqr + espSqr);
+                    cl_float s = cell.com[3] * invDist * invDist * invDist;
+                    for(int k = 0; k < 3; ++k)
+                        a[k] += s * r[k];
+                }
+                else
+                {
+                    for(cl_uint c = 0; c < cell.numChildren; ++c)
+                        stack[top++] = cell.firstChild + c;
+                }
+            }
+
+            cl_float *out = acc + 4 * keys[i].index;
+            for(int k = 0; k < 3; ++k)
+                out[k] = a[k];
+        }
+    }
+};
+
+struct BHIntegrate
+{
+    cl_float *pos;
+    cl_float *vel;
+    const cl_float *acc;
+    cl_float delT;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            for(int k = 0; k < 3; ++k)
+            {
+                size_t index = 4 * i + k;
+                pos[index] += vel[index] * delT + 0.5f * acc[index] * delT * delT;
+                vel[index] += acc[index] * delT;
+            }
+        }
+    }
+};
+
+void
+NBody::barnesHutCPUReference()
+{
+    streamsdk::SDKThreadPool &pool = streamsdk::SDKThreadPool::getInstance();
+    size_t n = (size_t)numBodies;
+    if(n == 0)
+        return;
+
+    // Bounding cube, slightly enlarged so that no body sits on its upper face
+    BHBoundsBody boundsBody = {refPos};
+    BHBounds bounds = pool.parallelReduce(0, n, boundsBody(0, 1), boundsBody, BHBoundsCombine());
+    cl_float extent = 0.0f;
+    cl_float centre[3];
+    for(int k = 0; k < 3; ++k)
+    {
+        extent = std::max(extent, bounds.hi[k] - bounds.lo[k]);
+        centre[k] = 0.5f * (bounds.lo[k] + bounds.hi[k]);
+    }
+    extent = (extent > 0.0f) ? extent * 1.001f : 1.0f;
+
+    // Morton codes, sorted as independent chunks that are then merged pairwise
+    std::vector<BHKey> keys(n), scratch(n);
+    BHComputeKeys computeKeys = {refPos, &keys[0], {0.0f, 0.0f, 0.0f},
+                                 (cl_float)(1 << BH_MORTON_LEVELS) / extent};
+    for(int k = 0; k < 3; ++k)
+        computeKeys.origin[k] = centre[k] - 0.5f * extent;
+    pool.parallelFor(0, n, computeKeys);
+
+    size_t numChunks = 1;
+    while(numChunks < 4 * pool.getNumThreads() && numChunks * 1024 < n)
+        numChunks *= 2;
+    size_t width = (n + numChunks - 1) / numChunks;
+    BHSortChunks sortChunks = {&keys[0], n, width};
+    pool.parallelFor(0, numChunks, sortChunks, 1);
+    for(; width < n; width *= 2)
+    {
+        BHMergeRuns mergeRuns = {&keys[0], &scratch[0], n, width};
+        pool.parallelFor(0, (n + 2 * width - 1) / (2 * width), mergeRuns, 1);
+        keys.swap(scratch);
+    }
+
+    std::vector<float> sorted(4 * n);
+    BHGatherBodies gather = {refPos, &keys[0], &sorted[0]};
+    pool.parallelFor(0, n, gather);
+
+    // Tree, one level per pass. levels[d] is the first cell of depth d
+    std::vector<BHCell> cells(1);
+    std::vector<size_t> levels;
+    BHCell &root = cells[0];
+    for(int k = 0; k < 3; ++k)
+        root.centre[k] = centre[k];
+    root.size = extent;
+    root.begin = 0;
+    root.end = (cl_uint)n;
+    levels.push_back(0);
+
+    for(int depth = 0; levels.back() < cells.size(); ++depth)
+    {
+        size_t first = levels.back(), last = cells.size();
+        BHCountChildren count = {&keys[0], &cells[0], depth};
+        pool.parallelFor(first, last, count);
+
+        size_t next = last;
+        for(size_t c = first; c < last; ++c)
+        {
+            cells[c].firstChild = (cl_uint)next;
+            next += cells[c].numChildren;
+        }
+        cells.resize(next);
+
+        BHCreateChildren create = {&keys[0], &cells[0], depth};
+        pool.parallelFor(first, last, create);
+        levels.push_back(last);
+    }
+
+    BHSumMass sumMass = {&sorted[0], &cells[0], 1.0f / theta};
+    for(size_t d = levels.size() - 1; d > 0; --d)
+        pool.parallelFor(levels[d - 1], levels[d], sumMass);
+
+    // Accelerations for the positions at the start of the step, then the
+    // same update as the all-pairs reference
+    std::vector<float> acc(4 * n, 0.0f);
+    BHTraverse traverse = {&sorted[0], &keys[0], &cells[0], &acc[0], espSqr};
+    pool.parallelFor(0, n, traverse, 64);
+
+    BHIntegrate integrate = {refPos, refVel, &acc[0], delT};
+    pool.parallelFor(0, n, integrate);
+}
+
 /*
 * n-body simulation on cpu
 */
 void 
 NBody::nBodyCPUReference()
 {
+    if(theta > 0.0f)
+    {
+        barnesHutCPUReference();
+        return;
+    }
+
     //Iterate for all samples
     for(int i = 0; i < numBodies; ++i)
     {
@@ -539,6 +1042,18 @@ NBody::initialize()
     sampleArgs->AddOption(num_iterations);
     delete num_iterations;
 
+    streamsdk::Option *opening_angle = new streamsdk::Option;
+    CHECK_ALLOCATION(opening_angle, "error. Failed to allocate memory (opening_angle)\n");
+
+    opening_angle->_sVersion = "";
+    opening_angle->_lVersion = "theta";
+    opening_angle->_description = "Barnes-Hut opening angle of the CPU reference (0 = all pairs)";
+    opening_angle->_type = streamsdk::CA_ARG_FLOAT;
+    opening_angle->_value = &theta;
+
+    sampleArgs->AddOption(opening_angle);
+    delete opening_angle;
+
     return SDK_SUCCESS;
 }
 
@@ -674,6 +1189,32 @@ int
 NBody::run()
 {
     int status = 0;
+
+    // Restart from the initial bodies, execute() may call run() several times
+    exchange = true;
+
+    status = clEnqueueWriteBuffer(commandQueue,
+                                  currPos,
+                                  CL_TRUE,
+                                  0,
+                                  numBodies * sizeof(cl_float4),
+                                  initPos,
+                                  0,
+                                  0,
+                                  0);
+    CHECK_OPENCL_ERROR(status, "clEnqueueWriteBuffer failed. (currPos)");
+
+    status = clEnqueueWriteBuffer(commandQueue,
+                                  currVel,
+                                  CL_TRUE,
+                                  0,
+                                  numBodies * sizeof(cl_float4),
+                                  initVel,
+                                  0,
+                                  0,
+                                  0);
+    CHECK_OPENCL_ERROR(status, "clEnqueueWriteBuffer failed. (currVel)");
+
     // Arguments are set and execution call is enqueued on command buffer
     if(setupCLKernels() != SDK_SUCCESS)
         return SDK_FAILURE;
@@ -806,17 +1347,9 @@ NBody::~NBody()
 
     FREE(initVel);
 
-#if defined (_WIN32)
-        ALIGNED_FREE(pos);
-#else
-        FREE(pos);
-#endif
+    POOL_FREE(pos);
 
-#if defined (_WIN32)
-        ALIGNED_FREE(vel);
-#else
-        FREE(vel);
-#endif
+    POOL_FREE(vel);
 
     FREE(devices);
     FREE(refPos);
@@ -842,17 +1375,9 @@ main(int argc, char * argv[])
         return clNBody.genBinaryImage();
     }
 
-    status = clNBody.setup();
-    if(status != SDK_SUCCESS)
-        return SDK_FAILURE;
-
-    status = clNBody.run();
-    CHECK_ERROR(status, SDK_SUCCESS, "Sample Run Program Failed");
-
-    status = clNBody.verifyResults();
-    CHECK_ERROR(status, SDK_SUCCESS, "Sample Verify Results Failed");
-
-    clNBody.printStats();
+    // Setup, Run, VerifyResults and printStats
+    status = clNBody.execute();
+    CHECK_ERROR(status, SDK_SUCCESS, "Sample Execution Failed");
 
     if(display)
     {
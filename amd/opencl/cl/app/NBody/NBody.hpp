@@ -26,9 +26,14 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <SDKApplication.hpp>
 #include <SDKCommandArgs.hpp>
 #include <SDKFile.hpp>
+#include <SDKBufferPool.hpp>
+#include <SDKThreadPool.hpp>
 
 #define GROUP_SIZE 256
 
+#define BH_LEAF_SIZE 8       /**< bodies below which a Barnes-Hut cell is not split */
+#define BH_MORTON_LEVELS 21  /**< bits per axis of the Morton codes = maximum tree depth */
+
 /**
 * NBody 
 * Class implements OpenCL  NBody sample
@@ -59,6 +64,7 @@ class NBody : public SDKSample
     size_t groupSize;                   /**< Work-Group size */
     cl_int numParticles;
     int iterations;
+    cl_float theta;                     /**< Barnes-Hut opening angle of the reference, 0 = all pairs */
     bool exchange;                                      /** Exchange current pos/vel with new pos/vel */
     streamsdk::SDKDeviceInfo deviceInfo;                /**< Structure to store device information*/
     streamsdk::KernelWorkGroupInfo kernelInfo;          /**< Structure to store kernel related info */
@@ -89,6 +95,7 @@ public:
         devices(NULL),
         groupSize(GROUP_SIZE),
         iterations(1),
+        theta(0.0f),
         exchange(true),
 		isFirstLuanch(true),
 		glEvent(NULL)
@@ -115,6 +122,7 @@ public:
         devices(NULL),
         groupSize(GROUP_SIZE),
         iterations(1),
+        theta(0.0f),
         exchange(true),
 		isFirstLuanch(true),
 		glEvent(NULL)
@@ -165,6 +173,13 @@ public:
     */
     void nBodyCPUReference();
 
+    /**
+    * Barnes-Hut variant of nBodyCPUReference, used when theta > 0.
+    * Cells seen under an angle below theta act as a point mass,
+    * so one step costs O(n log n) instead of O(n^2)
+    */
+    void barnesHutCPUReference();
+
     /**
     * Override from SDKSample. Print sample stats.
     */
@@ -23,55 +23,12 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 int 
 RadixSort::hostRadixSort()
 {
-    cl_uint *histogram = (cl_uint*)malloc(RADICES * sizeof(cl_uint));
-    CHECK_ALLOCATION(histogram, "Failed to allocate host memory. (histogram)");
+    memcpy(hSortedData, unsortedData, elementCount * sizeof(cl_uint));
 
-    cl_uint *tempData = (cl_uint*)malloc(elementCount * sizeof(cl_uint));
-    CHECK_ALLOCATION(tempData, "Failed to allocate host memory. (tempData)");
+    // Multi-threaded LSD sort of 8 bit digits, passes of constant digits are skipped
+    CHECK_ERROR(streamsdk::radixSort(hSortedData, (size_t)elementCount), true,
+                "Failed to allocate host memory. (radixSort)");
 
-    if(histogram != NULL && tempData != NULL)
-    {
-        memcpy(tempData, unsortedData, elementCount * sizeof(cl_uint));
-        for(int bits = 0; bits < sizeof(cl_uint) * RADIX ; bits += RADIX)
-        {
-            // Initialize histogram bucket to zeros
-            memset(histogram, 0, RADICES * sizeof(cl_uint));
-
-            // Calculate 256 histogram for all element
-            for(int i = 0; i < elementCount; ++i)
-            {
-                cl_uint element = tempData[i];
-                cl_uint value = (element >> bits) & RADIX_MASK;
-                histogram[value]++;
-            }
-
-            // Prescan the histogram bucket
-            cl_uint sum = 0;
-            for(int i = 0; i < RADICES; ++i)
-            {
-                cl_uint val = histogram[i];
-                histogram[i] = sum;
-                sum += val;
-            }
-
-            // Rearrange  the elements based on prescaned histogram
-            for(int i = 0; i < elementCount; ++i)
-            {
-                cl_uint element = tempData[i];
-                cl_uint value = (element >> bits) & RADIX_MASK;
-                cl_uint index = histogram[value];
-                hSortedData[index] = tempData[i];
-                histogram[value] = index + 1;
-            }
-
-            // Copy to tempData for further use
-            if(bits != RADIX * 3)
-                memcpy(tempData, hSortedData, elementCount * sizeof(cl_uint));
-        }
-    }
-
-    FREE(tempData);
-    FREE(histogram);
     return SDK_SUCCESS;
 }
 
@@ -1154,20 +1111,16 @@ main(int argc, char * argv[])
         return clRadixSort.genBinaryImage();
     }
 
-    status = clRadixSort.setup();
+    // Setup, Run, VerifyResults and printStats
+    status = clRadixSort.execute();
     if(status != SDK_SUCCESS)
+    {
+        // setup skips devices the sample does not support
         return (status == SDK_EXPECTED_FAILURE) ? SDK_SUCCESS : SDK_FAILURE;
-
-    if (clRadixSort.run() != SDK_SUCCESS)
-        return SDK_FAILURE;
-
-    if (clRadixSort.verifyResults() != SDK_SUCCESS)
-        return SDK_FAILURE;
+    }
 
     if (clRadixSort.cleanup() != SDK_SUCCESS)
         return SDK_FAILURE;
 
-    clRadixSort.printStats();
-
     return SDK_SUCCESS;
 }
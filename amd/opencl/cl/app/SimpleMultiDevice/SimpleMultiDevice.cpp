@@ -227,6 +227,9 @@ Device::getProfilingData()
     //Measure time in ms
     elapsedTime = 1e-6 * (kernelEndTime - kernelStartTime);
 
+    // Put the kernel on the SDK_TRACE timeline
+    streamsdk::SDKTrace::getInstance().recordEvent(eventObject);
+
     return SDK_SUCCESS;
 }
 
@@ -280,6 +283,7 @@ Device::verifyResults()
 int
 Device::cleanupResources()
 {
+    streamsdk::SDKTrace::getInstance().releaseQueue(queue);
     int status = clReleaseCommandQueue(queue);
     CHECK_OPENCL_ERROR(status, "clReleaseCommandQueue failed.(queue)");
 
@@ -354,6 +358,7 @@ Device::cleanupResources()
 void* threadFunc(void *device)
 {
     Device *d = (Device*)device;
+    streamsdk::SDKTraceScope traceScope("threadFunc");
 
     size_t globalThreads = width;
     size_t localThreads = GROUP_SIZE;
@@ -526,6 +531,7 @@ int runMultiGPU()
         status = clReleaseKernel(gpu[i].kernel);
         CHECK_OPENCL_ERROR(status, "clReleaseCommandQueue failed.");
 
+        streamsdk::SDKTrace::getInstance().releaseQueue(gpu[i].queue);
         status = clReleaseCommandQueue(gpu[i].queue);
         CHECK_OPENCL_ERROR(status, "clReleaseCommandQueue failed.");
 
@@ -909,9 +915,11 @@ int runMultiDevice()
     CHECK_OPENCL_ERROR(status, "clReleaseMemObject failed. (outputBuffer)");
 
     //ReleaseCommand-queue
+    streamsdk::SDKTrace::getInstance().releaseQueue(cpu[0].queue);
     status = clReleaseCommandQueue(cpu[0].queue);
     CHECK_OPENCL_ERROR(status, "clReleaseCommandQueue failed.(cpu[0].queue)");
 
+    streamsdk::SDKTrace::getInstance().releaseQueue(gpu[0].queue);
     status = clReleaseCommandQueue(gpu[0].queue);
     CHECK_OPENCL_ERROR(status, "clReleaseCommandQueue failed.(gpu[0].queue)");
 
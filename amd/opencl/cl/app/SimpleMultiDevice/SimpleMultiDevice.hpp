@@ -24,6 +24,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <time.h>
 #include <SDKCommon.hpp>
 #include <SDKThread.hpp>
+#include <SDKTrace.hpp>
 
 #define KERNEL_ITERATIONS 100
 #define GROUP_SIZE 64
@@ -179,7 +179,12 @@ TransferOverlap::setupCL(void)
     if(setupTransferOverlap() != SDK_SUCCESS)
         return SDK_FAILURE;
 
-    queue = clCreateCommandQueue(context, devices[deviceId], 0, &status);
+    // Profiling is only needed to put the commands on the trace timeline
+    queue = clCreateCommandQueue(
+                context,
+                devices[deviceId],
+                streamsdk::SDKTrace::getInstance().getQueueProperties(),
+                &status);
     CHECK_OPENCL_ERROR(status, "clCreateCommandQueue failed.");
 
     inputBuffer1 = clCreateBuffer(context, inFlags, nBytes, NULL, &status);
@@ -434,6 +439,7 @@ TransferOverlap::verifyResultBuffer(cl_mem resultBuffer, bool firstLoop)
     cl_int   status;
     cl_event event;
     void *ptrResult = NULL;
+    streamsdk::SDKTraceScope traceScope("verifyResultBuffer");
 
     t.Reset(); 
     t.Start();
@@ -501,6 +507,7 @@ TransferOverlap::verifyResultBuffer(cl_mem resultBuffer, bool firstLoop)
         1);
 
     // Release event
+    streamsdk::SDKTrace::getInstance().recordEvent(event);
     status = clReleaseEvent(event);
     CHECK_OPENCL_ERROR(status, "clReleaseEvent(event) failed.");
 
@@ -538,8 +545,10 @@ TransferOverlap::launchKernel(cl_mem inputBuffer, cl_mem resultBuffer, unsigned
 
     cl_event  event;
     cl_event *evPtr;
+    streamsdk::SDKTraceScope traceScope("launchKernel");
+    bool tracing = streamsdk::SDKTrace::getInstance().isEnabled();
 
-    if( noOverlap )
+    if( noOverlap || tracing )
         evPtr = &event;
     else
         evPtr = NULL;
@@ -580,9 +589,15 @@ TransferOverlap::launchKernel(cl_mem inputBuffer, cl_mem resultBuffer, unsigned
     // Release the event
     if(noOverlap)
     {
+        streamsdk::SDKTrace::getInstance().recordEvent(*evPtr);
         status = clReleaseEvent(*evPtr);
         CHECK_OPENCL_ERROR(status, "clReleaseEvent(*evPtr) failed.");
     }
+    else if(tracing)
+    {
+        // Recorded once the following unmap has completed
+        pendingKernelEvent = event;
+    }
 
     return SDK_SUCCESS;
 }
@@ -592,6 +607,7 @@ TransferOverlap::launchMapBuffer(cl_mem buffer, cl_event *mapEvent)
 {
     cl_int status;
     void *ptr = NULL;
+    streamsdk::SDKTraceScope traceScope("launchMapBuffer");
 
     t.Reset(); 
     t.Start();
@@ -635,6 +651,7 @@ TransferOverlap::fillBuffer(cl_mem buffer, cl_event *mapEvent, void *ptr, unsign
 {
     cl_int status;
     cl_event event;
+    streamsdk::SDKTraceScope traceScope("fillBuffer");
 
     t.Reset();
     t.Start();
@@ -652,6 +669,7 @@ TransferOverlap::fillBuffer(cl_mem buffer, cl_event *mapEvent, void *ptr, unsign
         1);    
 
     // Release event
+    streamsdk::SDKTrace::getInstance().recordEvent(*mapEvent);
     status = clReleaseEvent(*mapEvent);
     CHECK_OPENCL_ERROR(status, "clReleaseEvent(*mapEvent) failed.");
 
@@ -678,12 +696,29 @@ TransferOverlap::fillBuffer(cl_mem buffer, cl_event *mapEvent, void *ptr, unsign
         1);
     
     // Release event
+    streamsdk::SDKTrace::getInstance().recordEvent(event);
     status = clReleaseEvent(event);
     CHECK_OPENCL_ERROR(status, "clReleaseEvent(event) failed.");
 
+    // The in-order queue ran the preceding kernel before this unmap
+    status = releasePendingKernelEvent();
+    CHECK_OPENCL_ERROR(status, "clReleaseEvent(pendingKernelEvent) failed.");
+
     return SDK_SUCCESS;
 }
 
+cl_int
+TransferOverlap::releasePendingKernelEvent()
+{
+    if(pendingKernelEvent == NULL)
+        return CL_SUCCESS;
+
+    streamsdk::SDKTrace::getInstance().recordEvent(pendingKernelEvent);
+    cl_int status = clReleaseEvent(pendingKernelEvent);
+    pendingKernelEvent = NULL;
+    return status;
+}
+
 int 
 TransferOverlap::runOverlapTest()
 {
@@ -801,7 +836,11 @@ TransferOverlap::runOverlapTest()
 
     status = clFinish(queue);
     CHECK_OPENCL_ERROR(status, "clFlush() failed.");
+
+    status = releasePendingKernelEvent();
+    CHECK_OPENCL_ERROR(status, "clReleaseEvent(pendingKernelEvent) failed.");
     
+    streamsdk::SDKTrace::getInstance().recordEvent(lastBuf1MapEvent);
     status = clReleaseEvent(lastBuf1MapEvent);
     CHECK_OPENCL_ERROR(status, "clReleaseEvent() failed.");
 
@@ -928,6 +967,7 @@ TransferOverlap::cleanup()
     status = clReleaseProgram(program);
     CHECK_OPENCL_ERROR(status, "clReleaseProgram() failed.");
 
+    streamsdk::SDKTrace::getInstance().releaseQueue(queue);
     status = clReleaseCommandQueue(queue);
     CHECK_OPENCL_ERROR(status, "clReleaseCommandQueue() failed.");
 
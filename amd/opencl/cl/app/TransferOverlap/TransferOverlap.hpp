@@ -66,6 +66,7 @@ class TransferOverlap : public SDKSample
     cl_program program;
     cl_kernel readKernel;
     cl_kernel writeKernel;
+    cl_event pendingKernelEvent; // Overlapped kernel awaiting trace recording
     cl_device_id  *devices;      // CL device list
 
     CPerfCounter t;
@@ -102,6 +103,7 @@ public:
          context(NULL),
          readKernel(NULL),
          writeKernel(NULL), 
+         pendingKernelEvent(NULL),
          inputBuffer1(NULL),
          inputBuffer2(NULL),
          resultBuffer1(NULL),
@@ -135,6 +137,7 @@ public:
          context(NULL),
          readKernel(NULL),
          writeKernel(NULL), 
+         pendingKernelEvent(NULL),
          inputBuffer1(NULL),
          inputBuffer2(NULL),
          resultBuffer1(NULL),
@@ -206,6 +209,7 @@ public:
     int launchKernel(cl_mem inputBuffer, cl_mem resultBuffer, unsigned char v);
     void* launchMapBuffer(cl_mem buffer, cl_event *mapEvent);
     int fillBuffer(cl_mem buffer, cl_event *mapEvent, void *ptr, unsigned char v);
+    cl_int releasePendingKernelEvent();
     int runOverlapTest();
 };
 
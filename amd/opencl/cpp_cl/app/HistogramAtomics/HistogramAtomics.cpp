@@ -19,21 +19,14 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 #include <math.h>
 
-void 
+int 
 Histogram::calculateHostBin()
 {
-    // compute CPU histogram
-    cl_int *p = (cl_int*)input;
-
-    memset(cpuhist, 0, sizeof(cl_uint) * NBINS);
+    // compute CPU histogram, every byte of the input is one value
+    CHECK_ERROR(streamsdk::histogram((const unsigned char*)input, inputNBytes, NBINS, cpuhist), true,
+                "Failed to allocate host memory. (histogram)");
 
-    for(unsigned int i = 0; i < inputNBytes / sizeof(cl_uint); i++) 
-    {
-        cpuhist[ (p[i] >> 24) & 0xff ]++;
-        cpuhist[ (p[i] >> 16) & 0xff ]++;
-        cpuhist[ (p[i] >> 8) & 0xff ]++;
-        cpuhist[ (p[i] >> 0) & 0xff ]++;
-    }
+    return SDK_SUCCESS;
 }
 
 int
@@ -462,7 +455,8 @@ Histogram::verifyResults()
         /* reference implementation on host device
          * calculates the histogram bin on host
          */
-        calculateHostBin();
+        int status = calculateHostBin();
+        CHECK_ERROR(status, SDK_SUCCESS, "Host Implementation Failed");
 
         // compare the results and see if they match 
         bool flag = true;
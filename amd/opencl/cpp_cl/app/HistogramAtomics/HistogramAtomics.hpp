@@ -28,6 +28,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <SDKApplication.hpp>
 #include <SDKCommandArgs.hpp>
 #include <SDKFile.hpp>
+#include <SDKHistogram.hpp>
 
 
 #define NBINS        256
@@ -204,8 +205,9 @@ private:
 
     /**
      *  Calculate histogram bin on host 
+     * @return SDK_SUCCESS on success and SDK_FAILURE on failure
      */
-    void calculateHostBin();
+    int calculateHostBin();
 
 };
 
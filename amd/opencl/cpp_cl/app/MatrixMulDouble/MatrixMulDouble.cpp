@@ -659,16 +659,8 @@ MatrixMulDouble::MatrixMulDoubleCPUReference(
     const cl_uint x,
     const cl_uint z)
 {
-    for(cl_uint i=0; i < y; i++)
-    {
-        for(cl_uint j=0; j < z; j++)
-        {
-            for(cl_uint k=0; k < x; k++)
-            {
-                output[i*z + j] += (inputA[i*x + k]*inputB[k*z + j]);
-            }
-        }
-    }
+    // output (y x z) += inputA (y x x) * inputB (x x z)
+    streamsdk::gemm(y, z, x, inputA, x, inputB, z, output, z, true);
 }
 
 int 
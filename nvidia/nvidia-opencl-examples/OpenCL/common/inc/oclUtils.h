@@ -137,6 +137,7 @@ extern "C" char* oclLoadProgSource(const char* cFilename, const char* cPreamble,
 //! @param cdDevice     device of interest
 //! @param binary       returned code
 //! @param length       length of returned code
+//!                     (NULL and 0 if the binary could not be queried)
 //////////////////////////////////////////////////////////////////////////////
 extern "C" void oclGetProgBinary( cl_program cpProgram, cl_device_id cdDevice, char** binary, size_t* length);
 
@@ -157,6 +158,39 @@ extern "C" void oclLogPtx(cl_program cpProgram, cl_device_id cdDevice, const cha
 //////////////////////////////////////////////////////////////////////////////
 extern "C" void oclLogBuildInfo(cl_program cpProgram, cl_device_id cdDevice);
 
+// Default directory for cached program binaries (relative to the working directory)
+#define OCL_PROGRAM_CACHE_DIR "oclProgramCache"
+
+//////////////////////////////////////////////////////////////////////////////
+//! Create and build a program, reusing binaries cached by an earlier run
+//!
+//! Drop-in for clCreateProgramWithSource + clBuildProgram.  Binaries are cached
+//! per device in the program cache directory, keyed by the source (including
+//! any preamble), the build options and the device/driver identity.  When
+//! every device has a valid entry the program is created with
+//! clCreateProgramWithBinary; otherwise (or if that fails) it is built from
+//! source and the cache is refreshed.  Set OCL_PROGRAM_CACHE=0 in the
+//! environment to disable the cache, or to a path to relocate it.
+//!
+//! @return the program (also on build failure, for oclLogBuildInfo), 0 if it could not be created
+//! @param cxGPUContext     OpenCL context
+//! @param uiNumDevices     number of devices in cdDevices, 0 for all devices of the context
+//! @param cdDevices        devices to build for (may be NULL if uiNumDevices is 0)
+//! @param cSource          program source, e.g. as returned by oclLoadProgSource
+//! @param szSourceLength   length of cSource
+//! @param cOptions         build options passed to clBuildProgram (may be NULL)
+//! @param ciErrNum         returned error code: clBuildProgram's result, or the creation error
+//////////////////////////////////////////////////////////////////////////////
+extern "C" cl_program oclBuildProgramCached(cl_context cxGPUContext, cl_uint uiNumDevices, const cl_device_id* cdDevices,
+                                            const char* cSource, size_t szSourceLength, const char* cOptions, cl_int* ciErrNum);
+
+//////////////////////////////////////////////////////////////////////////////
+//! Set the directory used by oclBuildProgramCached (NULL restores the default, "" disables caching)
+//!
+//! @param cDirectory   cache directory
+//////////////////////////////////////////////////////////////////////////////
+extern "C" void oclSetProgramCacheDir(const char* cDirectory);
+
 // Helper function for De-allocating cl objects
 // *********************************************************************
 extern "C" void oclDeleteMemObjs(cl_mem* cmMemObjs, int iNumObjs);
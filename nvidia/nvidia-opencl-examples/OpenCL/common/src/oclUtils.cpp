@@ -19,6 +19,13 @@
 #include <iostream>
 #include <algorithm>
 #include <stdarg.h>
+#ifdef _WIN32
+    #include <direct.h>
+    #include <process.h>
+#else
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 //////////////////////////////////////////////////////////////////////////////
 //! Gets the platform ID for NVIDIA if available, otherwise default
@@ -554,31 +561,50 @@ cl_device_id oclGetDev(cl_context cxGPUContext, unsigned int nr)
 //! @param cdDevice     device of interest
 //! @param binary       returned code
 //! @param length       length of returned code
+//!                     (NULL and 0 if the binary could not be queried)
 //////////////////////////////////////////////////////////////////////////////
 void oclGetProgBinary( cl_program cpProgram, cl_device_id cdDevice, char** binary, size_t* length)
 {
+    *binary = NULL;
+    *length = 0;
+
     // Grab the number of devices associated witht the program
-    cl_uint num_devices;
-    clGetProgramInfo(cpProgram, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint), &num_devices, NULL);
+    cl_uint num_devices = 0;
+    cl_int ciErr = clGetProgramInfo(cpProgram, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint), &num_devices, NULL);
+    if (ciErr != CL_SUCCESS || num_devices == 0)
+    {
+        return;
+    }
 
-    // Grab the device ids
+    // Grab the device ids and the sizes of the binaries
     cl_device_id* devices = (cl_device_id*) malloc(num_devices * sizeof(cl_device_id));
-    clGetProgramInfo(cpProgram, CL_PROGRAM_DEVICES, num_devices * sizeof(cl_device_id), devices, 0);
-
-    // Grab the sizes of the binaries
-    size_t* binary_sizes = (size_t*)malloc(num_devices * sizeof(size_t));    
-    clGetProgramInfo(cpProgram, CL_PROGRAM_BINARY_SIZES, num_devices * sizeof(size_t), binary_sizes, NULL);
+    size_t* binary_sizes = (size_t*)malloc(num_devices * sizeof(size_t));
+    char** ptx_code = (char**) calloc(num_devices, sizeof(char*));
+    bool bOk = (devices != NULL && binary_sizes != NULL && ptx_code != NULL);
+    if (bOk)
+    {
+        ciErr = clGetProgramInfo(cpProgram, CL_PROGRAM_DEVICES, num_devices * sizeof(cl_device_id), devices, NULL);
+        ciErr |= clGetProgramInfo(cpProgram, CL_PROGRAM_BINARY_SIZES, num_devices * sizeof(size_t), binary_sizes, NULL);
+        bOk = (ciErr == CL_SUCCESS);
+    }
 
     // Now get the binaries
-    char** ptx_code = (char**) malloc(num_devices * sizeof(char*));
-    for( unsigned int i=0; i<num_devices; ++i) {
-        ptx_code[i]= (char*)malloc(binary_sizes[i]);
+    for( unsigned int i=0; bOk && i<num_devices; ++i) {
+        ptx_code[i]= (char*)malloc(binary_sizes[i] > 0 ? binary_sizes[i] : 1);
+        bOk = (ptx_code[i] != NULL);
+    }
+    if (bOk)
+    {
+        bOk = (clGetProgramInfo(cpProgram, CL_PROGRAM_BINARIES, num_devices * sizeof(char*), ptx_code, NULL) == CL_SUCCESS);
     }
-    clGetProgramInfo(cpProgram, CL_PROGRAM_BINARIES, 0, ptx_code, NULL);
 
     // Find the index of the device of interest
-    unsigned int idx = 0;
-    while( idx<num_devices && devices[idx] != cdDevice ) ++idx;
+    unsigned int idx = num_devices;
+    if (bOk)
+    {
+        idx = 0;
+        while( idx<num_devices && devices[idx] != cdDevice ) ++idx;
+    }
     
     // If it is associated prepare the result
     if( idx < num_devices )
@@ -588,11 +614,11 @@ void oclGetProgBinary( cl_program cpProgram, cl_device_id cdDevice, char** binar
     }
 
     // Cleanup
-    free( devices );
-    free( binary_sizes );
-    for( unsigned int i=0; i<num_devices; ++i) {
+    for( unsigned int i=0; ptx_code != NULL && i<num_devices; ++i) {
         if( i != idx ) free(ptx_code[i]);
     }
+    free( devices );
+    free( binary_sizes );
     free( ptx_code );
 }
 
@@ -623,7 +649,7 @@ void oclLogPtx(cl_program cpProgram, cl_device_id cdDevice, const char* cPtxFile
     {
         ptx_code[i] = (char*)malloc(binary_sizes[i]);
     }
-    clGetProgramInfo(cpProgram, CL_PROGRAM_BINARIES, 0, ptx_code, NULL);
+    clGetProgramInfo(cpProgram, CL_PROGRAM_BINARIES, num_devices * sizeof(char*), ptx_code, NULL);
 
     // Find the index of the device of interest
     unsigned int idx = 0;
@@ -681,6 +707,274 @@ void oclLogBuildInfo(cl_program cpProgram, cl_device_id cdDevice)
     shrLog("\n%s\nBuild Log:\n%s\n%s\n", HDASHLINE, cBuildLog, HDASHLINE);
 }
 
+// Program binary cache helpers
+// *********************************************************************
+#define OCL_PROGRAM_CACHE_MAGIC "OCLPBIN1"
+
+// On-disk header of a cached binary, followed by uiBinaryLength bytes
+struct oclProgramCacheHeader
+{
+    char magic[8];
+    unsigned long long uiKey;         // primary hash of source, options and device, also the file name
+    unsigned long long uiCheck;       // second, independently seeded hash guarding against collisions
+    unsigned long long uiBinaryLength;
+};
+
+static std::string sProgramCacheDir;
+static bool bProgramCacheDirSet = false;
+
+void oclSetProgramCacheDir(const char* cDirectory)
+{
+    bProgramCacheDirSet = (cDirectory != NULL);
+    sProgramCacheDir = bProgramCacheDirSet ? cDirectory : "";
+}
+
+// Returns the active cache directory, or an empty string when caching is off
+static std::string oclProgramCacheDir()
+{
+    if (bProgramCacheDirSet)
+    {
+        return sProgramCacheDir;
+    }
+    const char* cEnv = getenv("OCL_PROGRAM_CACHE");
+    if (cEnv == NULL || strcmp(cEnv, "1") == 0)
+    {
+        return OCL_PROGRAM_CACHE_DIR;
+    }
+    return (strcmp(cEnv, "0") == 0) ? "" : cEnv;
+}
+
+// FNV-1a over a block, fields are separated by their terminating 0 so "ab"+"c" != "a"+"bc"
+static void oclHashBytes(unsigned long long uiHash[2], const void* pData, size_t szLength)
+{
+    const unsigned char* pBytes = (const unsigned char*)pData;
+    for (size_t i = 0; i < szLength; i++)
+    {
+        uiHash[0] = (uiHash[0] ^ pBytes[i]) * 0x100000001b3ULL;
+        uiHash[1] = (uiHash[1] ^ pBytes[i]) * 0x100000001b3ULL;
+    }
+    uiHash[0] = (uiHash[0] ^ 0xff) * 0x100000001b3ULL;
+    uiHash[1] = (uiHash[1] ^ 0xff) * 0x100000001b3ULL;
+}
+
+static void oclHashDeviceString(unsigned long long uiHash[2], cl_device_id cdDevice, cl_device_info param)
+{
+    char cBuffer[1024] = "";
+    clGetDeviceInfo(cdDevice, param, sizeof(cBuffer), cBuffer, NULL);
+    oclHashBytes(uiHash, cBuffer, strlen(cBuffer));
+}
+
+static std::string oclProgramCachePath(const std::string& sDir, unsigned long long uiKey)
+{
+    char cName[32];
+    sprintf(cName, "%08x%08x.bin", (unsigned int)(uiKey >> 32), (unsigned int)uiKey);
+    return sDir + "/" + cName;
+}
+
+// Reads a cached binary, returns NULL if missing, truncated or not matching the key
+static unsigned char* oclReadProgramCache(const std::string& sPath, const unsigned long long uiHash[2], size_t* szLength)
+{
+    FILE* pFileStream = NULL;
+    #ifdef _WIN32
+        fopen_s(&pFileStream, sPath.c_str(), "rb");
+    #else
+        pFileStream = fopen(sPath.c_str(), "rb");
+    #endif
+    if (pFileStream == NULL)
+    {
+        return NULL;
+    }
+
+    oclProgramCacheHeader header;
+    unsigned char* pBinary = NULL;
+    if (fread(&header, sizeof(header), 1, pFileStream) == 1 &&
+        memcmp(header.magic, OCL_PROGRAM_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.uiKey == uiHash[0] && header.uiCheck == uiHash[1] &&
+        header.uiBinaryLength > 0 && header.uiBinaryLength < ((unsigned long long)1 << 31))
+    {
+        pBinary = (unsigned char*)malloc((size_t)header.uiBinaryLength);
+        if (fread(pBinary, (size_t)header.uiBinaryLength, 1, pFileStream) == 1)
+        {
+            *szLength = (size_t)header.uiBinaryLength;
+        }
+        else
+        {
+            free(pBinary);
+            pBinary = NULL;
+        }
+    }
+    fclose(pFileStream);
+    return pBinary;
+}
+
+// Writes a cached binary through a temporary file so concurrent runs never see a partial entry
+static void oclWriteProgramCache(const std::string& sDir, const unsigned long long uiHash[2], const char* pBinary, size_t szLength)
+{
+    #ifdef _WIN32
+        _mkdir(sDir.c_str());
+    #else
+        mkdir(sDir.c_str(), 0777);
+    #endif
+
+    std::string sPath = oclProgramCachePath(sDir, uiHash[0]);
+    char cSuffix[32];
+    #ifdef _WIN32
+        sprintf_s(cSuffix, sizeof(cSuffix), ".%u.tmp", (unsigned int)_getpid());
+    #else
+        sprintf(cSuffix, ".%u.tmp", (unsigned int)getpid());
+    #endif
+    std::string sTemp = sPath + cSuffix;
+
+    FILE* pFileStream = NULL;
+    #ifdef _WIN32
+        fopen_s(&pFileStream, sTemp.c_str(), "wb");
+    #else
+        pFileStream = fopen(sTemp.c_str(), "wb");
+    #endif
+    if (pFileStream == NULL)
+    {
+        return;
+    }
+
+    oclProgramCacheHeader header;
+    memcpy(header.magic, OCL_PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.uiKey = uiHash[0];
+    header.uiCheck = uiHash[1];
+    header.uiBinaryLength = szLength;
+    bool bOk = fwrite(&header, sizeof(header), 1, pFileStream) == 1 &&
+               fwrite(pBinary, szLength, 1, pFileStream) == 1;
+    bOk = (fclose(pFileStream) == 0) && bOk;
+
+    #ifdef _WIN32
+        if (bOk) remove(sPath.c_str());
+    #endif
+    if (!bOk || rename(sTemp.c_str(), sPath.c_str()) != 0)
+    {
+        remove(sTemp.c_str());
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Create and build a program, reusing binaries cached by an earlier run
+//!
+//! @return the program, 0 if it could not be created
+//! @param cxGPUContext     OpenCL context
+//! @param uiNumDevices     number of devices in cdDevices, 0 for all devices of the context
+//! @param cdDevices        devices to build for
+//! @param cSource          program source
+//! @param szSourceLength   length of cSource
+//! @param cOptions         build options
+//! @param ciErrNum         returned error code
+//////////////////////////////////////////////////////////////////////////////
+cl_program oclBuildProgramCached(cl_context cxGPUContext, cl_uint uiNumDevices, const cl_device_id* cdDevices,
+                                 const char* cSource, size_t szSourceLength, const char* cOptions, cl_int* ciErrNum)
+{
+    cl_int ciLocalErr;
+    cl_int& ciErr = (ciErrNum != NULL) ? *ciErrNum : ciLocalErr;
+
+    // Resolve the device list
+    std::vector<cl_device_id> devices;
+    if (uiNumDevices == 0 || cdDevices == NULL)
+    {
+        size_t szParmDataBytes = 0;
+        clGetContextInfo(cxGPUContext, CL_CONTEXT_DEVICES, 0, NULL, &szParmDataBytes);
+        devices.resize(szParmDataBytes / sizeof(cl_device_id));
+        if (!devices.empty())
+        {
+            clGetContextInfo(cxGPUContext, CL_CONTEXT_DEVICES, szParmDataBytes, &devices[0], NULL);
+        }
+    }
+    else
+    {
+        devices.assign(cdDevices, cdDevices + uiNumDevices);
+    }
+    if (devices.empty())
+    {
+        ciErr = CL_INVALID_DEVICE;
+        return 0;
+    }
+    cl_uint uiDevices = (cl_uint)devices.size();
+
+    // Hash the source and options once, then specialize the key per device
+    std::string sDir = oclProgramCacheDir();
+    std::vector<unsigned long long> keys(2 * uiDevices);
+    std::vector<unsigned char*> binaries(uiDevices, (unsigned char*)NULL);
+    std::vector<size_t> lengths(uiDevices, 0);
+    cl_uint uiHits = 0;
+    if (!sDir.empty())
+    {
+        unsigned long long uiBase[2] = {0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL};
+        oclHashBytes(uiBase, cSource, szSourceLength);
+        oclHashBytes(uiBase, cOptions ? cOptions : "", cOptions ? strlen(cOptions) : 0);
+        for (cl_uint i = 0; i < uiDevices; i++)
+        {
+            unsigned long long* uiHash = &keys[2 * i];
+            uiHash[0] = uiBase[0];
+            uiHash[1] = uiBase[1];
+            oclHashDeviceString(uiHash, devices[i], CL_DEVICE_VENDOR);
+            oclHashDeviceString(uiHash, devices[i], CL_DEVICE_NAME);
+            oclHashDeviceString(uiHash, devices[i], CL_DEVICE_VERSION);
+            oclHashDeviceString(uiHash, devices[i], CL_DRIVER_VERSION);
+
+            binaries[i] = oclReadProgramCache(oclProgramCachePath(sDir, uiHash[0]), uiHash, &lengths[i]);
+            uiHits += (binaries[i] != NULL);
+        }
+    }
+
+    // All devices cached: create from binaries, falling back to source if the driver rejects them
+    cl_program cpProgram = 0;
+    if (uiHits == uiDevices)
+    {
+        cl_int ciBinErr;
+        cpProgram = clCreateProgramWithBinary(cxGPUContext, uiDevices, &devices[0], &lengths[0],
+                                              (const unsigned char**)&binaries[0], NULL, &ciBinErr);
+        if (ciBinErr == CL_SUCCESS)
+        {
+            ciBinErr = clBuildProgram(cpProgram, uiDevices, &devices[0], cOptions, NULL, NULL);
+        }
+        if (ciBinErr != CL_SUCCESS && cpProgram != 0)
+        {
+            clReleaseProgram(cpProgram);
+            cpProgram = 0;
+        }
+    }
+    for (cl_uint i = 0; i < uiDevices; i++)
+    {
+        free(binaries[i]);
+    }
+    if (cpProgram != 0)
+    {
+        shrLog(" ...using cached program binary (%s)\n", sDir.c_str());
+        ciErr = CL_SUCCESS;
+        return cpProgram;
+    }
+
+    // Build from source
+    cpProgram = clCreateProgramWithSource(cxGPUContext, 1, &cSource, &szSourceLength, &ciErr);
+    if (ciErr != CL_SUCCESS)
+    {
+        return 0;
+    }
+    ciErr = clBuildProgram(cpProgram, uiDevices, &devices[0], cOptions, NULL, NULL);
+
+    // Refresh the cache for every device
+    if (ciErr == CL_SUCCESS && !sDir.empty())
+    {
+        for (cl_uint i = 0; i < uiDevices; i++)
+        {
+            char* cBinary = NULL;
+            size_t szLength = 0;
+            oclGetProgBinary(cpProgram, devices[i], &cBinary, &szLength);
+            if (cBinary != NULL && szLength > 0)
+            {
+                oclWriteProgramCache(sDir, &keys[2 * i], cBinary, szLength);
+            }
+            free(cBinary);
+        }
+    }
+    return cpProgram;
+}
+
 // Helper function for De-allocating cl objects
 // *********************************************************************
 void oclDeleteMemObjs(cl_mem* cmMemObjs, int iNumObjs)
@@ -79,6 +79,7 @@ int main(int argc, char** argv)
 
     // set logfile name and start logs
     shrSetLogFileName ("oclBandwidthTest.txt");
+    shrSetLogAsync(true);   // keep console and file I/O out of the timed loops
     shrLog("%s Starting...\n\n", argv[0]); 
 
     // run the main test
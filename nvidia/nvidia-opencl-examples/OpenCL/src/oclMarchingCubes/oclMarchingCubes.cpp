@@ -542,14 +542,10 @@ void initCL(int argc, char** argv) {
     cSourceCL = oclLoadProgSource(cPathAndName, "", &program_length);
     oclCheckErrorEX(cSourceCL != NULL, shrTRUE, pCleanup);
 
-    // create the program
-    cpProgram = clCreateProgramWithSource(cxGPUContext, 1,
-					  (const char **)&cSourceCL, &program_length, &ciErrNum);
-    oclCheckErrorEX(ciErrNum, CL_SUCCESS, pCleanup);
-    
-    // build the program
+    // create and build the program (reusing the cached binary if there is one)
     std::string buildOpts = "-cl-mad-enable";
-    ciErrNum = clBuildProgram(cpProgram, 0, NULL, buildOpts.c_str(), NULL, NULL);
+    cpProgram = oclBuildProgramCached(cxGPUContext, 0, NULL, cSourceCL, program_length, buildOpts.c_str(), &ciErrNum);
+    oclCheckErrorEX(cpProgram != NULL, shrTRUE, pCleanup);
     if (ciErrNum != CL_SUCCESS)
     {
         // write out standard error, Build Log and PTX, then cleanup and return error
@@ -797,6 +793,8 @@ runTest(int argc, char** argv)
 void
 computeIsosurface()
 {
+    shrProfileZone zone("computeIsosurface");
+
     int threads = 128;
     dim3 grid(numVoxels / threads, 1, 1);
     // get around maximum grid size of 65535 in each dimension
@@ -818,6 +816,7 @@ computeIsosurface()
     // since we are using an exclusive scan, the total is the last value of
     // the scan result plus the last value in the input array
     {
+        shrProfileZone readbackZone("readback activeVoxels");
         uint lastElement, lastScanElement;
 
         clEnqueueReadBuffer(cqCommandQueue, d_voxelOccupied,CL_TRUE, (numVoxels-1) * sizeof(uint), sizeof(uint), &lastElement, 0, 0, 0);
@@ -843,6 +842,7 @@ computeIsosurface()
 
     // readback total number of vertices
     {
+        shrProfileZone readbackZone("readback totalVerts");
         uint lastElement, lastScanElement;
         clEnqueueReadBuffer(cqCommandQueue, d_voxelVerts,CL_TRUE, (numVoxels-1) * sizeof(uint), sizeof(uint), &lastElement, 0, 0, 0);
         clEnqueueReadBuffer(cqCommandQueue, d_voxelVertsScan,CL_TRUE, (numVoxels-1) * sizeof(uint), sizeof(uint), &lastScanElement, 0, 0, 0);
@@ -1010,6 +1010,8 @@ deleteVBO(GLuint* vbo, cl_mem vbo_cl)
 ////////////////////////////////////////////////////////////////////////////////
 void renderIsosurface()
 {
+    shrProfileZone zone("renderIsosurface");
+
     glBindBuffer(GL_ARRAY_BUFFER, posVbo);
     glVertexPointer(4, GL_FLOAT, 0, 0);
     glEnableClientState(GL_VERTEX_ARRAY);
@@ -1032,6 +1034,7 @@ void renderIsosurface()
 void
 display()
 {
+    shrProfileZone zone("display");
     shrDeltaT(0);
 
     // run CUDA kernel to generate geometry
@@ -38,12 +38,9 @@ extern "C" void initScan(cl_context cxGPUContext, cl_command_queue cqParamComman
         char *cScan = oclLoadProgSource(shrFindFilePath("Scan.cl", argv[0]), "// My comment\n", &kernelLength);
         oclCheckError(cScan != NULL, shrTRUE);
 
-    shrLog(" ...creating scan program\n");
-        cpProgram = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cScan, &kernelLength, &ciErrNum);
-        oclCheckError(ciErrNum, CL_SUCCESS);
-
-    shrLog(" ...building scan program\n");
-        ciErrNum = clBuildProgram(cpProgram, 0, NULL, compileOptions, NULL, NULL);
+    shrLog(" ...creating and building scan program\n");
+        cpProgram = oclBuildProgramCached(cxGPUContext, 0, NULL, cScan, kernelLength, compileOptions, &ciErrNum);
+        oclCheckError(cpProgram != NULL, shrTRUE);
 		if (ciErrNum != CL_SUCCESS)
 		{
 			// write out standard error, Build Log and PTX, then cleanup and exit
@@ -9,11 +9,213 @@
  *
  */
 
+#include <shrUtils.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
 ////////////////////////////////////////////////////////////////////////////////
 // export C interface
 extern "C"
 void computeGold( float*, const float*, const float*, unsigned int, unsigned int, unsigned int);
 
+////////////////////////////////////////////////////////////////////////////////
+// Packed, blocked GEMM in double precision
+//
+// Panels of B (GOLD_KC x GOLD_NC) and blocks of A (GOLD_MC x GOLD_KC) are
+// converted to double and packed into strips of NR columns / MR rows, so the
+// micro-kernel streams both with unit stride and keeps an MR x NR tile of C
+// in registers.  Blocks of A are spread over the host threads, C is summed
+// in a double buffer and rounded to float once at the end.
+////////////////////////////////////////////////////////////////////////////////
+#define GOLD_MC 72          // rows of a block of A (L2), multiple of every MR
+#define GOLD_KC 256         // depth of the packed blocks
+#define GOLD_NC 2048        // columns of a panel of B (L3), multiple of every NR
+#define GOLD_MAX_TILE 48    // largest MR * NR
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+    #define GOLD_USE_SSE2
+    #define GOLD_USE_AVX __attribute__((target("avx,fma")))
+    #include <immintrin.h>
+    static bool goldHasAVX() { return __builtin_cpu_supports("avx") && __builtin_cpu_supports("fma"); }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define GOLD_USE_SSE2
+    #include <emmintrin.h>
+#endif
+
+// Adds A strip (MR values per step) * B strip (NR values per step) over kc steps to C
+typedef void (*GoldKernel)(unsigned int kc, const double* a, const double* b, double* c, unsigned int ldc);
+
+#ifdef GOLD_USE_AVX
+// 6 x 8 tile, 12 accumulators
+#define GOLD_ROW_AVX(r) \
+    { \
+        __m256d ar = _mm256_broadcast_sd(a + r); \
+        c##r##0 = _mm256_fmadd_pd(ar, b0, c##r##0); \
+        c##r##1 = _mm256_fmadd_pd(ar, b1, c##r##1); \
+    }
+#define GOLD_STORE_AVX(r) \
+    { \
+        _mm256_storeu_pd(c + r*ldc, _mm256_add_pd(_mm256_loadu_pd(c + r*ldc), c##r##0)); \
+        _mm256_storeu_pd(c + r*ldc + 4, _mm256_add_pd(_mm256_loadu_pd(c + r*ldc + 4), c##r##1)); \
+    }
+
+GOLD_USE_AVX static void goldKernel_AVX(unsigned int kc, const double* a, const double* b, double* c, unsigned int ldc)
+{
+    __m256d c00 = _mm256_setzero_pd(), c01 = c00, c10 = c00, c11 = c00;
+    __m256d c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+    __m256d c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+
+    for (unsigned int l = 0; l < kc; ++l, a += 6, b += 8)
+    {
+        __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+        GOLD_ROW_AVX(0) GOLD_ROW_AVX(1) GOLD_ROW_AVX(2)
+        GOLD_ROW_AVX(3) GOLD_ROW_AVX(4) GOLD_ROW_AVX(5)
+    }
+
+    GOLD_STORE_AVX(0) GOLD_STORE_AVX(1) GOLD_STORE_AVX(2)
+    GOLD_STORE_AVX(3) GOLD_STORE_AVX(4) GOLD_STORE_AVX(5)
+}
+#endif
+
+#ifdef GOLD_USE_SSE2
+// 4 x 4 tile, 8 accumulators
+#define GOLD_ROW_SSE2(r) \
+    { \
+        __m128d ar = _mm_set1_pd(a[r]); \
+        c##r##0 = _mm_add_pd(c##r##0, _mm_mul_pd(ar, b0)); \
+        c##r##1 = _mm_add_pd(c##r##1, _mm_mul_pd(ar, b1)); \
+    }
+#define GOLD_STORE_SSE2(r) \
+    { \
+        _mm_storeu_pd(c + r*ldc, _mm_add_pd(_mm_loadu_pd(c + r*ldc), c##r##0)); \
+        _mm_storeu_pd(c + r*ldc + 2, _mm_add_pd(_mm_loadu_pd(c + r*ldc + 2), c##r##1)); \
+    }
+
+static void goldKernel_SSE2(unsigned int kc, const double* a, const double* b, double* c, unsigned int ldc)
+{
+    __m128d c00 = _mm_setzero_pd(), c01 = c00, c10 = c00, c11 = c00;
+    __m128d c20 = c00, c21 = c00, c30 = c00, c31 = c00;
+
+    for (unsigned int l = 0; l < kc; ++l, a += 4, b += 4)
+    {
+        __m128d b0 = _mm_loadu_pd(b), b1 = _mm_loadu_pd(b + 2);
+        GOLD_ROW_SSE2(0) GOLD_ROW_SSE2(1) GOLD_ROW_SSE2(2) GOLD_ROW_SSE2(3)
+    }
+
+    GOLD_STORE_SSE2(0) GOLD_STORE_SSE2(1) GOLD_STORE_SSE2(2) GOLD_STORE_SSE2(3)
+}
+#else
+// 4 x 4 tile
+static void goldKernel_Scalar(unsigned int kc, const double* a, const double* b, double* c, unsigned int ldc)
+{
+    double acc[4][4] = {{0}};
+    for (unsigned int l = 0; l < kc; ++l, a += 4, b += 4)
+        for (int r = 0; r < 4; ++r)
+            for (int j = 0; j < 4; ++j)
+                acc[r][j] += a[r] * b[j];
+
+    for (int r = 0; r < 4; ++r)
+        for (int j = 0; j < 4; ++j)
+            c[r*ldc + j] += acc[r][j];
+}
+#endif
+
+struct GoldGemm
+{
+    GoldKernel kernel;
+    unsigned int mr, nr;
+    const float* A;             // hA x wA
+    const float* B;             // wA x wB
+    double* C;                  // hA x wB
+    float* result;
+    unsigned int hA, wA, wB;
+    unsigned int jc, pc;        // origin of the current panel of B
+    unsigned int width, depth;  // extent of the current panel of B
+    double* packedB;
+};
+
+// Convert and pack strips [begin, end) of NR columns of the current panel of B
+static void goldPackB(unsigned int begin, unsigned int end, void* data)
+{
+    GoldGemm* g = (GoldGemm*)data;
+    for (unsigned int s = begin; s < end; ++s)
+    {
+        unsigned int j = s * g->nr;
+        unsigned int w = std::min(g->nr, g->width - j);
+        double* dst = g->packedB + (size_t)s * g->nr * g->depth;
+        for (unsigned int l = 0; l < g->depth; ++l, dst += g->nr)
+        {
+            const float* src = g->B + (size_t)(g->pc + l) * g->wB + g->jc + j;
+            for (unsigned int x = 0; x < w; ++x)
+                dst[x] = src[x];
+            for (unsigned int x = w; x < g->nr; ++x)
+                dst[x] = 0;
+        }
+    }
+}
+
+// Multiply blocks [begin, end) of GOLD_MC rows of A with the current panel of B
+static void goldMultiplyBlocks(unsigned int begin, unsigned int end, void* data)
+{
+    GoldGemm* g = (GoldGemm*)data;
+    std::vector<double> packedA(GOLD_MC * GOLD_KC);
+    double tile[GOLD_MAX_TILE];
+
+    for (unsigned int block = begin; block < end; ++block)
+    {
+        unsigned int i0 = block * GOLD_MC;
+        unsigned int rows = std::min((unsigned int)GOLD_MC, g->hA - i0);
+
+        // convert and pack the block into strips of MR rows
+        double* dst = &packedA[0];
+        for (unsigned int i = 0; i < rows; i += g->mr)
+        {
+            unsigned int h = std::min(g->mr, rows - i);
+            for (unsigned int l = 0; l < g->depth; ++l, dst += g->mr)
+            {
+                for (unsigned int r = 0; r < h; ++r)
+                    dst[r] = g->A[(size_t)(i0 + i + r) * g->wA + g->pc + l];
+                for (unsigned int r = h; r < g->mr; ++r)
+                    dst[r] = 0;
+            }
+        }
+
+        for (unsigned int j = 0; j < g->width; j += g->nr)
+        {
+            unsigned int w = std::min(g->nr, g->width - j);
+            const double* stripB = g->packedB + (size_t)(j / g->nr) * g->nr * g->depth;
+            for (unsigned int i = 0; i < rows; i += g->mr)
+            {
+                unsigned int h = std::min(g->mr, rows - i);
+                const double* stripA = &packedA[0] + (size_t)(i / g->mr) * g->mr * g->depth;
+                double* out = g->C + (size_t)(i0 + i) * g->wB + g->jc + j;
+                if (h == g->mr && w == g->nr)
+                {
+                    g->kernel(g->depth, stripA, stripB, out, g->wB);
+                    continue;
+                }
+
+                // edge: full tile into scratch, add the valid part
+                memset(tile, 0, sizeof(tile));
+                g->kernel(g->depth, stripA, stripB, tile, g->nr);
+                for (unsigned int r = 0; r < h; ++r)
+                    for (unsigned int x = 0; x < w; ++x)
+                        out[(size_t)r * g->wB + x] += tile[r * g->nr + x];
+            }
+        }
+    }
+}
+
+static void goldRoundRows(unsigned int begin, unsigned int end, void* data)
+{
+    GoldGemm* g = (GoldGemm*)data;
+    for (size_t i = (size_t)begin * g->wB; i < (size_t)end * g->wB; ++i)
+    {
+        g->result[i] = (float)g->C[i];
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //! Compute reference data set
 //! C = A * B
@@ -26,14 +228,42 @@ void computeGold( float*, const float*, const float*, unsigned int, unsigned int
 void
 computeGold(float* C, const float* A, const float* B, unsigned int hA, unsigned int wA, unsigned int wB)
 {
-    for (unsigned int i = 0; i < hA; ++i)
-        for (unsigned int j = 0; j < wB; ++j) {
-            double sum = 0;
-            for (unsigned int k = 0; k < wA; ++k) {
-                double a = A[i * wA + k];
-                double b = B[k * wB + j];
-                sum += a * b;
-            }
-            C[i * wB + j] = (float)sum;
+    GoldGemm g;
+    #if defined(GOLD_USE_AVX)
+        bool bAVX = goldHasAVX();
+        g.kernel = bAVX ? goldKernel_AVX : goldKernel_SSE2;
+        g.mr = bAVX ? 6 : 4;
+        g.nr = bAVX ? 8 : 4;
+    #elif defined(GOLD_USE_SSE2)
+        g.kernel = goldKernel_SSE2;
+        g.mr = g.nr = 4;
+    #else
+        g.kernel = goldKernel_Scalar;
+        g.mr = g.nr = 4;
+    #endif
+    g.A = A;
+    g.B = B;
+    g.result = C;
+    g.hA = hA;
+    g.wA = wA;
+    g.wB = wB;
+
+    std::vector<double> sum((size_t)hA * wB, 0.0);
+    std::vector<double> packedB((size_t)(std::min((unsigned int)GOLD_NC, wB) + g.nr) * std::min((unsigned int)GOLD_KC, wA) + 1);
+    g.C = sum.empty() ? NULL : &sum[0];
+    g.packedB = &packedB[0];
+
+    unsigned int numBlocks = (hA + GOLD_MC - 1) / GOLD_MC;
+    for (g.jc = 0; g.jc < wB; g.jc += GOLD_NC)
+    {
+        g.width = std::min((unsigned int)GOLD_NC, wB - g.jc);
+        for (g.pc = 0; g.pc < wA; g.pc += GOLD_KC)
+        {
+            g.depth = std::min((unsigned int)GOLD_KC, wA - g.pc);
+            shrParallelFor(0, (g.width + g.nr - 1) / g.nr, 0, goldPackB, &g);
+            shrParallelFor(0, numBlocks, 1, goldMultiplyBlocks, &g);
         }
+    }
+
+    shrParallelFor(0, hA, 0, goldRoundRows, &g);
 }
@@ -12,39 +12,370 @@
 
 
 #include "multithreading.h"
+#include <stdlib.h>
 
 #if _WIN32
-    //Create thread
-    CUTThread cutStartThread(CUT_THREADROUTINE func, void *data){
-        return CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)func, data, 0, NULL);
+    typedef CRITICAL_SECTION CUTMutex;
+    typedef CONDITION_VARIABLE CUTCond;
+
+    #define cutMutexInit(m)     InitializeCriticalSection(m)
+    #define cutMutexLock(m)     EnterCriticalSection(m)
+    #define cutMutexUnlock(m)   LeaveCriticalSection(m)
+    #define cutCondInit(c)      InitializeConditionVariable(c)
+    #define cutCondWait(c, m)   SleepConditionVariableCS(c, m, INFINITE)
+    #define cutCondTimedWait(c, m, ms) (SleepConditionVariableCS(c, m, ms) != 0)
+    #define cutCondSignal(c)    WakeConditionVariable(c)
+    #define cutCondBroadcast(c) WakeAllConditionVariable(c)
+    #define cutCpuRelax()       YieldProcessor()
+
+    static int cutNumCPUs() {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (int)info.dwNumberOfProcessors;
     }
+#else
+    #include <unistd.h>
+    #if defined(__linux__)
+        #include <sched.h>
+        #include <limits.h>
+        #include <sys/syscall.h>
+        #include <linux/futex.h>
+    #endif
+    #include <sys/time.h>
+
+    typedef pthread_mutex_t CUTMutex;
+    typedef pthread_cond_t CUTCond;
 
-    //Wait for thread to finish
-    void cutEndThread(CUTThread thread){
-        WaitForSingleObject(thread, INFINITE);
-        CloseHandle(thread);
+    #define cutMutexInit(m)     pthread_mutex_init(m, NULL)
+    #define cutMutexLock(m)     pthread_mutex_lock(m)
+    #define cutMutexUnlock(m)   pthread_mutex_unlock(m)
+    #define cutCondInit(c)      pthread_cond_init(c, NULL)
+    #define cutCondWait(c, m)   pthread_cond_wait(c, m)
+    #define cutCondSignal(c)    pthread_cond_signal(c)
+    #define cutCondBroadcast(c) pthread_cond_broadcast(c)
+    #if defined(__i386__) || defined(__x86_64__)
+        #define cutCpuRelax()   __asm__ __volatile__("pause" ::: "memory")
+    #else
+        #define cutCpuRelax()   __asm__ __volatile__("" ::: "memory")
+    #endif
+
+    static int cutNumCPUs() {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        return (n > 0) ? (int)n : 1;
     }
 
-    //Destroy thread
-    void cutDestroyThread(CUTThread thread){
-        TerminateThread(thread, 0);
-        CloseHandle(thread);
+    //Returns false if ms elapsed without a signal.
+    static bool cutCondTimedWait(pthread_cond_t *c, pthread_mutex_t *m, int ms) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        long long ns = (long long)now.tv_usec * 1000 + (long long)ms * 1000000;
+        struct timespec deadline;
+        deadline.tv_sec = now.tv_sec + (time_t)(ns / 1000000000);
+        deadline.tv_nsec = (long)(ns % 1000000000);
+        return pthread_cond_timedwait(c, m, &deadline) == 0;
     }
+#endif
 
-    //Wait for multiple threads
-    void cutWaitForThreads(const CUTThread * threads, int num){
-        WaitForMultipleObjects(num, threads, true, INFINITE);
 
-        for(int i = 0; i < num; i++)
-            CloseHandle(threads[i]);
-    }
+////////////////////////////////////////////////////////////////////////////////
+// Thread pool
+////////////////////////////////////////////////////////////////////////////////
+enum CUTTaskState { CUT_TASK_QUEUED, CUT_TASK_RUNNING, CUT_TASK_DONE, CUT_TASK_CANCELLED };
 
+struct CUTTask {
+	CUT_THREADROUTINE func;
+	void *data;
+	int cpu;
+	int state;
+	int refs;           //one for the pool until the routine is done, one for the handle
+	CUTTask *next;
+};
+
+static struct CUTPool {
+	CUTMutex mutex;
+	CUTCond workAvailable;
+	CUTCond taskDone;
+	CUTTask *head, *tail;
+	int queued;
+	int idle;
+	int workers;
+	int keepWorkers;    //workers started by cutInitThreadPool, exempt from the idle timeout
+	bool shutdown;
+	CUTTask *freeList;  //recycled task records
+} pool;
+
+static void cutPoolInit() {
+	cutMutexInit(&pool.mutex);
+	cutCondInit(&pool.workAvailable);
+	cutCondInit(&pool.taskDone);
+}
+
+#if _WIN32
+	static INIT_ONCE poolOnce = INIT_ONCE_STATIC_INIT;
+	static BOOL CALLBACK cutPoolInitOnce(PINIT_ONCE, PVOID, PVOID *) {
+		cutPoolInit();
+		return TRUE;
+	}
+#else
+	static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+#endif
+
+static void cutPoolStart() {
+#if _WIN32
+	InitOnceExecuteOnce(&poolOnce, cutPoolInitOnce, NULL, NULL);
+#else
+	pthread_once(&poolOnce, cutPoolInit);
+#endif
+}
+
+//Drops one reference, pool mutex held.
+static void cutReleaseTask(CUTTask *task) {
+	if( --task->refs == 0 ) {
+		task->next = pool.freeList;
+		pool.freeList = task;
+	}
+}
+
+//Pins the calling worker to cpu, or restores its original affinity for CUT_ANY_CPU.
+#if _WIN32
+	static void cutSetWorkerAffinity(int cpu, DWORD_PTR originalMask) {
+		SetThreadAffinityMask(GetCurrentThread(), (cpu == CUT_ANY_CPU) ? originalMask : ((DWORD_PTR)1 << (cpu % (8 * sizeof(DWORD_PTR)))));
+	}
+#elif defined(__linux__)
+	static void cutSetWorkerAffinity(int cpu, const cpu_set_t &originalMask) {
+		if( cpu == CUT_ANY_CPU ) {
+			pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &originalMask);
+		} else {
+			cpu_set_t mask;
+			CPU_ZERO(&mask);
+			CPU_SET(cpu % CPU_SETSIZE, &mask);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &mask);
+		}
+	}
+#endif
+
+//Worker loop: take the next job, run it, repeat.  Workers beyond keepWorkers
+//exit after CUT_WORKER_IDLE_MS without a job, all of them on shutdown once the queue is empty.
+static void cutWorkerLoop() {
+#if _WIN32
+	DWORD_PTR originalMask = SetThreadAffinityMask(GetCurrentThread(), ~(DWORD_PTR)0);
+	SetThreadAffinityMask(GetCurrentThread(), originalMask);
+#elif defined(__linux__)
+	cpu_set_t originalMask;
+	pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &originalMask);
+#endif
+	bool bPinned = false;
+
+	cutMutexLock(&pool.mutex);
+	for(;;) {
+		bool bRetire = false;
+		while( pool.head == NULL && !bRetire ) {
+			if( pool.shutdown ) {
+				bRetire = true;
+				break;
+			}
+			++pool.idle;
+			bool bSignaled = cutCondTimedWait(&pool.workAvailable, &pool.mutex, CUT_WORKER_IDLE_MS);
+			--pool.idle;
+			bRetire = !bSignaled && pool.head == NULL && pool.workers > pool.keepWorkers;
+		}
+		if( bRetire ) {
+			--pool.workers;
+			cutCondBroadcast(&pool.taskDone);
+			cutMutexUnlock(&pool.mutex);
+			return;
+		}
+
+		CUTTask *task = pool.head;
+		pool.head = task->next;
+		if( pool.head == NULL ) pool.tail = NULL;
+		--pool.queued;
+
+		if( task->state == CUT_TASK_CANCELLED ) {
+			cutReleaseTask(task);
+			continue;
+		}
+		task->state = CUT_TASK_RUNNING;
+		cutMutexUnlock(&pool.mutex);
+
+		if( task->cpu != CUT_ANY_CPU || bPinned ) {
+#if _WIN32 || defined(__linux__)
+			cutSetWorkerAffinity(task->cpu, originalMask);
+#endif
+			bPinned = (task->cpu != CUT_ANY_CPU);
+		}
+		task->func(task->data);
+
+		cutMutexLock(&pool.mutex);
+		task->state = CUT_TASK_DONE;
+		cutReleaseTask(task);
+		cutCondBroadcast(&pool.taskDone);
+	}
+}
+
+#if _WIN32
+	static DWORD WINAPI cutWorker(LPVOID) {
+		cutWorkerLoop();
+		return 0;
+	}
+#else
+	static void *cutWorker(void *) {
+		cutWorkerLoop();
+		return NULL;
+	}
+#endif
+
+//Spawns a detached worker, pool mutex held.
+static void cutSpawnWorker() {
+#if _WIN32
+	HANDLE thread = CreateThread(NULL, 0, cutWorker, NULL, 0, NULL);
+	if( thread != NULL ) {
+		CloseHandle(thread);
+		++pool.workers;
+	}
+#else
+	pthread_t thread;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if( pthread_create(&thread, &attr, cutWorker, NULL) == 0 ) {
+		++pool.workers;
+	}
+	pthread_attr_destroy(&attr);
+#endif
+}
+
+void cutInitThreadPool(int numThreads) {
+	cutPoolStart();
+	cutMutexLock(&pool.mutex);
+	pool.keepWorkers = (numThreads > pool.keepWorkers) ? numThreads : pool.keepWorkers;
+	while( pool.workers < numThreads ) {
+		int workers = pool.workers;
+		cutSpawnWorker();
+		if( pool.workers == workers ) break;
+	}
+	cutMutexUnlock(&pool.mutex);
+}
+
+void cutShutdownThreadPool() {
+	cutPoolStart();
+	cutMutexLock(&pool.mutex);
+	pool.shutdown = true;
+	cutCondBroadcast(&pool.workAvailable);
+	while( pool.workers > 0 ) {
+		cutCondWait(&pool.taskDone, &pool.mutex);
+	}
+	pool.shutdown = false;
+	pool.keepWorkers = 0;
+
+	while( pool.freeList != NULL ) {
+		CUTTask *task = pool.freeList;
+		pool.freeList = task->next;
+		free(task);
+	}
+	cutMutexUnlock(&pool.mutex);
+}
+
+//Create thread pinned to a CPU
+CUTThread cutStartThreadOnCPU(CUT_THREADROUTINE func, void *data, int cpu) {
+	cutPoolStart();
+	cutMutexLock(&pool.mutex);
+
+	CUTTask *task = pool.freeList;
+	if( task != NULL ) {
+		pool.freeList = task->next;
+	} else {
+		task = (CUTTask *)malloc(sizeof(CUTTask));
+		if( task == NULL ) {
+			cutMutexUnlock(&pool.mutex);
+			return NULL;
+		}
+	}
+	task->func = func;
+	task->data = data;
+	task->cpu = cpu;
+	task->state = CUT_TASK_QUEUED;
+	task->refs = 2;
+	task->next = NULL;
+
+	if( pool.tail != NULL ) pool.tail->next = task; else pool.head = task;
+	pool.tail = task;
+	++pool.queued;
+
+	//Every routine must start right away (it may wait on another one), so grow when nobody is free
+	if( pool.queued > pool.idle ) {
+		cutSpawnWorker();
+	}
+	cutCondSignal(&pool.workAvailable);
+
+	cutMutexUnlock(&pool.mutex);
+	return task;
+}
+
+//Create thread
+CUTThread cutStartThread(CUT_THREADROUTINE func, void *data) {
+	return cutStartThreadOnCPU(func, data, CUT_ANY_CPU);
+}
+
+//Wait for thread to finish
+void cutEndThread(CUTThread thread) {
+	if( thread == NULL ) return;
+	cutMutexLock(&pool.mutex);
+	while( thread->state != CUT_TASK_DONE ) {
+		cutCondWait(&pool.taskDone, &pool.mutex);
+	}
+	cutReleaseTask(thread);
+	cutMutexUnlock(&pool.mutex);
+}
+
+//Release the handle without waiting
+void cutDetachThread(CUTThread thread) {
+	if( thread == NULL ) return;
+	cutMutexLock(&pool.mutex);
+	cutReleaseTask(thread);
+	cutMutexUnlock(&pool.mutex);
+}
+
+//Destroy thread
+void cutDestroyThread(CUTThread thread) {
+	if( thread == NULL ) return;
+	cutMutexLock(&pool.mutex);
+	if( thread->state == CUT_TASK_QUEUED ) {
+		thread->state = CUT_TASK_CANCELLED;
+	}
+	cutReleaseTask(thread);
+	cutMutexUnlock(&pool.mutex);
+}
+
+//Wait for multiple threads
+void cutWaitForThreads(const CUTThread * threads, int num) {
+	for(int i = 0; i < num; i++)
+		cutEndThread(threads[i]);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Barrier
+////////////////////////////////////////////////////////////////////////////////
+//Spins until released or the budget runs out, returns true if released.
+static bool cutSpinOnBarrier(CUTBarrier *barrier) {
+	static int numCPUs = 0;
+	if( numCPUs == 0 ) numCPUs = cutNumCPUs();
+	if( numCPUs == 1 ) return barrier->count >= barrier->releaseCount;
+
+	for( int i = 0; i < CUT_BARRIER_SPIN; ++i ) {
+		if( barrier->count >= barrier->releaseCount ) return true;
+		cutCpuRelax();
+	}
+	return barrier->count >= barrier->releaseCount;
+}
+
+#if _WIN32
 	//Create barrier.
 	CUTBarrier cutCreateBarrier(int releaseCount) {
 		CUTBarrier barrier;
 
-		InitializeCriticalSection(&barrier.criticalSection);
-		barrier.barrierEvent = CreateEvent(NULL, TRUE, FALSE, TEXT("BarrierEvent"));
+		barrier.barrierEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
 		barrier.count = 0;
 		barrier.releaseCount = releaseCount;
 
@@ -53,56 +384,31 @@
 
 	//Increment barrier. (excution continues)
 	void cutIncrementBarrier(CUTBarrier* barrier) {
-		int myBarrierCount;
-		EnterCriticalSection(&barrier->criticalSection);
-		myBarrierCount = ++barrier->count;
-		LeaveCriticalSection(&barrier->criticalSection);
-
-		if( myBarrierCount >= barrier->releaseCount ) {
+		if( InterlockedIncrement(&barrier->count) == barrier->releaseCount ) {
 			SetEvent(barrier->barrierEvent);
 		}
 	}
 
 	//Wait for barrier release.
 	void cutWaitForBarrier(CUTBarrier* barrier) {
-		WaitForSingleObject(barrier->barrierEvent, INFINITE);
+		if( !cutSpinOnBarrier(barrier) ) {
+			WaitForSingleObject(barrier->barrierEvent, INFINITE);
+		}
 	}
 
 	//Destory barrier
 	void cutDestroyBarrier(CUTBarrier* barrier) {
-		
+		CloseHandle(barrier->barrierEvent);
 	}
 
 
 #else
-    //Create thread
-    CUTThread cutStartThread(CUT_THREADROUTINE func, void * data){
-        pthread_t thread;
-        pthread_create(&thread, NULL, func, data);
-        return thread;
-    }
-
-    //Wait for thread to finish
-    void cutEndThread(CUTThread thread){
-        pthread_join(thread, NULL);
-    }
-
-    //Destroy thread
-    void cutDestroyThread(CUTThread thread){
-        pthread_cancel(thread);
-    }
-
-    //Wait for multiple threads
-    void cutWaitForThreads(const CUTThread * threads, int num){
-        for(int i = 0; i < num; i++)
-            cutEndThread(threads[i]);
-    }
-
 	//Create barrier.
 	CUTBarrier cutCreateBarrier(int releaseCount) {
 		CUTBarrier barrier;
 
 		barrier.count = 0;
+		barrier.waiters = 0;
 		barrier.releaseCount = releaseCount;
 
 		pthread_mutex_init(&barrier.mutex, 0);
@@ -113,23 +419,38 @@
 	}
 
 	//Increment barrier. (excution continues)
+	//The full fences of the atomic add here and in the waiter registration
+	//guarantee that either the incrementer sees the waiter or the waiter sees the count.
 	void cutIncrementBarrier(CUTBarrier* barrier) {
-		int myBarrierCount;
-		pthread_mutex_lock(&barrier->mutex);
-		myBarrierCount = ++barrier->count;
-		pthread_mutex_unlock(&barrier->mutex);
-	
-		if( myBarrierCount >=barrier->releaseCount ) {
-			pthread_cond_signal(&barrier->conditionVariable);
+		int myBarrierCount = __sync_add_and_fetch(&barrier->count, 1);
+
+		if( myBarrierCount == barrier->releaseCount && barrier->waiters > 0 ) {
+#if defined(__linux__)
+			syscall(SYS_futex, &barrier->count, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+			pthread_mutex_lock(&barrier->mutex);
+			pthread_cond_broadcast(&barrier->conditionVariable);
+			pthread_mutex_unlock(&barrier->mutex);
+#endif
 		}
 	}
 
 	//Wait for barrier release.
 	void cutWaitForBarrier(CUTBarrier* barrier) {
+		if( cutSpinOnBarrier(barrier) ) return;
+
+		__sync_fetch_and_add(&barrier->waiters, 1);
+#if defined(__linux__)
+		int count;
+		while( (count = barrier->count) < barrier->releaseCount )
+			syscall(SYS_futex, &barrier->count, FUTEX_WAIT_PRIVATE, count, NULL, NULL, 0);
+#else
 		pthread_mutex_lock(&barrier->mutex);
 		while(barrier->count < barrier->releaseCount)
 		  pthread_cond_wait(&barrier->conditionVariable, &barrier->mutex);
 		pthread_mutex_unlock(&barrier->mutex);
+#endif
+		__sync_fetch_and_sub(&barrier->waiters, 1);
 	}
 
 	//Destory barrier
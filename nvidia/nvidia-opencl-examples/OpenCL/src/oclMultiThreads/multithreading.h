@@ -14,19 +14,37 @@
 
 
 //Simple portable thread library.
+//
+//cutStartThread() does not create an OS thread per call: routines run on a
+//persistent pool of worker threads that grows on demand (a started routine
+//never waits for another one to finish, so blocking routines are fine) and
+//idles on a condition variable between jobs.  Workers beyond those started by
+//cutInitThreadPool exit after CUT_WORKER_IDLE_MS without a job, and
+//cutShutdownThreadPool stops all of them.  A CUTThread is a handle to the
+//job, not to the worker.
+//
+//CUTBarrier spins briefly before sleeping (on a futex on Linux), so releases
+//that arrive within a few microseconds never pay for a kernel wakeup.
+
+//Pass as cpu to cutStartThreadOnCPU() to leave the worker unpinned.
+#define CUT_ANY_CPU -1
+
+//Spin iterations before a barrier waiter sleeps (skipped on single-CPU systems).
+#define CUT_BARRIER_SPIN 4000
+
+//Idle time after which a worker grown on demand exits.
+#define CUT_WORKER_IDLE_MS 5000
 
 #if _WIN32
     //Windows threads.
     #include <windows.h>
 
-    typedef HANDLE CUTThread;
     typedef unsigned (WINAPI *CUT_THREADROUTINE)(void *);
 
 	struct CUTBarrier {
-		CRITICAL_SECTION criticalSection;
 		HANDLE barrierEvent;
 		int releaseCount;
-		int count;
+		volatile LONG count;
 	};
 
     #define CUT_THREADPROC unsigned WINAPI
@@ -36,33 +54,48 @@
     //POSIX threads.
     #include <pthread.h>
 
-    typedef pthread_t CUTThread;
     typedef void *(*CUT_THREADROUTINE)(void *);
 
     #define CUT_THREADPROC void*
-    #define  CUT_THREADEND 
+    #define  CUT_THREADEND return NULL
 
 	struct CUTBarrier {
-		pthread_mutex_t mutex;
+		pthread_mutex_t mutex;              //sleep path on systems without futexes
 		pthread_cond_t conditionVariable;
 		int releaseCount;
-		int count;
+		volatile int count;
+		volatile int waiters;
 	};
 
 #endif
 
+//Handle to a routine started on the thread pool.
+typedef struct CUTTask *CUTThread;
+
 
 #ifdef __cplusplus
     extern "C" {
 #endif
 
-//Create thread.
+//Start the pool with numThreads idle workers (optional, avoids creation cost on first use).
+void cutInitThreadPool(int numThreads);
+
+//Wait for queued and running routines, then stop every worker. (the pool starts again on the next call)
+void cutShutdownThreadPool(void);
+
+//Create thread. (NULL if out of memory, the other functions accept NULL)
 CUTThread cutStartThread(CUT_THREADROUTINE, void *data);
 
+//Create thread pinned to a CPU for the duration of the routine (CUT_ANY_CPU for no affinity).
+CUTThread cutStartThreadOnCPU(CUT_THREADROUTINE, void *data, int cpu);
+
 //Wait for thread to finish.
 void cutEndThread(CUTThread thread);
 
-//Destroy thread.
+//Release the handle without waiting, the routine keeps running.
+void cutDetachThread(CUTThread thread);
+
+//Destroy thread. (a routine that has not started yet is dropped, a running one is detached)
 void cutDestroyThread(CUTThread thread);
 
 //Wait for multiple threads.
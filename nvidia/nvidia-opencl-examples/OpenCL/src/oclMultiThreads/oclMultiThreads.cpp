@@ -169,7 +169,7 @@ CALLBACK_FUNC event_callback(cl_event event, cl_int event_command_exec_status, v
         printf("\t> event_callback() event_id=%d, kernel runtime %f (ms)\n", ((cpu_worker_arg_t *)user_data)->id, run_time*1.0e-6);
     }
 
-    cutStartThread(&cpu_postprocess, user_data);
+    cutDetachThread(cutStartThread(&cpu_postprocess, user_data));
 }
 
 // returns the time it took to run the test
@@ -209,7 +209,7 @@ void launch_hybrid_workload(cl_context context, cl_device_id device,
 	}
 
 	// Launch CPU thread to start the heterogneous workload
-	cutStartThread(&cpu_preprocess, (void*) arg);
+	cutDetachThread(cutStartThread(&cpu_preprocess, (void*) arg));
 
 	// Upload data to GPU.
 	ciErrNum = clEnqueueWriteBuffer(queue, buffer, CL_FALSE, 0, buffer_size, arg->data_fp, 1, &arg->user_event, 0);
@@ -352,7 +352,7 @@ cl_int launch_hybrid_matrixMultiply(cl_context context,
 	arg->user_event = clCreateUserEvent(context, &ciErrNum);	
 
 	// Launch CPU thread to start the heterogneous workload
-	cutStartThread(&cpu_preprocess, (void*) arg);
+	cutDetachThread(cutStartThread(&cpu_preprocess, (void*) arg));
 
     // Copy only assigned rows (h_A) from CPU host to GPU device    
     ciErrNum = clEnqueueCopyBuffer(commandQueue, 
@@ -487,6 +487,7 @@ int main(int argc, char** argv)
 
 	// start the logs
     shrSetLogFileName ("oclMultiThreads.txt");
+    shrSetLogAsync(true);   // worker threads log without waiting on console and file I/O
 
 #ifdef _WIN32
 	// we are detecting what Windows OS is being used, as the Windows threading types requires Windows Vista/7
@@ -596,6 +597,9 @@ int main(int argc, char** argv)
 ////////////////////////////////////////////////////////////////////////////////
 	barrier = cutCreateBarrier(N);
 
+	// Pre-spawn the pool workers for the pre- and post-processing routines of every workload
+	cutInitThreadPool(2 * N);
+
 #if 0
     compileOCLKernel(cxGPUContext, cdDevices[0], "matrixMul.cl", &program[0], argv);
 
@@ -625,6 +629,7 @@ int main(int argc, char** argv)
 
 	// Wait until all work is done by both CPU & GPU(s)
 	cutWaitForBarrier(&barrier);
+	cutShutdownThreadPool();
 
 	// Cleanup
 
@@ -26,6 +26,10 @@
             virtual void setSoftening(float softening) { m_softeningSquared = softening * softening; }
             virtual void setDamping(float damping)     { m_damping = damping; }
 
+            // Barnes-Hut opening angle: cells seen under a smaller angle act 
+            // as a point mass.  0 (default) sums all pairs exactly
+            void setOpeningAngle(float theta)          { m_theta = theta; }
+
             virtual float* getArray(BodyArray array);
             virtual void   setArray(BodyArray array, const float* data);
 
@@ -38,15 +42,19 @@
             virtual void _finalize();
 
             void _computeNBodyGravitation();
+            void _computeBarnesHutGravitation();
             void _integrateNBodySystem(float deltaTime);
             
         protected: // data
             float* m_pos[2];
             float* m_vel[2];
             float* m_force;
+            float* m_soa;       // x | y | z copy of the positions for the vectorized sum
+            int m_numPadded;    // length of each m_soa array
 
             float m_softeningSquared;
             float m_damping;
+            float m_theta;
 
             unsigned int m_currentRead;
             unsigned int m_currentWrite;
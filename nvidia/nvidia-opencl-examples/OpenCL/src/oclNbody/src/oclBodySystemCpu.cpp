@@ -13,12 +13,19 @@
 #include <oclUtils.h>
 #include <memory.h>
 #include <algorithm>
+#include <vector>
+
+#define NBODY_TASK_TARGETS 64      // targets per task, SoA arrays are padded to this
+#define NBODY_TILE_SOURCES 2048    // sources per tile (24 KB of x, y, z)
 
 BodySystemCPU::BodySystemCPU(int numBodies)
 : BodySystem(numBodies),
   m_force(0),
+  m_soa(0),
+  m_numPadded(0),
   m_softeningSquared(.00125f),
   m_damping(0.995f),
+  m_theta(0.0f),
   m_currentRead(0),
   m_currentWrite(0)
 {
@@ -46,11 +53,16 @@ void BodySystemCPU::_initialize(int numBodies)
     m_vel[1] = new float[m_numBodies*4];
     m_force  = new float[m_numBodies*4];
 
+    // whole tasks for the vectorized _computeNBodyGravitation
+    m_numPadded = (m_numBodies + NBODY_TASK_TARGETS - 1) / NBODY_TASK_TARGETS * NBODY_TASK_TARGETS;
+    m_soa    = new float[m_numPadded*3];
+
     memset(m_pos[0], 0, m_numBodies*4*sizeof(float));
     memset(m_pos[1], 0, m_numBodies*4*sizeof(float));
     memset(m_vel[0], 0, m_numBodies*4*sizeof(float));
     memset(m_vel[1], 0, m_numBodies*4*sizeof(float));
     memset(m_force, 0, m_numBodies*4*sizeof(float));
+    memset(m_soa, 0, m_numPadded*3*sizeof(float));
 
     m_bInitialized = true;
 }
@@ -64,6 +76,7 @@ void BodySystemCPU::_finalize()
     delete [] m_vel[0];
     delete [] m_vel[1];
     delete [] m_force;
+    delete [] m_soa;
 }
 
 void BodySystemCPU::update(float deltaTime)
@@ -119,23 +132,592 @@ extern void normalize(float vector[3]);
 extern void bodyBodyInteraction(float accel[3], float posMass0[4], float posMass1[4], 
 				float softeningSquared);
 
+////////////////////////////////////////////////////////////////////////////////
+// Vectorized all-pairs gravitation
+//
+// Positions are copied to a structure of arrays (x | y | z, padded to whole 
+// tasks).  A task takes NBODY_TASK_TARGETS targets in vector lanes, two 
+// vectors at a time, and sweeps the sources in L1-sized tiles, broadcasting
+// one source per step.  1/sqrt comes from the hardware approximation plus one
+// Newton-Raphson step.  Sums differ from the scalar loop only by rounding.
+////////////////////////////////////////////////////////////////////////////////
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+    #define NBODY_USE_SSE
+    #define NBODY_USE_AVX __attribute__((target("avx,fma")))
+    #include <immintrin.h>
+    static bool nbodyHasAVX() { return __builtin_cpu_supports("avx") && __builtin_cpu_supports("fma"); }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define NBODY_USE_SSE
+    #include <emmintrin.h>
+#endif
+
+struct NBodyGravity
+{
+    const float* soa;           // x, y, z of the bodies, numPadded each
+    const float* posMass;       // interleaved positions (mass of the targets)
+    float* force;
+    unsigned int numBodies;
+    unsigned int numPadded;
+    float softeningSquared;
+};
+
+#ifdef NBODY_USE_AVX
+NBODY_USE_AVX static void gravityTask_AVX(const NBodyGravity* g, unsigned int first, float* acc)
+{
+    const float* x = g->soa + first;
+    const float* y = x + g->numPadded;
+    const float* z = y + g->numPadded;
+    const __m256 eps = _mm256_set1_ps(g->softeningSquared);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+
+    for (unsigned int j0 = 0; j0 < g->numBodies; j0 += NBODY_TILE_SOURCES)
+    {
+        unsigned int j1 = std::min(j0 + NBODY_TILE_SOURCES, g->numBodies);
+        for (unsigned int t = 0; t < NBODY_TASK_TARGETS; t += 16)
+        {
+            __m256 xi0 = _mm256_loadu_ps(x + t), xi1 = _mm256_loadu_ps(x + t + 8);
+            __m256 yi0 = _mm256_loadu_ps(y + t), yi1 = _mm256_loadu_ps(y + t + 8);
+            __m256 zi0 = _mm256_loadu_ps(z + t), zi1 = _mm256_loadu_ps(z + t + 8);
+            __m256 ax0 = _mm256_loadu_ps(acc + t), ax1 = _mm256_loadu_ps(acc + t + 8);
+            __m256 ay0 = _mm256_loadu_ps(acc + NBODY_TASK_TARGETS + t), ay1 = _mm256_loadu_ps(acc + NBODY_TASK_TARGETS + t + 8);
+            __m256 az0 = _mm256_loadu_ps(acc + 2*NBODY_TASK_TARGETS + t), az1 = _mm256_loadu_ps(acc + 2*NBODY_TASK_TARGETS + t + 8);
+
+            for (unsigned int j = j0; j < j1; ++j)
+            {
+                __m256 xj = _mm256_broadcast_ss(g->soa + j);
+                __m256 yj = _mm256_broadcast_ss(g->soa + g->numPadded + j);
+                __m256 zj = _mm256_broadcast_ss(g->soa + 2*g->numPadded + j);
+
+                __m256 dx0 = _mm256_sub_ps(xj, xi0), dx1 = _mm256_sub_ps(xj, xi1);
+                __m256 dy0 = _mm256_sub_ps(yj, yi0), dy1 = _mm256_sub_ps(yj, yi1);
+                __m256 dz0 = _mm256_sub_ps(zj, zi0), dz1 = _mm256_sub_ps(zj, zi1);
+                __m256 d0 = _mm256_fmadd_ps(dz0, dz0, _mm256_fmadd_ps(dy0, dy0, _mm256_fmadd_ps(dx0, dx0, eps)));
+                __m256 d1 = _mm256_fmadd_ps(dz1, dz1, _mm256_fmadd_ps(dy1, dy1, _mm256_fmadd_ps(dx1, dx1, eps)));
+
+                // invDist = r * (1.5 - 0.5 * d * r * r), r ~ 1/sqrt(d)
+                __m256 r0 = _mm256_rsqrt_ps(d0), r1 = _mm256_rsqrt_ps(d1);
+                r0 = _mm256_mul_ps(r0, _mm256_fnmadd_ps(_mm256_mul_ps(half, d0), _mm256_mul_ps(r0, r0), threeHalves));
+                r1 = _mm256_mul_ps(r1, _mm256_fnmadd_ps(_mm256_mul_ps(half, d1), _mm256_mul_ps(r1, r1), threeHalves));
+                __m256 s0 = _mm256_mul_ps(r0, _mm256_mul_ps(r0, r0));
+                __m256 s1 = _mm256_mul_ps(r1, _mm256_mul_ps(r1, r1));
+
+                ax0 = _mm256_fmadd_ps(dx0, s0, ax0); ax1 = _mm256_fmadd_ps(dx1, s1, ax1);
+                ay0 = _mm256_fmadd_ps(dy0, s0, ay0); ay1 = _mm256_fmadd_ps(dy1, s1, ay1);
+                az0 = _mm256_fmadd_ps(dz0, s0, az0); az1 = _mm256_fmadd_ps(dz1, s1, az1);
+            }
+
+            _mm256_storeu_ps(acc + t, ax0); _mm256_storeu_ps(acc + t + 8, ax1);
+            _mm256_storeu_ps(acc + NBODY_TASK_TARGETS + t, ay0); _mm256_storeu_ps(acc + NBODY_TASK_TARGETS + t + 8, ay1);
+            _mm256_storeu_ps(acc + 2*NBODY_TASK_TARGETS + t, az0); _mm256_storeu_ps(acc + 2*NBODY_TASK_TARGETS + t + 8, az1);
+        }
+    }
+}
+#endif
+
+#ifdef NBODY_USE_SSE
+static void gravityTask_SSE(const NBodyGravity* g, unsigned int first, float* acc)
+{
+    const float* x = g->soa + first;
+    const float* y = x + g->numPadded;
+    const float* z = y + g->numPadded;
+    const __m128 eps = _mm_set1_ps(g->softeningSquared);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+
+    for (unsigned int j0 = 0; j0 < g->numBodies; j0 += NBODY_TILE_SOURCES)
+    {
+        unsigned int j1 = std::min(j0 + NBODY_TILE_SOURCES, g->numBodies);
+        for (unsigned int t = 0; t < NBODY_TASK_TARGETS; t += 8)
+        {
+            __m128 xi0 = _mm_loadu_ps(x + t), xi1 = _mm_loadu_ps(x + t + 4);
+            __m128 yi0 = _mm_loadu_ps(y + t), yi1 = _mm_loadu_ps(y + t + 4);
+            __m128 zi0 = _mm_loadu_ps(z + t), zi1 = _mm_loadu_ps(z + t + 4);
+            __m128 ax0 = _mm_loadu_ps(acc + t), ax1 = _mm_loadu_ps(acc + t + 4);
+            __m128 ay0 = _mm_loadu_ps(acc + NBODY_TASK_TARGETS + t), ay1 = _mm_loadu_ps(acc + NBODY_TASK_TARGETS + t + 4);
+            __m128 az0 = _mm_loadu_ps(acc + 2*NBODY_TASK_TARGETS + t), az1 = _mm_loadu_ps(acc + 2*NBODY_TASK_TARGETS + t + 4);
+
+            for (unsigned int j = j0; j < j1; ++j)
+            {
+                __m128 xj = _mm_set1_ps(g->soa[j]);
+                __m128 yj = _mm_set1_ps(g->soa[g->numPadded + j]);
+                __m128 zj = _mm_set1_ps(g->soa[2*g->numPadded + j]);
+
+                __m128 dx0 = _mm_sub_ps(xj, xi0), dx1 = _mm_sub_ps(xj, xi1);
+                __m128 dy0 = _mm_sub_ps(yj, yi0), dy1 = _mm_sub_ps(yj, yi1);
+                __m128 dz0 = _mm_sub_ps(zj, zi0), dz1 = _mm_sub_ps(zj, zi1);
+                __m128 d0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx0, dx0), _mm_mul_ps(dy0, dy0)), _mm_add_ps(_mm_mul_ps(dz0, dz0), eps));
+                __m128 d1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx1, dx1), _mm_mul_ps(dy1, dy1)), _mm_add_ps(_mm_mul_ps(dz1, dz1), eps));
+
+                // invDist = r * (1.5 - 0.5 * d * r * r), r ~ 1/sqrt(d)
+                __m128 r0 = _mm_rsqrt_ps(d0), r1 = _mm_rsqrt_ps(d1);
+                r0 = _mm_mul_ps(r0, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, d0), _mm_mul_ps(r0, r0))));
+                r1 = _mm_mul_ps(r1, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, d1), _mm_mul_ps(r1, r1))));
+                __m128 s0 = _mm_mul_ps(r0, _mm_mul_ps(r0, r0));
+                __m128 s1 = _mm_mul_ps(r1, _mm_mul_ps(r1, r1));
+
+                ax0 = _mm_add_ps(ax0, _mm_mul_ps(dx0, s0)); ax1 = _mm_add_ps(ax1, _mm_mul_ps(dx1, s1));
+                ay0 = _mm_add_ps(ay0, _mm_mul_ps(dy0, s0)); ay1 = _mm_add_ps(ay1, _mm_mul_ps(dy1, s1));
+                az0 = _mm_add_ps(az0, _mm_mul_ps(dz0, s0)); az1 = _mm_add_ps(az1, _mm_mul_ps(dz1, s1));
+            }
+
+            _mm_storeu_ps(acc + t, ax0); _mm_storeu_ps(acc + t + 4, ax1);
+            _mm_storeu_ps(acc + NBODY_TASK_TARGETS + t, ay0); _mm_storeu_ps(acc + NBODY_TASK_TARGETS + t + 4, ay1);
+            _mm_storeu_ps(acc + 2*NBODY_TASK_TARGETS + t, az0); _mm_storeu_ps(acc + 2*NBODY_TASK_TARGETS + t + 4, az1);
+        }
+    }
+}
+#endif
+
+#ifndef NBODY_USE_SSE
+static void gravityTask_Scalar(const NBodyGravity* g, unsigned int first, float* acc)
+{
+    unsigned int last = std::min(first + NBODY_TASK_TARGETS, g->numBodies);
+    for (unsigned int i = first; i < last; ++i)
+    {
+        float posMass1[4] = {g->posMass[i*4], g->posMass[i*4+1], g->posMass[i*4+2], 1.0f};
+        float a[3] = {0, 0, 0};
+        for (unsigned int j = 0; j < g->numBodies; ++j)
+        {
+            bodyBodyInteraction(a, (float*)&g->posMass[j*4], posMass1, g->softeningSquared);
+        }
+        acc[i - first] = a[0];
+        acc[NBODY_TASK_TARGETS + i - first] = a[1];
+        acc[2*NBODY_TASK_TARGETS + i - first] = a[2];
+    }
+}
+#endif
+
+static void gravityTasks(unsigned int begin, unsigned int end, void* data)
+{
+    const NBodyGravity* g = (const NBodyGravity*)data;
+    #ifdef NBODY_USE_AVX
+        static const bool bAVX = nbodyHasAVX();
+    #endif
+
+    for (unsigned int task = begin; task < end; ++task)
+    {
+        unsigned int first = task * NBODY_TASK_TARGETS;
+        float acc[3*NBODY_TASK_TARGETS];
+        memset(acc, 0, sizeof(acc));
+
+        #if defined(NBODY_USE_AVX)
+            if (bAVX)
+                gravityTask_AVX(g, first, acc);
+            else
+                gravityTask_SSE(g, first, acc);
+        #elif defined(NBODY_USE_SSE)
+            gravityTask_SSE(g, first, acc);
+        #else
+            gravityTask_Scalar(g, first, acc);
+        #endif
+
+        // force = mass of the target * sum over the sources
+        unsigned int last = std::min(first + NBODY_TASK_TARGETS, g->numBodies);
+        for (unsigned int i = first; i < last; ++i)
+        {
+            float mass = g->posMass[i*4+3];
+            g->force[i*4]   = mass * acc[i - first];
+            g->force[i*4+1] = mass * acc[NBODY_TASK_TARGETS + i - first];
+            g->force[i*4+2] = mass * acc[2*NBODY_TASK_TARGETS + i - first];
+        }
+    }
+}
+
 void BodySystemCPU::_computeNBodyGravitation() 
 {
-    for(int i = 0; i < m_numBodies; ++i) 
+    if (m_theta > 0.0f)
     {
-        m_force[i*4] = m_force[i*4+1] = m_force[i*4+2] = 0;
+        _computeBarnesHutGravitation();
+        return;
+    }
 
-	    for(int j = 0; j < m_numBodies; ++j) 
-	    {
-	        float acc[3] = {0, 0, 0};		
-	        bodyBodyInteraction(acc, &m_pos[m_currentRead][j*4], &m_pos[m_currentRead][i*4], 
-				    m_softeningSquared);	
-	        for (int k = 0; k < 3; ++k)
-	        {
-	            m_force[i*4+k] += acc[k];
-	        }
-	    }
+    // structure of arrays, the padding only feeds unused target lanes
+    const float* pos = m_pos[m_currentRead];
+    for (int i = 0; i < m_numBodies; ++i)
+    {
+        m_soa[i] = pos[i*4];
+        m_soa[m_numPadded + i] = pos[i*4+1];
+        m_soa[2*m_numPadded + i] = pos[i*4+2];
+    }
+
+    NBodyGravity g;
+    g.soa = m_soa;
+    g.posMass = pos;
+    g.force = m_force;
+    g.numBodies = (unsigned int)m_numBodies;
+    g.numPadded = (unsigned int)m_numPadded;
+    g.softeningSquared = m_softeningSquared;
+    shrParallelFor(0, (unsigned int)(m_numPadded / NBODY_TASK_TARGETS), 1, gravityTasks, &g);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Barnes-Hut gravitation
+//
+// Bodies are sorted along a Morton (Z-order) curve of their bounding cube, so 
+// every octree cell is a contiguous range of the sorted bodies and the 
+// children of a cell are found by binary search on the next 3 bits of the 
+// codes.  The tree is built one level at a time, centres of mass are summed
+// bottom-up the same way and every level is split over the host threads.
+////////////////////////////////////////////////////////////////////////////////
+#define BH_LEAF_SIZE 8          // bodies below which a cell is not split
+#define BH_MORTON_LEVELS 21     // bits per axis of the Morton codes = maximum depth
+
+struct BHKey
+{
+    unsigned long long code;
+    unsigned int index;
+
+    bool operator<(const BHKey& other) const
+    {
+        return code < other.code || (code == other.code && index < other.index);
     }
+};
+
+struct BHCell
+{
+    float com[4];               // centre of the sources, w = number of bodies
+    float centre[3];            // centre of the cube
+    float size;                 // edge length of the cube
+    float openSqr;              // squared distance below which the cell is opened
+    unsigned int begin, end;    // bodies (sorted order)
+    unsigned int firstChild;    // children are stored contiguously
+    unsigned int numChildren;   // 0 for a leaf
+};
+
+struct BHTree
+{
+    const float* pos;           // bodies, original order
+    float* sorted;              // bodies, Morton order
+    BHKey* keys;
+    BHKey* scratch;
+    BHCell* cells;
+    float* force;
+    unsigned int numBodies;
+    unsigned int width;         // sort: run length
+    int depth;                  // build: depth of the cells being split
+    float origin[3];
+    float scale;                // Morton cells per unit length
+    float invTheta;
+    float softeningSquared;
+};
+
+// Spread the low 21 bits of v so that they occupy every third bit
+static unsigned long long spreadBits(unsigned int v)
+{
+    unsigned long long x = v & 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffULL;
+    x = (x | x << 16) & 0x1f0000ff0000ffULL;
+    x = (x | x << 8) & 0x100f00f00f00f00fULL;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2) & 0x1249249249249249ULL;
+    return x;
+}
+
+static void computeKeys(unsigned int begin, unsigned int end, void* data)
+{
+    BHTree* tree = (BHTree*)data;
+    const float maxCell = (float)((1 << BH_MORTON_LEVELS) - 1);
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        unsigned long long code = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            float c = (tree->pos[i*4+k] - tree->origin[k]) * tree->scale;
+            c = std::max(0.0f, std::min(c, maxCell));
+            code |= spreadBits((unsigned int)c) << (2 - k);
+        }
+        tree->keys[i].code = code;
+        tree->keys[i].index = i;
+    }
+}
+
+// Sort runs [c*width, (c+1)*width) of the keys
+static void sortRuns(unsigned int begin, unsigned int end, void* data)
+{
+    BHTree* tree = (BHTree*)data;
+    for (unsigned int c = begin; c < end; ++c)
+    {
+        unsigned int first = std::min(c * tree->width, tree->numBodies);
+        unsigned int last = std::min(first + tree->width, tree->numBodies);
+        std::sort(tree->keys + first, tree->keys + last);
+    }
+}
+
+// Merge sorted runs 2p and 2p+1 of the keys into scratch
+static void mergeRuns(unsigned int begin, unsigned int end, void* data)
+{
+    BHTree* tree = (BHTree*)data;
+    for (unsigned int p = begin; p < end; ++p)
+    {
+        unsigned int first = (unsigned int)std::min(2ull * p * tree->width, (unsigned long long)tree->numBodies);
+        unsigned int middle = std::min(first + tree->width, tree->numBodies);
+        unsigned int last = (unsigned int)std::min((unsigned long long)middle + tree->width, (unsigned long long)tree->numBodies);
+        std::merge(tree->keys + first, tree->keys + middle, tree->keys + middle, tree->keys + last, 
+                   tree->scratch + first);
+    }
+}
+
+static void gatherBodies(unsigned int begin, unsigned int end, void* data)
+{
+    BHTree* tree = (BHTree*)data;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        memcpy(&tree->sorted[i*4], &tree->pos[tree->keys[i].index*4], 4*sizeof(float));
+    }
+}
+
+// Non-empty octants of a cell: octant o holds the bodies split[o] .. split[o+1]
+static void splitCell(const BHKey* keys, const BHCell& cell, int depth, unsigned int split[9])
+{
+    int shift = 3 * (BH_MORTON_LEVELS - 1 - depth);
+    split[0] = cell.begin;
+    split[8] = cell.end;
+    for (unsigned int o = 1; o < 8; ++o)
+    {
+        unsigned int lo = split[o-1], hi = cell.end;
+        while (lo < hi)
+        {
+            unsigned int mid = lo + (hi - lo) / 2;
+            if (((keys[mid].code >> shift) & 7) < o)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        split[o] = lo;
+    }
+}
+
+static void countChildren(unsigned int begin, unsigned int end, void* data)
+{
+    BHTree* tree = (BHTree*)data;
+    for (unsigned int c = begin; c < end; ++c)
+    {
+        BHCell& cell = tree->cells[c];
+        cell.numChildren = 0;
+        if (cell.end - cell.begin <= BH_LEAF_SIZE || tree->depth == BH_MORTON_LEVELS)
+            continue;
+
+        unsigned int split[9];
+        splitCell(tree->keys, cell, tree->depth, split);
+        for (int o = 0; o < 8; ++o)
+        {
+            if (split[o+1] > split[o])
+                cell.numChildren++;
+        }
+    }
+}
+
+// firstChild has been assigned by a prefix sum over numChildren
+static void createChildren(unsigned int begin, unsigned int end, void* data)
+{
+    BHTree* tree = (BHTree*)data;
+    for (unsigned int c = begin; c < end; ++c)
+    {
+        const BHCell& cell = tree->cells[c];
+        if (cell.numChildren == 0)
+            continue;
+
+        unsigned int split[9];
+        splitCell(tree->keys, cell, tree->depth, split);
+        unsigned int child = cell.firstChild;
+        for (int o = 0; o < 8; ++o)
+        {
+            if (split[o+1] == split[o])
+                continue;
+
+            BHCell& sub = tree->cells[child++];
+            sub.size = 0.5f * cell.size;
+            for (int k = 0; k < 3; ++k)
+            {
+                sub.centre[k] = cell.centre[k] + (((o >> (2 - k)) & 1) ? 0.25f : -0.25f) * cell.size;
+            }
+            sub.begin = split[o];
+            sub.end = split[o+1];
+        }
+    }
+}
+
+// Centre of the sources of cells whose children are complete.  As in 
+// bodyBodyInteraction the force on a body is scaled by its own mass only, so 
+// every source weighs 1 and a cell acts as its body count at the mean 
+// position.  A cell is opened closer than size/theta from that centre, plus 
+// its offset from the middle of the cube so lopsided cells stay safe
+static void sumMass(unsigned int begin, unsigned int end, void* data)
+{
+    BHTree* tree = (BHTree*)data;
+    for (unsigned int c = begin; c < end; ++c)
+    {
+        BHCell& cell = tree->cells[c];
+        float sum[4] = {0, 0, 0, 0};
+        unsigned int count = cell.numChildren ? cell.numChildren : cell.end - cell.begin;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const float* p = cell.numChildren ? tree->cells[cell.firstChild + i].com 
+                                              : &tree->sorted[(cell.begin + i)*4];
+            float w = cell.numChildren ? p[3] : 1.0f;
+            sum[0] += w * p[0];
+            sum[1] += w * p[1];
+            sum[2] += w * p[2];
+            sum[3] += w;
+        }
+
+        float offsetSqr = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            cell.com[k] = (sum[3] != 0) ? sum[k] / sum[3] : cell.centre[k];
+            offsetSqr += (cell.com[k] - cell.centre[k]) * (cell.com[k] - cell.centre[k]);
+        }
+        cell.com[3] = sum[3];
+
+        float openDist = cell.size * tree->invTheta + sqrtf(offsetSqr);
+        cell.openSqr = openDist * openDist;
+    }
+}
+
+// Walk the tree for sorted bodies [begin, end).  Neighbours in Morton order 
+// open nearly the same cells, which keeps the walk in cache
+static void traverseTree(unsigned int begin, unsigned int end, void* data)
+{
+    BHTree* tree = (BHTree*)data;
+    unsigned int stack[8 * BH_MORTON_LEVELS + 8];
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        float* posMass1 = &tree->sorted[i*4];
+        float acc[3] = {0, 0, 0};
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0)
+        {
+            const BHCell& cell = tree->cells[stack[--top]];
+            if (cell.numChildren == 0)
+            {
+                for (unsigned int j = cell.begin; j < cell.end; ++j)
+                {
+                    bodyBodyInteraction(acc, &tree->sorted[j*4], posMass1, tree->softeningSquared);
+                }
+                continue;
+            }
+
+            float r[3] = {cell.com[0] - posMass1[0], cell.com[1] - posMass1[1], cell.com[2] - posMass1[2]};
+            if (r[0] * r[0] + r[1] * r[1] + r[2] * r[2] > cell.openSqr)
+            {
+                float a[3] = {0, 0, 0};
+                bodyBodyInteraction(a, (float*)cell.com, posMass1, tree->softeningSquared);
+                acc[0] += cell.com[3] * a[0];
+                acc[1] += cell.com[3] * a[1];
+                acc[2] += cell.com[3] * a[2];
+            }
+            else
+            {
+                for (unsigned int c = 0; c < cell.numChildren; ++c)
+                    stack[top++] = cell.firstChild + c;
+            }
+        }
+
+        float* force = &tree->force[tree->keys[i].index*4];
+        force[0] = acc[0];
+        force[1] = acc[1];
+        force[2] = acc[2];
+    }
+}
+
+// Same forces as _computeNBodyGravitation, with distant cells replaced by 
+// their body count at the mean position of their bodies
+void BodySystemCPU::_computeBarnesHutGravitation()
+{
+    unsigned int n = (unsigned int)m_numBodies;
+    if (n == 0)
+        return;
+
+    BHTree tree;
+    tree.pos = m_pos[m_currentRead];
+    tree.force = m_force;
+    tree.numBodies = n;
+    tree.invTheta = 1.0f / m_theta;
+    tree.softeningSquared = m_softeningSquared;
+
+    // bounding cube, slightly enlarged so that no body sits on its upper face
+    float lo[3], hi[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        lo[k] = hi[k] = tree.pos[k];
+    }
+    for (unsigned int i = 1; i < n; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            lo[k] = std::min(lo[k], tree.pos[i*4+k]);
+            hi[k] = std::max(hi[k], tree.pos[i*4+k]);
+        }
+    }
+    float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    extent = (extent > 0) ? extent * 1.001f : 1.0f;
+    for (int k = 0; k < 3; ++k)
+    {
+        tree.origin[k] = 0.5f * (lo[k] + hi[k] - extent);
+    }
+    tree.scale = (float)(1 << BH_MORTON_LEVELS) / extent;
+
+    // Morton order: sorted runs, merged pairwise
+    std::vector<BHKey> keys(n), scratch(n);
+    tree.keys = &keys[0];
+    tree.scratch = &scratch[0];
+    shrParallelFor(0, n, 4096, computeKeys, &tree);
+
+    unsigned int numRuns = 1;
+    while (numRuns < 4 * shrGetNumHostThreads() && numRuns * 1024 < n)
+        numRuns *= 2;
+    tree.width = (n + numRuns - 1) / numRuns;
+    shrParallelFor(0, numRuns, 1, sortRuns, &tree);
+    for (; tree.width < n; tree.width *= 2)
+    {
+        shrParallelFor(0, (unsigned int)((n + 2ull * tree.width - 1) / (2ull * tree.width)), 1, mergeRuns, &tree);
+        std::swap(tree.keys, tree.scratch);
+    }
+
+    std::vector<float> sorted(n*4);
+    tree.sorted = &sorted[0];
+    shrParallelFor(0, n, 4096, gatherBodies, &tree);
+
+    // tree, one level per pass; levels[d] is the first cell of depth d
+    std::vector<BHCell> cells(1);
+    std::vector<unsigned int> levels(1, 0);
+    for (int k = 0; k < 3; ++k)
+    {
+        cells[0].centre[k] = tree.origin[k] + 0.5f * extent;
+    }
+    cells[0].size = extent;
+    cells[0].begin = 0;
+    cells[0].end = n;
+
+    for (tree.depth = 0; levels.back() < cells.size(); ++tree.depth)
+    {
+        unsigned int first = levels.back(), last = (unsigned int)cells.size();
+        tree.cells = &cells[0];
+        shrParallelFor(first, last, 256, countChildren, &tree);
+
+        unsigned int next = last;
+        for (unsigned int c = first; c < last; ++c)
+        {
+            cells[c].firstChild = next;
+            next += cells[c].numChildren;
+        }
+        cells.resize(next);
+
+        tree.cells = &cells[0];
+        shrParallelFor(first, last, 256, createChildren, &tree);
+        levels.push_back(last);
+    }
+
+    for (size_t d = levels.size() - 1; d > 0; --d)
+    {
+        shrParallelFor(levels[d-1], levels[d], 256, sumMass, &tree);
+    }
+
+    shrParallelFor(0, n, 64, traverseTree, &tree);
 }
 
 void BodySystemCPU::_integrateNBodySystem(float deltaTime)
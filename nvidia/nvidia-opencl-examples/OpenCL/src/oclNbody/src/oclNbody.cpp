@@ -102,6 +102,7 @@ NBodyParams demoParams[] =
 // Basic simulation parameters
 int numBodies = 7680;               // default # of bodies in sim (can be overridden by command line switch --n=<N>)
 bool bDouble = false;               //false: sp float, true: dp 
+float fTheta = 0.0f;                // Barnes-Hut opening angle of the host reference, 0 = all pairs (--theta=<angle>)
 int numDemos = sizeof(demoParams) / sizeof(NBodyParams);
 int activeDemo = 0;
 NBodyParams activeParams = demoParams[activeDemo];
@@ -189,6 +190,7 @@ int main(int argc, char** argv)
 	shrLog("  --noprompt\t\tQuit simulation automatically after a brief period\n");
     shrLog("  --n=<numbodies>\tSpecify # of bodies to simulate (default = %d)\n", numBodies);
 	shrLog("  --double\t\tUse double precision floating point values for simulation\n");
+	shrLog("  --theta=<angle>\tBarnes-Hut opening angle for the host reference (default = 0, all pairs)\n");
 	shrLog("  --p=<workgroup X dim>\tSpecify X dimension of workgroup (default = %d)\n", p);
 	shrLog("  --q=<workgroup Y dim>\tSpecify Y dimension of workgroup (default = %d)\n\n", q);
 
@@ -198,6 +200,7 @@ int main(int argc, char** argv)
         shrGetCmdLineArgumenti(argc, (const char**)argv, "p", &p);
         shrGetCmdLineArgumenti(argc, (const char**)argv, "q", &q);
         shrGetCmdLineArgumenti(argc, (const char**)argv, "n", &numBodies);
+        shrGetCmdLineArgumentf(argc, (const char**)argv, "theta", &fTheta);
 	    bDouble = (shrTRUE == shrCheckCmdLineFlag(argc, (const char**)argv, "double"));
         bNoPrompt = shrCheckCmdLineFlag(argc, (const char**)argv, "noprompt");
         bQATest = shrCheckCmdLineFlag(argc, (const char**)argv, "qatest");
@@ -444,6 +447,8 @@ void InitGL(int* argc, char **argv)
 //*****************************************************************************
 void DisplayGL()
 {
+    shrProfileZone zone("DisplayGL");
+
     // update the simulation, unless paused
     double dProcessingTime = 0.0;
     if (!bPause)
@@ -455,8 +460,10 @@ void DisplayGL()
         }
 
         // Run the simlation computations
+        shrProfileBegin("simulate");
         nbody->update(activeParams.m_timestep); 
         nbody->getArray(BodySystem::BODYSYSTEM_POSITION);
+        shrProfileEnd();
 
         // Make graphics work with or without CL/GL interop 
         if (bUsePBO) 
@@ -491,7 +498,9 @@ void DisplayGL()
         glRotatef(camera_rot_lag[0], 1.0, 0.0, 0.0);
         glRotatef(camera_rot_lag[1], 0.0, 1.0, 0.0);
         renderer->setSpriteSize(activeParams.m_pointSize);
+        shrProfileBegin("render");
         renderer->display(displayMode);
+        shrProfileEnd();
     }
 
     // Display user interface if enabled
@@ -663,6 +672,8 @@ void KeyboardGL(unsigned char key, int /*x*/, int /*y*/)
 //*****************************************************************************
 void RunProfiling(int iterations, unsigned int uiWorkgroup)
 {
+    shrProfileZone zone("RunProfiling");
+
     // once without timing to prime the GPU
     nbody->update(activeParams.m_timestep);
     nbody->synchronizeThreads();
@@ -869,7 +880,10 @@ bool CompareResults(int numBodies)
     BodySystemCPU* nbodyCPU = new BodySystemCPU(numBodies);
     nbodyCPU->setArray(BodySystem::BODYSYSTEM_POSITION, hPos);
     nbodyCPU->setArray(BodySystem::BODYSYSTEM_VELOCITY, hVel);
+    nbodyCPU->setOpeningAngle(fTheta);
+    shrProfileBegin("host reference");
     nbodyCPU->update(0.001f);
+    shrProfileEnd();
 
     // Check if result matches 
     shrBOOL bMatch = shrComparefe(fGPUData, 
@@ -305,6 +305,8 @@ void InitGL(int* argc, char** argv)
 //*****************************************************************************
 void DisplayGL()
 {
+    shrProfileZone zone("DisplayGL");
+
     // update the simulation, if not paused
     double dProcessingTime = 0.0;
     if (!bPause)
@@ -37,12 +37,9 @@ extern "C" void initBitonicSort(cl_context cxGPUContext, cl_command_queue cqPara
         char *cBitonicSort = oclLoadProgSource(shrFindFilePath("BitonicSort_b.cl", argv[0]), "// My comment\n", &kernelLength);
         oclCheckError(cBitonicSort != NULL, shrTRUE);
 
-    shrLog("...creating bitonic sort program\n");
-        cpBitonicSort = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cBitonicSort, &kernelLength, &ciErrNum);
-        oclCheckError(ciErrNum, CL_SUCCESS);
-
-    shrLog("...building bitonic sort program\n");
-        ciErrNum = clBuildProgram(cpBitonicSort, 0, NULL, NULL, NULL, NULL);
+    shrLog("...creating and building bitonic sort program\n");
+        cpBitonicSort = oclBuildProgramCached(cxGPUContext, 0, NULL, cBitonicSort, kernelLength, NULL, &ciErrNum);
+        oclCheckError(cpBitonicSort != NULL, shrTRUE);
 		if (ciErrNum != CL_SUCCESS)
 		{
 			// write out standard error, Build Log and PTX, then cleanup and exit
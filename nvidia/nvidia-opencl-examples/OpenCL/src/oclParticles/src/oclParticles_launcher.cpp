@@ -61,12 +61,9 @@ extern "C" void initParticles(cl_context cxGPUContext, cl_command_queue cqParamC
         char *cParticles = oclLoadProgSource(shrFindFilePath("Particles.cl", argv[0]), "// My comment\n", &kernelLength);
         oclCheckError(cParticles != NULL, shrTRUE);
 
-    shrLog("Creating particles program...\n");
-        cpParticles = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cParticles, &kernelLength, &ciErrNum);
-        oclCheckError(ciErrNum, CL_SUCCESS);
-
-    shrLog("Building particles program...\n");
-        ciErrNum = clBuildProgram(cpParticles, 0, NULL, "-cl-fast-relaxed-math", NULL, NULL);
+    shrLog("Creating and building particles program...\n");
+        cpParticles = oclBuildProgramCached(cxGPUContext, 0, NULL, cParticles, kernelLength, "-cl-fast-relaxed-math", &ciErrNum);
+        oclCheckError(cpParticles != NULL, shrTRUE);
 		if (ciErrNum != CL_SUCCESS)
 		{
 			// write out standard error, Build Log and PTX, then cleanup and exit
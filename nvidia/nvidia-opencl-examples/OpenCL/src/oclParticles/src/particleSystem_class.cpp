@@ -201,6 +201,7 @@ static int isNan(float f){
 //Step the simulation
 void ParticleSystem::update(float deltaTime){
     assert(m_bInitialized);
+    shrProfileZone zone("ParticleSystem::update");
 
     setParameters(&m_params);
     setParametersHost(&m_params);
@@ -209,18 +210,22 @@ void ParticleSystem::update(float deltaTime){
     memHandle_t pos; 
     if (!m_bQATest)
     {
+        shrProfileZone vboZone("download VBO");
         glBindBufferARB(GL_ARRAY_BUFFER, m_posVbo);
         pos = (memHandle_t)glMapBufferARB(GL_ARRAY_BUFFER, GL_READ_WRITE);
         copyArrayToDevice(m_dPos, pos, 0, m_numParticles * 4 * sizeof(float));
     }
 
+    shrProfileBegin("integrateSystem");
     integrateSystem(
         m_dPos,
         m_dVel,
         deltaTime,
         m_numParticles
     );
+    shrProfileEnd();
 
+    shrProfileBegin("calcHash");
     calcHash(
         m_dHash,
         m_dIndex,
@@ -228,10 +233,15 @@ void ParticleSystem::update(float deltaTime){
         m_numParticles
     );
 
+    shrProfileEnd();
+
+    shrProfileBegin("bitonicSort");
     bitonicSort(NULL, m_dHash, m_dIndex, m_dHash, m_dIndex, 1, m_numParticles, 0);
+    shrProfileEnd();
 
     //Find start and end of each cell and
     //Reorder particle data for better cache coherency
+    shrProfileBegin("findCellBoundsAndReorder");
     findCellBoundsAndReorder(
         m_dCellStart,
         m_dCellEnd,
@@ -244,7 +254,9 @@ void ParticleSystem::update(float deltaTime){
         m_numParticles,
         m_numGridCells
     );
+    shrProfileEnd();
 
+    shrProfileBegin("collide");
     collide(
         m_dVel,
         m_dReorderedPos,
@@ -255,10 +267,12 @@ void ParticleSystem::update(float deltaTime){
         m_numParticles,
         m_numGridCells
     );
+    shrProfileEnd();
 
     //Update buffers
     if (!m_bQATest)
     {
+        shrProfileZone vboZone("upload VBO");
         copyArrayFromDevice(pos,m_dPos, 0, m_numParticles * 4 * sizeof(float));
         glUnmapBufferARB(GL_ARRAY_BUFFER);
     }
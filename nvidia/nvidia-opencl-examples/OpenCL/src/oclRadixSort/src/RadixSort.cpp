@@ -47,14 +47,13 @@ RadixSort::RadixSort(cl_context GPUContext,
     shrCheckError(cSourcePath != NULL, shrTRUE);
     char *cRadixSort = oclLoadProgSource(cSourcePath, "// My comment\n", &szKernelLength);
     oclCheckError(cRadixSort != NULL, shrTRUE);
-    cpProgram = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cRadixSort, &szKernelLength, &ciErrNum);
-    oclCheckError(ciErrNum, CL_SUCCESS);
 #ifdef MAC
     char *flags = "-DMAC -cl-fast-relaxed-math";
 #else
     char *flags = "-cl-fast-relaxed-math";
 #endif
-    ciErrNum = clBuildProgram(cpProgram, 0, NULL, flags, NULL, NULL);
+    cpProgram = oclBuildProgramCached(cxGPUContext, 0, NULL, cRadixSort, szKernelLength, flags, &ciErrNum);
+    oclCheckError(cpProgram != NULL, shrTRUE);
     if (ciErrNum != CL_SUCCESS)
     {
         // write out standard ciErrNumor, Build Log and PTX, then cleanup and exit
@@ -35,8 +35,8 @@ Scan::Scan(cl_context GPUContext,
     shrCheckError(cSourcePath != NULL, shrTRUE);
     char *cScan = oclLoadProgSource(cSourcePath, "// My comment\n", &szKernelLength);
     oclCheckError(cScan != NULL, shrTRUE);
-    cpProgram = clCreateProgramWithSource(cxGPUContext, 1, (const char **)&cScan, &szKernelLength, &ciErrNum);
-    ciErrNum = clBuildProgram(cpProgram, 0, NULL, "-cl-fast-relaxed-math", NULL, NULL);
+    cpProgram = oclBuildProgramCached(cxGPUContext, 0, NULL, cScan, szKernelLength, "-cl-fast-relaxed-math", &ciErrNum);
+    oclCheckError(cpProgram != NULL, shrTRUE);
     if (ciErrNum != CL_SUCCESS)
     {
         // write out standard error, Build Log and PTX, then cleanup and exit
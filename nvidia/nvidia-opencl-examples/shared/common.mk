@@ -321,7 +321,7 @@ else
 		LIB += -lcutil_$(LIB_ARCH)$(LIBSUFFIX) 
 	endif
 	ifneq ($(OMIT_SHRUTIL_LIB),1)
-		LIB += -lshrutil_$(LIB_ARCH)$(LIBSUFFIX) 
+		LIB += -lshrutil_$(LIB_ARCH)$(LIBSUFFIX) -lpthread
 	endif
 
 	# Device emulation configuration
@@ -139,6 +139,10 @@ inline void __ExitInTime(int seconds)
 
 inline void __shrQAFinish(int argc, const char **argv, int iStatus)
 {
+#ifdef SHR_UTILS_H
+    // write out pending asynchronous log messages before the results
+    shrLogFlush();
+#endif
     // By default QATest is disabled and NoPrompt is Enabled (times out at seconds passed into __ExitInTime() )
     bool bQATest = false, bNoPrompt = true, bQuitInTime = true;
     const char *sStatus[] = { "FAILED", "PASSED", "WAIVED", NULL };
@@ -187,6 +191,10 @@ inline void __shrQAFinish(int argc, const char **argv, int iStatus)
 
 inline void __shrQAFinish2(bool bQATest, int argc, const char **argv, int iStatus)
 {
+#ifdef SHR_UTILS_H
+    // write out pending asynchronous log messages before the results
+    shrLogFlush();
+#endif
     bool bQuitInTime = true;
     const char *sStatus[] = { "FAILED", "PASSED", "WAIVED", NULL };
 	
@@ -223,6 +231,10 @@ inline void __shrQAFinish2(bool bQATest, int argc, const char **argv, int iStatu
 
 inline void shrQAFinishExit(int argc, const char **argv, int iStatus)
 {
+#ifdef SHR_UTILS_H
+    // report the shrProfile zones recorded by the sample, if any
+    shrProfileReport();
+#endif
     __shrQAFinish(argc, argv, iStatus);
 
     exit(iStatus ? EXIT_SUCCESS : EXIT_FAILURE); 
@@ -230,6 +242,10 @@ inline void shrQAFinishExit(int argc, const char **argv, int iStatus)
 
 inline void shrQAFinishExit2(bool bQAtest, int argc, const char **argv, int iStatus)
 {
+#ifdef SHR_UTILS_H
+    // report the shrProfile zones recorded by the sample, if any
+    shrProfileReport();
+#endif
     __shrQAFinish2(bQAtest, argc, argv, iStatus);
 
     exit(iStatus ? EXIT_SUCCESS : EXIT_FAILURE);
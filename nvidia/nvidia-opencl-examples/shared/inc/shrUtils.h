@@ -169,6 +169,25 @@ extern "C" int shrLogEx(int iLogMode, int iErrNum, const char* cFormatString, ..
 // *********************************************************************
 extern "C" int shrLog(const char* cFormatString, ...);
 
+// *********************************************************************
+// Asynchronous logging
+// When enabled (here or with SHR_LOG_ASYNC=1 in the environment), shrLog
+// and shrLogEx copy the formatted message into a bounded lock-free ring 
+// and a background thread writes and flushes the console and log files.
+// Messages with ERRORMSG or CLOSELOG are on disk when the call returns, 
+// the ring is drained by shrLogFlush, shrQAFinish* and at process exit.
+// Output printed directly with printf may interleave differently.
+// *********************************************************************
+extern "C" void shrSetLogAsync(bool bEnable);
+
+// Wait until all messages logged so far have been written and flushed
+extern "C" void shrLogFlush(void);
+
+// Same as shrLogEx, but in asynchronous mode the formatting also moves to 
+// the background thread: the format string and the arguments it consumes
+// (strings by value) are queued instead of the formatted text
+extern "C" int shrLogDeferred(int iLogMode, int iErrNum, const char* cFormatString, ...);
+
 // *********************************************************************
 // Delta timer function for up to 3 independent timers using host high performance counters 
 // Maintains state for 3 independent counters
@@ -183,6 +202,61 @@ extern "C" double shrDeltaT(int iCounterID);
 // *********************************************************************
 extern "C" void shrSetLogFileName (const char* cOverRideName);
 
+// *********************************************************************
+// Hierarchical host profiler
+// Zones nest per host thread and are merged by their path across threads. 
+// The report (call counts, inclusive and exclusive time per zone) is 
+// printed with shrLog by shrQAFinishExit or at process exit, and written 
+// as CSV to DEFAULTPROFILEFILE or the file named by SHR_PROFILE.  
+// SHR_PROFILE=0 turns zones into no-ops.
+//! Example: { shrProfileZone zone("Simulate"); ... }
+//!     or   shrProfileBegin("Simulate"); ... shrProfileEnd();
+// *********************************************************************
+#define DEFAULTPROFILEFILE "SdkProfile.csv"
+
+// Open a zone named cZoneName (string must stay valid until the report) 
+// as a child of the innermost open zone of the calling thread
+extern "C" void shrProfileBegin(const char* cZoneName);
+
+// Close the innermost open zone of the calling thread
+extern "C" void shrProfileEnd(void);
+
+// Print the report and write the profile file, only the first call after 
+// zones were recorded has an effect
+extern "C" void shrProfileReport(void);
+
+// Optional profile file name override
+extern "C" void shrSetProfileFileName(const char* cOverRideName);
+
+// Scoped zone, closes itself when leaving the enclosing block
+class shrProfileZone
+{
+public:
+    explicit shrProfileZone(const char* cZoneName) { shrProfileBegin(cZoneName); }
+    ~shrProfileZone() { shrProfileEnd(); }
+private:
+    shrProfileZone(const shrProfileZone&);
+    shrProfileZone& operator=(const shrProfileZone&);
+};
+
+// *********************************************************************
+// Host parallel loop
+// Calls pBody(begin, end, pUserData) on blocks of at most uiGrain indices
+// covering [uiBegin, uiEnd).  The calling thread and helper threads take 
+// the blocks in order from a shared counter, so uneven blocks balance out,
+// and the call returns when all blocks are done.  A single block runs on 
+// the calling thread.  uiGrain = 0 picks a few blocks per thread.
+//! Example: shrParallelFor(0, n, 256, ScaleRows, &args);
+// *********************************************************************
+typedef void (*shrParallelBody)(unsigned int uiBegin, unsigned int uiEnd, void* pUserData);
+
+extern "C" void shrParallelFor(unsigned int uiBegin, unsigned int uiEnd, unsigned int uiGrain, 
+                               shrParallelBody pBody, void* pUserData);
+
+// Number of host threads used by shrParallelFor and the shrCompare family
+// (all processors, or SHR_NUM_THREADS from the environment)
+extern "C" unsigned int shrGetNumHostThreads(void);
+
 // Helper function to init data arrays 
 // *********************************************************************
 extern "C" void shrFillArray(float* pfData, int iSize);
@@ -345,6 +419,84 @@ extern "C" shrBOOL shrWriteFileb( const char* filename, const char* data, unsign
 extern "C" shrBOOL shrWriteFileub( const char* filename, const unsigned char* data,
                 unsigned int len, bool verbose = false);
 
+// Binary dataset container
+// *********************************************************************
+// A 64 byte header followed by the raw little-endian payload.  shrReadFile*
+// recognizes the magic and loads such files directly, anything else is
+// parsed as the legacy whitespace separated text format.  shrWriteFile*
+// emits the binary container when the file name ends in SHR_DATASET_EXT.
+#define SHR_DATASET_MAGIC "SHRDATA1"
+#define SHR_DATASET_EXT ".shrdat"
+#define SHR_DATASET_MAX_DIMS 4
+
+enum shrDataType
+{
+    SHR_DTYPE_UNKNOWN = 0,
+    SHR_DTYPE_FLOAT   = 1,
+    SHR_DTYPE_DOUBLE  = 2,
+    SHR_DTYPE_INT     = 3,
+    SHR_DTYPE_UINT    = 4,
+    SHR_DTYPE_CHAR    = 5,
+    SHR_DTYPE_UCHAR   = 6
+};
+
+// On-disk header, the payload starts right after it
+typedef struct
+{
+    char               magic[8];                      // SHR_DATASET_MAGIC
+    unsigned int       dtype;                         // shrDataType of the elements
+    unsigned int       ndims;                         // number of used entries in shape
+    unsigned int       shape[SHR_DATASET_MAX_DIMS];   // extent per dimension, innermost last
+    double             epsilon;                       // comparison epsilon stored by the writer
+    unsigned long long count;                         // number of elements in the payload
+    unsigned long long checksum;                      // FNV-1a based checksum of the payload
+    unsigned char      reserved[8];
+} shrDatasetHeader;
+
+// Read-only view of a mapped dataset file (filled by shrMapDataFile)
+typedef struct
+{
+    const void*      data;      // first payload element, points into the mapping
+    shrDatasetHeader header;    // copy of the file header
+    void*            mapBase;   // internal: base address of the mapping
+    size_t           mapSize;   // internal: size of the mapping in bytes
+} shrDataView;
+
+////////////////////////////////////////////////////////////////////////////
+//! Size in bytes of one element of the given shrDataType, 0 if unknown
+////////////////////////////////////////////////////////////////////////////
+extern "C" size_t shrDataTypeSize(unsigned int dtype);
+
+////////////////////////////////////////////////////////////////////////////
+//! Write \filename as a binary dataset container regardless of its extension
+//! @return shrTRUE if writing the file succeeded, otherwise shrFALSE
+//! @param filename name of the file to write
+//! @param dtype  shrDataType of the elements in data
+//! @param data  pointer to data to write
+//! @param ndims  number of dimensions in shape (1 .. SHR_DATASET_MAX_DIMS)
+//! @param shape  extent per dimension, the product is the element count
+//! @param epsilon  epsilon for comparison stored in the header
+////////////////////////////////////////////////////////////////////////////
+extern "C" shrBOOL shrWriteDataFile( const char* filename, unsigned int dtype, const void* data,
+                unsigned int ndims, const unsigned int* shape, double epsilon,
+                bool verbose = false);
+
+////////////////////////////////////////////////////////////////////////////
+//! Map a binary dataset container read-only without copying the payload
+//! @return shrTRUE if the file is a valid container, otherwise shrFALSE
+//! @param filename name of the source file
+//! @param view  receives the header and a pointer to the mapped payload
+//! @param verify  recompute and check the payload checksum
+//! @note The view stays valid until shrUnmapDataFile is called on it
+////////////////////////////////////////////////////////////////////////////
+extern "C" shrBOOL shrMapDataFile( const char* filename, shrDataView* view,
+                bool verify = true, bool verbose = false);
+
+////////////////////////////////////////////////////////////////////////////
+//! Release a view obtained from shrMapDataFile
+////////////////////////////////////////////////////////////////////////////
+extern "C" void shrUnmapDataFile( shrDataView* view);
+
 ////////////////////////////////////////////////////////////////////////////
 //! Load PPM image file (with unsigned char as data element type), padding 
 //! 4th component
@@ -395,6 +547,78 @@ extern "C" shrBOOL shrSavePGMub( const char* file, unsigned char *data,
 extern "C" shrBOOL shrLoadPGMub( const char* file, unsigned char** data,
                   unsigned int *w,unsigned int *h);
 
+////////////////////////////////////////////////////////////////////////////
+// Row-streaming PPM/PGM access
+// * An image is read or written a band of rows at a time, so large images
+//   never need a second full-size copy
+// * Rows are converted on the fly between the file layout (3 channels for
+//   PPM, 1 for PGM) and the caller's layout (1, 3 or 4 channels, any row
+//   pitch), so they can go straight into mapped or pinned buffers
+////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    FILE* fp;
+    unsigned int width;
+    unsigned int height;
+    unsigned int channels;      // channels in the file: 1 (PGM) or 3 (PPM)
+    unsigned int row;           // next row to be read or written
+    unsigned char* staging;     // conversion buffer, allocated on first use
+    size_t stagingRows;
+} shrImageStream;
+
+////////////////////////////////////////////////////////////////////////////
+//! Open a PPM or PGM file and parse its header
+//! @return shrTRUE if the file is a valid binary PPM/PGM, otherwise shrFALSE
+//! @param file    name of the image file
+//! @param stream  stream to initialize, width/height/channels are set on return
+////////////////////////////////////////////////////////////////////////////
+extern "C" shrBOOL shrOpenImageRead( const char* file, shrImageStream* stream);
+
+////////////////////////////////////////////////////////////////////////////
+//! Create a PPM (3 channels) or PGM (1 channel) file and write its header
+//! @return shrTRUE if the file could be created, otherwise shrFALSE
+//! @param file      name of the image file
+//! @param stream    stream to initialize
+//! @param w         width of the image
+//! @param h         height of the image
+//! @param channels  1 for PGM, 3 for PPM
+////////////////////////////////////////////////////////////////////////////
+extern "C" shrBOOL shrOpenImageWrite( const char* file, shrImageStream* stream,
+                                      unsigned int w, unsigned int h, unsigned int channels);
+
+////////////////////////////////////////////////////////////////////////////
+//! Read the next rows of an image opened with shrOpenImageRead
+//! @return number of rows read (less than \a rows at the end of the image or on error)
+//! @param stream       image stream
+//! @param data         destination of the first row
+//! @param rows         number of rows to read
+//! @param dstChannels  channels per pixel in \a data: the file's own count, 
+//!                     or 4 (RGB is padded with 0, gray is replicated to RGB)
+//! @param dstPitch     bytes between rows in \a data, 0 for tightly packed
+////////////////////////////////////////////////////////////////////////////
+extern "C" unsigned int shrReadImageRows( shrImageStream* stream, unsigned char* data, unsigned int rows,
+                                          unsigned int dstChannels, size_t dstPitch);
+
+////////////////////////////////////////////////////////////////////////////
+//! Write the next rows of an image opened with shrOpenImageWrite
+//! @return number of rows written
+//! @param stream       image stream
+//! @param data         first row to write
+//! @param rows         number of rows to write
+//! @param srcChannels  channels per pixel in \a data: the file's own count, 
+//!                     or 4 for a PPM (the 4th component is dropped)
+//! @param srcPitch     bytes between rows in \a data, 0 for tightly packed
+////////////////////////////////////////////////////////////////////////////
+extern "C" unsigned int shrWriteImageRows( shrImageStream* stream, const unsigned char* data, unsigned int rows,
+                                           unsigned int srcChannels, size_t srcPitch);
+
+////////////////////////////////////////////////////////////////////////////
+//! Close an image stream
+//! @return shrTRUE if all data reached the file, otherwise shrFALSE
+//! @param stream  image stream
+////////////////////////////////////////////////////////////////////////////
+extern "C" shrBOOL shrCloseImage( shrImageStream* stream);
+
 ////////////////////////////////////////////////////////////////////////////
 // Command line arguments: General notes
 // * All command line arguments begin with '--' followed by the token; 
@@ -575,6 +799,40 @@ extern "C" shrBOOL shrComparefet( const float* reference, const float* data,
 extern "C" shrBOOL shrCompareL2fe( const float* reference, const float* data,
                 const unsigned int len, const float epsilon );
 
+// Error statistics gathered by shrComparefStats
+#define SHR_ULP_BUCKETS 16
+typedef struct
+{
+    unsigned int count;            // number of elements compared
+    unsigned int errorCount;       // elements outside [-epsilon, epsilon]
+    double       maxError;         // largest absolute difference (NaN if any element is NaN)
+    unsigned int maxErrorIndex;    // index of the first element with the largest difference
+    double       l2Error;          // L2-norm of reference - data
+    double       l2Reference;      // L2-norm of reference
+    double       relativeL2Error;  // l2Error / l2Reference, 0 for a zero reference
+    unsigned int maxUlp;           // largest distance in units in the last place
+    unsigned int ulpHistogram[SHR_ULP_BUCKETS]; // [0]: equal, [k]: [2^(k-1), 2^k) ulp,
+                                                // the last bucket also counts NaN
+} shrCompareStats;
+
+////////////////////////////////////////////////////////////////////////////
+//! Compare two float arrays with an epsilon tolerance for equality and 
+//! gather detailed error statistics
+//! @return shrTRUE if all elements are within epsilon, otherwise shrFALSE
+//! @param reference  handle to the reference data / gold image
+//! @param data       handle to the computed data
+//! @param len        number of elements in reference and data
+//! @param epsilon    epsilon to use for the comparison
+//! @param stats      receives the error statistics
+////////////////////////////////////////////////////////////////////////////
+extern "C" shrBOOL shrComparefStats( const float* reference, const float* data,
+                const unsigned int len, const float epsilon, shrCompareStats* stats );
+
+////////////////////////////////////////////////////////////////////////////
+//! Log statistics gathered by shrComparefStats with shrLog
+////////////////////////////////////////////////////////////////////////////
+extern "C" void shrLogCompareStats( const shrCompareStats* stats );
+
 ////////////////////////////////////////////////////////////////////////////////
 //! Compare two PPM image files with an epsilon tolerance for equality
 //! @return shrTRUEif \a reference and \a data are identical, otherwise shrFALSE
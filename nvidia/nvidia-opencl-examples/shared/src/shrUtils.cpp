@@ -23,8 +23,22 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <algorithm>
+#include <time.h>
 #include <stdio.h>
 
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <pthread.h>
+    #include <sys/mman.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define SHR_USE_SSE2
+    #include <emmintrin.h>
+#endif
+
 using namespace std;
 
 // size of PGM file header 
@@ -168,13 +182,585 @@ void shrSetLogFileName (const char* cOverRideName)
     return;
 }
 
-// Function to log standardized information to console, file or both
+// Hierarchical host profiler
+// *********************************************************************
+#ifdef _WIN32
+    #define SHR_THREAD_LOCAL __declspec(thread)
+    typedef SRWLOCK shrMutex;
+    #define SHR_MUTEX_INITIALIZER SRWLOCK_INIT
+    static void shrMutexInit(shrMutex* m)   { InitializeSRWLock(m); }
+    static void shrMutexLock(shrMutex* m)   { AcquireSRWLockExclusive(m); }
+    static void shrMutexUnlock(shrMutex* m) { ReleaseSRWLockExclusive(m); }
+#else
+    #define SHR_THREAD_LOCAL __thread
+    typedef pthread_mutex_t shrMutex;
+    #define SHR_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+    static void shrMutexInit(shrMutex* m)   { pthread_mutex_init(m, NULL); }
+    static void shrMutexLock(shrMutex* m)   { pthread_mutex_lock(m); }
+    static void shrMutexUnlock(shrMutex* m) { pthread_mutex_unlock(m); }
+#endif
+
+// Monotonic host clock in seconds, the same counters shrDeltaT reads but 
+// without its shared state so any thread can call it
+static double shrHostTime()
+{
+    #ifdef _WIN32
+        LARGE_INTEGER liCount, liFreq;
+        QueryPerformanceFrequency(&liFreq);
+        QueryPerformanceCounter(&liCount);
+        return (double)liCount.QuadPart / (double)liFreq.QuadPart;
+    #elif defined(CLOCK_MONOTONIC)
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+    #else
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (double)tv.tv_sec + 1.0e-6 * (double)tv.tv_usec;
+    #endif
+}
+
+struct shrProfileNode
+{
+    const char*                   name;
+    shrProfileNode*               parent;
+    std::vector<shrProfileNode*>  children;
+    unsigned long long            calls;
+    double                        inclusive;  // seconds spent inside the zone
+    double                        childTime;  // seconds spent inside child zones
+    double                        start;      // begin time of the open call
+    double                        running;    // time of the open call, only set while reporting
+};
+
+struct shrThreadProfile
+{
+    shrMutex        lock;      // taken by the owner on begin/end and by the report
+    shrProfileNode  root;
+    shrProfileNode* current;
+};
+
+static SHR_THREAD_LOCAL shrThreadProfile* pThreadProfile = NULL;
+static std::vector<shrThreadProfile*> ProfileThreads;
+static shrMutex ProfileLock = SHR_MUTEX_INITIALIZER;   // guards the members below
+static bool bProfileAtExit = false;
+static int iProfileEnabled = -1;
+static bool bProfileReported = false;
+static char* cProfilePathAndName = NULL;
+
+static void shrInitProfileNode(shrProfileNode* node, const char* name, shrProfileNode* parent)
+{
+    node->name = name;
+    node->parent = parent;
+    node->calls = 0;
+    node->inclusive = 0.0;
+    node->childTime = 0.0;
+    node->start = 0.0;
+    node->running = 0.0;
+}
+
+static shrProfileNode* shrFindProfileChild(shrProfileNode* parent, const char* name)
+{
+    for (size_t i = 0; i < parent->children.size(); ++i)
+    {
+        shrProfileNode* child = parent->children[i];
+        if ((child->name == name) || (strcmp(child->name, name) == 0))
+        {
+            return child;
+        }
+    }
+    shrProfileNode* child = new shrProfileNode;
+    shrInitProfileNode(child, name, parent);
+    parent->children.push_back(child);
+    return child;
+}
+
+static void shrProfileAtExit()
+{
+    shrProfileReport();
+}
+
+static bool shrProfileEnabled()
+{
+    if (iProfileEnabled < 0)
+    {
+        const char* env = getenv("SHR_PROFILE");
+        iProfileEnabled = ((env != NULL) && (strcmp(env, "0") == 0)) ? 0 : 1;
+    }
+    return (iProfileEnabled != 0);
+}
+
+// Profile of the calling thread, registered on first use.  Profiles are 
+// never freed so the report can still read them after the thread exited
+static shrThreadProfile* shrGetThreadProfile()
+{
+    if (pThreadProfile == NULL)
+    {
+        shrThreadProfile* tp = new shrThreadProfile;
+        shrMutexInit(&tp->lock);
+        shrInitProfileNode(&tp->root, "", NULL);
+        tp->current = &tp->root;
+
+        shrMutexLock(&ProfileLock);
+        if (!bProfileAtExit)
+        {
+            atexit(shrProfileAtExit);
+            bProfileAtExit = true;
+        }
+        ProfileThreads.push_back(tp);
+        shrMutexUnlock(&ProfileLock);
+        pThreadProfile = tp;
+    }
+    return pThreadProfile;
+}
+
+void shrProfileBegin(const char* cZoneName)
+{
+    if ((cZoneName == NULL) || !shrProfileEnabled())
+    {
+        return;
+    }
+    shrThreadProfile* tp = shrGetThreadProfile();
+    shrMutexLock(&tp->lock);
+    shrProfileNode* node = shrFindProfileChild(tp->current, cZoneName);
+    tp->current = node;
+    node->start = shrHostTime();
+    shrMutexUnlock(&tp->lock);
+}
+
+void shrProfileEnd(void)
+{
+    double now = shrHostTime();
+    shrThreadProfile* tp = pThreadProfile;
+    if ((tp == NULL) || (tp->current == &tp->root))
+    {
+        // unbalanced end or profiling disabled
+        return;
+    }
+    shrMutexLock(&tp->lock);
+    shrProfileNode* node = tp->current;
+    double dt = now - node->start;
+    node->calls++;
+    node->inclusive += dt;
+    node->parent->childTime += dt;
+    tp->current = node->parent;
+    shrMutexUnlock(&tp->lock);
+}
+
+void shrSetProfileFileName(const char* cOverRideName)
+{
+    if (cProfilePathAndName != NULL)
+    {
+        free(cProfilePathAndName);
+    }
+    cProfilePathAndName = (char*)malloc(strlen(cOverRideName) + 1);
+    #ifdef WIN32
+        strcpy_s(cProfilePathAndName, strlen(cOverRideName) + 1, cOverRideName);
+    #else
+        strcpy(cProfilePathAndName, cOverRideName);
+    #endif
+}
+
+// Add the zones below src into dst, zones still open count with their 
+// time so far
+static void shrMergeProfileNode(shrProfileNode* dst, const shrProfileNode* src)
+{
+    dst->calls += src->calls + ((src->running > 0.0) ? 1 : 0);
+    dst->inclusive += src->inclusive + src->running;
+    dst->childTime += src->childTime;
+    for (size_t i = 0; i < src->children.size(); ++i)
+    {
+        const shrProfileNode* child = src->children[i];
+        dst->childTime += child->running;
+        shrMergeProfileNode(shrFindProfileChild(dst, child->name), child);
+    }
+}
+
+static void shrFreeProfileNode(shrProfileNode* node)
+{
+    for (size_t i = 0; i < node->children.size(); ++i)
+    {
+        shrFreeProfileNode(node->children[i]);
+        delete node->children[i];
+    }
+    node->children.clear();
+}
+
+static bool shrCompareProfileNodes(const shrProfileNode* a, const shrProfileNode* b)
+{
+    return a->inclusive > b->inclusive;
+}
+
+static void shrReportProfileNode(shrProfileNode* node, int depth, const std::string& path, 
+                                 double total, FILE* fp)
+{
+    std::sort(node->children.begin(), node->children.end(), shrCompareProfileNodes);
+    for (size_t i = 0; i < node->children.size(); ++i)
+    {
+        shrProfileNode* child = node->children[i];
+        std::string childPath = path.empty() ? std::string(child->name) : path + "/" + child->name;
+        double exclusive = child->inclusive - child->childTime;
+        double percent = (total > 0.0) ? 100.0 * child->inclusive / total : 0.0;
+
+        std::string label(2 * depth, ' ');
+        label += child->name;
+        shrLog("  %-40s %10u %12.3f %12.3f %7.1f\n", label.c_str(), (unsigned int)child->calls, 
+               1000.0 * child->inclusive, 1000.0 * exclusive, percent);
+        if (fp != NULL)
+        {
+            fprintf(fp, "\"%s\",%d,%llu,%.6f,%.6f,%.2f\n", childPath.c_str(), depth, child->calls,
+                    1000.0 * child->inclusive, 1000.0 * exclusive, percent);
+        }
+        shrReportProfileNode(child, depth + 1, childPath, total, fp);
+    }
+}
+
+void shrProfileReport(void)
+{
+    shrMutexLock(&ProfileLock);
+    if (bProfileReported || ProfileThreads.empty())
+    {
+        shrMutexUnlock(&ProfileLock);
+        return;
+    }
+    bProfileReported = true;
+
+    // merge the per-thread trees by zone path
+    shrProfileNode merged;
+    shrInitProfileNode(&merged, "", NULL);
+    double now = shrHostTime();
+    for (size_t t = 0; t < ProfileThreads.size(); ++t)
+    {
+        shrThreadProfile* tp = ProfileThreads[t];
+        shrMutexLock(&tp->lock);
+        for (shrProfileNode* node = tp->current; node != &tp->root; node = node->parent)
+        {
+            node->running = now - node->start;
+        }
+        shrMergeProfileNode(&merged, &tp->root);
+        for (shrProfileNode* node = tp->current; node != &tp->root; node = node->parent)
+        {
+            node->running = 0.0;
+        }
+        shrMutexUnlock(&tp->lock);
+    }
+    unsigned int numThreads = (unsigned int)ProfileThreads.size();
+    shrMutexUnlock(&ProfileLock);
+
+    if (merged.children.empty())
+    {
+        return;
+    }
+
+    double total = 0.0;
+    for (size_t i = 0; i < merged.children.size(); ++i)
+    {
+        total += merged.children[i]->inclusive;
+    }
+
+    const char* cFileName = cProfilePathAndName;
+    const char* env = getenv("SHR_PROFILE");
+    if ((cFileName == NULL) && (env != NULL) && (strcmp(env, "1") != 0))
+    {
+        cFileName = env;
+    }
+    if (cFileName == NULL)
+    {
+        cFileName = DEFAULTPROFILEFILE;
+    }
+
+    FILE* fp = NULL;
+    #ifdef _WIN32
+        if (fopen_s(&fp, cFileName, "w") != 0)
+        {
+            fp = NULL;
+        }
+    #else
+        fp = fopen(cFileName, "w");
+    #endif
+    if (fp != NULL)
+    {
+        fprintf(fp, "zone,depth,calls,inclusive_ms,exclusive_ms,percent\n");
+    }
+
+    shrLog("\nHost profile (%u thread(s), times summed over threads):\n", numThreads);
+    shrLog("  %-40s %10s %12s %12s %7s\n", "Zone", "Calls", "Incl (ms)", "Excl (ms)", "Incl %");
+    shrReportProfileNode(&merged, 0, std::string(), total, fp);
+    shrLog("\n");
+
+    if (fp != NULL)
+    {
+        fclose(fp);
+        shrLog("Host profile written to <%s>\n\n", cFileName);
+    }
+    shrFreeProfileNode(&merged);
+}
+
+// Logging
 // *********************************************************************
-static int shrLogV(int iLogMode, int iErrNum, const char* cFormatString, va_list vaArgList)
+// shrLogEx formats the message on the calling thread and writes it to the
+// console and/or log files.  In asynchronous mode (shrSetLogAsync or 
+// SHR_LOG_ASYNC=1) the caller instead copies the formatted text, or for 
+// shrLogDeferred the format string and its arguments, into a bounded 
+// lock-free ring and a background thread formats, writes and flushes it.
+static FILE* pFileStream0 = NULL;                           // sample log file
+static FILE* pFileStream1 = NULL;                           // master log file
+static shrMutex LogWriteLock = SHR_MUTEX_INITIALIZER;       // serializes writers of the streams
+
+// Scan the format specifier starting at the '%' in pStr, returns the last 
+// character consumed and the specifier and its type in sFormatSpec / cType
+// (cType is 0 if the specifier has no supported type)
+static const char* shrLogScanSpec(const char* pStr, std::string& sFormatSpec, char& cType)
+{
+    static const std::string sFormatChars = " -+#0123456789.dioufnpcsXxEeGgAa";
+    static const std::string sTypeChars = "dioufnpcsXxEeGgAa";
+
+    // skip over the '%' and read the full format specifier for the argument
+    ++pStr;
+    sFormatSpec = '%';
+    cType = 0;
+
+    // special handling for string of %%%%
+    bool bRepeater = (*pStr == '%');
+    if (bRepeater)
+    {
+        cType = '%';
+    }
+
+    // chars after the '%' are part of format if on list of constants... scan until that isn't true or NULL is found
+    while (*pStr && ((sFormatChars.find(*pStr) != string::npos) || bRepeater))    
+    {
+        sFormatSpec += *pStr;
+
+        // If the char is a type specifier, trap it and stop scanning
+        // (a type specifier char is always the last in the format except for string of %%%)
+        if (sTypeChars.find(*pStr) != string::npos)    
+        {
+            cType = *pStr;
+            break;                                      
+        }
+
+        // Special handling for string of %%%
+        // If a string of %%% was started and then it ends, break (There won't be a typical type specifier)
+        if (bRepeater && (*pStr != '%'))
+        {
+            break;
+        }
+
+        pStr++;
+    }
+    return pStr;
+}
+
+// Append one formatted argument to sOut
+template<class T>
+static void shrLogAppend(std::string& sOut, const std::string& sFormatSpec, T arg)
+{
+    char cBuffer[256];
+    #ifdef _WIN32
+        int iLen = _snprintf_s(cBuffer, sizeof(cBuffer), _TRUNCATE, sFormatSpec.c_str(), arg);
+    #else
+        int iLen = snprintf(cBuffer, sizeof(cBuffer), sFormatSpec.c_str(), arg);
+    #endif
+    if ((iLen >= 0) && (iLen < (int)sizeof(cBuffer)))
+    {
+        sOut.append(cBuffer, iLen);
+    }
+    else
+    {
+        // longer than the stack buffer (long %s) or truncated on Windows
+        std::vector<char> vBuffer(MAX(iLen, (int)(64 * 1024)) + 1);
+        #ifdef _WIN32
+            iLen = _snprintf_s(&vBuffer[0], vBuffer.size(), _TRUNCATE, sFormatSpec.c_str(), arg);
+        #else
+            iLen = snprintf(&vBuffer[0], vBuffer.size(), sFormatSpec.c_str(), arg);
+        #endif
+        sOut.append(&vBuffer[0], (iLen < 0) ? strlen(&vBuffer[0]) : MIN((size_t)iLen, vBuffer.size() - 1));
+    }
+}
+
+// Argument source reading a va_list
+struct shrLogVaArgs
+{
+    va_list vaArgList;
+
+    shrLogVaArgs(va_list vaSrc) { va_copy(vaArgList, vaSrc); }
+    ~shrLogVaArgs() { va_end(vaArgList); }
+
+    int          nextInt()    { return va_arg(vaArgList, int); }
+    unsigned int nextUInt()   { return va_arg(vaArgList, unsigned int); }
+    double       nextDouble() { return va_arg(vaArgList, double); }
+    const char*  nextString() { return va_arg(vaArgList, const char*); }
+    const void*  nextPointer() { return va_arg(vaArgList, const void*); }
+};
+
+// Argument source reading the arguments packed by shrLogPackArgs
+struct shrLogPackedArgs
+{
+    const char* pData;
+    const char* pEnd;
+
+    template<class T>
+    T next(char cTag)
+    {
+        T value = T();
+        if ((pData < pEnd) && (*pData == cTag) && (pData + 1 + sizeof(T) <= pEnd))
+        {
+            memcpy(&value, pData + 1, sizeof(T));
+            pData += 1 + sizeof(T);
+        }
+        return value;
+    }
+    int          nextInt()    { return next<int>('i'); }
+    unsigned int nextUInt()   { return next<unsigned int>('u'); }
+    double       nextDouble() { return next<double>('d'); }
+    const void*  nextPointer() { return next<const void*>('p'); }
+    const char*  nextString() 
+    {
+        if ((pData < pEnd) && (*pData == 's'))
+        {
+            const char* pStr = pData + 1;
+            pData = pStr + strlen(pStr) + 1;
+            return pStr;
+        }
+        return "";
+    }
+};
+
+// Expand cFormatString with the arguments from args into sOut
+template<class Args>
+static void shrLogFormat(std::string& sOut, const char* cFormatString, Args& args)
+{
+    std::string sFormatSpec;
+    char cType;
+
+    // Start at the head of the string and scan to the null at the end
+    for (const char* pStr = cFormatString; *pStr; ++pStr)
+    {
+        // Check if the current character is not a formatting specifier ('%') 
+        if (*pStr != '%')
+        {
+            // character is not '%', so copy it verbatim
+            sOut += *pStr;
+            continue;
+        }
+
+        pStr = shrLogScanSpec(pStr, sFormatSpec, cType);
+
+        // Now handle the arg according to type 
+        switch (cType)
+        {
+            case '%':   // special handling for string of %%%%
+                shrLogAppend(sOut, sFormatSpec, 0);
+                break;
+            case 'c':   // single byte char
+                shrLogAppend(sOut, sFormatSpec, args.nextInt());
+                break;
+            case 's':   // string of single byte chars
+                shrLogAppend(sOut, sFormatSpec, args.nextString());
+                break;
+            case 'd':   // signed decimal integer 
+            case 'i':   // signed decimal integer 
+                shrLogAppend(sOut, sFormatSpec, args.nextInt());
+                break;
+            case 'u':   // unsigned decimal integer 
+            case 'o':   // unsigned octal integer 
+            case 'x':   // unsigned hexadecimal integer using "abcdef"
+            case 'X':   // unsigned hexadecimal integer using "ABCDEF"
+                shrLogAppend(sOut, sFormatSpec, args.nextUInt());
+                break;
+            case 'f':   // float/double
+            case 'e':   // scientific double/float
+            case 'E':   // scientific double/float
+            case 'g':   // scientific double/float
+            case 'G':   // scientific double/float
+            case 'a':   // signed hexadecimal double precision float
+            case 'A':   // signed hexadecimal double precision float
+                shrLogAppend(sOut, sFormatSpec, args.nextDouble());
+                break;
+            case 'p':   // pointer
+                shrLogAppend(sOut, sFormatSpec, args.nextPointer());
+                break;
+            case 'n':   // no write-back to the caller, the pointer is only skipped
+                args.nextPointer();
+                break;
+            default: 
+                // copy the char of an unknown/unsupported type verbatim
+                if (*pStr == 0)
+                {
+                    return;
+                }
+                sOut += *pStr;
+                break;
+        }
+    }
+}
+
+// Pack the arguments cFormatString consumes, each as a type tag followed by
+// the value (strings are copied including their terminating null)
+static void shrLogPackArgs(std::string& sOut, const char* cFormatString, va_list vaSrc)
+{
+    shrLogVaArgs args(vaSrc);
+    std::string sFormatSpec;
+    char cType;
+
+    for (const char* pStr = cFormatString; *pStr; ++pStr)
+    {
+        if (*pStr != '%')
+        {
+            continue;
+        }
+        pStr = shrLogScanSpec(pStr, sFormatSpec, cType);
+        switch (cType)
+        {
+            case 'c': case 'd': case 'i':
+            {
+                int iArg = args.nextInt();
+                sOut += 'i';
+                sOut.append((const char*)&iArg, sizeof(iArg));
+                break;
+            }
+            case 'u': case 'o': case 'x': case 'X':
+            {
+                unsigned int uiArg = args.nextUInt();
+                sOut += 'u';
+                sOut.append((const char*)&uiArg, sizeof(uiArg));
+                break;
+            }
+            case 'f': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            {
+                double dArg = args.nextDouble();
+                sOut += 'd';
+                sOut.append((const char*)&dArg, sizeof(dArg));
+                break;
+            }
+            case 'p': case 'n':
+            {
+                const void* pArg = args.nextPointer();
+                sOut += 'p';
+                sOut.append((const char*)&pArg, sizeof(pArg));
+                break;
+            }
+            case 's':
+            {
+                const char* cArg = args.nextString();
+                sOut += 's';
+                sOut.append(cArg ? cArg : "(null)");
+                sOut += '\0';
+                break;
+            }
+            default:
+                if (*pStr == 0)
+                {
+                    return;
+                }
+                break;
+        }
+    }
+}
+
+// Open the log files iLogMode needs, returns the mode that can be served
+static int shrLogOpenStreams(int iLogMode)
 {
-    static FILE* pFileStream0 = NULL;
-    static FILE* pFileStream1 = NULL;
-    size_t szNumWritten = 0;
     char cFileMode [3];
 
     // if the sample log file is closed and the call includes a "write-to-file", open file for writing
@@ -206,6 +792,7 @@ static int shrLogV(int iLogMode, int iErrNum, const char* cFormatString, va_list
                 if (pFileStream0)
                 {
                     fclose (pFileStream0);
+                    pFileStream0 = NULL;
                 }
 				iLogMode = LOGCONSOLE; // if we can't open a file, we will still output to the console window
             }
@@ -223,11 +810,6 @@ static int shrLogV(int iLogMode, int iErrNum, const char* cFormatString, va_list
             // open the file in the requested mode
             if ((pFileStream0 = fopen(cLogFilePathAndName, cFileMode)) == 0)
             {
-                // if error on attempt to open, be sure the file is null or close it, then return negative error code
-                if (pFileStream0)
-                {
-                    fclose (pFileStream0);
-                }
 				iLogMode = LOGCONSOLE; // if we can't open a file, we will still output to the console window
             }
         #endif
@@ -249,21 +831,13 @@ static int shrLogV(int iLogMode, int iErrNum, const char* cFormatString, va_list
 					pFileStream1 = NULL;
                 }
 				iLogMode = LOGCONSOLE;  // Force to LOGCONSOLE only since the file stream is invalid
-//				return -err;
             }
         #else           // Linux & Mac version
 
             // open the file in the requested mode
             if ((pFileStream1 = fopen(MASTERLOGFILE, "a+")) == 0)
             {
-                // if error on attempt to open, be sure the file is null or close it, then return negative error code
-                if (pFileStream1)
-                {
-                    fclose (pFileStream1);
-					pFileStream1 = NULL;
-                }
 				iLogMode = LOGCONSOLE;  // Force to LOGCONSOLE only since the file stream is invalid
-//              return -1;
             }
         #endif
         
@@ -282,250 +856,473 @@ static int shrLogV(int iLogMode, int iErrNum, const char* cFormatString, va_list
 			}
 		}
     }
+    return iLogMode;
+}
+
+// Flush the streams written since the last flush
+static void shrLogFlushStreams(int iLogMode)
+{
+    if (iLogMode & LOGCONSOLE) 
+    {
+        fflush(stdout);
+    }
+    if ((iLogMode & LOGFILE) && pFileStream0)
+    {
+        fflush (pFileStream0);
+    }
+    // if the master log file has been updated, flush it too
+    if ((iLogMode & LOGFILE) && (iLogMode & MASTER) && pFileStream1)
+    {
+        fflush (pFileStream1);
+    }
+}
+
+// Write one formatted message to console and/or files, the caller holds
+// LogWriteLock.  Returns the modes whose streams were written
+static int shrLogWriteText(int iLogMode, int iErrNum, const char* cText, size_t szLen, bool bFlush)
+{
+    iLogMode = shrLogOpenStreams(iLogMode);
 
     // Handle special Error Message code
     if (iLogMode & ERRORMSG)  
     {   
-        // print string to console if flagged
         if (iLogMode & LOGCONSOLE) 
         {
-            szNumWritten = printf ("\n !!! Error # %i at ", iErrNum);                           // console 
+            printf ("\n !!! Error # %i at ", iErrNum);                                        // console 
         }
-        // print string to file if flagged
         if (iLogMode & LOGFILE) 
         {
-            szNumWritten = fprintf (pFileStream0, "\n !!! Error # %i at ", iErrNum);            // sample log file
+            fprintf (pFileStream0, "\n !!! Error # %i at ", iErrNum);                         // sample log file
         }
     }
 
-    // Vars used for variable argument processing
-    const char*     pStr; 
-    const char*     cArg;
-    int             iArg;
-    double          dArg;
-    unsigned int    uiArg;
-    std::string sFormatSpec;
-    const std::string sFormatChars = " -+#0123456789.dioufnpcsXxEeGgAa";
-    const std::string sTypeChars = "dioufnpcsXxEeGgAa";
-    char cType = 'c';
+    if (iLogMode & LOGCONSOLE) 
+    {
+        fwrite(cText, 1, szLen, stdout);                                                        // console 
+    }
+    if (iLogMode & LOGFILE)    
+    {
+        fwrite(cText, 1, szLen, pFileStream0);                                                  // sample log file
+        if (iLogMode & MASTER)                          
+        {
+            fwrite(cText, 1, szLen, pFileStream1);                                              // master log file
+        }
+    }
 
-    // Start at the head of the string and scan to the null at the end
-    for (pStr = cFormatString; *pStr; ++pStr)
+    // end the sample log with a horizontal line if closing
+    if (iLogMode & CLOSELOG) 
     {
-        // Check if the current character is not a formatting specifier ('%') 
-        if (*pStr != '%')
+        if (iLogMode & LOGCONSOLE) 
         {
-            // character is not '%', so print it verbatim to console and/or files as flagged
-            if (iLogMode & LOGCONSOLE) 
-            {
-                szNumWritten = putc(*pStr, stdout);                                             // console 
-            }
-            if (iLogMode & LOGFILE)    
-            {
-                szNumWritten  = putc(*pStr, pFileStream0);                                      // sample log file
-                if (iLogMode & MASTER)                          
-                {
-                    szNumWritten = putc(*pStr, pFileStream1);                                   // master log file
-                }
-            }
-        } 
-        else 
+            printf(HDASHLINE);
+        }
+        if (iLogMode & LOGFILE)
         {
-            // character is '%', so skip over it and read the full format specifier for the argument
-            ++pStr;
-            sFormatSpec = '%';
+            fprintf(pFileStream0, HDASHLINE);
+        }
+    }
 
-            // special handling for string of %%%%
-            bool bRepeater = (*pStr == '%');
-            if (bRepeater)
-            {
-                cType = '%';
-            }
+    // flush console and/or file buffers if updated
+    if (bFlush || (iLogMode & CLOSELOG))
+    {
+        shrLogFlushStreams(iLogMode);
+    }
 
-            // chars after the '%' are part of format if on list of constants... scan until that isn't true or NULL is found
-            while (pStr && ((sFormatChars.find(*pStr) != string::npos) || bRepeater))    
-            {
-                sFormatSpec += *pStr;
+    // If the log file is open and the caller requests "close file", then close and NULL file handle
+    if ((pFileStream0) && (iLogMode & CLOSELOG))
+    {
+        fclose (pFileStream0);
+        pFileStream0 = NULL;
+    }
+    if ((pFileStream1) && (iLogMode & CLOSELOG))
+    {
+        fclose (pFileStream1);
+        pFileStream1 = NULL;
+    }
+    return iLogMode;
+}
 
-                // If the char is a type specifier, trap it and stop scanning
-                // (a type specifier char is always the last in the format except for string of %%%)
-                if (sTypeChars.find(*pStr) != string::npos)    
-                {
-                    cType = *pStr;
-                    break;                                      
-                }
+// Asynchronous log ring
+// *********************************************************************
+// A record occupies one or more consecutive slots.  Producers claim slots 
+// with a compare-and-swap on uiLogTail, copy their payload and publish each
+// slot by advancing its sequence number (Vyukov's bounded queue, extended 
+// to multi-slot claims).  The single drain thread consumes from uiLogHead 
+// and hands the slots back by advancing their sequence by the ring size.
+// A full ring makes producers wait, so memory stays bounded.  Records 
+// larger than SHR_LOG_MAX_RECORD_SLOTS slots are written synchronously.
+#define SHR_LOG_SLOT_PAYLOAD 232
+#define SHR_LOG_NUM_SLOTS 4096                              // ~1 MB of ring
+#define SHR_LOG_MAX_RECORD_SLOTS (SHR_LOG_NUM_SLOTS / 4)
+
+enum shrLogRecordKind
+{
+    SHR_LOG_TEXT = 0,       // preformatted text
+    SHR_LOG_DEFERRED = 1    // format string, null, packed arguments
+};
 
-                // Special handling for string of %%%
-                // If a string of %%% was started and then it ends, break (There won't be a typical type specifier)
-                if (bRepeater && (*pStr != '%'))
-                {
-                    break;
-                }
+struct shrLogSlot
+{
+    volatile unsigned int seq;
+    unsigned int          numSlots;     // slots of the record (first slot only)
+    unsigned int          payloadSize;  // bytes of the record (first slot only)
+    int                   iLogMode;
+    int                   iErrNum;
+    int                   iKind;
+    char                  data[SHR_LOG_SLOT_PAYLOAD];
+};
+
+static shrLogSlot* pLogRing = NULL;
+static volatile unsigned int uiLogTail = 0;     // next position to claim
+static volatile unsigned int uiLogHead = 0;     // next position to drain
+static volatile int iLogAsync = -1;             // -1: not decided yet
+static volatile int iLogStop = 0;
+static volatile int iLogProducers = 0;          // producers inside shrLogEnqueue
+static shrMutex LogControlLock = SHR_MUTEX_INITIALIZER;
+#ifdef _WIN32
+    static HANDLE hLogThread = NULL;
+#else
+    static pthread_t hLogThread;
+#endif
 
-                pStr++;
-            }
+static bool shrLogCAS(volatile unsigned int* p, unsigned int uiExpected, unsigned int uiDesired)
+{
+    #ifdef _WIN32
+        return (InterlockedCompareExchange((volatile LONG*)p, (LONG)uiDesired, (LONG)uiExpected) == (LONG)uiExpected);
+    #else
+        return __sync_bool_compare_and_swap(p, uiExpected, uiDesired);
+    #endif
+}
 
-            // Now handle the arg according to type 
-            switch (cType)
-            {
-                case '%':   // special handling for string of %%%%
-                {
-                    if (iLogMode & LOGCONSOLE) 
-                    {
-                        szNumWritten = printf(sFormatSpec.c_str());                             // console 
-                    }
-                    if (iLogMode & LOGFILE)
-                    {
-                        szNumWritten = fprintf (pFileStream0, sFormatSpec.c_str());             // sample log file
-                        if (iLogMode & MASTER)                          
-                        {
-                            szNumWritten  = fprintf(pFileStream1, sFormatSpec.c_str());         // master log file
-                        }
-                    }
-                    continue;
-                }
-                case 'c':   // single byte char
-                case 's':   // string of single byte chars
-                {
-                    // Set cArg as the next value in list and print to console and/or files if flagged
-                    cArg = va_arg(vaArgList, char*);
-                    if (iLogMode & LOGCONSOLE) 
-                    {
-                        szNumWritten = printf(sFormatSpec.c_str(), cArg);                       // console 
-                    }
-                    if (iLogMode & LOGFILE)
-                    {
-                        szNumWritten = fprintf (pFileStream0, sFormatSpec.c_str(), cArg);       // sample log file
-                        if (iLogMode & MASTER)                          
-                        {
-                            szNumWritten  = fprintf(pFileStream1, sFormatSpec.c_str(), cArg);   // master log file
-                        }
-                    }
-                    continue;
-                }
-                case 'd':   // signed decimal integer 
-                case 'i':   // signed decimal integer 
-                {
-                    // set iArg as the next value in list and print to console and/or files if flagged
-                    iArg = va_arg(vaArgList, int);
-                    if (iLogMode & LOGCONSOLE) 
-                    {
-                        szNumWritten = printf(sFormatSpec.c_str(), iArg);                       // console 
-                    }
-                    if (iLogMode & LOGFILE)
-                    {
-                        szNumWritten = fprintf (pFileStream0, sFormatSpec.c_str(), iArg);       // sample log file  
-                        if (iLogMode & MASTER)                          
-                        {
-                            szNumWritten  = fprintf(pFileStream1, sFormatSpec.c_str(), iArg);   // master log file
-                        }
-                    }
-                    continue;
-                }
-                case 'u':   // unsigned decimal integer 
-                case 'o':   // unsigned octal integer 
-                case 'x':   // unsigned hexadecimal integer using "abcdef"
-                case 'X':   // unsigned hexadecimal integer using "ABCDEF"
-                {
-                    // set uiArg as the next value in list and print to console and/or files if flagged
-                    uiArg = va_arg(vaArgList, unsigned int);
-                    if (iLogMode & LOGCONSOLE)                                                  
-                    {
-                        szNumWritten = printf(sFormatSpec.c_str(), uiArg);                      // console 
-                    }
-                    if (iLogMode & LOGFILE)
-                    {
-                        szNumWritten = fprintf (pFileStream0, sFormatSpec.c_str(), uiArg);      // sample log file
-                        if (iLogMode & MASTER)                          
-                        {
-                            szNumWritten  = fprintf(pFileStream1, sFormatSpec.c_str(), uiArg);  // master log file
-                        }
-                    }
-                    continue;
-                }
-                case 'f':   // float/double
-                case 'e':   // scientific double/float
-                case 'E':   // scientific double/float
-                case 'g':   // scientific double/float
-                case 'G':   // scientific double/float
-                case 'a':   // signed hexadecimal double precision float
-                case 'A':   // signed hexadecimal double precision float
-                {
-                    // set dArg as the next value in list and print to console and/or files if flagged
-                    dArg = va_arg(vaArgList, double);
-                    if (iLogMode & LOGCONSOLE) 
-                    {
-                        szNumWritten = printf(sFormatSpec.c_str(), dArg);                       // console 
-                    }
-                    if (iLogMode & LOGFILE)
-                    {
-                        szNumWritten = fprintf (pFileStream0, sFormatSpec.c_str(), dArg);       // sample log file
-                        if (iLogMode & MASTER)                          
-                        {
-                            szNumWritten  = fprintf(pFileStream1, sFormatSpec.c_str(), dArg);   // master log file
-                        }
-                    }
-                    continue;
-                }
-                default: 
-                {
-                    // print arg of unknown/unsupported type to console and/or file if flagged
-                    if (iLogMode & LOGCONSOLE)                          // console 
-                    {
-                        szNumWritten = putc(*pStr, stdout);
-                    }
-                    if (iLogMode & LOGFILE)    
-                    {
-                        szNumWritten  = putc(*pStr, pFileStream0);      // sample log file
-                        if (iLogMode & MASTER)                          
-                        {
-                            szNumWritten  = putc(*pStr, pFileStream1);  // master log file
-                        }
-                    }
-                }
-            }
+static void shrLogAdd(volatile int* p, int iValue)
+{
+    #ifdef _WIN32
+        InterlockedExchangeAdd((volatile LONG*)p, (LONG)iValue);
+    #else
+        __sync_fetch_and_add(p, iValue);
+    #endif
+}
+
+static void shrLogFence()
+{
+    #ifdef _WIN32
+        MemoryBarrier();
+    #else
+        __sync_synchronize();
+    #endif
+}
+
+static void shrLogPause(unsigned int uiMicroseconds)
+{
+    #ifdef _WIN32
+        Sleep((uiMicroseconds + 999) / 1000);
+    #else
+        usleep(uiMicroseconds);
+    #endif
+}
+
+// Drain one record if one is published, returns false if the ring is empty
+static bool shrLogDrainRecord(std::string& sPayload, std::string& sText)
+{
+    unsigned int uiPos = uiLogHead;
+    shrLogSlot* pFirst = &pLogRing[uiPos % SHR_LOG_NUM_SLOTS];
+    if ((int)(pFirst->seq - (uiPos + 1)) < 0)
+    {
+        return false;
+    }
+    shrLogFence();
+
+    // wait until every slot of the record is published
+    unsigned int uiNumSlots = pFirst->numSlots;
+    for (unsigned int i = 1; i < uiNumSlots; ++i)
+    {
+        shrLogSlot* pSlot = &pLogRing[(uiPos + i) % SHR_LOG_NUM_SLOTS];
+        while ((int)(pSlot->seq - (uiPos + i + 1)) < 0)
+        {
+            shrLogPause(10);
         }
     }
+    shrLogFence();
 
-    // end the sample log with a horizontal line if closing
-    if (iLogMode & CLOSELOG) 
+    sPayload.resize(0);
+    unsigned int uiRemaining = pFirst->payloadSize;
+    for (unsigned int i = 0; i < uiNumSlots; ++i)
     {
-        if (iLogMode & LOGCONSOLE) 
+        unsigned int uiChunk = MIN(uiRemaining, (unsigned int)SHR_LOG_SLOT_PAYLOAD);
+        sPayload.append(pLogRing[(uiPos + i) % SHR_LOG_NUM_SLOTS].data, uiChunk);
+        uiRemaining -= uiChunk;
+    }
+    int iLogMode = pFirst->iLogMode;
+    int iErrNum = pFirst->iErrNum;
+    int iKind = pFirst->iKind;
+
+    // hand the slots back to the producers
+    shrLogFence();
+    for (unsigned int i = 0; i < uiNumSlots; ++i)
+    {
+        pLogRing[(uiPos + i) % SHR_LOG_NUM_SLOTS].seq = uiPos + i + SHR_LOG_NUM_SLOTS;
+    }
+    shrLogFence();
+    uiLogHead = uiPos + uiNumSlots;
+
+    const char* cText = sPayload.c_str();
+    size_t szLen = sPayload.size();
+    if (iKind == SHR_LOG_DEFERRED)
+    {
+        const char* cFormat = sPayload.c_str();
+        shrLogPackedArgs args = { cFormat + strlen(cFormat) + 1, sPayload.c_str() + sPayload.size() };
+        sText.resize(0);
+        shrLogFormat(sText, cFormat, args);
+        cText = sText.c_str();
+        szLen = sText.size();
+    }
+
+    shrMutexLock(&LogWriteLock);
+    shrLogWriteText(iLogMode, iErrNum, cText, szLen, false);
+    shrMutexUnlock(&LogWriteLock);
+    return true;
+}
+
+#ifdef _WIN32
+    static DWORD WINAPI shrLogThreadMain(LPVOID)
+#else
+    static void* shrLogThreadMain(void*)
+#endif
+{
+    std::string sPayload, sText;
+    unsigned int uiIdle = 0;
+    int iWritten = 0;
+    for (;;)
+    {
+        if (shrLogDrainRecord(sPayload, sText))
         {
-            printf(HDASHLINE);
+            uiIdle = 0;
+            iWritten = 1;
+            continue;
         }
-        if (iLogMode & LOGFILE)
+
+        // ring is empty: flush what was written, then back off
+        if (iWritten)
         {
-            fprintf(pFileStream0, HDASHLINE);
+            shrMutexLock(&LogWriteLock);
+            shrLogFlushStreams(LOGBOTH | MASTER);
+            shrMutexUnlock(&LogWriteLock);
+            iWritten = 0;
+        }
+        shrLogFence();
+        if (iLogStop && (uiLogHead == uiLogTail))
+        {
+            break;
         }
+        uiIdle = MIN(uiIdle + 1, 40u);
+        shrLogPause(50 * uiIdle);
     }
+    return 0;
+}
 
-    // flush console and/or file buffers if updated
-    if (iLogMode & LOGCONSOLE) 
+// Queue one record, returns false if the record has to be written 
+// synchronously (asynchronous logging is off or the record is too large)
+static bool shrLogEnqueue(int iLogMode, int iErrNum, int iKind, const std::string& sPayload)
+{
+    if (sPayload.size() > (size_t)(SHR_LOG_MAX_RECORD_SLOTS * SHR_LOG_SLOT_PAYLOAD))
     {
-        fflush(stdout);
+        return false;
     }
-    if (iLogMode & LOGFILE)
+    unsigned int uiSize = (unsigned int)sPayload.size();
+    unsigned int uiNumSlots = MAX((uiSize + SHR_LOG_SLOT_PAYLOAD - 1) / SHR_LOG_SLOT_PAYLOAD, 1u);
+
+    // shrSetLogAsync(false) waits for the producers counted here, so a 
+    // record that sees asynchronous logging on is drained before it returns
+    shrLogAdd(&iLogProducers, 1);
+    shrLogFence();
+
+    // claim uiNumSlots consecutive slots.  The drain thread frees slots in 
+    // order, so the last one being free means all of them are
+    unsigned int uiPos;
+    for (;;)
     {
-        fflush (pFileStream0);
+        if (iLogAsync != 1)
+        {
+            shrLogAdd(&iLogProducers, -1);
+            return false;
+        }
+        uiPos = uiLogTail;
+        shrLogSlot* pLast = &pLogRing[(uiPos + uiNumSlots - 1) % SHR_LOG_NUM_SLOTS];
+        int iDiff = (int)(pLast->seq - (uiPos + uiNumSlots - 1));
+        if (iDiff == 0)
+        {
+            if (shrLogCAS(&uiLogTail, uiPos, uiPos + uiNumSlots))
+            {
+                break;
+            }
+        }
+        else if (iDiff < 0)
+        {
+            // ring is full, wait for the drain thread
+            shrLogPause(100);
+        }
+    }
+    shrLogFence();
+
+    shrLogSlot* pFirst = &pLogRing[uiPos % SHR_LOG_NUM_SLOTS];
+    pFirst->numSlots = uiNumSlots;
+    pFirst->payloadSize = uiSize;
+    pFirst->iLogMode = iLogMode;
+    pFirst->iErrNum = iErrNum;
+    pFirst->iKind = iKind;
+    for (unsigned int i = 0; i < uiNumSlots; ++i)
+    {
+        unsigned int uiOffset = i * SHR_LOG_SLOT_PAYLOAD;
+        unsigned int uiChunk = MIN(uiSize - uiOffset, (unsigned int)SHR_LOG_SLOT_PAYLOAD);
+        memcpy(pLogRing[(uiPos + i) % SHR_LOG_NUM_SLOTS].data, sPayload.data() + uiOffset, uiChunk);
+    }
+    shrLogFence();
 
-        // if the master log file has been updated, flush it too
-        if (iLogMode & MASTER)
+    // publish
+    for (unsigned int i = 0; i < uiNumSlots; ++i)
+    {
+        pLogRing[(uiPos + i) % SHR_LOG_NUM_SLOTS].seq = uiPos + i + 1;
+    }
+    shrLogFence();
+    shrLogAdd(&iLogProducers, -1);
+    return true;
+}
+
+static void shrLogShutdown()
+{
+    shrSetLogAsync(false);
+}
+
+void shrSetLogAsync(bool bEnable)
+{
+    shrMutexLock(&LogControlLock);
+    if (bEnable && (iLogAsync != 1))
+    {
+        if (pLogRing == NULL)
         {
-            fflush (pFileStream1);
+            pLogRing = new shrLogSlot[SHR_LOG_NUM_SLOTS];
+            for (unsigned int i = 0; i < SHR_LOG_NUM_SLOTS; ++i)
+            {
+                pLogRing[i].seq = uiLogTail + i;
+            }
+            atexit(shrLogShutdown);
         }
+        iLogStop = 0;
+        #ifdef _WIN32
+            hLogThread = CreateThread(NULL, 0, shrLogThreadMain, NULL, 0, NULL);
+            bool bStarted = (hLogThread != NULL);
+        #else
+            bool bStarted = (pthread_create(&hLogThread, NULL, shrLogThreadMain, NULL) == 0);
+        #endif
+        shrLogFence();
+        iLogAsync = bStarted ? 1 : 0;
     }
+    else if (!bEnable && (iLogAsync == 1))
+    {
+        // stop accepting records, wait for the producers that got in (the 
+        // drain thread keeps running, so one waiting for slots finishes),
+        // then let the drain thread empty the ring and exit
+        iLogAsync = 0;
+        shrLogFence();
+        while (iLogProducers != 0)
+        {
+            shrLogPause(10);
+        }
+        shrLogFence();
+        iLogStop = 1;
+        #ifdef _WIN32
+            WaitForSingleObject(hLogThread, INFINITE);
+            CloseHandle(hLogThread);
+        #else
+            pthread_join(hLogThread, NULL);
+        #endif
 
-    // If the log file is open and the caller requests "close file", then close and NULL file handle
-    if ((pFileStream0) && (iLogMode & CLOSELOG))
+        // the drain thread has emptied the ring, this is only a safety net
+        std::string sPayload, sText;
+        while ((int)(uiLogHead - uiLogTail) < 0)
+        {
+            if (!shrLogDrainRecord(sPayload, sText))
+            {
+                shrLogPause(10);
+            }
+        }
+        shrMutexLock(&LogWriteLock);
+        shrLogFlushStreams(LOGBOTH | MASTER);
+        shrMutexUnlock(&LogWriteLock);
+    }
+    else if (iLogAsync < 0)
     {
-        fclose (pFileStream0);
-        pFileStream0 = NULL;
+        iLogAsync = 0;
     }
-    if ((pFileStream1) && (iLogMode & CLOSELOG))
+    shrMutexUnlock(&LogControlLock);
+}
+
+void shrLogFlush(void)
+{
+    if (iLogAsync != 1)
     {
-        fclose (pFileStream1);
-        pFileStream1 = NULL;
+        return;
+    }
+    unsigned int uiTarget = uiLogTail;
+    while ((int)(uiLogHead - uiTarget) < 0)
+    {
+        shrLogPause(50);
+    }
+    shrMutexLock(&LogWriteLock);
+    shrLogFlushStreams(LOGBOTH | MASTER);
+    shrMutexUnlock(&LogWriteLock);
+}
+
+// Decide once whether SHR_LOG_ASYNC asks for asynchronous logging
+static bool shrLogIsAsync()
+{
+    if (iLogAsync < 0)
+    {
+        const char* env = getenv("SHR_LOG_ASYNC");
+        shrSetLogAsync((env != NULL) && (strcmp(env, "0") != 0));
+    }
+    return (iLogAsync == 1);
+}
+
+// Function to log standardized information to console, file or both
+// *********************************************************************
+static int shrLogV(int iLogMode, int iErrNum, const char* cFormatString, va_list vaArgList, bool bDeferred)
+{
+    std::string sPayload;
+    int iKind = SHR_LOG_TEXT;
+    bool bAsync = shrLogIsAsync();
+    if (bAsync && bDeferred)
+    {
+        // keep the format and the raw arguments, the drain thread expands them
+        sPayload = cFormatString;
+        sPayload += '\0';
+        shrLogPackArgs(sPayload, cFormatString, vaArgList);
+        iKind = SHR_LOG_DEFERRED;
+    }
+    else
+    {
+        shrLogVaArgs args(vaArgList);
+        shrLogFormat(sPayload, cFormatString, args);
+    }
+
+    if (!bAsync || !shrLogEnqueue(iLogMode, iErrNum, iKind, sPayload))
+    {
+        if (iKind == SHR_LOG_DEFERRED)
+        {
+            // not queued after all: expand the packed arguments here
+            std::string sText;
+            shrLogPackedArgs args = { sPayload.c_str() + strlen(sPayload.c_str()) + 1, sPayload.c_str() + sPayload.size() };
+            shrLogFormat(sText, sPayload.c_str(), args);
+            sPayload.swap(sText);
+        }
+        shrMutexLock(&LogWriteLock);
+        shrLogWriteText(iLogMode, iErrNum, sPayload.data(), sPayload.size(), true);
+        shrMutexUnlock(&LogWriteLock);
+    }
+    else if (iLogMode & (ERRORMSG | CLOSELOG))
+    {
+        // errors and closing the log must be on disk when the call returns
+        shrLogFlush();
     }
 
     // return error code or OK 
@@ -547,7 +1344,7 @@ int shrLogEx(int iLogMode = LOGCONSOLE, int iErrNum = 0, const char* cFormatStri
 
     // Prepare variable agument list 
     va_start(vaArgList, cFormatString);
-    int ret = shrLogV(iLogMode, iErrNum, cFormatString, vaArgList);
+    int ret = shrLogV(iLogMode, iErrNum, cFormatString, vaArgList, false);
 
     // end variable argument handler
     va_end(vaArgList);
@@ -563,7 +1360,23 @@ int shrLog(const char* cFormatString = "", ...)
 
     // Prepare variable agument list 
     va_start(vaArgList, cFormatString);
-    int ret = shrLogV(LOGBOTH, 0, cFormatString, vaArgList);
+    int ret = shrLogV(LOGBOTH, 0, cFormatString, vaArgList, false);
+
+    // end variable argument handler
+    va_end(vaArgList);
+
+    return ret;
+}
+
+// Like shrLogEx, with formatting deferred to the drain thread
+// *********************************************************************
+int shrLogDeferred(int iLogMode, int iErrNum, const char* cFormatString, ...)
+{
+    va_list vaArgList;
+
+    // Prepare variable agument list 
+    va_start(vaArgList, cFormatString);
+    int ret = shrLogV(iLogMode, iErrNum, cFormatString, vaArgList, true);
 
     // end variable argument handler
     va_end(vaArgList);
@@ -674,20 +1487,371 @@ char* shrFindFilePath(const char* filename, const char* executable_path)
         std::fstream fh(path.c_str(), std::fstream::in);
         if (fh.good())
         {
-            // File found
-            // returning an allocated array here for backwards compatibility reasons
-            char* file_path = (char*) malloc(path.length() + 1);
-        #ifdef _WIN32  
-            strcpy_s(file_path, path.length() + 1, path.c_str());
-        #else
-            strcpy(file_path, path.c_str());
-        #endif                
-            return file_path;
+            // File found
+            // returning an allocated array here for backwards compatibility reasons
+            char* file_path = (char*) malloc(path.length() + 1);
+        #ifdef _WIN32  
+            strcpy_s(file_path, path.length() + 1, path.c_str());
+        #else
+            strcpy(file_path, path.c_str());
+        #endif                
+            return file_path;
+        }
+    }    
+
+    // File not found
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Binary dataset container helpers
+//////////////////////////////////////////////////////////////////////////////
+static unsigned int shrDataTypeOf(const float*)         { return SHR_DTYPE_FLOAT; }
+static unsigned int shrDataTypeOf(const double*)        { return SHR_DTYPE_DOUBLE; }
+static unsigned int shrDataTypeOf(const int*)           { return SHR_DTYPE_INT; }
+static unsigned int shrDataTypeOf(const unsigned int*)  { return SHR_DTYPE_UINT; }
+static unsigned int shrDataTypeOf(const char*)          { return SHR_DTYPE_CHAR; }
+static unsigned int shrDataTypeOf(const unsigned char*) { return SHR_DTYPE_UCHAR; }
+
+size_t shrDataTypeSize(unsigned int dtype)
+{
+    switch (dtype)
+    {
+        case SHR_DTYPE_FLOAT:  return sizeof(float);
+        case SHR_DTYPE_DOUBLE: return sizeof(double);
+        case SHR_DTYPE_INT:    return sizeof(int);
+        case SHR_DTYPE_UINT:   return sizeof(unsigned int);
+        case SHR_DTYPE_CHAR:   return sizeof(char);
+        case SHR_DTYPE_UCHAR:  return sizeof(unsigned char);
+        default:               return 0;
+    }
+}
+
+// FNV-1a over four interleaved 64 bit lanes (so the multiplies of the lanes
+// can overlap), remaining bytes go through lane 0, lanes are folded at the end
+static unsigned long long shrDatasetChecksum(const void* data, size_t size)
+{
+    const unsigned long long prime = 1099511628211ULL;
+    const unsigned char* p = (const unsigned char*)data;
+    unsigned long long h[4];
+    for (int l = 0; l < 4; ++l)
+    {
+        h[l] = 14695981039346656037ULL ^ (unsigned long long)l;
+    }
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        unsigned long long w[4];
+        memcpy(w, p + i, sizeof(w));
+        h[0] = (h[0] ^ w[0]) * prime;
+        h[1] = (h[1] ^ w[1]) * prime;
+        h[2] = (h[2] ^ w[2]) * prime;
+        h[3] = (h[3] ^ w[3]) * prime;
+    }
+    for (; i < size; ++i)
+    {
+        h[0] = (h[0] ^ p[i]) * prime;
+    }
+
+    unsigned long long result = 14695981039346656037ULL ^ (unsigned long long)size;
+    for (int l = 0; l < 4; ++l)
+    {
+        result = (result ^ h[l]) * prime;
+    }
+    return result;
+}
+
+// Map a whole file read-only, returns NULL for missing or empty files
+static void* shrMapFileReadOnly(const char* filename, size_t* size)
+{
+    void* base = NULL;
+    #ifdef _WIN32
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return NULL;
+        }
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && (fileSize.QuadPart > 0))
+        {
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping != NULL)
+            {
+                base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+                *size = (size_t)fileSize.QuadPart;
+            }
+        }
+        CloseHandle(file);
+    #else
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+        {
+            return NULL;
+        }
+        struct stat st;
+        if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+        {
+            base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (base == MAP_FAILED)
+            {
+                base = NULL;
+            }
+            else
+            {
+                *size = (size_t)st.st_size;
+                madvise(base, *size, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+    #endif
+    return base;
+}
+
+static void shrUnmapFileReadOnly(void* base, size_t size)
+{
+    #ifdef _WIN32
+        (void)size;
+        UnmapViewOfFile(base);
+    #else
+        munmap(base, size);
+    #endif
+}
+
+// Check whether \filename starts with the dataset magic
+static bool shrIsDataFile(const char* filename)
+{
+    FILE* fp = 0;
+    #ifdef _WIN32
+        if (fopen_s(&fp, filename, "rb") != 0)
+    #else
+        if ((fp = fopen(filename, "rb")) == 0)
+    #endif
+        {
+            return false;
+        }
+    char magic[8];
+    bool match = (fread(magic, 1, sizeof(magic), fp) == sizeof(magic)) &&
+                 (memcmp(magic, SHR_DATASET_MAGIC, sizeof(magic)) == 0);
+    fclose(fp);
+    return match;
+}
+
+// Check whether \filename ends in SHR_DATASET_EXT
+static bool shrHasDataFileExt(const char* filename)
+{
+    size_t len = strlen(filename);
+    size_t extLen = strlen(SHR_DATASET_EXT);
+    return (len >= extLen) && (strcmp(filename + len - extLen, SHR_DATASET_EXT) == 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Map a binary dataset container, validating header and checksum
+//////////////////////////////////////////////////////////////////////////////
+shrBOOL shrMapDataFile( const char* filename, shrDataView* view, bool verify, bool verbose)
+{
+    ARGCHECK(NULL != filename);
+    ARGCHECK(NULL != view);
+
+    memset(view, 0, sizeof(shrDataView));
+
+    size_t size = 0;
+    void* base = shrMapFileReadOnly(filename, &size);
+    if (base == NULL)
+    {
+        if (verbose)
+            std::cerr << "shrMapDataFile() : Mapping file failed." << std::endl;
+        return shrFALSE;
+    }
+
+    const char* error = NULL;
+    shrDatasetHeader header;
+    if (size < sizeof(shrDatasetHeader))
+    {
+        error = "file too small for a dataset header";
+    }
+    else
+    {
+        memcpy(&header, base, sizeof(shrDatasetHeader));
+
+        size_t elemSize = shrDataTypeSize(header.dtype);
+        unsigned long long count = 1;
+        for (unsigned int d = 0; (d < header.ndims) && (d < SHR_DATASET_MAX_DIMS); ++d)
+        {
+            count *= header.shape[d];
+        }
+
+        if (memcmp(header.magic, SHR_DATASET_MAGIC, sizeof(header.magic)) != 0)
+        {
+            error = "not a dataset file";
+        }
+        else if (elemSize == 0)
+        {
+            error = "unknown element type";
+        }
+        else if ((header.ndims == 0) || (header.ndims > SHR_DATASET_MAX_DIMS) || (count != header.count))
+        {
+            error = "inconsistent shape";
+        }
+        else if (header.count > (size - sizeof(shrDatasetHeader)) / elemSize)
+        {
+            error = "payload truncated";
+        }
+        else if (verify &&
+                 (shrDatasetChecksum((const char*)base + sizeof(shrDatasetHeader),
+                                     (size_t)header.count * elemSize) != header.checksum))
+        {
+            error = "checksum mismatch";
+        }
+    }
+
+    if (error != NULL)
+    {
+        if (verbose)
+            std::cerr << "shrMapDataFile() : " << filename << ": " << error << "." << std::endl;
+        shrUnmapFileReadOnly(base, size);
+        return shrFALSE;
+    }
+
+    view->data = (const char*)base + sizeof(shrDatasetHeader);
+    view->header = header;
+    view->mapBase = base;
+    view->mapSize = size;
+    return shrTRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Release a view obtained from shrMapDataFile
+//////////////////////////////////////////////////////////////////////////////
+void shrUnmapDataFile( shrDataView* view)
+{
+    if ((view != NULL) && (view->mapBase != NULL))
+    {
+        shrUnmapFileReadOnly(view->mapBase, view->mapSize);
+        memset(view, 0, sizeof(shrDataView));
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Write a binary dataset container
+//////////////////////////////////////////////////////////////////////////////
+shrBOOL shrWriteDataFile( const char* filename, unsigned int dtype, const void* data,
+                          unsigned int ndims, const unsigned int* shape, double epsilon,
+                          bool verbose)
+{
+    ARGCHECK(NULL != filename);
+    ARGCHECK(NULL != shape);
+
+    size_t elemSize = shrDataTypeSize(dtype);
+    if ((elemSize == 0) || (ndims == 0) || (ndims > SHR_DATASET_MAX_DIMS))
+    {
+        if (verbose)
+            std::cerr << "shrWriteDataFile() : Invalid element type or shape." << std::endl;
+        return shrFALSE;
+    }
+
+    shrDatasetHeader header;
+    memset(&header, 0, sizeof(shrDatasetHeader));
+    memcpy(header.magic, SHR_DATASET_MAGIC, sizeof(header.magic));
+    header.dtype = dtype;
+    header.ndims = ndims;
+    header.count = 1;
+    for (unsigned int d = 0; d < ndims; ++d)
+    {
+        header.shape[d] = shape[d];
+        header.count *= shape[d];
+    }
+    header.epsilon = epsilon;
+
+    size_t payloadSize = (size_t)header.count * elemSize;
+    if ((payloadSize > 0) && (data == NULL))
+    {
+        return shrFALSE;
+    }
+    header.checksum = shrDatasetChecksum(data, payloadSize);
+
+    FILE* fp = 0;
+    #ifdef _WIN32
+        if (fopen_s(&fp, filename, "wb") != 0)
+    #else
+        if ((fp = fopen(filename, "wb")) == 0)
+    #endif
+        {
+            if (verbose)
+                std::cerr << "shrWriteDataFile() : Opening file failed." << std::endl;
+            return shrFALSE;
+        }
+
+    bool ok = (fwrite(&header, sizeof(shrDatasetHeader), 1, fp) == 1) &&
+              ((payloadSize == 0) || (fwrite(data, payloadSize, 1, fp) == 1));
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok)
+    {
+        if (verbose)
+            std::cerr << "shrWriteDataFile() : Writing file failed." << std::endl;
+        return shrFALSE;
+    }
+    return shrTRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Load a binary dataset container into the buffer handed to shrReadFile
+//////////////////////////////////////////////////////////////////////////////
+template<class T>
+shrBOOL
+shrReadDataFile( const char* filename, T** data, unsigned int* len, bool verbose)
+{
+    shrDataView view;
+    if (!shrMapDataFile(filename, &view, true, verbose))
+    {
+        return shrFALSE;
+    }
+
+    if (view.header.dtype != shrDataTypeOf((const T*)NULL))
+    {
+        if (verbose)
+            std::cerr << "shrReadFile() : Element type of dataset does not match." << std::endl;
+        shrUnmapDataFile(&view);
+        return shrFALSE;
+    }
+    if (view.header.count > 0xFFFFFFFFULL)
+    {
+        if (verbose)
+            std::cerr << "shrReadFile() : Dataset too large." << std::endl;
+        shrUnmapDataFile(&view);
+        return shrFALSE;
+    }
+
+    unsigned int count = (unsigned int)view.header.count;
+
+    // check if the given handle is already initialized
+    if( NULL != *data) 
+    {
+        if( *len != count) 
+        {
+            std::cerr << "shrReadFile() : Initialized memory given but "
+                      << "size  mismatch with signal read "
+                      << "(data read / data init = " << count
+                      <<  " / " << *len << ")" << std::endl;
+            shrUnmapDataFile(&view);
+            return shrFALSE;
         }
-    }    
+    }
+    else 
+    {
+        // allocate storage for the data read
+        *data = (T*) malloc( sizeof(T) * count);
+        // store signal size
+        *len = count;
+    }
 
-    // File not found
-    return 0;
+    // copy data straight out of the mapping
+    memcpy( *data, view.data, sizeof(T) * count);
+    shrUnmapDataFile(&view);
+
+    return shrTRUE;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -706,6 +1870,12 @@ shrReadFile( const char* filename, T** data, unsigned int* len, bool verbose)
     ARGCHECK(NULL != filename);
     ARGCHECK(NULL != len);
 
+    // binary dataset container, otherwise fall through to the text format
+    if (shrIsDataFile(filename))
+    {
+        return shrReadDataFile(filename, data, len, verbose);
+    }
+
     // intermediate storage for the data read
     std::vector<T>  data_read;
 
@@ -783,6 +1953,13 @@ shrWriteFile( const char* filename, const T* data, unsigned int len,
     ARGCHECK(NULL != filename);
     ARGCHECK(NULL != data);
 
+    // binary dataset container selected by the file extension
+    if (shrHasDataFileExt(filename))
+    {
+        return shrWriteDataFile(filename, shrDataTypeOf(data), data, 1, &len,
+                                static_cast<double>(epsilon), verbose);
+    }
+
     // open file for writing
     std::fstream fh( filename, std::fstream::out);
     // check if filestream is valid
@@ -989,64 +2166,175 @@ shrBOOL shrWriteFileb( const char* filename,const unsigned char* data,unsigned i
 }
 
 //////////////////////////////////////////////////////////////////////////////
-//! Load PGM or PPM file
-//! @note if data == NULL then the necessary memory is allocated in the 
-//!       function and w and h are initialized to the size of the image
-//! @return shrTRUE if the file loading succeeded, otherwise shrFALSE
-//! @param file        name of the file to load
-//! @param data        handle to the memory for the image file data
-//! @param w        width of the image
-//! @param h        height of the image
-//! @param channels number of channels in image
+//! Convert packed RGB pixels to RGBA (4th component 0) and back
+//! @note SSSE3 path selected at runtime, 16 pixels per iteration
 //////////////////////////////////////////////////////////////////////////////
-shrBOOL loadPPM(const char* file, unsigned char** data, 
-            unsigned int *w, unsigned int *h, unsigned int *channels) 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define SHR_USE_SSSE3 __attribute__((target("ssse3")))
+    #include <tmmintrin.h>
+    static bool shrHasSSSE3() { return __builtin_cpu_supports("ssse3") != 0; }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #define SHR_USE_SSSE3
+    #include <intrin.h>
+    #include <tmmintrin.h>
+    static bool shrHasSSSE3() { int info[4]; __cpuid(info, 1); return (info[2] & (1 << 9)) != 0; }
+#endif
+
+#ifdef SHR_USE_SSSE3
+SHR_USE_SSSE3 static size_t shrExpandRGBToRGBA_SSSE3(const unsigned char* src, unsigned char* dst, size_t n)
 {
-    FILE* fp = 0;
+    const __m128i expand = _mm_setr_epi8(0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16, src += 48, dst += 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)src);
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+        _mm_storeu_si128((__m128i*)dst,        _mm_shuffle_epi8(a, expand));
+        _mm_storeu_si128((__m128i*)(dst + 16), _mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), expand));
+        _mm_storeu_si128((__m128i*)(dst + 32), _mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), expand));
+        _mm_storeu_si128((__m128i*)(dst + 48), _mm_shuffle_epi8(_mm_srli_si128(c, 4), expand));
+    }
+    return i;
+}
+
+SHR_USE_SSSE3 static size_t shrPackRGBAToRGB_SSSE3(const unsigned char* src, unsigned char* dst, size_t n)
+{
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16, src += 64, dst += 48)
+    {
+        __m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), pack);
+        __m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 16)), pack);
+        __m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 32)), pack);
+        __m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 48)), pack);
+        _mm_storeu_si128((__m128i*)dst,        _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+        _mm_storeu_si128((__m128i*)(dst + 16), _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+        _mm_storeu_si128((__m128i*)(dst + 32), _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+    }
+    return i;
+}
+#endif
+
+static void shrExpandRGBToRGBA(const unsigned char* src, unsigned char* dst, size_t n)
+{
+    size_t i = 0;
+#ifdef SHR_USE_SSSE3
+    static const bool bSSSE3 = shrHasSSSE3();
+    if (bSSSE3)
+    {
+        i = shrExpandRGBToRGBA_SSSE3(src, dst, n);
+    }
+#endif
+    for (src += 3 * i, dst += 4 * i; i < n; i++, src += 3, dst += 4)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 0;
+    }
+}
+
+static void shrPackRGBAToRGB(const unsigned char* src, unsigned char* dst, size_t n)
+{
+    size_t i = 0;
+#ifdef SHR_USE_SSSE3
+    static const bool bSSSE3 = shrHasSSSE3();
+    if (bSSSE3)
+    {
+        i = shrPackRGBAToRGB_SSSE3(src, dst, n);
+    }
+#endif
+    for (src += 4 * i, dst += 3 * i; i < n; i++, src += 4, dst += 3)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+    }
+}
+
+static void shrExpandGrayToRGBA(const unsigned char* src, unsigned char* dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++, dst += 4)
+    {
+        dst[0] = dst[1] = dst[2] = src[i];
+        dst[3] = 0;
+    }
+}
+
+// Rows are converted through a staging band of about this many bytes
+#define SHR_IMAGE_STAGING_BYTES (256 * 1024)
+
+// Makes sure the stream's staging band holds at least one row, returns its capacity in rows
+static size_t shrImageStaging(shrImageStream* stream)
+{
+    if (stream->staging == NULL)
+    {
+        size_t szRow = (size_t)stream->width * stream->channels;
+        stream->stagingRows = (szRow >= SHR_IMAGE_STAGING_BYTES) ? 1 : SHR_IMAGE_STAGING_BYTES / szRow;
+        stream->staging = (unsigned char*)malloc(szRow * stream->stagingRows);
+        if (stream->staging == NULL)
+        {
+            stream->stagingRows = 0;
+        }
+    }
+    return stream->stagingRows;
+}
 
+static FILE* shrOpenBinary(const char* file, const char* mode)
+{
+    FILE* fp = NULL;
     #ifdef _WIN32
-        // open the file for binary read
-        errno_t err;
-        if ((err = fopen_s(&fp, file, "rb")) != 0)
-    #else
-        // open the file for binary read
-        if ((fp = fopen(file, "rb")) == 0)
-    #endif
+        if (fopen_s(&fp, file, mode) != 0)
         {
-            // if error on attempt to open, be sure the file is null or close it, then return negative error code
-            if (fp)
-            {
-                fclose (fp);
-            }
-            std::cerr << "loadPPM() : Failed to open file: " << file << std::endl;
-            return shrFALSE;
+            fp = NULL;
         }
+    #else
+        fp = fopen(file, mode);
+    #endif
+    return fp;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Open a PPM or PGM file and parse its header
+//! @return shrTRUE if the file is a valid binary PPM/PGM, otherwise shrFALSE
+//! @param file    name of the image file
+//! @param stream  stream to initialize
+//////////////////////////////////////////////////////////////////////////////
+shrBOOL shrOpenImageRead( const char* file, shrImageStream* stream)
+{
+    ARGCHECK(NULL != stream);
+    memset(stream, 0, sizeof(shrImageStream));
+
+    FILE* fp = shrOpenBinary(file, "rb");
+    if (fp == NULL)
+    {
+        std::cerr << "loadPPM() : Failed to open file: " << file << std::endl;
+        return shrFALSE;
+    }
 
     // check header
     char header[PGMHeaderSize];
     if ((fgets( header, PGMHeaderSize, fp) == NULL) && ferror(fp))
     {
-        if (fp)
-        {
-            fclose (fp);
-        }
+        fclose (fp);
         std::cerr << "loadPPM() : File is not a valid PPM or PGM image" << std::endl;
-        *channels = 0;
         return shrFALSE;
     }
 
+    unsigned int channels;
     if (strncmp(header, "P5", 2) == 0)
     {
-        *channels = 1;
+        channels = 1;
     }
     else if (strncmp(header, "P6", 2) == 0)
     {
-        *channels = 3;
+        channels = 3;
     }
     else
     {
+        fclose (fp);
         std::cerr << "loadPPM() : File is not a PPM or PGM image" << std::endl;
-        *channels = 0;
         return shrFALSE;
     }
 
@@ -1057,12 +2345,9 @@ shrBOOL loadPPM(const char* file, unsigned char** data,
     unsigned int i = 0;
     while(i < 3) 
     {
-        if ((fgets(header, PGMHeaderSize, fp) == NULL) && ferror(fp))
+        if (fgets(header, PGMHeaderSize, fp) == NULL)
         {
-            if (fp)
-            {
-                fclose (fp);
-            }
+            fclose (fp);
             std::cerr << "loadPPM() : File is not a valid PPM or PGM image" << std::endl;
             return shrFALSE;
         }
@@ -1097,31 +2382,257 @@ shrBOOL loadPPM(const char* file, unsigned char** data,
         #endif
     }
 
+    // an empty image has no rows to stage
+    if ((width == 0) || (height == 0))
+    {
+        fclose (fp);
+        std::cerr << "loadPPM() : Image has no pixels (" << width << " x " << height << ")" << std::endl;
+        return shrFALSE;
+    }
+
+    stream->fp = fp;
+    stream->width = width;
+    stream->height = height;
+    stream->channels = channels;
+    return shrTRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Create a PPM (3 channels) or PGM (1 channel) file and write its header
+//! @return shrTRUE if the file could be created, otherwise shrFALSE
+//! @param file      name of the image file
+//! @param stream    stream to initialize
+//! @param w         width of the image
+//! @param h         height of the image
+//! @param channels  1 for PGM, 3 for PPM
+//////////////////////////////////////////////////////////////////////////////
+shrBOOL shrOpenImageWrite( const char* file, shrImageStream* stream,
+                           unsigned int w, unsigned int h, unsigned int channels)
+{
+    ARGCHECK(NULL != stream);
+    ARGCHECK(w > 0);
+    ARGCHECK(h > 0);
+    memset(stream, 0, sizeof(shrImageStream));
+
+    if (channels != 1 && channels != 3)
+    {
+        std::cerr << "savePPM() : Invalid number of channels." << std::endl;
+        return shrFALSE;
+    }
+
+    FILE* fp = shrOpenBinary(file, "wb");
+    if (fp == NULL)
+    {
+        std::cerr << "savePPM() : Opening file failed." << std::endl;
+        return shrFALSE;
+    }
+
+    if (fprintf(fp, "%s\n%u\n%u\n%u\n", (channels == 1) ? "P5" : "P6", w, h, 0xff) < 0)
+    {
+        fclose(fp);
+        std::cerr << "savePPM() : Writing data failed." << std::endl;
+        return shrFALSE;
+    }
+
+    stream->fp = fp;
+    stream->width = w;
+    stream->height = h;
+    stream->channels = channels;
+    return shrTRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Read the next rows of an image opened with shrOpenImageRead
+//! @return number of rows read
+//! @param stream       image stream
+//! @param data         destination of the first row
+//! @param rows         number of rows to read
+//! @param dstChannels  channels per pixel in data (file channels or 4)
+//! @param dstPitch     bytes between rows in data, 0 for tightly packed
+//////////////////////////////////////////////////////////////////////////////
+unsigned int shrReadImageRows( shrImageStream* stream, unsigned char* data, unsigned int rows,
+                               unsigned int dstChannels, size_t dstPitch)
+{
+    if (stream == NULL || stream->fp == NULL || data == NULL ||
+        (dstChannels != stream->channels && dstChannels != 4))
+    {
+        return 0;
+    }
+    rows = std::min(rows, stream->height - stream->row);
+
+    size_t szFileRow = (size_t)stream->width * stream->channels;
+    size_t szDstRow = (size_t)stream->width * dstChannels;
+    dstPitch = (dstPitch == 0) ? szDstRow : dstPitch;
+
+    unsigned int done = 0;
+    if (dstChannels == stream->channels && dstPitch == szDstRow)
+    {
+        // same layout: read straight into the destination
+        done = (unsigned int)(fread(data, szFileRow, rows, stream->fp));
+    }
+    else if (dstChannels == stream->channels)
+    {
+        for (; done < rows; done++)
+        {
+            if (fread(data + done * dstPitch, szFileRow, 1, stream->fp) != 1) break;
+        }
+    }
+    else
+    {
+        // read a band of rows into staging, then widen each row into place
+        size_t szBand = shrImageStaging(stream);
+        while (done < rows && szBand > 0)
+        {
+            size_t szWant = std::min(szBand, (size_t)(rows - done));
+            size_t szGot = fread(stream->staging, szFileRow, szWant, stream->fp);
+            for (size_t r = 0; r < szGot; r++)
+            {
+                const unsigned char* src = stream->staging + r * szFileRow;
+                unsigned char* dst = data + (done + r) * dstPitch;
+                if (stream->channels == 3)
+                {
+                    shrExpandRGBToRGBA(src, dst, stream->width);
+                }
+                else
+                {
+                    shrExpandGrayToRGBA(src, dst, stream->width);
+                }
+            }
+            done += (unsigned int)szGot;
+            if (szGot != szWant) break;
+        }
+    }
+
+    stream->row += done;
+    return done;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Write the next rows of an image opened with shrOpenImageWrite
+//! @return number of rows written
+//! @param stream       image stream
+//! @param data         first row to write
+//! @param rows         number of rows to write
+//! @param srcChannels  channels per pixel in data (file channels, or 4 for a PPM)
+//! @param srcPitch     bytes between rows in data, 0 for tightly packed
+//////////////////////////////////////////////////////////////////////////////
+unsigned int shrWriteImageRows( shrImageStream* stream, const unsigned char* data, unsigned int rows,
+                                unsigned int srcChannels, size_t srcPitch)
+{
+    if (stream == NULL || stream->fp == NULL || data == NULL ||
+        (srcChannels != stream->channels && !(srcChannels == 4 && stream->channels == 3)))
+    {
+        return 0;
+    }
+    rows = std::min(rows, stream->height - stream->row);
+
+    size_t szFileRow = (size_t)stream->width * stream->channels;
+    size_t szSrcRow = (size_t)stream->width * srcChannels;
+    srcPitch = (srcPitch == 0) ? szSrcRow : srcPitch;
+
+    unsigned int done = 0;
+    if (srcChannels == stream->channels && srcPitch == szSrcRow)
+    {
+        done = (unsigned int)(fwrite(data, szFileRow, rows, stream->fp));
+    }
+    else if (srcChannels == stream->channels)
+    {
+        for (; done < rows; done++)
+        {
+            if (fwrite(data + done * srcPitch, szFileRow, 1, stream->fp) != 1) break;
+        }
+    }
+    else
+    {
+        // narrow a band of rows into staging, then write it in one call
+        size_t szBand = shrImageStaging(stream);
+        while (done < rows && szBand > 0)
+        {
+            size_t szWant = std::min(szBand, (size_t)(rows - done));
+            for (size_t r = 0; r < szWant; r++)
+            {
+                shrPackRGBAToRGB(data + (done + r) * srcPitch, stream->staging + r * szFileRow, stream->width);
+            }
+            size_t szPut = fwrite(stream->staging, szFileRow, szWant, stream->fp);
+            done += (unsigned int)szPut;
+            if (szPut != szWant) break;
+        }
+    }
+
+    stream->row += done;
+    return done;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Close an image stream
+//! @return shrTRUE if all data reached the file, otherwise shrFALSE
+//! @param stream  image stream
+//////////////////////////////////////////////////////////////////////////////
+shrBOOL shrCloseImage( shrImageStream* stream)
+{
+    if (stream == NULL)
+    {
+        return shrFALSE;
+    }
+    shrBOOL bOK = shrTRUE;
+    if (stream->fp != NULL)
+    {
+        bOK = (ferror(stream->fp) == 0) ? shrTRUE : shrFALSE;
+        bOK = (fclose(stream->fp) == 0) ? bOK : shrFALSE;
+    }
+    free(stream->staging);
+    memset(stream, 0, sizeof(shrImageStream));
+    return bOK;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//! Load PGM or PPM file
+//! @note if data == NULL then the necessary memory is allocated in the 
+//!       function and w and h are initialized to the size of the image
+//! @return shrTRUE if the file loading succeeded, otherwise shrFALSE
+//! @param file        name of the file to load
+//! @param data        handle to the memory for the image file data
+//! @param w        width of the image
+//! @param h        height of the image
+//! @param channels number of channels in image
+//////////////////////////////////////////////////////////////////////////////
+shrBOOL loadPPM(const char* file, unsigned char** data, 
+            unsigned int *w, unsigned int *h, unsigned int *channels) 
+{
+    shrImageStream stream;
+    if (shrOpenImageRead(file, &stream) != shrTRUE)
+    {
+        *channels = 0;
+        return shrFALSE;
+    }
+    *channels = stream.channels;
+
     // check if given handle for the data is initialized
     if(NULL != *data) 
     {
-        if (*w != width || *h != height) 
+        if (*w != stream.width || *h != stream.height) 
         {
-            fclose(fp);
+            shrCloseImage(&stream);
             std::cerr << "loadPPM() : Invalid image dimensions." << std::endl;
             return shrFALSE;
         }
     } 
     else 
     {
-        *data = (unsigned char*)malloc( sizeof(unsigned char) * width * height * *channels);
-        *w = width;
-        *h = height;
+        *data = (unsigned char*)malloc( sizeof(unsigned char) * stream.width * stream.height * stream.channels);
+        *w = stream.width;
+        *h = stream.height;
     }
 
     // read and close file
-    if (fread(*data, sizeof(unsigned char), width * height * *channels, fp) != width * height * *channels)
+    unsigned int height = stream.height;
+    if (shrReadImageRows(&stream, *data, height, stream.channels, 0) != height)
     {
-        fclose(fp);
+        shrCloseImage(&stream);
         std::cerr << "loadPPM() : Invalid image." << std::endl;
         return shrFALSE;
     }
-    fclose(fp);
+    shrCloseImage(&stream);
 
     return shrTRUE;
 }
@@ -1133,47 +2644,27 @@ shrBOOL loadPPM(const char* file, unsigned char** data,
 //! @param data  handle to the data read
 //! @param w     width of the image
 //! @param h     height of the image
+//! @param srcChannels  channels per pixel in data (4 is written as a 3 channel PPM)
 //////////////////////////////////////////////////////////////////////////////  
-shrBOOL savePPM( const char* file, unsigned char *data, 
-             unsigned int w, unsigned int h, unsigned int channels) 
+shrBOOL savePPM( const char* file, const unsigned char *data, 
+             unsigned int w, unsigned int h, unsigned int srcChannels) 
 {
     ARGCHECK(NULL != data);
     ARGCHECK(w > 0);
     ARGCHECK(h > 0);
 
-    std::fstream fh( file, std::fstream::out | std::fstream::binary );
-    if( fh.bad()) 
-    {
-        std::cerr << "savePPM() : Opening file failed." << std::endl;
-        return shrFALSE;
-    }
-
-    if (channels == 1)
+    shrImageStream stream;
+    if (shrOpenImageWrite(file, &stream, w, h, (srcChannels == 4) ? 3 : srcChannels) != shrTRUE)
     {
-        fh << "P5\n";
-    }
-    else if (channels == 3) {
-        fh << "P6\n";
-    }
-    else {
-        std::cerr << "savePPM() : Invalid number of channels." << std::endl;
         return shrFALSE;
     }
 
-    fh << w << "\n" << h << "\n" << 0xff << std::endl;
-
-    for( unsigned int i = 0; (i < (w*h*channels)) && fh.good(); ++i) 
-    {
-        fh << data[i];
-    }
-    fh.flush();
-
-    if( fh.bad()) 
+    unsigned int rows = shrWriteImageRows(&stream, data, h, srcChannels, 0);
+    if (shrCloseImage(&stream) != shrTRUE || rows != h) 
     {
         std::cerr << "savePPM() : Writing data failed." << std::endl;
         return shrFALSE;
     } 
-    fh.close();
 
     return shrTRUE;
 }
@@ -1185,48 +2676,34 @@ shrBOOL savePPM( const char* file, unsigned char *data,
 //! @param data  handle to the data read
 //! @param w     width of the image
 //! @param h     height of the image
-////////////////////////////////////////////////////////////////////////////////
-shrBOOL shrLoadPPM4ub( const char* file, unsigned char** OutData, 
-                unsigned int *w, unsigned int *h)
-{
-    // Load file data into a temporary buffer with automatic allocation
-    unsigned char* cLocalData = 0;
-    unsigned int channels;
-    shrBOOL bLoadOK = loadPPM(file, &cLocalData, w, h, &channels);   // this allocates cLocalData, which must be freed later
-
-    // If the data loaded OK from file to temporary buffer, then go ahead with padding and transfer 
-    if (shrTRUE == bLoadOK)
-    {
-        // if the receiving buffer is null, allocate it... caller must free this 
-        int size = *w * *h;
-        if (*OutData == NULL)
-        {
-            *OutData = (unsigned char*)malloc(sizeof(unsigned char) * size * 4);
-        }
-
-        // temp pointers for incrementing
-        unsigned char* cTemp = cLocalData;
-        unsigned char* cOutPtr = *OutData;
-
-        // transfer data, padding 4th element
-        for(int i=0; i<size; i++) 
-        {
-            *cOutPtr++ = *cTemp++;
-            *cOutPtr++ = *cTemp++;
-            *cOutPtr++ = *cTemp++;
-            *cOutPtr++ = 0;
-        }
-
-        // free temp lcoal buffer and return OK
-        free(cLocalData);
-        return shrTRUE;
-    }
-    else
+////////////////////////////////////////////////////////////////////////////////
+shrBOOL shrLoadPPM4ub( const char* file, unsigned char** OutData, 
+                unsigned int *w, unsigned int *h)
+{
+    shrImageStream stream;
+    if (shrOpenImageRead(file, &stream) != shrTRUE)
     {
         // image wouldn't load
-        free(cLocalData);
         return shrFALSE;
     }
+    *w = stream.width;
+    *h = stream.height;
+
+    // if the receiving buffer is null, allocate it... caller must free this 
+    if (*OutData == NULL)
+    {
+        *OutData = (unsigned char*)malloc(sizeof(unsigned char) * stream.width * stream.height * 4);
+    }
+
+    // expand rows directly into the receiving buffer, padding 4th element
+    unsigned int height = stream.height;
+    shrBOOL bLoadOK = (shrReadImageRows(&stream, *OutData, height, 4, 0) == height) ? shrTRUE : shrFALSE;
+    shrCloseImage(&stream);
+    if (bLoadOK != shrTRUE)
+    {
+        std::cerr << "loadPPM() : Invalid image." << std::endl;
+    }
+    return bLoadOK;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1240,20 +2717,8 @@ shrBOOL shrLoadPPM4ub( const char* file, unsigned char** OutData,
 shrBOOL shrSavePPM4ub( const char* file, unsigned char *data, 
                unsigned int w, unsigned int h) 
 {
-    // strip 4th component
-    int size = w * h;
-    unsigned char *ndata = (unsigned char*) malloc( sizeof(unsigned char) * size*3);
-    unsigned char *ptr = ndata;
-    for(int i=0; i<size; i++) {
-        *ptr++ = *data++;
-        *ptr++ = *data++;
-        *ptr++ = *data++;
-        data++;
-    }
-    
-    shrBOOL succ = savePPM(file, ndata, w, h, 3);
-    free(ndata);
-    return succ;
+    // strip 4th component while streaming rows to the file
+    return savePPM(file, data, w, h, 4);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1484,6 +2949,507 @@ shrBOOL shrGetCmdLineArgumentstr( const int argc, const char** argv,
 
 }
 
+////////////////////////////////////////////////////////////////////////////// 
+// Parallel comparison engine
+//
+// The comparisons below split [0, len) into one contiguous chunk per host 
+// thread, run a kernel over each chunk and merge the per-chunk results in 
+// chunk order, so the outcome does not depend on thread scheduling.  Small
+// arrays stay on the calling thread.  SHR_NUM_THREADS overrides the number
+// of threads used.
+//////////////////////////////////////////////////////////////////////////////
+#define SHR_COMPARE_PARALLEL_MIN (1 << 18)
+#define SHR_COMPARE_MAX_THREADS 64
+
+static unsigned int shrComputeNumHostThreads()
+{
+    int n = 0;
+    const char* env = getenv("SHR_NUM_THREADS");
+    if (env != NULL)
+    {
+        n = atoi(env);
+    }
+    if (n <= 0)
+    {
+        #ifdef _WIN32
+            SYSTEM_INFO sysInfo;
+            GetSystemInfo(&sysInfo);
+            n = (int)sysInfo.dwNumberOfProcessors;
+        #else
+            n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        #endif
+    }
+    return (unsigned int)CLAMP(n, 1, SHR_COMPARE_MAX_THREADS);
+}
+
+unsigned int shrGetNumHostThreads(void)
+{
+    // initialised once, thread-safe, shrParallelFor callers may race here
+    static const unsigned int numThreads = shrComputeNumHostThreads();
+    return numThreads;
+}
+
+template<class Kernel>
+struct shrCompareJob
+{
+    const Kernel*             kernel;
+    unsigned int              begin;
+    unsigned int              end;
+    typename Kernel::Partial  partial;
+
+    #ifdef _WIN32
+        static DWORD WINAPI entry(LPVOID arg)
+    #else
+        static void* entry(void* arg)
+    #endif
+    {
+        shrCompareJob* job = (shrCompareJob*)arg;
+        (*job->kernel)(job->begin, job->end, job->partial);
+        return 0;
+    }
+};
+
+template<class Kernel>
+static void shrParallelCompare(const Kernel& kernel, unsigned int len, typename Kernel::Partial& result)
+{
+    unsigned int numChunks = (len < SHR_COMPARE_PARALLEL_MIN) ? 1 : shrGetNumHostThreads();
+    numChunks = MIN(numChunks, MAX(len / (SHR_COMPARE_PARALLEL_MIN / 4), 1u));
+    if (numChunks <= 1)
+    {
+        kernel(0, len, result);
+        return;
+    }
+
+    shrCompareJob<Kernel> jobs[SHR_COMPARE_MAX_THREADS];
+    #ifdef _WIN32
+        HANDLE threads[SHR_COMPARE_MAX_THREADS];
+    #else
+        pthread_t threads[SHR_COMPARE_MAX_THREADS];
+    #endif
+    bool started[SHR_COMPARE_MAX_THREADS];
+
+    for (unsigned int c = 0; c < numChunks; ++c)
+    {
+        jobs[c].kernel = &kernel;
+        jobs[c].begin = (unsigned int)(((unsigned long long)len * c) / numChunks);
+        jobs[c].end = (unsigned int)(((unsigned long long)len * (c + 1)) / numChunks);
+    }
+
+    // chunk 0 runs on the calling thread, a chunk whose thread could not be 
+    // started is run inline as well
+    for (unsigned int c = 1; c < numChunks; ++c)
+    {
+        #ifdef _WIN32
+            threads[c] = CreateThread(NULL, 0, shrCompareJob<Kernel>::entry, &jobs[c], 0, NULL);
+            started[c] = (threads[c] != NULL);
+        #else
+            started[c] = (pthread_create(&threads[c], NULL, shrCompareJob<Kernel>::entry, &jobs[c]) == 0);
+        #endif
+    }
+    kernel(jobs[0].begin, jobs[0].end, jobs[0].partial);
+    result = jobs[0].partial;
+
+    for (unsigned int c = 1; c < numChunks; ++c)
+    {
+        if (started[c])
+        {
+            #ifdef _WIN32
+                WaitForSingleObject(threads[c], INFINITE);
+                CloseHandle(threads[c]);
+            #else
+                pthread_join(threads[c], NULL);
+            #endif
+        }
+        else
+        {
+            kernel(jobs[c].begin, jobs[c].end, jobs[c].partial);
+        }
+        Kernel::merge(result, jobs[c].partial);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////// 
+// Host parallel loop
+//////////////////////////////////////////////////////////////////////////////
+struct shrParallelLoop
+{
+    shrParallelBody           pBody;
+    void*                     pUserData;
+    unsigned int              uiBegin;
+    unsigned int              uiEnd;
+    unsigned int              uiGrain;
+    unsigned int              uiNumBlocks;
+    volatile unsigned int     uiNextBlock;
+};
+
+static void shrRunParallelLoop(shrParallelLoop* loop)
+{
+    for (;;)
+    {
+        #ifdef _WIN32
+            unsigned int uiBlock = (unsigned int)InterlockedIncrement((volatile LONG*)&loop->uiNextBlock) - 1;
+        #else
+            unsigned int uiBlock = __sync_fetch_and_add(&loop->uiNextBlock, 1u);
+        #endif
+        if (uiBlock >= loop->uiNumBlocks)
+        {
+            return;
+        }
+
+        unsigned long long ulFirst = loop->uiBegin + (unsigned long long)uiBlock * loop->uiGrain;
+        unsigned long long ulLast = MIN(ulFirst + loop->uiGrain, (unsigned long long)loop->uiEnd);
+        loop->pBody((unsigned int)ulFirst, (unsigned int)ulLast, loop->pUserData);
+    }
+}
+
+#ifdef _WIN32
+    static DWORD WINAPI shrParallelLoopEntry(LPVOID arg)
+#else
+    static void* shrParallelLoopEntry(void* arg)
+#endif
+{
+    shrRunParallelLoop((shrParallelLoop*)arg);
+    return 0;
+}
+
+void shrParallelFor(unsigned int uiBegin, unsigned int uiEnd, unsigned int uiGrain, 
+                    shrParallelBody pBody, void* pUserData)
+{
+    if (uiEnd <= uiBegin)
+    {
+        return;
+    }
+
+    unsigned int uiLength = uiEnd - uiBegin;
+    unsigned int uiNumThreads = shrGetNumHostThreads();
+    if (uiGrain == 0)
+    {
+        uiGrain = MAX(uiLength / (4 * uiNumThreads), 1u);
+    }
+
+    shrParallelLoop loop;
+    loop.pBody = pBody;
+    loop.pUserData = pUserData;
+    loop.uiBegin = uiBegin;
+    loop.uiEnd = uiEnd;
+    loop.uiGrain = uiGrain;
+    loop.uiNumBlocks = (unsigned int)(((unsigned long long)uiLength + uiGrain - 1) / uiGrain);
+    loop.uiNextBlock = 0;
+    uiNumThreads = MIN(uiNumThreads, loop.uiNumBlocks);
+    if (uiNumThreads <= 1)
+    {
+        shrRunParallelLoop(&loop);
+        return;
+    }
+
+    // the calling thread works as well, blocks left by threads that could 
+    // not be started are picked up by the others
+    #ifdef _WIN32
+        HANDLE threads[SHR_COMPARE_MAX_THREADS];
+    #else
+        pthread_t threads[SHR_COMPARE_MAX_THREADS];
+    #endif
+    bool started[SHR_COMPARE_MAX_THREADS];
+    for (unsigned int t = 1; t < uiNumThreads; ++t)
+    {
+        #ifdef _WIN32
+            threads[t] = CreateThread(NULL, 0, shrParallelLoopEntry, &loop, 0, NULL);
+            started[t] = (threads[t] != NULL);
+        #else
+            started[t] = (pthread_create(&threads[t], NULL, shrParallelLoopEntry, &loop) == 0);
+        #endif
+    }
+    shrRunParallelLoop(&loop);
+
+    for (unsigned int t = 1; t < uiNumThreads; ++t)
+    {
+        if (started[t])
+        {
+            #ifdef _WIN32
+                WaitForSingleObject(threads[t], INFINITE);
+                CloseHandle(threads[t]);
+            #else
+                pthread_join(threads[t], NULL);
+            #endif
+        }
+    }
+}
+
+#ifdef SHR_USE_SSE2
+// Horizontal sum of four 32 bit counters
+static unsigned int shrSumEpi32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (unsigned int)_mm_cvtsi128_si32(v);
+}
+#endif
+
+// Counts elements whose difference T(reference - data) lies outside [-epsilon, epsilon]
+template<class T, class S>
+struct shrEpsilonCompareKernel
+{
+    typedef unsigned int Partial;
+
+    const T* reference;
+    const T* data;
+    S        epsilon;
+
+    void operator()(unsigned int begin, unsigned int end, Partial& errors) const
+    {
+        unsigned int count = 0;
+        unsigned int i = begin;
+        #ifdef SHR_USE_SSE2
+            count += simd(i, end);
+        #endif
+        for (; i < end; ++i) 
+        {
+            T diff = reference[i] - data[i];
+            count += !((diff <= epsilon) && (diff >= -epsilon));
+        }
+        errors = count;
+    }
+
+    // no vector path in general, specialized for float below
+    unsigned int simd(unsigned int&, unsigned int) const { return 0; }
+
+    static void merge(Partial& a, const Partial& b) { a += b; }
+};
+
+#ifdef SHR_USE_SSE2
+template<>
+inline unsigned int shrEpsilonCompareKernel<float, float>::simd(unsigned int& i, unsigned int end) const
+{
+    const __m128 posEps = _mm_set1_ps(epsilon);
+    const __m128 negEps = _mm_set1_ps(-epsilon);
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i count0 = _mm_setzero_si128();
+    __m128i count1 = _mm_setzero_si128();
+    for (; i + 8 <= end; i += 8) 
+    {
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(reference + i), _mm_loadu_ps(data + i));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(reference + i + 4), _mm_loadu_ps(data + i + 4));
+        __m128 ok0 = _mm_and_ps(_mm_cmple_ps(d0, posEps), _mm_cmpge_ps(d0, negEps));
+        __m128 ok1 = _mm_and_ps(_mm_cmple_ps(d1, posEps), _mm_cmpge_ps(d1, negEps));
+        count0 = _mm_add_epi32(count0, _mm_andnot_si128(_mm_castps_si128(ok0), one));
+        count1 = _mm_add_epi32(count1, _mm_andnot_si128(_mm_castps_si128(ok1), one));
+    }
+    return shrSumEpi32(_mm_add_epi32(count0, count1));
+}
+#endif
+
+// Counts elements with |float(reference) - float(data)| >= maxError
+template<class T>
+struct shrFloatDiffCompareKernel
+{
+    typedef unsigned int Partial;
+
+    const T* reference;
+    const T* data;
+    float    maxError;
+
+    void operator()(unsigned int begin, unsigned int end, Partial& errors) const
+    {
+        unsigned int count = 0;
+        unsigned int i = begin;
+        #ifdef SHR_USE_SSE2
+            count += simd(i, end);
+        #endif
+        for (; i < end; ++i) 
+        {
+            float diff = fabs((float)reference[i] - (float)data[i]);
+            count += !(diff < maxError);
+        }
+        errors = count;
+    }
+
+    unsigned int simd(unsigned int&, unsigned int) const { return 0; }
+
+    static void merge(Partial& a, const Partial& b) { a += b; }
+};
+
+#ifdef SHR_USE_SSE2
+template<>
+inline unsigned int shrFloatDiffCompareKernel<unsigned char>::simd(unsigned int& i, unsigned int end) const
+{
+    // the byte difference is an integer, so diff < maxError is the same as 
+    // diff <= limit for the largest integer limit below maxError
+    int limit = -1;
+    while ((limit < 255) && ((float)(limit + 1) < maxError))
+    {
+        ++limit;
+    }
+    if ((limit < 0) || (limit >= 255))
+    {
+        // every element fails or passes, leave it to the scalar loop
+        return 0;
+    }
+
+    const __m128i limitVec = _mm_set1_epi8((char)limit);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = _mm_setzero_si128();
+    while (i + 16 <= end) 
+    {
+        // per byte error counters, folded before they can overflow
+        __m128i bytes = _mm_setzero_si128();
+        unsigned int blockEnd = MIN(end, i + 255 * 16);
+        for (; i + 16 <= blockEnd; i += 16) 
+        {
+            __m128i r = _mm_loadu_si128((const __m128i*)(reference + i));
+            __m128i d = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i absDiff = _mm_or_si128(_mm_subs_epu8(r, d), _mm_subs_epu8(d, r));
+            __m128i within = _mm_cmpeq_epi8(_mm_max_epu8(absDiff, limitVec), limitVec);
+            // within is 0xFF (-1) for passing bytes, count the others
+            bytes = _mm_add_epi8(bytes, _mm_add_epi8(within, _mm_set1_epi8(1)));
+        }
+        total = _mm_add_epi64(total, _mm_sad_epu8(bytes, zero));
+    }
+    return (unsigned int)(_mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(total, total)));
+}
+#endif
+
+// Sums of squares for the L2-norm comparison
+struct shrL2Partial
+{
+    double error;
+    double ref;
+};
+
+struct shrL2CompareKernel
+{
+    typedef shrL2Partial Partial;
+
+    const float* reference;
+    const float* data;
+
+    void operator()(unsigned int begin, unsigned int end, Partial& sums) const
+    {
+        double error = 0.0;
+        double ref = 0.0;
+        unsigned int i = begin;
+        #ifdef SHR_USE_SSE2
+            __m128d error0 = _mm_setzero_pd(), error1 = _mm_setzero_pd();
+            __m128d ref0 = _mm_setzero_pd(), ref1 = _mm_setzero_pd();
+            for (; i + 4 <= end; i += 4) 
+            {
+                __m128 r = _mm_loadu_ps(reference + i);
+                __m128 diff = _mm_sub_ps(r, _mm_loadu_ps(data + i));
+                __m128d rLo = _mm_cvtps_pd(r);
+                __m128d rHi = _mm_cvtps_pd(_mm_movehl_ps(r, r));
+                __m128d dLo = _mm_cvtps_pd(diff);
+                __m128d dHi = _mm_cvtps_pd(_mm_movehl_ps(diff, diff));
+                error0 = _mm_add_pd(error0, _mm_mul_pd(dLo, dLo));
+                error1 = _mm_add_pd(error1, _mm_mul_pd(dHi, dHi));
+                ref0 = _mm_add_pd(ref0, _mm_mul_pd(rLo, rLo));
+                ref1 = _mm_add_pd(ref1, _mm_mul_pd(rHi, rHi));
+            }
+            double lanes[2];
+            _mm_storeu_pd(lanes, _mm_add_pd(error0, error1));
+            error = lanes[0] + lanes[1];
+            _mm_storeu_pd(lanes, _mm_add_pd(ref0, ref1));
+            ref = lanes[0] + lanes[1];
+        #endif
+        for (; i < end; ++i) 
+        {
+            double diff = (double)(reference[i] - data[i]);
+            error += diff * diff;
+            ref += (double)reference[i] * (double)reference[i];
+        }
+        sums.error = error;
+        sums.ref = ref;
+    }
+
+    static void merge(Partial& a, const Partial& b) 
+    { 
+        a.error += b.error; 
+        a.ref += b.ref; 
+    }
+};
+
+// Distance of two floats in units in the last place, 0xFFFFFFFF if either is NaN
+static unsigned int shrUlpDistance(float a, float b)
+{
+    if ((a != a) || (b != b))
+    {
+        return 0xFFFFFFFFu;
+    }
+    int ia, ib;
+    memcpy(&ia, &a, sizeof(int));
+    memcpy(&ib, &b, sizeof(int));
+    // map the sign-magnitude encoding onto a monotonic integer line
+    long long oa = (ia < 0) ? (long long)(int)0x80000000 - ia : ia;
+    long long ob = (ib < 0) ? (long long)(int)0x80000000 - ib : ib;
+    long long d = (oa > ob) ? oa - ob : ob - oa;
+    return (d > 0xFFFFFFFFLL) ? 0xFFFFFFFFu : (unsigned int)d;
+}
+
+// Full statistics for shrComparefStats
+struct shrStatsCompareKernel
+{
+    typedef shrCompareStats Partial;
+
+    const float* reference;
+    const float* data;
+    float        epsilon;
+
+    void operator()(unsigned int begin, unsigned int end, Partial& stats) const
+    {
+        memset(&stats, 0, sizeof(shrCompareStats));
+        stats.count = end - begin;
+        stats.maxErrorIndex = begin;
+
+        double error = 0.0;
+        double ref = 0.0;
+        for (unsigned int i = begin; i < end; ++i) 
+        {
+            float diff = reference[i] - data[i];
+            stats.errorCount += !((diff <= epsilon) && (diff >= -epsilon));
+
+            double absDiff = fabs((double)reference[i] - (double)data[i]);
+            if ((absDiff > stats.maxError) || (absDiff != absDiff))
+            {
+                if (stats.maxError == stats.maxError)
+                {
+                    stats.maxError = absDiff;
+                    stats.maxErrorIndex = i;
+                }
+            }
+            error += (double)diff * (double)diff;
+            ref += (double)reference[i] * (double)reference[i];
+
+            unsigned int ulp = shrUlpDistance(reference[i], data[i]);
+            unsigned int bucket = 0;
+            while ((ulp >> bucket) != 0 && (bucket < SHR_ULP_BUCKETS - 1))
+            {
+                ++bucket;
+            }
+            stats.ulpHistogram[bucket]++;
+            stats.maxUlp = MAX(stats.maxUlp, ulp);
+        }
+        stats.l2Error = error;
+        stats.l2Reference = ref;
+    }
+
+    static void merge(Partial& a, const Partial& b) 
+    {
+        // NaN is sticky and ties keep the lower index
+        if ((a.maxError == a.maxError) && ((b.maxError > a.maxError) || (b.maxError != b.maxError)))
+        {
+            a.maxError = b.maxError;
+            a.maxErrorIndex = b.maxErrorIndex;
+        }
+        a.count += b.count;
+        a.errorCount += b.errorCount;
+        a.l2Error += b.l2Error;
+        a.l2Reference += b.l2Reference;
+        a.maxUlp = MAX(a.maxUlp, b.maxUlp);
+        for (int k = 0; k < SHR_ULP_BUCKETS; ++k)
+        {
+            a.ulpHistogram[k] += b.ulpHistogram[k];
+        }
+    }
+};
+
 ////////////////////////////////////////////////////////////////////////////// 
 //! Compare two arrays of arbitrary type       
 //! @return shrTRUE if \a reference and \a data are identical, otherwise shrFALSE
@@ -1499,18 +3465,16 @@ compareData( const T* reference, const T* data, const unsigned int len,
 {
     ARGCHECK( epsilon >= 0);
 
-    bool result = true;
+    shrEpsilonCompareKernel<T, S> kernel = { reference, data, epsilon };
     unsigned int error_count = 0;
+    shrParallelCompare(kernel, len, error_count);
+    bool result = (error_count == 0);
 
-    for( unsigned int i = 0; i < len; ++i) {
+#ifdef _DEBUG
+    for( unsigned int i = 0; (error_count > 0) && (i < len); ++i) {
 
         T diff = reference[i] - data[i];
         bool comp = (diff <= epsilon) && (diff >= -epsilon);
-        result &= comp;
-
-        error_count += !comp;
-
-#ifdef _DEBUG
         if( ! comp) 
         {
             std::cerr << "ERROR, i = " << i << ",\t " 
@@ -1518,8 +3482,8 @@ compareData( const T* reference, const T* data, const unsigned int len,
                 << data[i] 
                 << " (reference / data)\n";
         }
-#endif
     }
+#endif
 
     if (threshold == 0.0f) {
         return (result) ? shrTRUE : shrFALSE;
@@ -1545,24 +3509,21 @@ compareDataAsFloat( const T* reference, const T* data, const unsigned int len,
 
     // If we set epsilon to be 0, let's set a minimum threshold
     float max_error = MAX( (float)epsilon, MIN_EPSILON_ERROR );
-    int error_count = 0;
-    bool result = true;
+    shrFloatDiffCompareKernel<T> kernel = { reference, data, max_error };
+    unsigned int count = 0;
+    shrParallelCompare(kernel, len, count);
+    int error_count = (int)count;
 
-    for( unsigned int i = 0; i < len; ++i) {
+#ifdef _DEBUG
+    for( unsigned int i = 0, reported = 0; (reported < (unsigned int)error_count) && (reported < 49) && (i < len); ++i) {
         float diff = fabs((float)reference[i] - (float)data[i]);
-        bool comp = (diff < max_error);
-        result &= comp;
-
-        if( ! comp) 
+        if( ! (diff < max_error)) 
         {
-            error_count++;
-#ifdef _DEBUG
-			if (error_count < 50) {
-                shrLog("\n    ERROR(epsilon=%4.3f), i=%d, (ref)0x%02x / (data)0x%02x / (diff)%d\n", max_error, i, reference[i], data[i], (unsigned int)diff);
-			}
-#endif
+            reported++;
+            shrLog("\n    ERROR(epsilon=%4.3f), i=%d, (ref)0x%02x / (data)0x%02x / (diff)%d\n", max_error, i, reference[i], data[i], (unsigned int)diff);
         }
     }
+#endif
     if (error_count) {
         shrLog("\n    Total # of errors = %d\n", error_count);
     }
@@ -1587,24 +3548,21 @@ compareDataAsFloatThreshold( const T* reference, const T* data, const unsigned i
 
     // If we set epsilon to be 0, let's set a minimum threshold
     float max_error = MAX( (float)epsilon, MIN_EPSILON_ERROR);
-    int error_count = 0;
-    bool result = true;
+    shrFloatDiffCompareKernel<T> kernel = { reference, data, max_error };
+    unsigned int count = 0;
+    shrParallelCompare(kernel, len, count);
+    int error_count = (int)count;
 
-    for( unsigned int i = 0; i < len; ++i) {
+#ifdef _DEBUG
+    for( unsigned int i = 0, reported = 0; (reported < (unsigned int)error_count) && (reported < 49) && (i < len); ++i) {
         float diff = fabs((float)reference[i] - (float)data[i]);
-        bool comp = (diff < max_error);
-        result &= comp;
-
-        if( ! comp) 
+        if( ! (diff < max_error)) 
         {
-            error_count++;
-#ifdef _DEBUG
-			if (error_count < 50) {
-                shrLog("\n    ERROR(epsilon=%4.3f), i=%d, (ref)0x%02x / (data)0x%02x / (diff)%d\n", max_error, i, reference[i], data[i], (unsigned int)diff);
-			}
-#endif
+            reported++;
+            shrLog("\n    ERROR(epsilon=%4.3f), i=%d, (ref)0x%02x / (data)0x%02x / (diff)%d\n", max_error, i, reference[i], data[i], (unsigned int)diff);
         }
     }
+#endif
 
     if (threshold == 0.0f) {
         if (error_count) {
@@ -1745,15 +3703,11 @@ shrBOOL shrCompareL2fe( const float* reference, const float* data,
 {
     ARGCHECK(epsilon >= 0);
 
-    float error = 0;
-    float ref = 0;
-
-    for( unsigned int i = 0; i < len; ++i) {
-
-        float diff = reference[i] - data[i];
-        error += diff * diff;
-        ref += reference[i] * reference[i];
-    }
+    shrL2CompareKernel kernel = { reference, data };
+    shrL2Partial sums = { 0.0, 0.0 };
+    shrParallelCompare(kernel, len, sums);
+    float error = (float)sums.error;
+    float ref = (float)sums.ref;
 
     float normRef = sqrtf(ref);
     if (fabs(ref) < 1e-7) {
@@ -1776,6 +3730,68 @@ shrBOOL shrCompareL2fe( const float* reference, const float* data,
     return result ? shrTRUE : shrFALSE;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//! Compare two float arrays with an epsilon tolerance and gather error statistics
+//! @return shrTRUE if all elements are within epsilon, otherwise shrFALSE
+//! @param reference  handle to the reference data / gold image
+//! @param data       handle to the computed data
+//! @param len        number of elements in reference and data
+//! @param epsilon    epsilon to use for the comparison
+//! @param stats      receives the error statistics
+////////////////////////////////////////////////////////////////////////////////
+shrBOOL shrComparefStats( const float* reference, const float* data,
+                const unsigned int len, const float epsilon, shrCompareStats* stats ) 
+{
+    ARGCHECK(epsilon >= 0);
+    ARGCHECK(NULL != stats);
+
+    shrStatsCompareKernel kernel = { reference, data, epsilon };
+    shrParallelCompare(kernel, len, *stats);
+
+    stats->l2Error = sqrt(stats->l2Error);
+    stats->l2Reference = sqrt(stats->l2Reference);
+    stats->relativeL2Error = (stats->l2Reference > 0.0) ? stats->l2Error / stats->l2Reference : 0.0;
+
+    return (stats->errorCount == 0) ? shrTRUE : shrFALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! Log the statistics gathered by shrComparefStats
+////////////////////////////////////////////////////////////////////////////////
+void shrLogCompareStats( const shrCompareStats* stats ) 
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+    shrLog("    Compared %u elements, %u outside epsilon\n", stats->count, stats->errorCount);
+    shrLog("    Max abs error %g at index %u, max ULP distance %u\n", 
+           stats->maxError, stats->maxErrorIndex, stats->maxUlp);
+    shrLog("    L2 error %g, reference L2 %g, relative L2 error %g\n", 
+           stats->l2Error, stats->l2Reference, stats->relativeL2Error);
+    shrLog("    ULP histogram:");
+    for (int k = 0; k < SHR_ULP_BUCKETS; ++k)
+    {
+        if (stats->ulpHistogram[k] == 0)
+        {
+            continue;
+        }
+        if (k == 0)
+        {
+            shrLog(" [0]=%u", stats->ulpHistogram[k]);
+        }
+        else if (k == SHR_ULP_BUCKETS - 1)
+        {
+            shrLog(" [>=%u]=%u", 1u << (k - 1), stats->ulpHistogram[k]);
+        }
+        else
+        {
+            shrLog(" [%u,%u)=%u", 1u << (k - 1), 1u << k, stats->ulpHistogram[k]);
+        }
+    }
+    shrLog("\n");
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //! Compare two PPM image files with an epsilon tolerance for equality
 //! @return shrTRUE if \a reference and \a data are identical, otherwise shrFALSE